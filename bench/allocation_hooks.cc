@@ -0,0 +1,130 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "bench_support.h"
+
+// Replaces the global allocation functions in order to count allocations and
+// track live heap size. Each block is prefixed with a header holding its
+// size, which keeps this independent of the platform allocator.
+
+using namespace au;
+
+static const size_t header_size = 16;
+
+static std::atomic<u64> allocation_count(0);
+static std::atomic<u64> live_bytes(0);
+static std::atomic<u64> peak_bytes(0);
+static std::atomic<u64> baseline_bytes(0);
+
+static void *allocate(const size_t size)
+{
+    auto ptr = static_cast<u8*>(std::malloc(size + header_size));
+    if (!ptr)
+        return nullptr;
+    *reinterpret_cast<size_t*>(ptr) = size;
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    const auto current
+        = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    auto peak = peak_bytes.load(std::memory_order_relaxed);
+    while (current > peak
+        && !peak_bytes.compare_exchange_weak(
+            peak, current, std::memory_order_relaxed))
+    {
+    }
+    return ptr + header_size;
+}
+
+static void deallocate(void *ptr)
+{
+    if (!ptr)
+        return;
+    const auto block = static_cast<u8*>(ptr) - header_size;
+    live_bytes.fetch_sub(
+        *reinterpret_cast<size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void *operator new(const size_t size)
+{
+    const auto ptr = allocate(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](const size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(const size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](const size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete(void *ptr, const size_t) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete[](void *ptr, const size_t) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    deallocate(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    deallocate(ptr);
+}
+
+void bench::reset_allocation_stats()
+{
+    allocation_count = 0;
+    baseline_bytes = live_bytes.load();
+    peak_bytes = baseline_bytes.load();
+}
+
+bench::AllocationStats bench::get_allocation_stats()
+{
+    bench::AllocationStats stats;
+    stats.count = allocation_count;
+    stats.peak_bytes = peak_bytes - baseline_bytes;
+    return stats;
+}
@@ -0,0 +1,273 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "bench_support.h"
+#include <chrono>
+#include <map>
+#include "algo/format.h"
+#include "algo/range.h"
+#include "algo/str.h"
+#include "err.h"
+#include "io/file_byte_stream.h"
+#include "memory_accounting.h"
+
+using namespace au;
+using namespace au::bench;
+
+static const std::string header
+    = "name\tbytes_in\tbytes_out\ttime\tallocations\tpeak_memory";
+
+static double to_megabytes(const double bytes)
+{
+    return bytes / 1024.0 / 1024.0;
+}
+
+BenchmarkResult bench::measure(
+    const std::string &name,
+    const size_t iterations,
+    const std::function<void(uoff_t &bytes_in, uoff_t &bytes_out)> run)
+{
+    BenchmarkResult result;
+    result.name = name;
+    result.bytes_in = 0;
+    result.bytes_out = 0;
+    result.time = 0;
+    result.allocations = 0;
+    result.peak_memory = 0;
+    for (const auto i : algo::range(std::max<size_t>(iterations, 1)))
+    {
+        uoff_t bytes_in = 0, bytes_out = 0;
+        reset_allocation_stats();
+        const auto start = std::chrono::steady_clock::now();
+        run(bytes_in, bytes_out);
+        const auto end = std::chrono::steady_clock::now();
+        const auto stats = get_allocation_stats();
+        const auto time = std::chrono::duration_cast<
+            std::chrono::nanoseconds>(end - start).count() / 1e9;
+        if (!i || time < result.time)
+            result.time = time;
+        result.bytes_in = bytes_in;
+        result.bytes_out = bytes_out;
+        result.allocations += stats.count;
+        result.peak_memory = std::max(result.peak_memory, stats.peak_bytes);
+    }
+    result.allocations /= std::max<size_t>(iterations, 1);
+    return result;
+}
+
+void bench::print_results(
+    const Logger &logger, const std::vector<BenchmarkResult> &results)
+{
+    logger.info(
+        "%-48s %10s %10s %10s %10s %12s %10s\n",
+        "Name", "In", "Out", "MB/s in", "MB/s out", "Allocations", "Peak");
+    for (const auto &result : results)
+    {
+        const auto time = std::max(result.time, 1e-9);
+        logger.info(
+            "%-48s %9.2fM %9.2fM %10.1f %10.1f %12.0f %9.2fM\n",
+            result.name.c_str(),
+            to_megabytes(result.bytes_in),
+            to_megabytes(result.bytes_out),
+            to_megabytes(result.bytes_in) / time,
+            to_megabytes(result.bytes_out) / time,
+            result.allocations,
+            to_megabytes(result.peak_memory));
+    }
+    logger.info(
+        "Process peak RSS: %.2fM\n", to_megabytes(memory::get_peak_rss()));
+}
+
+void bench::save_results(
+    const io::path &path, const std::vector<BenchmarkResult> &results)
+{
+    io::FileByteStream output_stream(path, io::FileMode::Write);
+    output_stream.write(header + "\n");
+    for (const auto &result : results)
+    {
+        output_stream.write(algo::format(
+            "%s\t%llu\t%llu\t%.9f\t%.1f\t%llu\n",
+            result.name.c_str(),
+            static_cast<unsigned long long>(result.bytes_in),
+            static_cast<unsigned long long>(result.bytes_out),
+            result.time,
+            result.allocations,
+            static_cast<unsigned long long>(result.peak_memory)));
+    }
+}
+
+std::vector<BenchmarkResult> bench::load_results(const io::path &path)
+{
+    io::FileByteStream input_stream(path, io::FileMode::Read);
+    std::vector<BenchmarkResult> results;
+    if (input_stream.read_line().str() != header)
+        throw err::CorruptDataError("Not a benchmark result file");
+    while (input_stream.left())
+    {
+        const auto line = input_stream.read_line().str();
+        if (line.empty())
+            continue;
+        const auto columns = algo::split(line, '\t', false);
+        if (columns.size() != 6)
+            throw err::CorruptDataError("Malformed line: " + line);
+        BenchmarkResult result;
+        result.name = columns[0];
+        result.bytes_in = std::stoull(columns[1]);
+        result.bytes_out = std::stoull(columns[2]);
+        result.time = std::stod(columns[3]);
+        result.allocations = std::stod(columns[4]);
+        result.peak_memory = std::stoull(columns[5]);
+        results.push_back(result);
+    }
+    return results;
+}
+
+bool bench::compare_results(
+    const Logger &logger,
+    const std::vector<BenchmarkResult> &baseline_results,
+    const std::vector<BenchmarkResult> &results,
+    const double threshold)
+{
+    std::map<std::string, const BenchmarkResult*> baseline_map;
+    for (const auto &result : baseline_results)
+        baseline_map[result.name] = &result;
+
+    bool success = true;
+    logger.info(
+        "%-48s %10s %10s %8s %12s %10s\n",
+        "Name", "Baseline", "Current", "Time", "Allocations", "Peak");
+    for (const auto &result : results)
+    {
+        const auto it = baseline_map.find(result.name);
+        if (it == baseline_map.end())
+        {
+            logger.info("%-48s (not in baseline)\n", result.name.c_str());
+            continue;
+        }
+        const auto &baseline = *it->second;
+        const auto ratio = baseline.time > 0
+            ? result.time / baseline.time - 1.0
+            : 0.0;
+        const auto regressed = ratio > threshold;
+        const auto message_type = regressed
+            ? Logger::MessageType::Warning
+            : Logger::MessageType::Info;
+        logger.log(
+            message_type,
+            "%-48s %8.3fms %8.3fms %+7.1f%% %+12.0f %+9.2fM%s\n",
+            result.name.c_str(),
+            baseline.time * 1000.0,
+            result.time * 1000.0,
+            ratio * 100.0,
+            result.allocations - baseline.allocations,
+            to_megabytes(static_cast<double>(result.peak_memory)
+                - static_cast<double>(baseline.peak_memory)),
+            regressed ? " REGRESSION" : "");
+        success &= !regressed;
+    }
+    return success;
+}
+
+int bench::run_benchmarks(
+    const std::vector<std::string> &arguments,
+    const std::function<void(ArgParser &)> register_extra_options,
+    const std::function<std::vector<BenchmarkResult>(
+        const Logger &logger,
+        const ArgParser &arg_parser,
+        const BenchmarkOptions &options)> run)
+{
+    Logger logger;
+    try
+    {
+        ArgParser arg_parser;
+        arg_parser.register_flag({"-h", "--help"})
+            ->set_description("Shows this message.");
+        arg_parser.register_switch({"-n", "--iterations"})
+            ->set_value_name("NUM")
+            ->set_description("Sets how many times each benchmark runs. "
+                "The fastest run is reported. Defaults to 3.");
+        arg_parser.register_switch({"--filter"})
+            ->set_value_name("TEXT")
+            ->set_description("Runs only benchmarks whose names contain "
+                "given text.");
+        arg_parser.register_switch({"--output"})
+            ->set_value_name("FILE")
+            ->set_description("Saves machine readable results to given file.");
+        arg_parser.register_switch({"--baseline"})
+            ->set_value_name("FILE")
+            ->set_description("Compares the results against a file saved "
+                "earlier with --output. Exits with an error if a benchmark "
+                "got slower by more than the threshold.");
+        arg_parser.register_switch({"--threshold"})
+            ->set_value_name("PERCENT")
+            ->set_description("Sets the regression threshold for --baseline. "
+                "Defaults to 5.");
+        register_extra_options(arg_parser);
+        arg_parser.parse(arguments);
+
+        if (arg_parser.has_flag("-h") || arg_parser.has_flag("--help"))
+        {
+            arg_parser.print_help(logger);
+            return 0;
+        }
+
+        BenchmarkOptions options;
+        if (arg_parser.has_switch("-n"))
+        {
+            options.iterations
+                = algo::from_string<int>(arg_parser.get_switch("-n"));
+        }
+        if (arg_parser.has_switch("--iterations"))
+        {
+            options.iterations
+                = algo::from_string<int>(arg_parser.get_switch("--iterations"));
+        }
+        if (arg_parser.has_switch("--filter"))
+            options.filter = arg_parser.get_switch("--filter");
+        if (arg_parser.has_switch("--output"))
+            options.output_path = arg_parser.get_switch("--output");
+        if (arg_parser.has_switch("--baseline"))
+            options.baseline_path = arg_parser.get_switch("--baseline");
+        if (arg_parser.has_switch("--threshold"))
+        {
+            options.threshold = algo::from_string<float>(
+                arg_parser.get_switch("--threshold")) / 100.0;
+        }
+
+        const auto results = run(logger, arg_parser, options);
+        print_results(logger, results);
+
+        if (!options.output_path.str().empty())
+            save_results(options.output_path, results);
+
+        if (!options.baseline_path.str().empty())
+        {
+            const auto baseline_results = load_results(options.baseline_path);
+            if (!compare_results(
+                logger, baseline_results, results, options.threshold))
+            {
+                return 1;
+            }
+        }
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        logger.err("Error: " + std::string(e.what()) + "\n");
+        return 1;
+    }
+}
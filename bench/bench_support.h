@@ -0,0 +1,94 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "arg_parser.h"
+#include "io/path.h"
+#include "logger.h"
+#include "types.h"
+
+namespace au {
+namespace bench {
+
+    struct AllocationStats final
+    {
+        u64 count;
+        u64 peak_bytes; // peak of live heap bytes since the last reset
+    };
+
+    // Implemented by global operator new / delete replacements, so they work
+    // only in executables that link bench/allocation_hooks.cc.
+    void reset_allocation_stats();
+    AllocationStats get_allocation_stats();
+
+    struct BenchmarkResult final
+    {
+        std::string name;
+        uoff_t bytes_in;  // per iteration
+        uoff_t bytes_out; // per iteration
+        double time;      // best iteration, in seconds
+        double allocations;    // per iteration
+        u64 peak_memory;  // peak of live heap bytes during one iteration
+    };
+
+    // Runs given function for given number of iterations and measures the
+    // fastest run. The function reports how many bytes it consumed and
+    // produced.
+    BenchmarkResult measure(
+        const std::string &name,
+        const size_t iterations,
+        const std::function<void(uoff_t &bytes_in, uoff_t &bytes_out)> run);
+
+    void print_results(
+        const Logger &logger, const std::vector<BenchmarkResult> &results);
+
+    // Results are stored as tab separated values, one benchmark per line.
+    void save_results(
+        const io::path &path, const std::vector<BenchmarkResult> &results);
+    std::vector<BenchmarkResult> load_results(const io::path &path);
+
+    // Prints relative differences against the baseline. Returns false if any
+    // benchmark got slower by more than given threshold (0.05 = 5%).
+    bool compare_results(
+        const Logger &logger,
+        const std::vector<BenchmarkResult> &baseline_results,
+        const std::vector<BenchmarkResult> &results,
+        const double threshold);
+
+    // Shared command line handling for the benchmark executables.
+    struct BenchmarkOptions final
+    {
+        size_t iterations = 3;
+        std::string filter;
+        io::path output_path;
+        io::path baseline_path;
+        double threshold = 0.05;
+    };
+
+    int run_benchmarks(
+        const std::vector<std::string> &arguments,
+        const std::function<void(ArgParser &)> register_extra_options,
+        const std::function<std::vector<BenchmarkResult>(
+            const Logger &logger,
+            const ArgParser &arg_parser,
+            const BenchmarkOptions &options)> run);
+
+} }
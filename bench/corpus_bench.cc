@@ -0,0 +1,192 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+// Runs every decoder on the sample files from the test suite corpus.
+// Sample files are expected in <corpus>/<vendor>/files/<format>/, which is
+// where the tests keep them, e.g. tests/dec/kirikiri/files/tlg/ for
+// kirikiri/tlg. Files that the decoder doesn't recognize (such as expected
+// test outputs) are skipped.
+
+#include <algorithm>
+#include "algo/str.h"
+#include "bench_support.h"
+#include "dec/idecoder_visitor.h"
+#include "dec/registry.h"
+#include "entry_point.h"
+#include "err.h"
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+#include "io/program_path.h"
+
+using namespace au;
+
+namespace
+{
+    class DecodingVisitor final : public dec::IDecoderVisitor
+    {
+    public:
+        DecodingVisitor(const Logger &logger, io::File &input_file);
+
+        void visit(const dec::BaseArchiveDecoder &decoder) override;
+        void visit(const dec::BaseFileDecoder &decoder) override;
+        void visit(const dec::BaseImageDecoder &decoder) override;
+        void visit(const dec::BaseAudioDecoder &decoder) override;
+
+        uoff_t bytes_out;
+
+    private:
+        const Logger &logger;
+        io::File &input_file;
+    };
+}
+
+DecodingVisitor::DecodingVisitor(const Logger &logger, io::File &input_file)
+    : bytes_out(0), logger(logger), input_file(input_file)
+{
+}
+
+void DecodingVisitor::visit(const dec::BaseArchiveDecoder &decoder)
+{
+    const auto meta = decoder.read_meta(logger, input_file);
+    for (const auto &entry : meta->entries)
+    {
+        const auto output_file
+            = decoder.read_file(logger, input_file, *meta, *entry);
+        if (output_file)
+            bytes_out += output_file->stream.size();
+    }
+}
+
+void DecodingVisitor::visit(const dec::BaseFileDecoder &decoder)
+{
+    const auto output_file = decoder.decode(logger, input_file);
+    if (output_file)
+        bytes_out += output_file->stream.size();
+}
+
+void DecodingVisitor::visit(const dec::BaseImageDecoder &decoder)
+{
+    const auto image = decoder.decode(logger, input_file);
+    bytes_out += image.width() * image.height() * 4;
+}
+
+void DecodingVisitor::visit(const dec::BaseAudioDecoder &decoder)
+{
+    const auto audio = decoder.decode(logger, input_file);
+    bytes_out += audio.samples.size();
+}
+
+static std::vector<io::path> get_sample_paths(
+    const io::path &corpus_dir, const std::string &decoder_name)
+{
+    const auto slash_pos = decoder_name.find('/');
+    if (slash_pos == std::string::npos)
+        return {};
+    const auto vendor = algo::replace_all(
+        decoder_name.substr(0, slash_pos), "-", "_");
+    const auto format = decoder_name.substr(slash_pos + 1);
+    const auto dir = corpus_dir / vendor / "files" / format;
+    std::vector<io::path> paths;
+    if (!io::is_directory(dir))
+        return paths;
+    for (const auto &path : io::recursive_directory_range(dir))
+        if (io::is_regular_file(path))
+            paths.push_back(path);
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+static std::vector<bench::BenchmarkResult> run(
+    const Logger &logger,
+    const ArgParser &arg_parser,
+    const bench::BenchmarkOptions &options)
+{
+    const io::path corpus_dir = arg_parser.has_switch("--corpus")
+        ? arg_parser.get_switch("--corpus")
+        : "tests/dec";
+    if (!io::is_directory(corpus_dir))
+    {
+        throw err::UsageError(
+            "Corpus directory " + corpus_dir.str() + " does not exist");
+    }
+
+    Logger dummy_logger;
+    dummy_logger.mute();
+
+    const auto &registry = dec::Registry::instance();
+    std::vector<bench::BenchmarkResult> results;
+    for (const auto &decoder_name : registry.get_decoder_names())
+    {
+        if (decoder_name.find(options.filter) == std::string::npos)
+            continue;
+
+        const auto decoder = registry.create_decoder(decoder_name);
+        std::vector<std::shared_ptr<io::File>> input_files;
+        for (const auto &path : get_sample_paths(corpus_dir, decoder_name))
+        {
+            // read the files into memory to leave disk I/O out of the picture
+            auto input_file = std::make_shared<io::File>(
+                path,
+                io::FileByteStream(path, io::FileMode::Read).read_to_eof());
+            if (decoder->is_recognized(*input_file))
+                input_files.push_back(input_file);
+        }
+        if (input_files.empty())
+            continue;
+
+        try
+        {
+            results.push_back(bench::measure(
+                decoder_name,
+                options.iterations,
+                [&](uoff_t &bytes_in, uoff_t &bytes_out)
+                {
+                    for (const auto &input_file : input_files)
+                    {
+                        DecodingVisitor visitor(dummy_logger, *input_file);
+                        decoder->accept(visitor);
+                        bytes_in += input_file->stream.size();
+                        bytes_out += visitor.bytes_out;
+                    }
+                }));
+            logger.info(".");
+            logger.flush();
+        }
+        catch (const std::exception &e)
+        {
+            logger.warn(
+                "\n%s: skipped (%s)\n", decoder_name.c_str(), e.what());
+        }
+    }
+    logger.info("\n");
+    return results;
+}
+
+ENTRY_POINT(
+    io::set_program_path_from_arg(arguments[0]);
+    arguments.erase(arguments.begin());
+    return bench::run_benchmarks(
+        arguments,
+        [](ArgParser &arg_parser)
+        {
+            arg_parser.register_switch({"--corpus"})
+                ->set_value_name("DIR")
+                ->set_description(
+                    "Sets the sample directory. Defaults to tests/dec.");
+        },
+        run);
+)
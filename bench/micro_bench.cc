@@ -0,0 +1,749 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+// Microbenchmarks of hot primitives from algo/, io/ and res/ on synthetic
+// inputs of several sizes.
+
+#include <algorithm>
+#include "algo/binary.h"
+#include "algo/crypt/crc32.h"
+#include "algo/crypt/md5.h"
+#include "algo/crypt/sha1.h"
+#include "algo/format.h"
+#include "algo/locale.h"
+#include "algo/pack/huffman.h"
+#include "algo/pack/lzss.h"
+#include "algo/pack/zlib.h"
+#include "algo/range.h"
+#include "bench_support.h"
+#include "enc/base_image_encoder.h"
+#include "enc/registry.h"
+#include "entry_point.h"
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+#include "io/lsb_bit_stream.h"
+#include "io/memory_byte_stream.h"
+#include "io/msb_bit_stream.h"
+#include "io/program_path.h"
+#include "res/image.h"
+#include "res/image_view.h"
+
+using namespace au;
+
+namespace
+{
+    struct Benchmark final
+    {
+        std::string name;
+        std::function<void(uoff_t &bytes_in, uoff_t &bytes_out)> run;
+    };
+
+    class Random final
+    {
+    public:
+        Random(const u32 seed) : state(seed)
+        {
+        }
+
+        u32 next()
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+
+    private:
+        u32 state;
+    };
+}
+
+static const size_t data_sizes[] = {4 * 1024, 64 * 1024, 1024 * 1024};
+static const size_t image_sizes[] = {64, 512, 2048};
+
+// Small inputs are processed several times per iteration so that each
+// iteration runs long enough to be measured reliably.
+static size_t get_repetitions(const size_t size)
+{
+    return std::max<size_t>(1, 1024 * 1024 / size);
+}
+
+static std::string get_size_name(const size_t size)
+{
+    return size >= 1024 * 1024
+        ? algo::format("%dM", static_cast<int>(size / 1024 / 1024))
+        : algo::format("%dK", static_cast<int>(size / 1024));
+}
+
+static bstr make_random_data(const size_t size)
+{
+    Random random(size);
+    bstr output(size);
+    for (auto &c : output)
+        c = random.next();
+    return output;
+}
+
+// Produces repetitive, text-like data that compresses reasonably well.
+static bstr make_compressible_data(const size_t size)
+{
+    Random random(size);
+    std::vector<bstr> words;
+    for (const auto i : algo::range(64))
+    {
+        bstr word(3 + random.next() % 8);
+        for (auto &c : word)
+            c = 'a' + random.next() % 26;
+        words.push_back(word);
+    }
+    bstr output;
+    output.reserve(size + 16);
+    while (output.size() < size)
+    {
+        output += words[random.next() % words.size()];
+        output += ' ';
+    }
+    output.resize(size);
+    return output;
+}
+
+static bstr make_sjis_data(const size_t size)
+{
+    Random random(size);
+    bstr output;
+    output.reserve(size + 2);
+    while (output.size() < size)
+    {
+        if (random.next() % 4)
+        {
+            // hiragana
+            output += static_cast<u8>(0x82);
+            output += static_cast<u8>(0x9F + random.next() % 0x52);
+        }
+        else
+            output += static_cast<u8>('a' + random.next() % 26);
+    }
+    output.resize(size & ~1);
+    return output;
+}
+
+static res::Image make_image(const size_t width, const size_t height)
+{
+    const auto data = make_random_data(width * height * 4);
+    res::Image image(width, height, data, res::PixelFormat::BGRA8888);
+    // make some pixels transparent so that overlays take both branches
+    for (auto &c : image)
+        c.a = c.a < 0x40 ? 0 : c.a;
+    return image;
+}
+
+// Produces gradients with a little noise, which compress more like actual
+// artwork than random pixels do.
+static res::Image make_smooth_image(const size_t width, const size_t height)
+{
+    Random random(width * height);
+    res::Image image(width, height);
+    for (const auto y : algo::range(height))
+    for (const auto x : algo::range(width))
+    {
+        auto &c = image.at(x, y);
+        c.r = x * 255 / width + random.next() % 4;
+        c.g = y * 255 / height + random.next() % 4;
+        c.b = (x + y) * 127 / (width + height);
+        c.a = x < static_cast<int>(width / 8) ? 0 : 0xFF;
+    }
+    return image;
+}
+
+// Balanced tree that maps 8-bit codes to themselves, serialized in the
+// format understood by HuffmanTree.
+static bstr make_huffman_tree_data()
+{
+    std::vector<bool> bits;
+    std::function<void(int, int)> write_node = [&](int depth, int value)
+    {
+        if (depth == 8)
+        {
+            bits.push_back(false);
+            for (const auto i : algo::range(8))
+                bits.push_back((value >> (7 - i)) & 1);
+            return;
+        }
+        bits.push_back(true);
+        write_node(depth + 1, value << 1);
+        write_node(depth + 1, (value << 1) | 1);
+    };
+    write_node(0, 0);
+    bstr output((bits.size() + 7) / 8);
+    for (const auto i : algo::range(bits.size()))
+        if (bits[i])
+            output[i >> 3] |= 0x80 >> (i & 7);
+    return output;
+}
+
+static void add_pack_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    algo::pack::BitwiseLzssSettings bitwise_settings;
+    bitwise_settings.position_bits = 12;
+    bitwise_settings.size_bits = 4;
+    bitwise_settings.min_match_size = 3;
+    bitwise_settings.initial_dictionary_pos = 0xFEE;
+    const algo::pack::BytewiseLzssSettings bytewise_settings;
+
+    for (const auto size : data_sizes)
+    {
+        const auto input = std::make_shared<bstr>(make_compressible_data(size));
+        const auto repetitions = get_repetitions(size);
+        const auto size_name = get_size_name(size);
+
+        const auto bitwise_input = std::make_shared<bstr>(
+            algo::pack::lzss_compress(*input, bitwise_settings));
+        benchmarks.push_back({
+            "lzss_decompress/bitwise/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    const auto output = algo::pack::lzss_decompress(
+                        *bitwise_input, size, bitwise_settings);
+                    bytes_in += bitwise_input->size();
+                    bytes_out += output.size();
+                }
+            }});
+
+        const auto bytewise_input = std::make_shared<bstr>(
+            algo::pack::lzss_compress(*input, bytewise_settings));
+        benchmarks.push_back({
+            "lzss_decompress/bytewise/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    const auto output = algo::pack::lzss_decompress(
+                        *bytewise_input, size, bytewise_settings);
+                    bytes_in += bytewise_input->size();
+                    bytes_out += output.size();
+                }
+            }});
+
+        const auto deflated_input = std::make_shared<bstr>(
+            algo::pack::zlib_deflate(
+                *input,
+                algo::pack::ZlibKind::PlainZlib,
+                algo::pack::CompressionLevel::Good));
+        benchmarks.push_back({
+            "zlib_inflate/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    const auto output = algo::pack::zlib_inflate(
+                        *deflated_input);
+                    bytes_in += deflated_input->size();
+                    bytes_out += output.size();
+                }
+            }});
+
+        const auto huffman_tree = std::make_shared<algo::pack::HuffmanTree>(
+            make_huffman_tree_data());
+        benchmarks.push_back({
+            "decode_huffman/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    const auto output = algo::pack::decode_huffman(
+                        *huffman_tree, *input, size);
+                    bytes_in += input->size();
+                    bytes_out += output.size();
+                }
+            }});
+    }
+}
+
+template<typename T> static void add_bit_stream_benchmark(
+    std::vector<Benchmark> &benchmarks, const std::string &name)
+{
+    for (const auto size : data_sizes)
+    {
+        const auto input = std::make_shared<bstr>(make_random_data(size));
+        const auto repetitions = get_repetitions(size);
+        benchmarks.push_back({
+            name + "/" + get_size_name(size),
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    T bit_stream(*input);
+                    u32 sum = 0;
+                    size_t bits = 1;
+                    while (bit_stream.left() >= 32)
+                    {
+                        sum += bit_stream.read(bits);
+                        bits = bits % 17 + 1;
+                    }
+                    bytes_in += input->size();
+                    bytes_out += sum & 1;
+                }
+            }});
+    }
+}
+
+static void add_pixel_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    using PF = res::PixelFormat;
+    static const std::vector<std::pair<PF, std::string>> formats
+    {
+        {PF::Gray8,     "Gray8"},
+        {PF::BGR555X,   "BGR555X"},
+        {PF::BGR565,    "BGR565"},
+        {PF::BGR888,    "BGR888"},
+        {PF::BGR888X,   "BGR888X"},
+        {PF::BGRA4444,  "BGRA4444"},
+        {PF::BGRA5551,  "BGRA5551"},
+        {PF::BGRA8888,  "BGRA8888"},
+        {PF::BGRnA4444, "BGRnA4444"},
+        {PF::BGRnA5551, "BGRnA5551"},
+        {PF::BGRnA8888, "BGRnA8888"},
+        {PF::RGB555X,   "RGB555X"},
+        {PF::RGB565,    "RGB565"},
+        {PF::RGB888,    "RGB888"},
+        {PF::RGB888X,   "RGB888X"},
+        {PF::RGBA4444,  "RGBA4444"},
+        {PF::RGBA5551,  "RGBA5551"},
+        {PF::RGBA8888,  "RGBA8888"},
+        {PF::RGBnA4444, "RGBnA4444"},
+        {PF::RGBnA5551, "RGBnA5551"},
+        {PF::RGBnA8888, "RGBnA8888"},
+    };
+
+    for (const auto &format : formats)
+    for (const auto size : image_sizes)
+    {
+        const auto fmt = format.first;
+        const auto pixel_count = size * size;
+        const auto input = std::make_shared<bstr>(make_random_data(
+            pixel_count * res::pixel_format_to_bpp(fmt)));
+        const auto repetitions = get_repetitions(input->size());
+        benchmarks.push_back({
+            algo::format(
+                "read_pixels/%s/%dx%d",
+                format.second.c_str(),
+                static_cast<int>(size),
+                static_cast<int>(size)),
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                std::vector<res::Pixel> output(pixel_count);
+                for (const auto i : algo::range(repetitions))
+                {
+                    res::read_pixels(input->get<const u8>(), output, fmt);
+                    bytes_in += input->size();
+                    bytes_out += output.size() * 4;
+                }
+            }});
+    }
+
+    // Each kernel separately, so that the vectorized ones can be compared
+    // with the scalar fallback.
+    static const std::vector<std::pair<res::PixelKernel, std::string>> kernels
+    {
+        {res::PixelKernel::Scalar, "scalar"},
+        {res::PixelKernel::Sse2,   "sse2"},
+        {res::PixelKernel::Avx2,   "avx2"},
+    };
+    const auto supported_kernels = res::get_supported_pixel_kernels();
+    std::vector<std::pair<res::PixelKernel, std::string>> available_kernels;
+    for (const auto &kernel : kernels)
+    {
+        if (std::find(
+            supported_kernels.begin(),
+            supported_kernels.end(),
+            kernel.first) != supported_kernels.end())
+        {
+            available_kernels.push_back(kernel);
+        }
+    }
+
+    const auto size = image_sizes[2];
+    const auto pixel_count = size * size;
+    for (const auto &format : formats)
+    for (const auto &kernel : available_kernels)
+    {
+        const auto fmt = format.first;
+        const auto input = std::make_shared<bstr>(make_random_data(
+            pixel_count * res::pixel_format_to_bpp(fmt)));
+        benchmarks.push_back({
+            algo::format(
+                "read_pixels/%s/%s/%dx%d",
+                format.second.c_str(),
+                kernel.second.c_str(),
+                static_cast<int>(size),
+                static_cast<int>(size)),
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                std::vector<res::Pixel> output(pixel_count);
+                res::read_pixels(
+                    input->get<const u8>(), output, fmt, kernel.first);
+                bytes_in += input->size();
+                bytes_out += output.size() * 4;
+            }});
+    }
+
+    const auto indices = std::make_shared<bstr>(make_random_data(pixel_count));
+    const auto colors = std::make_shared<std::vector<res::Pixel>>(256);
+    for (const auto &kernel : available_kernels)
+    {
+        benchmarks.push_back({
+            algo::format(
+                "read_indexed_pixels/%s/%dx%d",
+                kernel.second.c_str(),
+                static_cast<int>(size),
+                static_cast<int>(size)),
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                std::vector<res::Pixel> output(pixel_count);
+                res::read_indexed_pixels(
+                    indices->get<const u8>(),
+                    output,
+                    colors->data(),
+                    kernel.first);
+                bytes_in += indices->size();
+                bytes_out += output.size() * 4;
+            }});
+    }
+}
+
+static void add_image_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    // Layered image archives compose and flip images of up to 4K.
+    for (const auto size : {image_sizes[0], image_sizes[1], image_sizes[2],
+        static_cast<size_t>(4096)})
+    {
+        const auto size_name = algo::format(
+            "%dx%d", static_cast<int>(size), static_cast<int>(size));
+        const auto image = std::make_shared<res::Image>(make_image(size, size));
+        const auto image_size = size * size * 4;
+        const auto repetitions = get_repetitions(image_size);
+
+        const auto indices = std::make_shared<bstr>(
+            make_random_data(size * size));
+        const auto palette = std::make_shared<res::Palette>(
+            256, make_random_data(256 * 4), res::PixelFormat::BGRA8888);
+        benchmarks.push_back({
+            "Image::expand_palette/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    // images keep the indices until the pixels are needed
+                    res::Image output(size, size, *indices, *palette);
+                    output.begin();
+                    bytes_in += indices->size();
+                    bytes_out += image_size;
+                }
+            }});
+
+        static const std::vector<std::pair<
+            std::string, std::function<void(res::Image &)>>> transforms
+        {
+            {"flip_vertically", [](res::Image &i) { i.flip_vertically(); }},
+            {"flip_horizontally",
+                [](res::Image &i) { i.flip_horizontally(); }},
+            {"invert", [](res::Image &i) { i.invert(); }},
+        };
+        for (const auto &transform : transforms)
+        {
+            const auto &run = transform.second;
+            benchmarks.push_back({
+                "Image::" + transform.first + "/" + size_name,
+                [=](uoff_t &bytes_in, uoff_t &bytes_out)
+                {
+                    for (const auto i : algo::range(repetitions))
+                    {
+                        run(*image);
+                        bytes_in += image_size;
+                        bytes_out += image_size;
+                    }
+                }});
+        }
+
+        static const std::vector<std::pair<
+            res::Image::OverlayKind, std::string>> overlay_kinds
+        {
+            {res::Image::OverlayKind::OverwriteAll, "OverwriteAll"},
+            {res::Image::OverlayKind::OverwriteNonTransparent,
+                "OverwriteNonTransparent"},
+            {res::Image::OverlayKind::AddSimple, "AddSimple"},
+        };
+        const auto other_image = std::make_shared<res::Image>(
+            make_image(size, size));
+        benchmarks.push_back({
+            "Image::apply_mask/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    image->apply_mask(*other_image);
+                    bytes_in += image_size * 2;
+                    bytes_out += image_size;
+                }
+            }});
+        for (const auto &overlay_kind : overlay_kinds)
+        {
+            benchmarks.push_back({
+                "Image::overlay/" + overlay_kind.second + "/" + size_name,
+                [=](uoff_t &bytes_in, uoff_t &bytes_out)
+                {
+                    for (const auto i : algo::range(repetitions))
+                    {
+                        image->overlay(
+                            *other_image, 1, 1, overlay_kind.first);
+                        bytes_in += image_size;
+                        bytes_out += image_size;
+                    }
+                }});
+        }
+    }
+}
+
+static void add_image_encoder_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    const auto &registry = enc::Registry::instance();
+    for (const auto size : image_sizes)
+    {
+        const auto size_name = algo::format(
+            "%dx%d", static_cast<int>(size), static_cast<int>(size));
+        const auto image = std::make_shared<res::Image>(
+            make_smooth_image(size, size));
+        const auto image_size = size * size * 4;
+        const auto repetitions = get_repetitions(image_size);
+        for (const auto &format : registry.get_image_encoder_names())
+        {
+            const std::shared_ptr<const enc::BaseImageEncoder> encoder
+                = registry.create_image_encoder(format);
+            benchmarks.push_back({
+                "encode/" + format + "/" + size_name,
+                [=](uoff_t &bytes_in, uoff_t &bytes_out)
+                {
+                    Logger dummy_logger;
+                    dummy_logger.mute();
+                    for (const auto i : algo::range(repetitions))
+                    {
+                        const auto output_file = encoder->encode(
+                            dummy_logger, *image, "bench.dat");
+                        bytes_in += image_size;
+                        bytes_out += output_file->stream.size();
+                    }
+                }});
+
+            // A bottom-up image with a separate alpha plane, as many
+            // decoders produce, read through a view instead of being
+            // flipped and masked first.
+            if (size != image_sizes[2])
+                continue;
+            benchmarks.push_back({
+                "encode/" + format + "/flipped_masked_view/" + size_name,
+                [=](uoff_t &bytes_in, uoff_t &bytes_out)
+                {
+                    Logger dummy_logger;
+                    dummy_logger.mute();
+                    res::ImageView view(*image);
+                    view.flip_vertically().apply_mask(*image);
+                    const auto output_file = encoder->encode(
+                        dummy_logger, view, "bench.dat");
+                    bytes_in += image_size;
+                    bytes_out += output_file->stream.size();
+                }});
+        }
+    }
+}
+
+static void add_misc_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    for (const auto size : data_sizes)
+    {
+        const auto input = std::make_shared<bstr>(make_random_data(size));
+        const auto repetitions = get_repetitions(size);
+        const auto size_name = get_size_name(size);
+
+        const auto key = std::make_shared<bstr>(make_random_data(17));
+        benchmarks.push_back({
+            "unxor/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    const auto output = algo::unxor(*input, *key);
+                    bytes_in += input->size();
+                    bytes_out += output.size();
+                }
+            }});
+
+        benchmarks.push_back({
+            "crc32/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    bytes_out += algo::crypt::crc32(*input) & 1;
+                    bytes_in += input->size();
+                }
+            }});
+
+        benchmarks.push_back({
+            "md5/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    bytes_out += algo::crypt::md5(*input).size();
+                    bytes_in += input->size();
+                }
+            }});
+
+        benchmarks.push_back({
+            "sha1/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    bytes_out += algo::crypt::sha1(*input).size();
+                    bytes_in += input->size();
+                }
+            }});
+
+        const auto sjis_input = std::make_shared<bstr>(make_sjis_data(size));
+        benchmarks.push_back({
+            "sjis_to_utf8/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                for (const auto i : algo::range(repetitions))
+                {
+                    const auto output = algo::sjis_to_utf8(*sjis_input);
+                    bytes_in += sjis_input->size();
+                    bytes_out += output.size();
+                }
+            }});
+    }
+}
+
+static void read_typed_values(
+    io::BaseByteStream &input_stream, uoff_t &bytes_in, uoff_t &bytes_out)
+{
+    u32 sum = 0;
+    input_stream.seek(0);
+    while (input_stream.left() >= 15)
+    {
+        sum += input_stream.read<u8>();
+        sum += input_stream.read_le<u16>();
+        sum += input_stream.read_le<u32>();
+        sum += input_stream.read_be<u32>();
+        sum += input_stream.read_le<u32>();
+    }
+    bytes_in += input_stream.pos();
+    bytes_out += sum & 1;
+}
+
+static void add_byte_stream_benchmarks(
+    std::vector<Benchmark> &benchmarks, const io::path &temp_dir)
+{
+    for (const auto size : data_sizes)
+    {
+        const auto input = std::make_shared<bstr>(make_random_data(size));
+        const auto repetitions = get_repetitions(size);
+        const auto size_name = get_size_name(size);
+
+        benchmarks.push_back({
+            "MemoryByteStream/typed_reads/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                io::MemoryByteStream input_stream(*input);
+                for (const auto i : algo::range(repetitions))
+                    read_typed_values(input_stream, bytes_in, bytes_out);
+            }});
+
+        const auto path = temp_dir / ("au_bench_" + size_name + ".tmp");
+        benchmarks.push_back({
+            "FileByteStream/typed_reads/" + size_name,
+            [=](uoff_t &bytes_in, uoff_t &bytes_out)
+            {
+                if (!io::exists(path))
+                    io::FileByteStream(path, io::FileMode::Write).write(*input);
+                io::FileByteStream input_stream(path, io::FileMode::Read);
+                for (const auto i : algo::range(repetitions))
+                    read_typed_values(input_stream, bytes_in, bytes_out);
+            }});
+    }
+}
+
+static std::vector<bench::BenchmarkResult> run(
+    const Logger &logger,
+    const ArgParser &arg_parser,
+    const bench::BenchmarkOptions &options)
+{
+    const io::path temp_dir = arg_parser.has_switch("--temp-dir")
+        ? arg_parser.get_switch("--temp-dir")
+        : ".";
+
+    std::vector<Benchmark> benchmarks;
+    add_pack_benchmarks(benchmarks);
+    add_bit_stream_benchmark<io::MsbBitStream>(
+        benchmarks, "MsbBitStream::read");
+    add_bit_stream_benchmark<io::LsbBitStream>(
+        benchmarks, "LsbBitStream::read");
+    add_pixel_benchmarks(benchmarks);
+    add_image_benchmarks(benchmarks);
+    add_image_encoder_benchmarks(benchmarks);
+    add_misc_benchmarks(benchmarks);
+    add_byte_stream_benchmarks(benchmarks, temp_dir);
+
+    std::vector<bench::BenchmarkResult> results;
+    for (const auto &benchmark : benchmarks)
+    {
+        if (benchmark.name.find(options.filter) == std::string::npos)
+            continue;
+        results.push_back(bench::measure(
+            benchmark.name, options.iterations, benchmark.run));
+        logger.info(".");
+        logger.flush();
+    }
+    logger.info("\n");
+
+    for (const auto size : data_sizes)
+    {
+        const auto path
+            = temp_dir / ("au_bench_" + get_size_name(size) + ".tmp");
+        if (io::exists(path))
+            io::remove(path);
+    }
+    return results;
+}
+
+ENTRY_POINT(
+    io::set_program_path_from_arg(arguments[0]);
+    arguments.erase(arguments.begin());
+    return bench::run_benchmarks(
+        arguments,
+        [](ArgParser &arg_parser)
+        {
+            arg_parser.register_switch({"--temp-dir"})
+                ->set_value_name("DIR")
+                ->set_description("Sets where to put temporary files for "
+                    "file stream benchmarks. Defaults to current directory.");
+        },
+        run);
+)
@@ -20,6 +20,9 @@
 #include <vector>
 #include "algo/range.h"
 #include "err.h"
+#if AU_MEMORY_ACCOUNTING
+    #include "memory_accounting.h"
+#endif
 
 namespace au {
 namespace algo {
@@ -28,23 +31,70 @@ namespace algo {
     {
     public:
         Grid(const size_t width, const size_t height)
-            : content(width * height), _width(width), _height(height)
+            :
+                content(width * height),
+                _width(width),
+                _height(height)
         {
             if (!width || !height)
                 throw err::BadDataSizeError();
+            update_content_charge();
         }
 
-        Grid(const Grid &other) : Grid(other.width(), other.height())
+        Grid(const Grid &other)
+            :
+                content(other.content),
+                _width(other._width),
+                _height(other._height)
         {
-            for (const auto y : algo::range(_height))
-            for (const auto x : algo::range(_width))
-                at(x, y) = other.at(x, y);
+            update_content_charge();
+        }
+
+        Grid(Grid &&other)
+            :
+                content(std::move(other.content)),
+                _width(other._width),
+                _height(other._height)
+        {
+            #if AU_MEMORY_ACCOUNTING
+                content_charge = std::move(other.content_charge);
+            #endif
+            other.content.clear();
+            other._width = 0;
+            other._height = 0;
         }
 
         virtual ~Grid()
         {
         }
 
+        Grid &operator =(const Grid &other)
+        {
+            if (this == &other)
+                return *this;
+            content = other.content;
+            _width = other._width;
+            _height = other._height;
+            update_content_charge();
+            return *this;
+        }
+
+        Grid &operator =(Grid &&other)
+        {
+            if (this == &other)
+                return *this;
+            content = std::move(other.content);
+            #if AU_MEMORY_ACCOUNTING
+                content_charge = std::move(other.content_charge);
+            #endif
+            _width = other._width;
+            _height = other._height;
+            other.content.clear();
+            other._width = 0;
+            other._height = 0;
+            return *this;
+        }
+
         size_t width() const
         {
             return _width;
@@ -86,7 +136,34 @@ namespace algo {
         }
 
     protected:
-        std::vector<T> content;
+        // Takes over the given contents, which derived classes may leave
+        // empty and fill in later.
+        Grid(std::vector<T> &&content, const size_t width, const size_t height)
+            :
+                content(std::move(content)),
+                _width(width),
+                _height(height)
+        {
+            if (!width || !height)
+                throw err::BadDataSizeError();
+            update_content_charge();
+        }
+
+        // Charges the contents to the current memory account after they
+        // were resized.
+        void update_content_charge() const
+        {
+            #if AU_MEMORY_ACCOUNTING
+                content_charge.set(content.size() * sizeof(T));
+            #endif
+        }
+
+        // Mutable so that derived classes can fill the contents in on the
+        // first read.
+        mutable std::vector<T> content;
+        #if AU_MEMORY_ACCOUNTING
+            mutable memory::Charge content_charge;
+        #endif
         size_t _width, _height;
     };
 
@@ -0,0 +1,110 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace au {
+namespace algo {
+
+    // Immutable lookup table that maps name hashes back to the names, for
+    // archives that store only the hashes. Entries are kept in one array
+    // sorted by hash, so lookups are binary searches and the index can be
+    // shared between threads without locking.
+    template<typename THash, typename TName = std::string>
+        class HashNameIndex final
+    {
+    public:
+        using Entry = std::pair<THash, TName>;
+        using const_iterator = typename std::vector<Entry>::const_iterator;
+
+        HashNameIndex()
+        {
+        }
+
+        // If several names share a hash, the one that comes last wins.
+        template<typename TNames, typename THashFunc> HashNameIndex(
+            const TNames &names, const THashFunc &hash_func)
+        {
+            for (const auto &name : names)
+                entries.push_back(Entry(hash_func(name), name));
+            std::stable_sort(
+                entries.begin(),
+                entries.end(),
+                [](const Entry &a, const Entry &b)
+                {
+                    return a.first < b.first;
+                });
+
+            auto out = entries.begin();
+            for (auto it = entries.begin(); it != entries.end(); ++it)
+            {
+                const auto next = it + 1;
+                if (next != entries.end() && next->first == it->first)
+                    continue;
+                if (out != it)
+                    *out = std::move(*it);
+                ++out;
+            }
+            entries.erase(out, entries.end());
+            entries.shrink_to_fit();
+        }
+
+        const TName *find(const THash hash) const
+        {
+            const auto it = std::lower_bound(
+                entries.begin(),
+                entries.end(),
+                hash,
+                [](const Entry &entry, const THash value)
+                {
+                    return entry.first < value;
+                });
+            if (it == entries.end() || it->first != hash)
+                return nullptr;
+            return &it->second;
+        }
+
+        size_t size() const
+        {
+            return entries.size();
+        }
+
+        bool empty() const
+        {
+            return entries.empty();
+        }
+
+        const_iterator begin() const
+        {
+            return entries.begin();
+        }
+
+        const_iterator end() const
+        {
+            return entries.end();
+        }
+
+    private:
+        std::vector<Entry> entries;
+    };
+
+} }
@@ -54,7 +54,7 @@ bstr algo::pack::decode_huffman(
     const size_t target_size)
 {
     bstr output;
-    output.resize(target_size);
+    output.reserve(target_size);
     io::MsbBitStream input_stream(input);
     while (output.size() < target_size && input_stream.left())
     {
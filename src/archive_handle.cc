@@ -0,0 +1,361 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "archive_handle.h"
+#include <set>
+#include <unordered_map>
+#include "algo/format.h"
+#include "algo/naming_strategies.h"
+#include "algo/range.h"
+#include "arg_parser.h"
+#include "dec/idecoder_visitor.h"
+#include "enc/base_image_encoder.h"
+#include "enc/microsoft/wav_audio_encoder.h"
+#include "enc/registry.h"
+#include "err.h"
+#include "flow/vfs_bridge.h"
+
+using namespace au;
+
+static const size_t max_depth = 10;
+
+namespace
+{
+    // Runs a single recognized decoder on an entry, leaving output_file
+    // empty if the options don't enable decoders of its kind.
+    class EntryDecoder final : public dec::IDecoderVisitor
+    {
+    public:
+        EntryDecoder(
+            const Logger &logger,
+            const ArchiveReadOptions &options,
+            io::File &input_file);
+
+        void visit(const dec::BaseArchiveDecoder &decoder) override;
+        void visit(const dec::BaseFileDecoder &decoder) override;
+        void visit(const dec::BaseImageDecoder &decoder) override;
+        void visit(const dec::BaseAudioDecoder &decoder) override;
+
+        std::unique_ptr<io::File> output_file;
+
+    private:
+        const Logger &logger;
+        const ArchiveReadOptions &options;
+        io::File &input_file;
+    };
+}
+
+EntryDecoder::EntryDecoder(
+    const Logger &logger,
+    const ArchiveReadOptions &options,
+    io::File &input_file) :
+        logger(logger),
+        options(options),
+        input_file(input_file)
+{
+}
+
+void EntryDecoder::visit(const dec::BaseArchiveDecoder &decoder)
+{
+    // nested archives are returned as they are
+}
+
+void EntryDecoder::visit(const dec::BaseFileDecoder &decoder)
+{
+    if (options.enable_nested_decoding)
+        output_file = decoder.decode(logger, input_file);
+}
+
+void EntryDecoder::visit(const dec::BaseImageDecoder &decoder)
+{
+    if (!options.enable_conversion)
+        return;
+    const auto image = decoder.decode(logger, input_file);
+    output_file = enc::Registry::instance()
+        .create_image_encoder(options.image_format)
+        ->encode(logger, image, input_file.path);
+}
+
+void EntryDecoder::visit(const dec::BaseAudioDecoder &decoder)
+{
+    if (!options.enable_conversion)
+        return;
+    const auto audio = decoder.decode(logger, input_file);
+    output_file = enc::microsoft::WavAudioEncoder().encode(
+        logger, audio, input_file.path);
+}
+
+static void configure_decoder(
+    const dec::IDecoder &decoder, const std::vector<std::string> &arguments)
+{
+    ArgParser arg_parser;
+    const auto decorators = decoder.get_arg_parser_decorators();
+    for (const auto &decorator : decorators)
+        decorator.register_cli_options(arg_parser);
+    arg_parser.parse(arguments);
+    for (const auto &decorator : decorators)
+        decorator.parse_cli_options(arg_parser);
+}
+
+// Returns nullptr unless exactly one of the decoders recognizes the file.
+static std::shared_ptr<dec::IDecoder> recognize(
+    const dec::Registry &registry,
+    const std::set<std::string> &decoder_names,
+    io::File &input_file,
+    std::string &decoder_name)
+{
+    std::shared_ptr<dec::IDecoder> matching_decoder;
+    for (const auto &name : decoder_names)
+    {
+        auto decoder = registry.create_decoder(name);
+        if (!decoder->is_recognized(input_file))
+            continue;
+        if (matching_decoder)
+            return nullptr;
+        matching_decoder = decoder;
+        decoder_name = name;
+    }
+    return matching_decoder;
+}
+
+// Passes the file through recognized decoders for as long as one of them
+// applies, the same way the unpacker does for nested files: the output of
+// each decoder is checked against its own linked decoders along with the
+// ones the decoder was picked from, unless these were picked by the user.
+static std::unique_ptr<io::File> decode_nested(
+    const Logger &logger,
+    const dec::Registry &registry,
+    std::set<std::string> decoder_names,
+    const bool user_picked_decoder_names,
+    const std::vector<std::string> &decoder_arguments,
+    const ArchiveReadOptions &options,
+    std::unique_ptr<io::File> output_file)
+{
+    if (!options.enable_nested_decoding && !options.enable_conversion)
+        return output_file;
+
+    for (const auto depth : algo::range(max_depth))
+    {
+        std::string nested_decoder_name;
+        const auto nested_decoder = recognize(
+            registry, decoder_names, *output_file, nested_decoder_name);
+        if (!nested_decoder)
+            break;
+
+        // images the nested decoders build themselves follow the format
+        // picked for this read, like the ones converted below
+        auto nested_arguments = decoder_arguments;
+        nested_arguments.push_back("--image-format=" + options.image_format);
+        configure_decoder(*nested_decoder, nested_arguments);
+        EntryDecoder entry_decoder(logger, options, *output_file);
+        nested_decoder->accept(entry_decoder);
+        if (!entry_decoder.output_file)
+            break;
+
+        entry_decoder.output_file->path = algo::apply_naming_strategy(
+            nested_decoder->naming_strategy(),
+            output_file->path,
+            entry_decoder.output_file->path);
+        output_file = std::move(entry_decoder.output_file);
+
+        auto linked_decoder_names
+            = registry.get_linked_decoder_names(*nested_decoder);
+        if (depth > 0 || !user_picked_decoder_names)
+        {
+            linked_decoder_names.insert(
+                decoder_names.begin(), decoder_names.end());
+        }
+        decoder_names = std::move(linked_decoder_names);
+    }
+    return output_file;
+}
+
+ArchiveReadOptions::ArchiveReadOptions() :
+    enable_nested_decoding(false),
+    enable_conversion(false),
+    image_format("png")
+{
+}
+
+struct ArchiveHandle::Priv final
+{
+    Priv(
+        const std::shared_ptr<io::File> input_file,
+        const std::string &decoder_name,
+        const std::vector<std::string> &decoder_arguments,
+        const dec::Registry &registry);
+
+    const dec::Registry &registry;
+    const std::vector<std::string> decoder_arguments;
+    Logger logger;
+    std::shared_ptr<io::File> input_file;
+    std::string decoder_name;
+    std::shared_ptr<const dec::BaseArchiveDecoder> decoder;
+    std::shared_ptr<dec::ArchiveMeta> meta;
+    std::unordered_map<std::string, const dec::ArchiveEntry*> entries;
+    std::set<std::string> linked_decoder_names;
+    std::unique_ptr<flow::VirtualFileSystemBridge> vfs_bridge;
+};
+
+ArchiveHandle::Priv::Priv(
+    const std::shared_ptr<io::File> input_file,
+    const std::string &decoder_name,
+    const std::vector<std::string> &decoder_arguments,
+    const dec::Registry &registry) :
+        registry(registry),
+        decoder_arguments(decoder_arguments),
+        input_file(input_file)
+{
+    logger.mute();
+
+    std::set<std::string> decoders_to_check;
+    if (decoder_name.empty())
+    {
+        for (const auto &name : registry.get_decoder_names())
+            decoders_to_check.insert(name);
+    }
+    else
+    {
+        if (!registry.has_decoder(decoder_name))
+        {
+            throw err::UsageError(algo::format(
+                "Unknown decoder: %s", decoder_name.c_str()));
+        }
+        decoders_to_check.insert(decoder_name);
+    }
+
+    // non-archive decoders shouldn't make the recognition ambiguous
+    std::set<std::string> archive_decoders_to_check;
+    for (const auto &name : decoders_to_check)
+    {
+        const auto candidate = registry.create_decoder(name);
+        if (std::dynamic_pointer_cast<const dec::BaseArchiveDecoder>(candidate))
+            archive_decoders_to_check.insert(name);
+    }
+
+    decoder = std::static_pointer_cast<const dec::BaseArchiveDecoder>(
+        recognize(
+            registry,
+            archive_decoders_to_check,
+            *input_file,
+            this->decoder_name));
+    if (!decoder)
+        throw err::RecognitionError("File is not a recognized archive");
+
+    configure_decoder(*decoder, decoder_arguments);
+    meta = decoder->read_meta(logger, *input_file);
+    for (const auto &entry : meta->entries)
+    {
+        // the first of several equally named entries wins
+        const auto key = entry->path.str();
+        if (entries.find(key) == entries.end())
+            entries[key] = entry.get();
+    }
+
+    linked_decoder_names = registry.get_linked_decoder_names(*decoder);
+    vfs_bridge = std::make_unique<flow::VirtualFileSystemBridge>(
+        logger, *decoder, meta, input_file, input_file->path);
+}
+
+ArchiveHandle::ArchiveHandle(
+    const io::path &path,
+    const std::string &decoder_name,
+    const std::vector<std::string> &decoder_arguments,
+    const dec::Registry &registry) :
+        ArchiveHandle(
+            std::make_shared<io::File>(path, io::FileMode::Read),
+            decoder_name,
+            decoder_arguments,
+            registry)
+{
+}
+
+ArchiveHandle::ArchiveHandle(
+    const std::shared_ptr<io::File> input_file,
+    const std::string &decoder_name,
+    const std::vector<std::string> &decoder_arguments,
+    const dec::Registry &registry) :
+        p(new Priv(input_file, decoder_name, decoder_arguments, registry))
+{
+}
+
+ArchiveHandle::~ArchiveHandle()
+{
+}
+
+const std::string &ArchiveHandle::get_decoder_name() const
+{
+    return p->decoder_name;
+}
+
+std::vector<io::path> ArchiveHandle::get_entry_names() const
+{
+    std::vector<io::path> entry_names;
+    for (const auto &entry : p->meta->entries)
+        entry_names.push_back(entry->path);
+    return entry_names;
+}
+
+bool ArchiveHandle::has_entry(const io::path &entry_name) const
+{
+    return p->entries.find(entry_name.str()) != p->entries.end();
+}
+
+std::unique_ptr<io::File> ArchiveHandle::read(
+    const io::path &entry_name, const ArchiveReadOptions &options) const
+{
+    const auto it = p->entries.find(entry_name.str());
+    if (it == p->entries.end())
+    {
+        throw err::FileNotFoundError(algo::format(
+            "Entry not found: %s", entry_name.c_str()));
+    }
+
+    // every read gets its own stream, so reads don't share the position
+    io::File input_file_copy(*p->input_file);
+    auto output_file = p->decoder->read_file(
+        p->logger, input_file_copy, *p->meta, *it->second);
+    if (!output_file)
+        return nullptr;
+    return decode_nested(
+        p->logger,
+        p->registry,
+        p->linked_decoder_names,
+        false,
+        p->decoder_arguments,
+        options,
+        std::move(output_file));
+}
+
+std::unique_ptr<io::File> au::decode_file(
+    io::File &input_file,
+    const ArchiveReadOptions &options,
+    const std::vector<std::string> &decoder_arguments,
+    const dec::Registry &registry)
+{
+    Logger logger;
+    logger.mute();
+    const auto decoder_names = registry.get_decoder_names();
+    return decode_nested(
+        logger,
+        registry,
+        std::set<std::string>(decoder_names.begin(), decoder_names.end()),
+        true,
+        decoder_arguments,
+        options,
+        std::make_unique<io::File>(input_file));
+}
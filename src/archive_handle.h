@@ -0,0 +1,96 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "dec/registry.h"
+#include "io/file.h"
+
+namespace au {
+
+    struct ArchiveReadOptions final
+    {
+        ArchiveReadOptions();
+
+        // Decodes entries recognized by the archive's linked file decoders,
+        // for example compressed or encrypted scripts.
+        bool enable_nested_decoding;
+
+        // Converts entries recognized by the archive's linked image and
+        // audio decoders to WAV and to images in image_format, which names
+        // an enc::Registry image encoder ("png" by default). Nested decoders
+        // that build images of their own save them in image_format too; the
+        // archive's own decoder takes --image-format from its arguments.
+        bool enable_conversion;
+        std::string image_format;
+    };
+
+    // Library entry point for random access to a single archive. The file
+    // is recognized and its table is read once; entries can then be read by
+    // name from any number of threads at once.
+    class ArchiveHandle final
+    {
+    public:
+        // Recognizes the archive among all registered decoders unless
+        // a decoder name is given. The arguments are parsed by the decoder
+        // just like the command line arguments would be.
+        ArchiveHandle(
+            const io::path &path,
+            const std::string &decoder_name = "",
+            const std::vector<std::string> &decoder_arguments = {},
+            const dec::Registry &registry = dec::Registry::instance());
+
+        ArchiveHandle(
+            const std::shared_ptr<io::File> input_file,
+            const std::string &decoder_name = "",
+            const std::vector<std::string> &decoder_arguments = {},
+            const dec::Registry &registry = dec::Registry::instance());
+
+        ~ArchiveHandle();
+
+        const std::string &get_decoder_name() const;
+
+        // Returns entry names in the order in which they appear in
+        // the archive.
+        std::vector<io::path> get_entry_names() const;
+
+        bool has_entry(const io::path &entry_name) const;
+
+        // Returns nullptr if the decoder skips the entry, for example
+        // because it holds no data.
+        std::unique_ptr<io::File> read(
+            const io::path &entry_name,
+            const ArchiveReadOptions &options = ArchiveReadOptions()) const;
+
+    private:
+        struct Priv;
+        std::unique_ptr<Priv> p;
+    };
+
+    // Decodes a standalone file with whichever decoder recognizes it, and
+    // its output with that decoder's linked decoders. Returns a copy of the
+    // input if no decoder applies under the options.
+    std::unique_ptr<io::File> decode_file(
+        io::File &input_file,
+        const ArchiveReadOptions &options = ArchiveReadOptions(),
+        const std::vector<std::string> &decoder_arguments = {},
+        const dec::Registry &registry = dec::Registry::instance());
+
+}
@@ -407,6 +407,21 @@ const std::vector<std::string> ArgParser::get_stray() const
     return p->stray;
 }
 
+const std::vector<std::string> ArgParser::get_used_options() const
+{
+    std::vector<std::string> used_options;
+    for (const auto &option : p->options)
+    {
+        const auto flag = dynamic_cast<const FlagImpl*>(option.get());
+        const auto sw = dynamic_cast<const SwitchImpl*>(option.get());
+        if (flag && flag->is_set)
+            used_options.push_back(flag->names.at(0));
+        else if (sw && sw->is_set)
+            used_options.push_back(sw->names.at(0) + "=" + sw->value);
+    }
+    return used_options;
+}
+
 void ArgParser::print_help(const Logger &logger) const
 {
     if (!p->options.size())
@@ -68,6 +68,10 @@ namespace au {
         const std::string get_switch(const std::string &name) const;
         const std::vector<std::string> get_stray() const;
 
+        // Returns registered options that were set, in the form they would
+        // take on the command line, in the order of their registration.
+        const std::vector<std::string> get_used_options() const;
+
     private:
         struct Priv;
         std::unique_ptr<Priv> p;
@@ -250,7 +250,7 @@ res::Image PmsImageDecoder::decode_impl(
         throw err::UnsupportedBitDepthError(depth);
     }
 
-    return *image;
+    return std::move(*image);
 }
 
 static auto _ = dec::register_decoder<PmsImageDecoder>("alice-soft/pms");
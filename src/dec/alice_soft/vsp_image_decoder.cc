@@ -202,7 +202,7 @@ res::Image VspImageDecoder::decode_impl(
             palette);
     }
 
-    return *image;
+    return std::move(*image);
 }
 
 static auto _ = dec::register_decoder<VspImageDecoder>("alice-soft/vsp");
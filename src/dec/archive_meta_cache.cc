@@ -0,0 +1,217 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "dec/archive_meta_cache.h"
+#include <thread>
+#include "algo/crypt/crc32.h"
+#include "algo/crypt/sha1.h"
+#include "algo/format.h"
+#include "algo/range.h"
+#include "err.h"
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+#include "io/memory_byte_stream.h"
+
+using namespace au;
+using namespace au::dec;
+
+static const bstr magic = "AUMETA"_b;
+
+// bump whenever the serialization of any decoder's table changes
+static const u32 format_version = 1;
+
+static std::string to_hex(const bstr &input)
+{
+    std::string output;
+    for (const auto c : input)
+        output += algo::format("%02x", c);
+    return output;
+}
+
+ArchiveMetaCache::ArchiveMetaCache(const io::path &directory)
+    : directory(directory)
+{
+}
+
+std::string ArchiveMetaCache::get_key(
+    const io::File &input_file,
+    const std::string &decoder_id,
+    const std::vector<std::string> &options)
+{
+    // nested files live in memory and carry paths relative to their parent
+    // archive, which may well name an unrelated file on disk
+    if (!dynamic_cast<const io::FileByteStream*>(&input_file.stream))
+        return "";
+
+    try
+    {
+        const auto &path = input_file.path;
+        if (!io::is_regular_file(path))
+            return "";
+        const auto size = io::file_size(path);
+        if (size != input_file.stream.size())
+            return "";
+
+        auto key = algo::format(
+            "%s\n%llu\n%llu\n%s\n",
+            io::absolute(path).str().c_str(),
+            static_cast<unsigned long long>(size),
+            static_cast<unsigned long long>(io::last_write_time(path)),
+            decoder_id.c_str());
+        for (const auto &option : options)
+        {
+            key += option + "\n";
+
+            // options can name files, such as TFPK's file name lists, which
+            // change the table as much as the archive itself
+            const auto value_pos = option.find('=');
+            if (value_pos == std::string::npos)
+                continue;
+            const io::path option_path(option.substr(value_pos + 1));
+            if (!io::is_regular_file(option_path))
+                continue;
+            key += algo::format(
+                "%llu\n%llu\n",
+                static_cast<unsigned long long>(io::file_size(option_path)),
+                static_cast<unsigned long long>(
+                    io::last_write_time(option_path)));
+        }
+        return key;
+    }
+    catch (...)
+    {
+        return "";
+    }
+}
+
+io::path ArchiveMetaCache::get_entry_path(const std::string &key) const
+{
+    return directory / (to_hex(algo::crypt::sha1(key)) + ".meta");
+}
+
+std::unique_ptr<io::BaseByteStream> ArchiveMetaCache::load(
+    const std::string &key) const
+{
+    const auto path = get_entry_path(key);
+    try
+    {
+        if (!io::is_regular_file(path))
+            return nullptr;
+        io::FileByteStream input_stream(path, io::FileMode::Read);
+        if (input_stream.read(magic.size()) != magic)
+            return nullptr;
+        if (input_stream.read_le<u32>() != format_version)
+            return nullptr;
+        // guard against hash collisions
+        if (read_cached_bstr(input_stream) != bstr(key))
+            return nullptr;
+        const auto checksum = input_stream.read_le<u32>();
+        const auto data = read_cached_bstr(input_stream);
+        if (algo::crypt::crc32(data) != checksum)
+            return nullptr;
+        return std::make_unique<io::MemoryByteStream>(data);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void ArchiveMetaCache::store(const std::string &key, const bstr &data) const
+{
+    const auto path = get_entry_path(key);
+    io::create_directories(directory);
+
+    // write to a temporary file first so that concurrent readers never see
+    // a partially written entry
+    const auto tmp_path = io::path(path.str() + algo::format(
+        ".%llx.tmp",
+        static_cast<unsigned long long>(
+            std::hash<std::thread::id>()(std::this_thread::get_id()))));
+    {
+        io::FileByteStream output_stream(tmp_path, io::FileMode::Write);
+        output_stream.write(magic);
+        output_stream.write_le<u32>(format_version);
+        write_cached_bstr(output_stream, bstr(key));
+        output_stream.write_le<u32>(algo::crypt::crc32(data));
+        write_cached_bstr(output_stream, data);
+    }
+    try
+    {
+        io::rename(tmp_path, path);
+    }
+    catch (...)
+    {
+        io::remove(tmp_path);
+        throw;
+    }
+}
+
+void dec::write_cached_bstr(io::BaseByteStream &output, const bstr &data)
+{
+    output.write_le<u64>(data.size());
+    output.write(data);
+}
+
+bstr dec::read_cached_bstr(io::BaseByteStream &input)
+{
+    const auto size = input.read_le<u64>();
+    if (size > input.left())
+        throw err::BadDataSizeError();
+    return input.read(size);
+}
+
+void dec::write_cached_entry(
+    io::BaseByteStream &output, const PlainArchiveEntry &entry)
+{
+    write_cached_bstr(output, bstr(entry.path.str()));
+    output.write_le<u64>(entry.offset);
+    output.write_le<u64>(entry.size);
+}
+
+void dec::read_cached_entry(
+    io::BaseByteStream &input, PlainArchiveEntry &entry)
+{
+    entry.path = read_cached_bstr(input).str();
+    entry.offset = input.read_le<u64>();
+    entry.size = input.read_le<u64>();
+}
+
+void dec::write_cached_plain_meta(
+    io::BaseByteStream &output, const ArchiveMeta &meta)
+{
+    output.write_le<u32>(meta.entries.size());
+    for (const auto &entry : meta.entries)
+    {
+        write_cached_entry(
+            output, *static_cast<const PlainArchiveEntry*>(entry.get()));
+    }
+}
+
+std::unique_ptr<ArchiveMeta> dec::read_cached_plain_meta(
+    io::BaseByteStream &input)
+{
+    auto meta = std::make_unique<ArchiveMeta>();
+    const auto entry_count = input.read_le<u32>();
+    for (const auto i : algo::range(entry_count))
+    {
+        auto entry = std::make_unique<PlainArchiveEntry>();
+        read_cached_entry(input, *entry);
+        meta->entries.push_back(std::move(entry));
+    }
+    return meta;
+}
@@ -0,0 +1,73 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "dec/base_archive_decoder.h"
+#include "io/base_byte_stream.h"
+#include "io/path.h"
+
+namespace au {
+namespace dec {
+
+    // On-disk cache of archive tables. Entries are keyed by the archive's
+    // path, size and modification time as well as by the decoder and its
+    // options, including the size and modification time of files they
+    // name, so modified archives or different options never reuse a stale
+    // table.
+    class ArchiveMetaCache final
+    {
+    public:
+        ArchiveMetaCache(const io::path &directory);
+
+        // Returns an empty string if the file can't be cached, for example
+        // because it was extracted from another archive.
+        static std::string get_key(
+            const io::File &input_file,
+            const std::string &decoder_id,
+            const std::vector<std::string> &options);
+
+        // Returns nullptr if there's no valid entry for the given key.
+        std::unique_ptr<io::BaseByteStream> load(const std::string &key) const;
+
+        void store(const std::string &key, const bstr &data) const;
+
+    private:
+        io::path get_entry_path(const std::string &key) const;
+
+        io::path directory;
+    };
+
+    // Helpers for decoders that serialize their tables for the cache.
+    void write_cached_bstr(io::BaseByteStream &output, const bstr &data);
+    bstr read_cached_bstr(io::BaseByteStream &input);
+
+    void write_cached_entry(
+        io::BaseByteStream &output, const PlainArchiveEntry &entry);
+    void read_cached_entry(
+        io::BaseByteStream &input, PlainArchiveEntry &entry);
+
+    // Serializes tables that consist of PlainArchiveEntry items only.
+    void write_cached_plain_meta(
+        io::BaseByteStream &output, const ArchiveMeta &meta);
+    std::unique_ptr<ArchiveMeta> read_cached_plain_meta(
+        io::BaseByteStream &input);
+
+} }
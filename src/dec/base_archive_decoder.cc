@@ -19,8 +19,11 @@
 #include <algorithm>
 #include <cmath>
 #include "algo/format.h"
+#include "dec/archive_meta_cache.h"
 #include "dec/idecoder_visitor.h"
+#include "dec/registry.h"
 #include "err.h"
+#include "io/memory_byte_stream.h"
 
 using namespace au;
 using namespace au::dec;
@@ -41,11 +44,25 @@ BaseArchiveDecoder::BaseArchiveDecoder() : numeric_file_names(false)
                     "Replaces file names with extensionless sequential "
                     "numbers. Useful for recovering archives with broken file "
                     "names and for scripting.");
+
+            arg_parser
+                .register_switch({"--meta-cache"})
+                ->set_value_name("DIR")
+                ->set_description(
+                    "Stores archive tables in DIR, so that decoding the same "
+                    "archive again with the same options doesn't need to read "
+                    "its table. Supported only by some formats.");
         },
         [&](const ArgParser &arg_parser)
         {
             if (arg_parser.has_flag("--numeric-file-names"))
                 numeric_file_names = true;
+
+            meta_cache_dir = arg_parser.get_switch("--meta-cache");
+            meta_cache_options.clear();
+            for (const auto &option : arg_parser.get_used_options())
+                if (option.find("--meta-cache=") != 0)
+                    meta_cache_options.push_back(option);
         });
 }
 
@@ -57,8 +74,7 @@ void BaseArchiveDecoder::accept(IDecoderVisitor &visitor) const
 std::unique_ptr<ArchiveMeta> BaseArchiveDecoder::read_meta(
     const Logger &logger, io::File &input_file) const
 {
-    input_file.stream.seek(0);
-    auto meta = read_meta_impl(logger, input_file);
+    auto meta = read_meta_with_cache(logger, input_file);
 
     const auto width = meta->entries.size() > 1
         ? std::max<int>(1, 1 + std::log10(meta->entries.size()))
@@ -109,3 +125,71 @@ std::unique_ptr<io::File> BaseArchiveDecoder::read_file(
     // wrapper reserved for future usage
     return read_file_impl(logger, input_file, e, m);
 }
+
+bool BaseArchiveDecoder::supports_meta_cache() const
+{
+    return false;
+}
+
+void BaseArchiveDecoder::write_cached_meta(
+    io::BaseByteStream &output, const ArchiveMeta &meta) const
+{
+    throw err::NotSupportedError("Archive table can't be cached");
+}
+
+std::unique_ptr<ArchiveMeta> BaseArchiveDecoder::read_cached_meta(
+    io::BaseByteStream &input) const
+{
+    throw err::NotSupportedError("Archive table can't be cached");
+}
+
+std::string BaseArchiveDecoder::get_meta_cache_id() const
+{
+    return Registry::instance().get_decoder_name(*this);
+}
+
+std::unique_ptr<ArchiveMeta> BaseArchiveDecoder::read_meta_with_cache(
+    const Logger &logger, io::File &input_file) const
+{
+    const auto decoder_id = !meta_cache_dir.str().empty()
+        && supports_meta_cache()
+            ? get_meta_cache_id()
+            : "";
+    const auto key = !decoder_id.empty()
+        ? ArchiveMetaCache::get_key(
+            input_file, decoder_id, meta_cache_options)
+        : "";
+    if (key.empty())
+    {
+        input_file.stream.seek(0);
+        return read_meta_impl(logger, input_file);
+    }
+
+    const ArchiveMetaCache cache(meta_cache_dir);
+    const auto cached_stream = cache.load(key);
+    if (cached_stream)
+    {
+        try
+        {
+            return read_cached_meta(*cached_stream);
+        }
+        catch (const std::exception &e)
+        {
+            logger.warn("ignoring corrupt cached table (%s)\n", e.what());
+        }
+    }
+
+    input_file.stream.seek(0);
+    auto meta = read_meta_impl(logger, input_file);
+    try
+    {
+        io::MemoryByteStream output;
+        write_cached_meta(output, *meta);
+        cache.store(key, output.seek(0).read_to_eof());
+    }
+    catch (const std::exception &e)
+    {
+        logger.warn("failed to cache archive table (%s)\n", e.what());
+    }
+    return meta;
+}
@@ -79,8 +79,27 @@ namespace dec {
             const ArchiveMeta &m,
             const ArchiveEntry &e) const = 0;
 
+        // Decoders whose tables are expensive to read can opt in to
+        // the on-disk metadata cache by overriding these three methods.
+        virtual bool supports_meta_cache() const;
+
+        virtual void write_cached_meta(
+            io::BaseByteStream &output, const ArchiveMeta &meta) const;
+
+        virtual std::unique_ptr<ArchiveMeta> read_cached_meta(
+            io::BaseByteStream &input) const;
+
+        // Identifies the decoder in cache keys. Defaults to the name it was
+        // registered under; tables of unregistered decoders aren't cached.
+        virtual std::string get_meta_cache_id() const;
+
     private:
+        std::unique_ptr<ArchiveMeta> read_meta_with_cache(
+            const Logger &logger, io::File &input_file) const;
+
         bool numeric_file_names;
+        io::path meta_cache_dir;
+        std::vector<std::string> meta_cache_options;
     };
 
 } }
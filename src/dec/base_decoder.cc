@@ -16,10 +16,13 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/base_decoder.h"
+#include "enc/registry.h"
 
 using namespace au;
 using namespace au::dec;
 
+static const std::string default_image_format = "png";
+
 std::vector<ArgParserDecorator> BaseDecoder::get_arg_parser_decorators() const
 {
     return arg_parser_decorators;
@@ -43,6 +46,50 @@ void BaseDecoder::add_arg_parser_decorator(
     add_arg_parser_decorator(decorator);
 }
 
+void BaseDecoder::add_image_format_option()
+{
+    image_encoder = enc::Registry::instance().create_image_encoder(
+        default_image_format);
+    add_arg_parser_decorator(
+        [](ArgParser &arg_parser)
+        {
+            const auto &registry = enc::Registry::instance();
+            auto sw = arg_parser.register_switch({"--image-format"})
+                ->set_value_name("FORMAT")
+                ->set_description(
+                    "Selects the format of the images in the output "
+                    "(defaults to png).");
+            for (const auto &name : registry.get_image_encoder_names())
+            {
+                sw->add_possible_value(name);
+                const auto encoder = registry.create_image_encoder(name);
+                for (const auto &decorator
+                    : encoder->get_arg_parser_decorators())
+                {
+                    decorator.register_cli_options(arg_parser);
+                }
+            }
+        },
+        [&](const ArgParser &arg_parser)
+        {
+            const auto format = arg_parser.has_switch("--image-format")
+                ? arg_parser.get_switch("--image-format")
+                : default_image_format;
+            const auto encoder
+                = enc::Registry::instance().create_image_encoder(format);
+            for (const auto &decorator : encoder->get_arg_parser_decorators())
+                decorator.parse_cli_options(arg_parser);
+            image_encoder = encoder;
+        });
+}
+
+const enc::BaseImageEncoder &BaseDecoder::get_image_encoder() const
+{
+    if (!image_encoder)
+        throw std::logic_error("Decoder has no image format option");
+    return *image_encoder;
+}
+
 bool BaseDecoder::is_recognized(io::File &input_file) const
 {
     try
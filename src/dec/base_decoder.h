@@ -17,9 +17,11 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include "dec/idecoder.h"
 #include "dec/registry.h" // for child decoders
+#include "enc/base_image_encoder.h"
 
 namespace au {
 namespace dec {
@@ -46,8 +48,18 @@ namespace dec {
 
         virtual bool is_recognized_impl(io::File &input_file) const = 0;
 
+        // Decoders whose output includes images in formats of their own
+        // call this in their constructors, so that the images are saved in
+        // the format picked with --image-format, like converted images are.
+        // The options of the picked encoder apply to them as well.
+        void add_image_format_option();
+
+        // Returns the encoder for the picked format, PNG by default.
+        const enc::BaseImageEncoder &get_image_encoder() const;
+
     private:
         std::vector<ArgParserDecorator> arg_parser_decorators;
+        std::shared_ptr<const enc::BaseImageEncoder> image_encoder;
     };
 
 } }
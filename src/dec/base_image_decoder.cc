@@ -39,3 +39,26 @@ res::Image BaseImageDecoder::decode(const Logger &logger, io::File &file) const
     file.stream.seek(0);
     return decode_impl(logger, file);
 }
+
+bool BaseImageDecoder::supports_band_decoding() const
+{
+    return false;
+}
+
+void BaseImageDecoder::decode_bands(
+    const Logger &logger, io::File &file, res::IImageBandSink &sink) const
+{
+    if (!is_recognized(file))
+        throw err::RecognitionError();
+    file.stream.seek(0);
+    decode_bands_impl(logger, file, sink);
+}
+
+void BaseImageDecoder::decode_bands_impl(
+    const Logger &logger, io::File &file, res::IImageBandSink &sink) const
+{
+    const auto image = decode_impl(logger, file);
+    sink.begin(image.width(), image.height(), false);
+    sink.write_band(image);
+    sink.end();
+}
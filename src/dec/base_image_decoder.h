@@ -18,6 +18,7 @@
 #pragma once
 
 #include "base_decoder.h"
+#include "res/iimage_band_sink.h"
 #include "res/image.h"
 
 namespace au {
@@ -35,9 +36,23 @@ namespace dec {
         res::Image decode(
             const Logger &logger, io::File &input_file) const;
 
+        // Whether decode_bands() produces the bands as it goes rather than
+        // decoding the whole image first.
+        virtual bool supports_band_decoding() const;
+
+        void decode_bands(
+            const Logger &logger,
+            io::File &input_file,
+            res::IImageBandSink &sink) const;
+
     protected:
         virtual res::Image decode_impl(
             const Logger &logger, io::File &input_file) const = 0;
+
+        virtual void decode_bands_impl(
+            const Logger &logger,
+            io::File &input_file,
+            res::IImageBandSink &sink) const;
     };
 
 } }
@@ -58,9 +58,9 @@ res::Image CbgImageDecoder::decode_impl(
 
     const auto version = get_version(input_file.stream);
     if (version == Version::Version1)
-        return *cbg::Cbg1Decoder().decode(input_file.stream);
+        return std::move(*cbg::Cbg1Decoder().decode(input_file.stream));
     if (version == Version::Version2)
-        return *cbg::Cbg2Decoder().decode(input_file.stream);
+        return std::move(*cbg::Cbg2Decoder().decode(input_file.stream));
     throw err::UnsupportedVersionError(static_cast<int>(version));
 }
 
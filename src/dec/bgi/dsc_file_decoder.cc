@@ -18,7 +18,7 @@
 #include "dec/bgi/dsc_file_decoder.h"
 #include "algo/range.h"
 #include "dec/bgi/common.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
 #include "io/msb_bit_stream.h"
@@ -156,6 +156,11 @@ static bstr decompress(
     return output;
 }
 
+DscFileDecoder::DscFileDecoder()
+{
+    add_image_format_option();
+}
+
 bool DscFileDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.stream.read(magic.size()) == magic;
@@ -197,7 +202,7 @@ std::unique_ptr<io::File> DscFileDecoder::decode_impl(
                 throw err::UnsupportedBitDepthError(bpp);
         }
         res::Image image(width, height, data_stream.read_to_eof(), fmt);
-        const auto encoder = enc::png::PngImageEncoder();
+        const auto &encoder = get_image_encoder();
         return encoder.encode(logger, image, input_file.path);
     }
 
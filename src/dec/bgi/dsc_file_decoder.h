@@ -25,6 +25,9 @@ namespace bgi {
 
     class DscFileDecoder final : public BaseFileDecoder
     {
+    public:
+        DscFileDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
@@ -163,7 +163,7 @@ res::Image BsgImageDecoder::decode_impl(
         throw err::NotSupportedError("Unsupported image parameters");
 
     image->flip_vertically();
-    return *image;
+    return std::move(*image);
 }
 
 static auto _ = dec::register_decoder<BsgImageDecoder>("bishop/bsg");
@@ -17,7 +17,7 @@
 
 #include "dec/bluearrowgarden/image_archive_decoder.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 
 using namespace au;
 using namespace au::dec::bluearrowgarden;
@@ -39,6 +39,11 @@ namespace
     };
 }
 
+ImageArchiveDecoder::ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool ImageArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     input_file.stream.seek(4);
@@ -103,7 +108,7 @@ std::unique_ptr<io::File> ImageArchiveDecoder::read_file_impl(
         -entry->rect[0].x * meta->image->width(),
         -entry->rect[0].y * meta->image->height());
     image.crop(entry->width, entry->height);
-    return enc::png::PngImageEncoder().encode(logger, image, entry->path);
+    return get_image_encoder().encode(logger, image, entry->path);
 }
 
 static auto _
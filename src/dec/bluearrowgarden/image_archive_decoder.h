@@ -25,6 +25,9 @@ namespace bluearrowgarden {
 
     class ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
@@ -21,7 +21,7 @@
 #include "algo/ptr.h"
 #include "algo/range.h"
 #include "dec/jpeg/jpeg_image_decoder.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 #include "io/lsb_bit_stream.h"
 #include "io/memory_byte_stream.h"
@@ -156,6 +156,11 @@ static std::unique_ptr<res::Image> decode_jpeg(
     throw err::NotSupportedError("Not implemented");
 }
 
+Hg3ImageArchiveDecoder::Hg3ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool Hg3ImageArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.stream.seek(0).read(magic.size()) == magic;
@@ -219,10 +224,19 @@ std::unique_ptr<io::File> Hg3ImageArchiveDecoder::read_file_impl(
     else
         throw err::NotSupportedError("No image data found!\n");
 
-    res::Image actual_image(canvas_width, canvas_height);
-    actual_image.overlay(*image, x, y, res::Image::OverlayKind::OverwriteAll);
-    const auto encoder = enc::png::PngImageEncoder();
-    return encoder.encode(logger, actual_image, entry->path);
+    // Frames are cut to the canvas before they are moved into place, so
+    // that frames placed past its edges never take more than the canvas.
+    if (x >= canvas_width || y >= canvas_height)
+        image = std::make_unique<res::Image>(canvas_width, canvas_height);
+    else
+    {
+        image->crop(
+            std::min<size_t>(image->width(), canvas_width - x),
+            std::min<size_t>(image->height(), canvas_height - y));
+        image->offset(x, y).crop(canvas_width, canvas_height);
+    }
+    const auto &encoder = get_image_encoder();
+    return encoder.encode(logger, *image, entry->path);
 }
 
 algo::NamingStrategy Hg3ImageArchiveDecoder::naming_strategy() const
@@ -25,6 +25,9 @@ namespace cat_system {
 
     class Hg3ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        Hg3ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
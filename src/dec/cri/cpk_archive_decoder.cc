@@ -20,6 +20,7 @@
 #include "algo/any.h"
 #include "algo/range.h"
 #include "algo/str.h"
+#include "dec/archive_meta_cache.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
 #include "io/msb_bit_stream.h"
@@ -418,6 +419,23 @@ std::unique_ptr<io::File> CpkArchiveDecoder::read_file_impl(
     return std::make_unique<io::File>(entry->path, data);
 }
 
+bool CpkArchiveDecoder::supports_meta_cache() const
+{
+    return true;
+}
+
+void CpkArchiveDecoder::write_cached_meta(
+    io::BaseByteStream &output, const dec::ArchiveMeta &meta) const
+{
+    write_cached_plain_meta(output, meta);
+}
+
+std::unique_ptr<dec::ArchiveMeta> CpkArchiveDecoder::read_cached_meta(
+    io::BaseByteStream &input) const
+{
+    return read_cached_plain_meta(input);
+}
+
 std::vector<std::string> CpkArchiveDecoder::get_linked_formats() const
 {
     return {"cri/hca", "cri/xtx", "playstation/gxt", "playstation/gtf"};
@@ -40,6 +40,15 @@ namespace cri {
             io::File &input_file,
             const ArchiveMeta &m,
             const ArchiveEntry &e) const override;
+
+        bool supports_meta_cache() const override;
+
+        void write_cached_meta(
+            io::BaseByteStream &output,
+            const ArchiveMeta &meta) const override;
+
+        std::unique_ptr<ArchiveMeta> read_cached_meta(
+            io::BaseByteStream &input) const override;
     };
 
 } } }
@@ -17,7 +17,6 @@
 
 #include "dec/cyberworks/common/algo.h"
 #include "dec/cyberworks/dat_image_decoder.h"
-#include "enc/png/png_image_encoder.h"
 
 using namespace au;
 using namespace au::dec::cyberworks;
@@ -66,16 +65,16 @@ void common::decode_data(
     const Logger &logger,
     const bstr &type,
     bstr &data,
-    const DatPlugin &plugin)
+    const DatPlugin &plugin,
+    const enc::BaseImageEncoder &image_encoder)
 {
     if (type == "b0"_b || type == "n0"_b || type == "o0"_b)
     {
         io::File pseudo_file("dummy.dat", data);
         const auto image = DatImageDecoder(plugin).decode(
             logger, pseudo_file);
-        data = enc::png::PngImageEncoder()
-            .encode(logger, image, "")
-                ->stream.seek(0).read_to_eof();
+        data = image_encoder.encode(logger, image, "")
+            ->stream.seek(0).read_to_eof();
     }
 
     if (type == "j0"_b || type == "k0"_b)
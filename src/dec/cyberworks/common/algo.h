@@ -18,6 +18,7 @@
 #pragma once
 
 #include "dec/cyberworks/dat_plugin.h"
+#include "enc/base_image_encoder.h"
 #include "io/memory_byte_stream.h"
 #include "logger.h"
 
@@ -30,7 +31,8 @@ namespace common {
         const Logger &logger,
         const bstr &type,
         bstr &data,
-        const DatPlugin &plugin);
+        const DatPlugin &plugin,
+        const enc::BaseImageEncoder &image_encoder);
 
     u32 read_obfuscated_number(io::BaseByteStream &input_stream);
 
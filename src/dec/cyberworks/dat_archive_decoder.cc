@@ -19,6 +19,7 @@
 #include "algo/pack/lzss.h"
 #include "dec/cyberworks/common/algo.h"
 #include "dec/cyberworks/common/plugins.h"
+#include "enc/base_image_encoder.h"
 #include "io/memory_byte_stream.h"
 #include "virtual_file_system.h"
 
@@ -55,6 +56,7 @@ static std::vector<std::string> get_data_file_names(
 
 DatArchiveDecoder::DatArchiveDecoder()
 {
+    add_image_format_option();
     common::register_plugins(plugin_manager);
     add_arg_parser_decorator(
         plugin_manager.create_arg_parser_decorator(
@@ -121,7 +123,8 @@ std::unique_ptr<io::File> DatArchiveDecoder::read_file_impl(
     if (entry->size_orig != entry->size_comp)
         data = algo::pack::lzss_decompress(data, entry->size_orig);
 
-    common::decode_data(logger, entry->type, data, meta->plugin);
+    common::decode_data(
+        logger, entry->type, data, meta->plugin, get_image_encoder());
 
     auto ret = std::make_unique<io::File>(entry->path, data);
     ret->guess_extension();
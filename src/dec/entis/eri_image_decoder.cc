@@ -212,7 +212,7 @@ res::Image EriImageDecoder::decode_impl(
         return image;
 
     base_image->overlay(image, res::Image::OverlayKind::AddSimple);
-    return *base_image;
+    return std::move(*base_image);
 }
 
 static auto _ = dec::register_decoder<EriImageDecoder>("entis/eri");
@@ -21,7 +21,7 @@
 #include "algo/str.h"
 #include "dec/fc01/common/custom_lzss.h"
 #include "dec/fc01/common/util.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -51,6 +51,7 @@ static bstr decrypt(const bstr &input, size_t output_size, u8 initial_key)
 
 McaArchiveDecoder::McaArchiveDecoder()
 {
+    add_image_format_option();
     add_arg_parser_decorator(
         [](ArgParser &arg_parser)
         {
@@ -128,7 +129,7 @@ std::unique_ptr<io::File> McaArchiveDecoder::read_file_impl(
 
     data = common::fix_stride(data, width, height, 24);
     res::Image image(width, height, data, res::PixelFormat::BGR888);
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(logger, image, entry->path);
 }
 
@@ -17,7 +17,7 @@
 
 #include "dec/kaguya/an00_image_archive_decoder.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 
 using namespace au;
 using namespace au::dec::kaguya;
@@ -34,6 +34,11 @@ namespace
     };
 }
 
+An00ImageArchiveDecoder::An00ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 algo::NamingStrategy An00ImageArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Sibling;
@@ -84,7 +89,7 @@ std::unique_ptr<io::File> An00ImageArchiveDecoder::read_file_impl(
         input_file.stream.seek(entry->offset),
         res::PixelFormat::BGRA8888);
     image.flip_vertically();
-    return enc::png::PngImageEncoder().encode(logger, image, entry->path);
+    return get_image_encoder().encode(logger, image, entry->path);
 }
 
 static auto _ = dec::register_decoder<An00ImageArchiveDecoder>("kaguya/an00");
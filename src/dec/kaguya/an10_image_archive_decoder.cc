@@ -17,7 +17,7 @@
 
 #include "dec/kaguya/an10_image_archive_decoder.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 
 using namespace au;
 using namespace au::dec::kaguya;
@@ -35,6 +35,11 @@ namespace
     };
 }
 
+An10ImageArchiveDecoder::An10ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 algo::NamingStrategy An10ImageArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Sibling;
@@ -88,7 +93,7 @@ std::unique_ptr<io::File> An10ImageArchiveDecoder::read_file_impl(
             ? res::PixelFormat::BGR888
             : res::PixelFormat::BGRA8888);
     image.flip_vertically();
-    return enc::png::PngImageEncoder().encode(logger, image, entry->path);
+    return get_image_encoder().encode(logger, image, entry->path);
 }
 
 static auto _ = dec::register_decoder<An10ImageArchiveDecoder>("kaguya/an10");
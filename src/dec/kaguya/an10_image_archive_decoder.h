@@ -26,6 +26,9 @@ namespace kaguya {
 
     class An10ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        An10ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
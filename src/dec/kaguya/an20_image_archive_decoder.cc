@@ -17,7 +17,7 @@
 
 #include "dec/kaguya/an20_image_archive_decoder.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -36,6 +36,11 @@ namespace
     };
 }
 
+An20ImageArchiveDecoder::An20ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 algo::NamingStrategy An20ImageArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Sibling;
@@ -104,7 +109,7 @@ std::unique_ptr<io::File> An20ImageArchiveDecoder::read_file_impl(
             ? res::PixelFormat::BGR888
             : res::PixelFormat::BGRA8888);
     image.flip_vertically();
-    return enc::png::PngImageEncoder().encode(logger, image, entry->path);
+    return get_image_encoder().encode(logger, image, entry->path);
 }
 
 static auto _ = dec::register_decoder<An20ImageArchiveDecoder>("kaguya/an20");
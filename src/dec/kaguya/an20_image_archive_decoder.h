@@ -26,6 +26,9 @@ namespace kaguya {
 
     class An20ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        An20ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
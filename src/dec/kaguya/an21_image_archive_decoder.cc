@@ -18,7 +18,7 @@
 #include "dec/kaguya/an21_image_archive_decoder.h"
 #include "algo/range.h"
 #include "dec/kaguya/common/rle.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -37,6 +37,11 @@ namespace
     };
 }
 
+An21ImageArchiveDecoder::An21ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 algo::NamingStrategy An21ImageArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Sibling;
@@ -132,7 +137,7 @@ std::unique_ptr<io::File> An21ImageArchiveDecoder::read_file_impl(
             ? res::PixelFormat::BGR888
             : res::PixelFormat::BGRA8888);
     image.flip_vertically();
-    return enc::png::PngImageEncoder().encode(logger, image, entry->path);
+    return get_image_encoder().encode(logger, image, entry->path);
 }
 
 static auto _ = dec::register_decoder<An21ImageArchiveDecoder>("kaguya/an21");
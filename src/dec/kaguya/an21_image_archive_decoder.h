@@ -26,6 +26,9 @@ namespace kaguya {
 
     class An21ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        An21ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
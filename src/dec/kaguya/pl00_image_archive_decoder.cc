@@ -17,7 +17,7 @@
 
 #include "dec/kaguya/pl00_image_archive_decoder.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
 
@@ -37,6 +37,11 @@ namespace
     };
 }
 
+Pl00ImageArchiveDecoder::Pl00ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 algo::NamingStrategy Pl00ImageArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Sibling;
@@ -92,7 +97,7 @@ std::unique_ptr<io::File> Pl00ImageArchiveDecoder::read_file_impl(
         input_file.stream.seek(entry->offset),
         fmt);
     image.flip_vertically();
-    return enc::png::PngImageEncoder().encode(logger, image, entry->path);
+    return get_image_encoder().encode(logger, image, entry->path);
 }
 
 static auto _ = dec::register_decoder<Pl00ImageArchiveDecoder>("kaguya/pl00");
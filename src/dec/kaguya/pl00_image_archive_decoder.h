@@ -26,6 +26,9 @@ namespace kaguya {
 
     class Pl00ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        Pl00ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
@@ -18,7 +18,7 @@
 #include "dec/kaguya/pl10_image_archive_decoder.h"
 #include "algo/range.h"
 #include "dec/kaguya/common/rle.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -37,6 +37,11 @@ namespace
     };
 }
 
+Pl10ImageArchiveDecoder::Pl10ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 algo::NamingStrategy Pl10ImageArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Sibling;
@@ -112,7 +117,7 @@ std::unique_ptr<io::File> Pl10ImageArchiveDecoder::read_file_impl(
         throw err::UnsupportedChannelCountError(entry->channels);
     res::Image image(entry->width, entry->height, entry->data, fmt);
     image.flip_vertically();
-    return enc::png::PngImageEncoder().encode(logger, image, entry->path);
+    return get_image_encoder().encode(logger, image, entry->path);
 }
 
 static auto _ = dec::register_decoder<Pl10ImageArchiveDecoder>("kaguya/pl10");
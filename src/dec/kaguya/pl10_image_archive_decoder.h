@@ -26,6 +26,9 @@ namespace kaguya {
 
     class Pl10ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        Pl10ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
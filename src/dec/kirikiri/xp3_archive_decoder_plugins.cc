@@ -19,16 +19,14 @@
 #include "algo/ptr.h"
 #include "algo/range.h"
 #include "dec/kirikiri/cxdec.h"
-#include "io/program_path.h"
+#include "io/assets.h"
 
 using namespace au;
 using namespace au::dec::kirikiri;
 
 static bstr read_etc_file(const std::string &name)
 {
-    const auto path = io::get_assets_dir_path() / "xp3" / name;
-    io::File file(path, io::FileMode::Read);
-    return file.stream.seek(0).read_to_eof();
+    return *io::read_asset(io::path("xp3") / name);
 }
 
 static Xp3Plugin create_simple_plugin(const Xp3DecryptFunc &xp3_decrypt_func)
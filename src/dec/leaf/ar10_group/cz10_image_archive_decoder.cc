@@ -20,7 +20,7 @@
 #include "algo/format.h"
 #include "algo/pack/zlib.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
 
@@ -91,6 +91,11 @@ static bstr decompress(
     return output;
 }
 
+Cz10ImageArchiveDecoder::Cz10ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool Cz10ImageArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.stream.read(magic.size()) == magic;
@@ -144,7 +149,7 @@ std::unique_ptr<io::File> Cz10ImageArchiveDecoder::read_file_impl(
     {
         image.at(x, y)[c] = *data_ptr++;
     }
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(logger, image, entry->path);
 }
 
@@ -25,6 +25,9 @@ namespace leaf {
 
     class Cz10ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        Cz10ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
@@ -18,7 +18,7 @@
 #include "dec/leaf/pak2_group/pak2_image_archive_decoder.h"
 #include "algo/format.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -38,6 +38,11 @@ namespace
     };
 }
 
+Pak2ImageArchiveDecoder::Pak2ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool Pak2ImageArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.stream.seek(4).read(magic.size()) == magic;
@@ -121,7 +126,7 @@ std::unique_ptr<io::File> Pak2ImageArchiveDecoder::read_file_impl(
             entry->width, entry->height, mask_data, res::PixelFormat::Gray8);
         image.apply_mask(mask);
     }
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(logger, image, entry->path);
 }
 
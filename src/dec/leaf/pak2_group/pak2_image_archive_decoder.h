@@ -25,6 +25,9 @@ namespace leaf {
 
     class Pak2ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        Pak2ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
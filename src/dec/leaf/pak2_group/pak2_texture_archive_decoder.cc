@@ -18,7 +18,7 @@
 #include "dec/leaf/pak2_group/pak2_texture_archive_decoder.h"
 #include "algo/format.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -44,6 +44,11 @@ namespace
     };
 }
 
+Pak2TextureArchiveDecoder::Pak2TextureArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool Pak2TextureArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.stream.seek(4).read(magic.size()) == magic;
@@ -136,7 +141,7 @@ std::unique_ptr<io::File> Pak2TextureArchiveDecoder::read_file_impl(
             chunk.y,
             res::Image::OverlayKind::OverwriteAll);
     }
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(logger, image, entry->path);
 }
 
@@ -25,6 +25,9 @@ namespace leaf {
 
     class Pak2TextureArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        Pak2TextureArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
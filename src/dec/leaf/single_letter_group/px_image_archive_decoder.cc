@@ -20,7 +20,7 @@
 #include <set>
 #include "algo/format.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -465,6 +465,11 @@ static void read_meta(
     ::read_meta(input_stream, meta, known_offsets);
 }
 
+PxImageArchiveDecoder::PxImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool PxImageArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.path.has_extension("px");
@@ -500,7 +505,7 @@ std::unique_ptr<io::File> PxImageArchiveDecoder::read_file_impl(
 
     res::Image image(
         entry->width, entry->height, data, res::PixelFormat::BGRA8888);
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(logger, image, entry->path);
 }
 
@@ -25,6 +25,9 @@ namespace leaf {
 
     class PxImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        PxImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
@@ -18,7 +18,7 @@
 #include "dec/libido/egr_archive_decoder.h"
 #include "algo/format.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -33,6 +33,11 @@ namespace
     };
 }
 
+EgrArchiveDecoder::EgrArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool EgrArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.path.has_extension("egr");
@@ -83,7 +88,7 @@ std::unique_ptr<io::File> EgrArchiveDecoder::read_file_impl(
         input_file.stream.read(entry->width * entry->height),
         palette);
 
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(logger, image, entry->path);
 }
 
@@ -25,6 +25,9 @@ namespace libido {
 
     class EgrArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        EgrArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
@@ -21,7 +21,7 @@
 #include "algo/range.h"
 #include "dec/google/webp_image_decoder.h"
 #include "dec/png/png_image_decoder.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 #include "virtual_file_system.h"
 
@@ -82,6 +82,11 @@ static res::Image get_texture_image(
     throw err::FileNotFoundError("Block texture not found");
 }
 
+DziImageArchiveDecoder::DziImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool DziImageArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.stream.seek(0).read(magic.size()) == magic;
@@ -161,7 +166,7 @@ std::unique_ptr<io::File> DziImageArchiveDecoder::read_file_impl(
             y * 256,
             res::Image::OverlayKind::OverwriteAll);
     }
-    return enc::png::PngImageEncoder().encode(logger, image, entry->path);
+    return get_image_encoder().encode(logger, image, entry->path);
 }
 
 static auto _ = dec::register_decoder<DziImageArchiveDecoder>("malie/dzi");
@@ -25,6 +25,9 @@ namespace malie {
 
     class DziImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        DziImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
@@ -179,68 +179,77 @@ static Header read_header(io::BaseByteStream &input_stream)
     return h;
 }
 
-static res::Image get_image_from_palette(
+// Rows are decoded in bands of about this many bytes of pixels.
+static const size_t band_size = 4 * 1024 * 1024;
+
+// The functions below read the rows starting at first_row, in the order
+// they are stored in the file, until the band is full.
+static void read_rows_from_palette(
     io::BaseByteStream &input_stream,
     const Header &header,
-    const res::Palette &palette)
+    const res::Palette &palette,
+    const size_t first_row,
+    res::Image &band)
 {
-    res::Image image(header.width, header.height);
-    for (const auto y : algo::range(header.height))
+    for (const auto y : algo::range(band.height()))
     {
         io::MsbBitStream bit_stream(input_stream
-            .seek(header.data_offset + header.stride * y)
+            .seek(header.data_offset + header.stride * (first_row + y))
             .read((header.width * header.depth + 7) / 8));
         for (const auto x : algo::range(header.width))
         {
             auto c = bit_stream.read(header.depth);
             if (c < palette.size())
-                image.at(x, y) = palette[c];
+                band.at(x, y) = palette[c];
         }
     }
-    return image;
 }
 
-static std::unique_ptr<res::Image> get_image_without_palette_fast24(
-    io::BaseByteStream &input_stream, const Header &header)
+static void read_rows_without_palette_fast24(
+    io::BaseByteStream &input_stream,
+    const Header &header,
+    const size_t first_row,
+    res::Image &band)
 {
-    auto image = std::make_unique<res::Image>(header.width, header.height);
-    for (const auto y : algo::range(header.height))
+    for (const auto y : algo::range(band.height()))
     {
-        input_stream.seek(header.data_offset + header.stride * y);
+        input_stream.seek(header.data_offset + header.stride * (first_row + y));
         res::Image row(header.width, 1, input_stream, res::PixelFormat::BGR888);
         for (const auto x : algo::range(header.width))
-            image->at(x, y) = row.at(x, 0);
+            band.at(x, y) = row.at(x, 0);
     }
-    return image;
 }
 
-static std::unique_ptr<res::Image> get_image_without_palette_fast32(
-    io::BaseByteStream &input_stream, const Header &header)
+static void read_rows_without_palette_fast32(
+    io::BaseByteStream &input_stream,
+    const Header &header,
+    const size_t first_row,
+    res::Image &band)
 {
-    auto image = std::make_unique<res::Image>(header.width, header.height);
-    for (const auto y : algo::range(header.height))
+    for (const auto y : algo::range(band.height()))
     {
-        input_stream.seek(header.data_offset + header.stride * y);
+        input_stream.seek(header.data_offset + header.stride * (first_row + y));
         res::Image row(
             header.width, 1, input_stream, res::PixelFormat::BGRA8888);
         for (const auto x : algo::range(header.width))
-            image->at(x, y) = row.at(x, 0);
+            band.at(x, y) = row.at(x, 0);
     }
-    return image;
 }
 
-static std::unique_ptr<res::Image> get_image_without_palette_generic(
-    io::BaseByteStream &input_stream, const Header &header)
+static void read_rows_without_palette_generic(
+    io::BaseByteStream &input_stream,
+    const Header &header,
+    const size_t first_row,
+    res::Image &band)
 {
-    auto image = std::make_unique<res::Image>(header.width, header.height);
     double multipliers[4];
     for (const auto i : algo::range(4))
         multipliers[i] = 255.0 / std::max<size_t>(1, header.masks[i]);
 
-    for (const auto y : algo::range(header.height))
+    for (const auto y : algo::range(band.height()))
     {
         io::MsbBitStream bit_stream(input_stream
-            .seek(header.data_offset + header.stride * y)
+            .seek(header.data_offset + header.stride * (first_row + y))
             .read((header.width * header.depth + 7) / 8));
         for (const auto x : algo::range(header.width))
         {
@@ -249,28 +258,29 @@ static std::unique_ptr<res::Image> get_image_without_palette_generic(
                 c = rotl(c, header.depth, -header.rotation);
             else if (header.rotation > 0)
                 c = rotr(c, header.depth, header.rotation);
-            auto &p = image->at(x, y);
+            auto &p = band.at(x, y);
             p.b = (c & header.masks[0]) * multipliers[0];
             p.g = (c & header.masks[1]) * multipliers[1];
             p.r = (c & header.masks[2]) * multipliers[2];
             p.a = (c & header.masks[3]) * multipliers[3];
         }
     }
-    return image;
 }
 
-static res::Image get_image_without_palette(
-    io::BaseByteStream &input_stream, const Header &header)
+static void read_rows_without_palette(
+    io::BaseByteStream &input_stream,
+    const Header &header,
+    const size_t first_row,
+    res::Image &band)
 {
-    std::unique_ptr<res::Image> image;
-
     if (header.depth == 24
         && header.masks[0] == 0xFF0000
         && header.masks[1] == 0xFF00
         && header.masks[2] == 0xFF
         && header.masks[3] == 0)
     {
-        image = get_image_without_palette_fast24(input_stream, header);
+        read_rows_without_palette_fast24(
+            input_stream, header, first_row, band);
     }
 
     else if (header.depth == 32
@@ -279,69 +289,189 @@ static res::Image get_image_without_palette(
         && header.masks[2] == 0xFF00
         && (header.masks[3] == 0 || header.masks[3] == 0xFF))
     {
-        image = get_image_without_palette_fast32(input_stream, header);
+        read_rows_without_palette_fast32(
+            input_stream, header, first_row, band);
     }
 
     else
     {
-        image = get_image_without_palette_generic(input_stream, header);
+        read_rows_without_palette_generic(
+            input_stream, header, first_row, band);
     }
 
     if (!header.masks[3])
-        for (auto &c : *image)
+        for (auto &c : band)
             c.a = 0xFF;
+}
 
-    return *image;
+static void read_rows(
+    io::BaseByteStream &input_stream,
+    const Header &header,
+    const res::Palette &palette,
+    const size_t first_row,
+    res::Image &band)
+{
+    if (palette.size() > 0)
+        read_rows_from_palette(input_stream, header, palette, first_row, band);
+    else
+        read_rows_without_palette(input_stream, header, first_row, band);
 }
 
-bool BmpImageDecoder::is_recognized_impl(io::File &input_file) const
+static bool has_alpha(const res::Image &image)
 {
-    input_file.stream.seek(0);
-    if (input_file.stream.read(magic.size()) != magic)
-        return false;
-    input_file.stream.skip(4); // file size, some encoders corrupt this value
-    return input_file.stream.read_le<u32>() == 0; // but this should be reliable
+    for (const auto &c : image)
+        if (c.a != 0)
+            return true;
+    return false;
 }
 
-res::Image BmpImageDecoder::decode_impl(
-    const Logger &logger, io::File &input_file) const
+static void make_opaque(res::Image &image)
+{
+    for (auto &c : image)
+        c.a = 0xFF;
+}
+
+static res::Palette read_palette(
+    io::BaseByteStream &input_stream, const Header &header)
 {
-    input_file.stream.seek(10);
-    auto header = read_header(input_file.stream);
     res::Palette palette(header.palette_size);
     for (const auto i : algo::range(palette.size()))
     {
-        palette[i].b = input_file.stream.read<u8>();
-        palette[i].g = input_file.stream.read<u8>();
-        palette[i].r = input_file.stream.read<u8>();
+        palette[i].b = input_stream.read<u8>();
+        palette[i].g = input_stream.read<u8>();
+        palette[i].r = input_stream.read<u8>();
         palette[i].a = 0xFF;
-        input_file.stream.skip(1);
+        input_stream.skip(1);
     }
+    return palette;
+}
 
+// Reads the rows a band at a time until they show that the alpha channel
+// carries something, that is until two pixels differ in alpha or one has
+// alpha other than 0 or 255.
+static bool uses_alpha(
+    io::BaseByteStream &input_stream,
+    const Header &header,
+    const res::Palette &palette,
+    const size_t rows_per_band)
+{
+    if (!header.width || !header.height)
+        return false;
+    u8 alpha = 0;
+    for (size_t y = 0; y < header.height; y += rows_per_band)
+    {
+        res::Image band(
+            header.width, std::min<size_t>(rows_per_band, header.height - y));
+        read_rows(input_stream, header, palette, y, band);
+        if (!y)
+        {
+            alpha = band.at(0, 0).a;
+            if (alpha != 0 && alpha != 0xFF)
+                return true;
+        }
+        for (const auto &c : band)
+            if (c.a != alpha)
+                return true;
+    }
+    return false;
+}
+
+static void check_header(const Header &header)
+{
     if (header.planes != 1)
         throw err::NotSupportedError("Unexpected plane count");
 
     if (header.compression != 0 && header.compression != 3)
         throw err::NotSupportedError("Compressed BMPs are not supported");
+}
 
-    res::Image image = palette.size() > 0
-        ? get_image_from_palette(input_file.stream, header, palette)
-        : get_image_without_palette(input_file.stream, header);
+static void write_band(
+    res::IImageBandSink &sink, const res::Image &band, const bool flip)
+{
+    res::ImageView view(band);
+    if (flip)
+        view.flip_vertically();
+    sink.write_band(view);
+}
 
-    if (header.depth == 32)
-    {
-        bool everything_transparent = true;
-        for (const auto &c : image)
-            if (c.a != 0)
-                everything_transparent = false;
-        if (everything_transparent)
-            for (auto &c : image)
-                c.a = 0xFF;
-    }
+bool BmpImageDecoder::is_recognized_impl(io::File &input_file) const
+{
+    input_file.stream.seek(0);
+    if (input_file.stream.read(magic.size()) != magic)
+        return false;
+    input_file.stream.skip(4); // file size, some encoders corrupt this value
+    return input_file.stream.read_le<u32>() == 0; // but this should be reliable
+}
+
+bool BmpImageDecoder::supports_band_decoding() const
+{
+    return true;
+}
+
+res::Image BmpImageDecoder::decode_impl(
+    const Logger &logger, io::File &input_file) const
+{
+    input_file.stream.seek(10);
+    const auto header = read_header(input_file.stream);
+    const auto palette = read_palette(input_file.stream, header);
+    check_header(header);
+
+    res::Image image(header.width, header.height);
+    read_rows(input_file.stream, header, palette, 0, image);
+
+    if (header.depth == 32 && !has_alpha(image))
+        make_opaque(image);
 
     if (header.flip)
         image.flip_vertically();
     return image;
 }
 
+void BmpImageDecoder::decode_bands_impl(
+    const Logger &logger,
+    io::File &input_file,
+    res::IImageBandSink &sink) const
+{
+    input_file.stream.seek(10);
+    const auto header = read_header(input_file.stream);
+    const auto palette = read_palette(input_file.stream, header);
+    check_header(header);
+
+    const auto width = header.width;
+    const auto height = header.height;
+    const auto rows_per_band = std::max<size_t>(
+        1, band_size / std::max<size_t>(1, width * sizeof(res::Pixel)));
+
+    // The sink is told up front whether the image is opaque. The depth and
+    // the masks tell that for most images; the alpha of 32-bit images is
+    // checked with a separate read, which for images with alpha rarely gets
+    // past the first band. Images whose alpha is all 0 or all 255 are made
+    // opaque, as decode_impl() does with entirely transparent ones.
+    auto is_opaque = palette.size() > 0
+        ? palette.size() >= (1u << header.depth)
+        : !header.masks[3];
+    const auto ignore_alpha = header.depth == 32
+        && header.masks[3]
+        && !uses_alpha(input_file.stream, header, palette, rows_per_band);
+    if (ignore_alpha)
+        is_opaque = true;
+
+    sink.begin(width, height, is_opaque);
+    for (size_t y = 0; y < height; y += rows_per_band)
+    {
+        const auto row_count = std::min<size_t>(rows_per_band, height - y);
+        res::Image band(width, row_count);
+        read_rows(
+            input_file.stream,
+            header,
+            palette,
+            header.flip ? height - y - row_count : y,
+            band);
+        if (ignore_alpha)
+            make_opaque(band);
+        write_band(sink, band, header.flip);
+    }
+    sink.end();
+}
+
 static auto _ = dec::register_decoder<BmpImageDecoder>("microsoft/bmp");
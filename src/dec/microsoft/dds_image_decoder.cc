@@ -193,7 +193,7 @@ res::Image DdsImageDecoder::decode_impl(
     if (image == nullptr)
         throw err::NotSupportedError("Unsupported pixel format");
 
-    return *image;
+    return std::move(*image);
 }
 
 static auto _ = dec::register_decoder<DdsImageDecoder>("microsoft/dds");
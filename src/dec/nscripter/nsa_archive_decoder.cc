@@ -20,7 +20,7 @@
 #include "algo/range.h"
 #include "dec/nscripter/nsa_encrypted_stream.h"
 #include "dec/nscripter/spb_image_decoder.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -43,6 +43,7 @@ namespace
 
 NsaArchiveDecoder::NsaArchiveDecoder()
 {
+    add_image_format_option();
     add_arg_parser_decorator(
         [](ArgParser &arg_parser)
         {
@@ -116,7 +117,7 @@ std::unique_ptr<io::File> NsaArchiveDecoder::read_file_impl(
     if (entry->compression_type == CompressionType::Spb)
     {
         const auto decoder = SpbImageDecoder();
-        const auto encoder = enc::png::PngImageEncoder();
+        const auto &encoder = get_image_encoder();
         io::File spb_file("dummy.bmp", data);
         return encoder.encode(
             logger, decoder.decode(logger, spb_file), entry->path);
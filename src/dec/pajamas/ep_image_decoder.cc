@@ -126,7 +126,7 @@ res::Image EpImageDecoder::decode_impl(
     else
         ret = std::make_unique<res::Image>(width, height, data, format);
     ret->offset(x, y);
-    return *ret;
+    return std::move(*ret);
 }
 
 static auto _
@@ -190,7 +190,8 @@ res::Image GimImageDecoder::decode_impl(
 
     if (chunks.find(0x04) == chunks.end())
         throw err::CorruptDataError("Missing bitmap");
-    return *read_image(input_file.stream, chunks[0x04], std::move(palette));
+    return std::move(*read_image(
+        input_file.stream, chunks[0x04], std::move(palette)));
 }
 
 static auto _ = dec::register_decoder<GimImageDecoder>("playstation/gim");
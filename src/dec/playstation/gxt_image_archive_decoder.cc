@@ -17,7 +17,7 @@
 
 #include "dec/playstation/gxt_image_archive_decoder.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -57,6 +57,11 @@ namespace
     };
 }
 
+GxtImageArchiveDecoder::GxtImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 algo::NamingStrategy GxtImageArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Sibling;
@@ -117,7 +122,7 @@ std::unique_ptr<io::File> GxtImageArchiveDecoder::read_file_impl(
     const auto data = input_file.stream.seek(entry->offset).read(entry->size);
     res::Image image(
         entry->width, entry->height, data, res::PixelFormat::Gray8);
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(logger, image, entry->path);
 }
 
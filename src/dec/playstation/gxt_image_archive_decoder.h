@@ -25,6 +25,9 @@ namespace playstation {
 
     class GxtImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        GxtImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
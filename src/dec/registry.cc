@@ -18,6 +18,9 @@
 #include "dec/registry.h"
 #include <algorithm>
 #include <map>
+#include <mutex>
+#include <stack>
+#include <typeindex>
 #include "dec/idecoder.h"
 #include "err.h"
 
@@ -26,6 +29,11 @@ using namespace au::dec;
 struct Registry::Priv final
 {
     std::map<std::string, DecoderCreator> decoder_map;
+
+    // names of the decoder types, filled in on the first lookup
+    std::map<std::type_index, std::string> type_names;
+    size_t named_decoder_count = 0;
+    std::mutex type_names_mutex;
 };
 
 Registry::Registry() : p(new Priv)
@@ -58,6 +66,30 @@ std::shared_ptr<IDecoder>
     return p->decoder_map[name]();
 }
 
+std::set<std::string> Registry::get_linked_decoder_names(
+    const IDecoder &base_decoder) const
+{
+    std::set<std::string> known_formats;
+    std::vector<std::shared_ptr<IDecoder>> linked_decoders;
+    std::stack<const IDecoder*> decoders_to_inspect;
+    decoders_to_inspect.push(&base_decoder);
+    while (!decoders_to_inspect.empty())
+    {
+        const auto decoder_to_inspect = decoders_to_inspect.top();
+        decoders_to_inspect.pop();
+        for (const auto &format : decoder_to_inspect->get_linked_formats())
+        {
+            if (known_formats.find(format) != known_formats.end())
+                continue;
+            known_formats.insert(format);
+            auto linked_decoder = create_decoder(format);
+            decoders_to_inspect.push(linked_decoder.get());
+            linked_decoders.push_back(std::move(linked_decoder));
+        }
+    }
+    return known_formats;
+}
+
 void Registry::add_decoder(const std::string &name, DecoderCreator creator)
 {
     if (has_decoder(name))
@@ -74,6 +106,23 @@ Registry &Registry::instance()
     return instance;
 }
 
+std::string Registry::get_decoder_name(const IDecoder &decoder) const
+{
+    std::lock_guard<std::mutex> lock(p->type_names_mutex);
+    if (p->named_decoder_count != p->decoder_map.size())
+    {
+        p->type_names.clear();
+        for (const auto &item : p->decoder_map)
+        {
+            const auto decoder = item.second();
+            p->type_names.emplace(typeid(*decoder), item.first);
+        }
+        p->named_decoder_count = p->decoder_map.size();
+    }
+    const auto it = p->type_names.find(typeid(decoder));
+    return it != p->type_names.end() ? it->second : "";
+}
+
 std::unique_ptr<Registry> Registry::create_mock()
 {
     return std::unique_ptr<Registry>(new Registry());
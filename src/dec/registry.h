@@ -19,6 +19,8 @@
 
 #include <functional>
 #include <memory>
+#include <set>
+#include <string>
 #include <vector>
 
 namespace au {
@@ -42,6 +44,15 @@ namespace dec {
         void add_decoder(const std::string &name, DecoderCreator creator);
         std::shared_ptr<IDecoder> create_decoder(const std::string &name) const;
 
+        // Returns the name the decoder's type was registered under, or an
+        // empty string if it wasn't registered.
+        std::string get_decoder_name(const IDecoder &decoder) const;
+
+        // Returns names of the formats the decoder links to, directly or
+        // through other linked decoders.
+        std::set<std::string> get_linked_decoder_names(
+            const IDecoder &decoder) const;
+
     private:
         Registry();
 
@@ -19,7 +19,7 @@
 #include <map>
 #include "algo/format.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
 
@@ -202,6 +202,11 @@ static bstr read_incremental(
     return data;
 }
 
+S25ImageArchiveDecoder::S25ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool S25ImageArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.stream.read(magic.size()) == magic;
@@ -248,7 +253,7 @@ std::unique_ptr<io::File> S25ImageArchiveDecoder::read_file_impl(
     const auto pixel_data = entry->flags & 0x80000000
         ? read_incremental(input_file.stream, *entry, m)
         : read_plain(input_file.stream, *entry);
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(
         logger,
         res::Image(
@@ -25,6 +25,9 @@ namespace shiina_rio {
 
     class S25ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        S25ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
@@ -18,28 +18,31 @@
 #include "dec/shiina_rio/warc_archive_decoder.h"
 #include "dec/png/png_image_decoder.h"
 #include "dec/shiina_rio/warc/decrypt.h"
+#include "io/assets.h"
 #include "io/file.h"
 #include "io/memory_byte_stream.h"
-#include "io/program_path.h"
 
 using namespace au;
 using namespace au::dec::shiina_rio;
 
-static bstr read_etc_file(const std::string &name)
+static std::shared_ptr<const bstr> read_etc_file(const std::string &name)
 {
-    const auto path = io::get_assets_dir_path() / "shiina_rio" / name;
-    io::File file(path, io::FileMode::Read);
-    return file.stream.seek(0).read_to_eof();
+    return io::read_asset(io::path("shiina_rio") / name);
 }
 
-static std::shared_ptr<res::Image> read_etc_image(const std::string &name)
+static std::shared_ptr<const res::Image> read_etc_image(
+    const std::string &name)
 {
-    Logger dummy_logger;
-    dummy_logger.mute();
-    io::File tmp_file("tmp.png", read_etc_file(name));
-    const auto png_decoder = dec::png::PngImageDecoder();
-    return std::make_shared<res::Image>(
-        png_decoder.decode(dummy_logger, tmp_file));
+    return io::get_derived_asset<res::Image>(
+        "shiina_rio/" + name,
+        [&]()
+        {
+            Logger dummy_logger;
+            dummy_logger.mute();
+            io::File tmp_file("tmp.png", *read_etc_file(name));
+            const auto png_decoder = dec::png::PngImageDecoder();
+            return png_decoder.decode(dummy_logger, tmp_file);
+        });
 }
 
 namespace
@@ -58,8 +61,8 @@ namespace
             for (const auto i : algo::range(0x100))
             {
                 key = 0x343FD * key + 0x269EC3;
-                data.at(i) ^= decode_table.at(
-                    ((key >> 16) % 0x8000) % decode_table.size());
+                data.at(i) ^= decode_table->at(
+                    ((key >> 16) % 0x8000) % decode_table->size());
             }
         }
 
@@ -123,8 +126,9 @@ namespace
 
     struct TableExtraCrypt final : public warc::BaseExtraCrypt
     {
-        TableExtraCrypt(const bstr &table, const u32 seed)
-            : table(table), seed(seed)
+        TableExtraCrypt(
+            const std::shared_ptr<const bstr> table, const u32 seed)
+                : table(table), seed(seed)
         {
         }
 
@@ -146,8 +150,8 @@ namespace
                 k[2] = k[1];
                 k[1] = k[0];
                 k[0] = j;
-                const auto idx = j % table.size();
-                data[i] ^= table[idx];
+                const auto idx = j % table->size();
+                data[i] ^= (*table)[idx];
             }
         }
 
@@ -157,7 +161,7 @@ namespace
         }
 
     private:
-        bstr table;
+        const std::shared_ptr<const bstr> table;
         u32 seed;
     };
 
@@ -273,10 +277,10 @@ WarcArchiveDecoder::WarcArchiveDecoder()
             p->version = 2370;
             p->entry_name_size = 0x10;
             p->region_image = read_etc_image("region.png");
-            p->logo_data = read_etc_file("logo_237.png");
+            p->logo_data = *read_etc_file("logo_237.png");
             p->initial_crypt_base_keys
                 = {0xF182C682, 0xE882AA82, 0x718E5896, 0x8183CC82, 0xDAC98283};
-            p->crc_crypt_source = read_etc_file("table1.bin");
+            p->crc_crypt_source = *read_etc_file("table1.bin");
             return p;
         });
 
@@ -289,7 +293,7 @@ WarcArchiveDecoder::WarcArchiveDecoder()
             p->version = 2490;
             p->entry_name_size = 0x20;
             p->region_image = read_etc_image("region.png");
-            p->logo_data = read_etc_file("logo_shojo_mama.jpg");
+            p->logo_data = *read_etc_file("logo_shojo_mama.jpg");
             p->initial_crypt_base_keys = {0x4B535453, 0xA15FA15F, 0, 0, 0};
             p->extra_crypt = std::make_unique<TableExtraCrypt>(
                 read_etc_file("extra_table.png"), 0xECB2F5B2);
@@ -306,7 +310,7 @@ WarcArchiveDecoder::WarcArchiveDecoder()
             p->version = 2490;
             p->entry_name_size = 0x20;
             p->region_image = read_etc_image("region.png");
-            p->logo_data = read_etc_file("logo_majime1.jpg");
+            p->logo_data = *read_etc_file("logo_majime1.jpg");
             p->initial_crypt_base_keys
                 = {0xF1AD65AB, 0x55B7E1AD, 0x62B875B8, 0, 0};
             p->extra_crypt = std::make_unique<RevolveExtraCrypt>();
@@ -322,10 +326,10 @@ WarcArchiveDecoder::WarcArchiveDecoder()
             p->version = 2500;
             p->entry_name_size = 0x20;
             p->region_image = read_etc_image("region.png");
-            p->logo_data = read_etc_file("logo_sorcery_jokers.jpg");
+            p->logo_data = *read_etc_file("logo_sorcery_jokers.jpg");
             p->initial_crypt_base_keys = {0x6C877787, 0x00007787, 0, 0, 0};
             p->extra_crypt = std::make_unique<SorceryJokersExtraCrypt>();
-            p->crc_crypt_source = read_etc_file("table4.bin");
+            p->crc_crypt_source = *read_etc_file("table4.bin");
             return p;
         });
 
@@ -338,7 +342,7 @@ WarcArchiveDecoder::WarcArchiveDecoder()
             p->version = 2500;
             p->entry_name_size = 0x20;
             p->region_image = read_etc_image("region.png");
-            p->logo_data = read_etc_file("logo_gohoushi_nurse.jpg");
+            p->logo_data = *read_etc_file("logo_gohoushi_nurse.jpg");
             p->initial_crypt_base_keys
                 = {0xEFED26E8, 0x8CF5A1EE, 0x13E9D4EC, 0, 0};
             p->extra_crypt = std::make_unique<TableExtraCrypt>(
@@ -356,7 +360,7 @@ WarcArchiveDecoder::WarcArchiveDecoder()
             p->version = 2490;
             p->entry_name_size = 0x20;
             p->region_image = read_etc_image("region.png");
-            p->logo_data = read_etc_file("logo_gensou_no_idea.jpg");
+            p->logo_data = *read_etc_file("logo_gensou_no_idea.jpg");
             p->initial_crypt_base_keys
                 = {0x45BA9DA7, 0x68A8E7A9, 0x6AA84DA8, 0, 0};
             p->extra_crypt = std::make_unique<RevolveExtraCrypt>();
@@ -372,7 +376,7 @@ WarcArchiveDecoder::WarcArchiveDecoder()
             p->version = 2500;
             p->entry_name_size = 0x20;
             p->region_image = read_etc_image("region.png");
-            p->logo_data = read_etc_file("logo_maki_fes.jpg");
+            p->logo_data = *read_etc_file("logo_maki_fes.jpg");
             p->initial_crypt_base_keys = {0xF6DF81DF, 0x1BDE29DE, 0x5DE, 0, 0};
             p->extra_crypt = std::make_unique<MakiFesExtraCrypt>();
             return p;
@@ -387,11 +391,11 @@ WarcArchiveDecoder::WarcArchiveDecoder()
             p->version = 2500;
             p->entry_name_size = 0x20;
             p->region_image = read_etc_image("region.png");
-            p->logo_data = read_etc_file("logo_bitch_neechan.jpg");
+            p->logo_data = *read_etc_file("logo_bitch_neechan.jpg");
             p->initial_crypt_base_keys
                 = {0x0FEE1FEE, 0x02E30DEE, 0x8CEFD2EF, 0xC7EF9CEF, 0xEEE2D9FD};
             p->extra_crypt = std::make_unique<BitchNeechanExtraCrypt>();
-            p->crc_crypt_source = read_etc_file("table4.bin");
+            p->crc_crypt_source = *read_etc_file("table4.bin");
             return p;
         });
 
@@ -404,11 +408,11 @@ WarcArchiveDecoder::WarcArchiveDecoder()
             p->version = 2500;
             p->entry_name_size = 0x20;
             p->region_image = read_etc_image("region.png");
-            p->logo_data = read_etc_file("logo_nukitashi.jpg");
+            p->logo_data = *read_etc_file("logo_nukitashi.jpg");
             p->initial_crypt_base_keys
                 = {0x90B989AF, 0x60BA6AB8, 0x86B9E6B9, 0xF3B999B9, 0xF2B9BCA8};
             p->extra_crypt = std::make_unique<NukiTashiExtraCrypt>();
-            p->crc_crypt_source = read_etc_file("table4.bin");
+            p->crc_crypt_source = *read_etc_file("table4.bin");
             return p;
         });
 
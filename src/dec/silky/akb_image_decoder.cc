@@ -107,7 +107,7 @@ res::Image AkbImageDecoder::decode_impl(
 
     base_image->overlay(
         overlay, x1, y1, res::Image::OverlayKind::OverwriteNonTransparent);
-    return *base_image;
+    return std::move(*base_image);
 }
 
 static auto _ = dec::register_decoder<AkbImageDecoder>("silky/akb");
@@ -19,7 +19,7 @@
 #include <map>
 #include "algo/format.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -191,6 +191,11 @@ static std::vector<TextureInfo> read_texture_info_list(
     return texture_info_list;
 }
 
+AnmArchiveDecoder::AnmArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 algo::NamingStrategy AnmArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Root;
@@ -248,7 +253,7 @@ std::unique_ptr<io::File> AnmArchiveDecoder::read_file_impl(
     for (const auto &texture_info : entry->texture_info_list)
         write_image(input_file.stream, texture_info, image, width);
 
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(logger, image, entry->path);
 }
 
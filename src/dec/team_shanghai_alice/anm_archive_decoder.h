@@ -25,6 +25,9 @@ namespace team_shanghai_alice {
 
     class AnmArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        AnmArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
@@ -19,7 +19,7 @@
 #include "algo/format.h"
 #include "algo/ptr.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
 
@@ -40,6 +40,11 @@ namespace
     };
 }
 
+Pak1ImageArchiveDecoder::Pak1ImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool Pak1ImageArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     if (!input_file.path.has_extension("dat"))
@@ -150,7 +155,7 @@ std::unique_ptr<io::File> Pak1ImageArchiveDecoder::read_file_impl(
     else
         throw err::UnsupportedBitDepthError(entry->depth);
 
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(logger, *image, entry->path);
 }
 
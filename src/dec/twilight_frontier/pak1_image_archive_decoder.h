@@ -25,6 +25,9 @@ namespace twilight_frontier {
 
     class Pak1ImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        Pak1ImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
@@ -16,13 +16,18 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/twilight_frontier/tfpk_archive_decoder.h"
-#include <map>
+#include <set>
+#include <unordered_map>
 #include "algo/crypt/rsa.h"
 #include "algo/format.h"
+#include "algo/hash_name_index.h"
 #include "algo/locale.h"
 #include "algo/pack/zlib.h"
 #include "algo/range.h"
+#include "dec/archive_meta_cache.h"
 #include "err.h"
+#include "io/assets.h"
+#include "io/file_byte_stream.h"
 #include "io/file_system.h"
 #include "io/memory_byte_stream.h"
 
@@ -55,7 +60,8 @@ namespace
         size_t file_count;
     };
 
-    using HashLookupMap = std::map<u32, std::string>;
+    using HashLookupMap = std::unordered_map<u32, std::string>;
+    using UserNameIndex = algo::HashNameIndex<u32>;
 
     class RsaReader final
     {
@@ -275,15 +281,54 @@ static std::string get_unknown_name(
     return algo::format("unk-%08x%s", hash, ext.c_str());
 }
 
+static std::shared_ptr<const UserNameIndex> get_user_fn_index(
+    const std::string &path, const TfpkVersion version)
+{
+    if (path.empty())
+        return std::make_shared<const UserNameIndex>();
+
+    // the index depends only on the list and on the hash variant, so it's
+    // built once and then shared by every archive and every worker thread.
+    const auto key = algo::format(
+        "tfpk/file-names:%d:%s", static_cast<int>(version), path.c_str());
+    return io::get_derived_asset<UserNameIndex>(key, [&]()
+    {
+        std::set<std::string> fn_set;
+        io::FileByteStream stream(path, io::FileMode::Read);
+        std::string line;
+        while ((line = stream.read_line().str()) != "")
+            fn_set.insert(line);
+        return UserNameIndex(fn_set, [&](const std::string &fn)
+        {
+            return get_file_name_hash(fn, version);
+        });
+    });
+}
+
 static std::string get_dir_name(
-    const DirEntry &dir_entry, const HashLookupMap user_fn_map)
+    const DirEntry &dir_entry, const UserNameIndex &user_fn_index)
 {
-    const auto it = user_fn_map.find(dir_entry.initial_hash);
-    if (it != user_fn_map.end())
-        return it->second;
+    const auto name = user_fn_index.find(dir_entry.initial_hash);
+    if (name)
+        return *name;
     return get_unknown_name(0, dir_entry.initial_hash, "");
 }
 
+static std::string get_file_name(
+    const int index,
+    const u32 hash,
+    const HashLookupMap &fn_map,
+    const UserNameIndex &user_fn_index)
+{
+    const auto name = user_fn_index.find(hash);
+    if (name)
+        return *name;
+    const auto it = fn_map.find(hash);
+    if (it != fn_map.end())
+        return it->second;
+    return get_unknown_name(index, hash);
+}
+
 static std::vector<DirEntry> read_dir_entries(RsaReader &reader)
 {
     std::vector<DirEntry> dirs;
@@ -302,7 +347,7 @@ static std::vector<DirEntry> read_dir_entries(RsaReader &reader)
 static HashLookupMap read_fn_map(
     RsaReader &reader,
     const std::vector<DirEntry> &dir_entries,
-    const HashLookupMap &user_fn_map,
+    const UserNameIndex &user_fn_index,
     TfpkVersion version)
 {
     HashLookupMap fn_map;
@@ -322,7 +367,7 @@ static HashLookupMap read_fn_map(
 
     for (const auto &dir_entry : dir_entries)
     {
-        auto dn = get_dir_name(dir_entry, user_fn_map);
+        auto dn = get_dir_name(dir_entry, user_fn_index);
         if (dn.size() > 0 && dn[dn.size() - 1] != '/')
             dn += "/";
 
@@ -359,14 +404,7 @@ TfpkArchiveDecoder::TfpkArchiveDecoder()
         },
         [&](const ArgParser &arg_parser)
         {
-            const auto path = arg_parser.get_switch("file-names");
-            if (path != "")
-            {
-                io::FileByteStream stream(path, io::FileMode::Read);
-                std::string line;
-                while ((line = stream.read_line().str()) != "")
-                    fn_set.insert(line);
-            }
+            file_names_path = arg_parser.get_switch("file-names");
         });
 }
 
@@ -388,9 +426,8 @@ std::unique_ptr<dec::ArchiveMeta> TfpkArchiveDecoder::read_meta_impl(
         ? TfpkVersion::Th135
         : TfpkVersion::Th145;
 
-    HashLookupMap user_fn_map;
-    for (const auto &fn : fn_set)
-        user_fn_map[get_file_name_hash(fn, meta->version)] = fn;
+    const auto user_fn_index
+        = get_user_fn_index(file_names_path, meta->version);
 
     RsaReader reader(input_file.stream);
     HashLookupMap fn_map;
@@ -398,10 +435,10 @@ std::unique_ptr<dec::ArchiveMeta> TfpkArchiveDecoder::read_meta_impl(
     // TH135 contains file hashes, TH145 contains garbage
     const auto dir_entries = read_dir_entries(reader);
     if (dir_entries.size() > 0)
-        fn_map = read_fn_map(reader, dir_entries, user_fn_map, meta->version);
-
-    for (const auto &it : user_fn_map)
-        fn_map[it.first] = it.second;
+    {
+        fn_map = read_fn_map(
+            reader, dir_entries, *user_fn_index, meta->version);
+    }
 
     const auto file_count = reader.read_block()->read_le<u32>();
     for (const auto i : algo::range(file_count))
@@ -416,10 +453,7 @@ std::unique_ptr<dec::ArchiveMeta> TfpkArchiveDecoder::read_meta_impl(
             entry->offset = b1->read_le<u32>();
 
             const auto fn_hash = b2->read_le<u32>();
-            const auto it = fn_map.find(fn_hash);
-            entry->path = it == fn_map.end()
-                ? get_unknown_name(i, fn_hash)
-                : it->second;
+            entry->path = get_file_name(i, fn_hash, fn_map, *user_fn_index);
 
             entry->key = b3->read(16);
         }
@@ -430,10 +464,8 @@ std::unique_ptr<dec::ArchiveMeta> TfpkArchiveDecoder::read_meta_impl(
 
             const auto fn_hash = b2->read_le<u32>() ^ b3->read_le<u32>();
             const auto unk = b2->read_le<u32>() ^ b3->read_le<u32>();
-            const auto it = fn_map.find(fn_hash);
-            entry->path = it == fn_map.end()
-                ? get_unknown_name(i + 1, fn_hash)
-                : it->second;
+            entry->path = get_file_name(
+                i + 1, fn_hash, fn_map, *user_fn_index);
 
             b3->seek(0);
             io::MemoryByteStream key_stream;
@@ -467,6 +499,46 @@ std::unique_ptr<io::File> TfpkArchiveDecoder::read_file_impl(
     return output_file;
 }
 
+bool TfpkArchiveDecoder::supports_meta_cache() const
+{
+    return true;
+}
+
+void TfpkArchiveDecoder::write_cached_meta(
+    io::BaseByteStream &output, const dec::ArchiveMeta &m) const
+{
+    const auto meta = static_cast<const CustomArchiveMeta*>(&m);
+    output.write<u8>(static_cast<u8>(meta->version));
+    output.write_le<u32>(meta->entries.size());
+    for (const auto &e : meta->entries)
+    {
+        const auto entry = static_cast<const CustomArchiveEntry*>(e.get());
+        write_cached_entry(output, *entry);
+        write_cached_bstr(output, entry->key);
+    }
+}
+
+std::unique_ptr<dec::ArchiveMeta> TfpkArchiveDecoder::read_cached_meta(
+    io::BaseByteStream &input) const
+{
+    auto meta = std::make_unique<CustomArchiveMeta>();
+    const auto version = input.read<u8>();
+    if (version > static_cast<u8>(TfpkVersion::Th145))
+        throw err::CorruptDataError("Unknown version");
+    meta->version = static_cast<TfpkVersion>(version);
+    const auto entry_count = input.read_le<u32>();
+    for (const auto i : algo::range(entry_count))
+    {
+        auto entry = std::make_unique<CustomArchiveEntry>();
+        read_cached_entry(input, *entry);
+        entry->key = read_cached_bstr(input);
+        if (entry->key.empty())
+            throw err::CorruptDataError("Missing entry key");
+        meta->entries.push_back(std::move(entry));
+    }
+    return meta;
+}
+
 std::vector<std::string> TfpkArchiveDecoder::get_linked_formats() const
 {
     return
@@ -17,7 +17,6 @@
 
 #pragma once
 
-#include <set>
 #include "dec/base_archive_decoder.h"
 
 namespace au {
@@ -43,8 +42,17 @@ namespace twilight_frontier {
             const ArchiveMeta &m,
             const ArchiveEntry &e) const override;
 
+        bool supports_meta_cache() const override;
+
+        void write_cached_meta(
+            io::BaseByteStream &output,
+            const ArchiveMeta &meta) const override;
+
+        std::unique_ptr<ArchiveMeta> read_cached_meta(
+            io::BaseByteStream &input) const override;
+
     private:
-        std::set<std::string> fn_set;
+        std::string file_names_path;
     };
 
 } } }
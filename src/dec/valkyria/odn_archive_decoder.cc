@@ -18,7 +18,7 @@
 #include "dec/valkyria/odn_archive_decoder.h"
 #include <map>
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
 
@@ -57,6 +57,11 @@ static size_t hex_to_int(const bstr &input)
     return ret;
 }
 
+OdnArchiveDecoder::OdnArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 bool OdnArchiveDecoder::is_recognized_impl(io::File &input_file) const
 {
     return input_file.path.has_extension("odn");
@@ -181,10 +186,12 @@ static bstr decompress(const bstr &input, const size_t chunk_size)
     return output;
 }
 
-static bstr decompress_bgr(const Logger &logger, const bstr &input)
+static bstr decompress_bgr(
+    const Logger &logger,
+    const enc::BaseImageEncoder &encoder,
+    const bstr &input)
 {
     const auto output = decompress(input, 3);
-    const auto encoder = enc::png::PngImageEncoder();
     for (const auto &known_image_size : known_image_sizes)
     {
         const auto width = std::get<0>(known_image_size);
@@ -200,10 +207,12 @@ static bstr decompress_bgr(const Logger &logger, const bstr &input)
     return output;
 }
 
-static bstr decompress_bgra(const Logger &logger, const bstr &input)
+static bstr decompress_bgra(
+    const Logger &logger,
+    const enc::BaseImageEncoder &encoder,
+    const bstr &input)
 {
     const auto output = decompress(input, 4);
-    const auto encoder = enc::png::PngImageEncoder();
     for (const auto &known_image_size : known_image_sizes)
     {
         const auto width = std::get<0>(known_image_size);
@@ -246,9 +255,9 @@ std::unique_ptr<io::File> OdnArchiveDecoder::read_file_impl(
     const auto prefix = entry->path.str().substr(0, 4);
     auto data = input_file.stream.seek(entry->offset).read(entry->size);
     if (prefix == "back")
-        data = decompress_bgr(logger, data);
+        data = decompress_bgr(logger, get_image_encoder(), data);
     if (prefix == "codn" || prefix == "cccc")
-        data = decompress_bgra(logger, data);
+        data = decompress_bgra(logger, get_image_encoder(), data);
     auto ret = std::make_unique<io::File>(entry->path, data);
     ret->guess_extension();
     return ret;
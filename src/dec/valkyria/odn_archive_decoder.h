@@ -25,6 +25,9 @@ namespace valkyria {
 
     class OdnArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        OdnArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
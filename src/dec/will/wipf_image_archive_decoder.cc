@@ -17,7 +17,7 @@
 
 #include "dec/will/wipf_image_archive_decoder.h"
 #include "algo/range.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 #include "io/memory_byte_stream.h"
 #include "virtual_file_system.h"
@@ -150,6 +150,11 @@ static std::unique_ptr<dec::ArchiveMeta> read_meta(io::File &input_file)
     return meta;
 }
 
+WipfImageArchiveDecoder::WipfImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 algo::NamingStrategy WipfImageArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Sibling;
@@ -194,7 +199,7 @@ std::unique_ptr<io::File> WipfImageArchiveDecoder::read_file_impl(
     auto image = read_image(input_file, *entry);
     if (entry->mask)
         image->apply_mask(*entry->mask);
-    const auto encoder = enc::png::PngImageEncoder();
+    const auto &encoder = get_image_encoder();
     return encoder.encode(logger, *image, entry->path);
 }
 
@@ -26,6 +26,9 @@ namespace will {
 
     class WipfImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        WipfImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
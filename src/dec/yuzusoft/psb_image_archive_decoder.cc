@@ -20,7 +20,7 @@
 #include "algo/range.h"
 #include "dec/kirikiri/tlg_image_decoder.h"
 #include "dec/png/png_image_decoder.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/base_image_encoder.h"
 #include "err.h"
 
 using namespace au;
@@ -256,6 +256,11 @@ io::BaseByteStream &NamedDirectory::get(const std::string &name)
     throw err::CorruptDataError("Missing entry '" + name + "'");
 }
 
+PsbImageArchiveDecoder::PsbImageArchiveDecoder()
+{
+    add_image_format_option();
+}
+
 algo::NamingStrategy PsbImageArchiveDecoder::naming_strategy() const
 {
     return algo::NamingStrategy::Sibling;
@@ -402,7 +407,7 @@ std::unique_ptr<io::File> PsbImageArchiveDecoder::read_file_impl(
         image = std::move(base_image);
     }
 
-    return enc::png::PngImageEncoder().encode(logger, *image, entry->path);
+    return get_image_encoder().encode(logger, *image, entry->path);
 }
 
 static auto _ = dec::register_decoder<PsbImageArchiveDecoder>("yuzusoft/psb");
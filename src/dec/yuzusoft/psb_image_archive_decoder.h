@@ -26,6 +26,9 @@ namespace yuzusoft {
 
     class PsbImageArchiveDecoder final : public BaseArchiveDecoder
     {
+    public:
+        PsbImageArchiveDecoder();
+
     protected:
         bool is_recognized_impl(io::File &input_file) const override;
 
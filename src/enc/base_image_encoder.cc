@@ -16,16 +16,112 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "enc/base_image_encoder.h"
+#include <cstring>
+#include "algo/range.h"
+#include "err.h"
 
 using namespace au;
 using namespace au::enc;
 
+class BaseImageEncoder::CollectingBandSink final : public res::IImageBandSink
+{
+public:
+    CollectingBandSink(
+        const BaseImageEncoder &encoder,
+        const Logger &logger,
+        io::File &output_file);
+
+    void begin(
+        const size_t width,
+        const size_t height,
+        const bool is_opaque) override;
+    void write_band(const res::ImageView &band) override;
+    void end() override;
+
+private:
+    const BaseImageEncoder &encoder;
+    const Logger &logger;
+    io::File &output_file;
+    std::unique_ptr<res::Image> image;
+    size_t next_row;
+};
+
+BaseImageEncoder::CollectingBandSink::CollectingBandSink(
+    const BaseImageEncoder &encoder,
+    const Logger &logger,
+    io::File &output_file) :
+        encoder(encoder),
+        logger(logger),
+        output_file(output_file),
+        next_row(0)
+{
+}
+
+void BaseImageEncoder::CollectingBandSink::begin(
+    const size_t width, const size_t height, const bool is_opaque)
+{
+    image = std::make_unique<res::Image>(width, height);
+    next_row = 0;
+}
+
+void BaseImageEncoder::CollectingBandSink::write_band(
+    const res::ImageView &band)
+{
+    if (band.width() != image->width()
+        || next_row + band.height() > image->height())
+    {
+        throw err::BadDataSizeError();
+    }
+    for (const auto y : algo::range(band.height()))
+    {
+        const auto output_ptr = &image->at(0, next_row + y);
+        const auto row_ptr = band.get_row(y, output_ptr);
+        if (row_ptr != output_ptr)
+            std::memcpy(output_ptr, row_ptr, band.width() * sizeof(res::Pixel));
+    }
+    next_row += band.height();
+}
+
+void BaseImageEncoder::CollectingBandSink::end()
+{
+    if (next_row != image->height())
+        throw err::BadDataSizeError();
+    encoder.encode_impl(logger, *image, output_file);
+    image.reset();
+}
+
+std::vector<ArgParserDecorator>
+    BaseImageEncoder::get_arg_parser_decorators() const
+{
+    return arg_parser_decorators;
+}
+
+void BaseImageEncoder::add_arg_parser_decorator(
+    const std::function<void(ArgParser &)> register_callback,
+    const std::function<void(const ArgParser &)> parse_callback)
+{
+    arg_parser_decorators.push_back(
+        ArgParserDecorator(register_callback, parse_callback));
+}
+
 std::unique_ptr<io::File> BaseImageEncoder::encode(
     const Logger &logger,
-    const res::Image &input_image,
+    const res::ImageView &input_image,
     const io::path &name) const
 {
     auto output_file = std::make_unique<io::File>(name, ""_b);
     encode_impl(logger, input_image, *output_file);
     return output_file;
 }
+
+std::unique_ptr<res::IImageBandSink> BaseImageEncoder::create_band_sink(
+    const Logger &logger, io::File &output_file) const
+{
+    return create_band_sink_impl(logger, output_file);
+}
+
+std::unique_ptr<res::IImageBandSink> BaseImageEncoder::create_band_sink_impl(
+    const Logger &logger, io::File &output_file) const
+{
+    return std::make_unique<CollectingBandSink>(*this, logger, output_file);
+}
@@ -17,9 +17,12 @@
 
 #pragma once
 
+#include <vector>
+#include "arg_parser_decorator.h"
 #include "io/file.h"
 #include "logger.h"
-#include "res/image.h"
+#include "res/iimage_band_sink.h"
+#include "res/image_view.h"
 
 namespace au {
 namespace enc {
@@ -29,16 +32,36 @@ namespace enc {
     public:
         virtual ~BaseImageEncoder() {}
 
+        std::vector<ArgParserDecorator> get_arg_parser_decorators() const;
+
         std::unique_ptr<io::File> encode(
             const Logger &logger,
-            const res::Image &input_image,
+            const res::ImageView &input_image,
             const io::path &name) const;
 
+        // Returns a sink that encodes the image it receives to the file,
+        // which must outlive it. Unless overridden, the bands are collected
+        // and encoded at the end.
+        std::unique_ptr<res::IImageBandSink> create_band_sink(
+            const Logger &logger, io::File &output_file) const;
+
     protected:
+        void add_arg_parser_decorator(
+            const std::function<void(ArgParser &)> register_callback,
+            const std::function<void(const ArgParser &)> parse_callback);
+
         virtual void encode_impl(
             const Logger &logger,
-            const res::Image &input_image,
+            const res::ImageView &input_image,
             io::File &output_file) const = 0;
+
+        virtual std::unique_ptr<res::IImageBandSink> create_band_sink_impl(
+            const Logger &logger, io::File &output_file) const;
+
+    private:
+        class CollectingBandSink;
+
+        std::vector<ArgParserDecorator> arg_parser_decorators;
     };
 
 } }
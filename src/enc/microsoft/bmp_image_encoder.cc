@@ -16,19 +16,21 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "enc/microsoft/bmp_image_encoder.h"
+#include <cstring>
 #include "algo/range.h"
+#include "enc/registry.h"
 
 using namespace au;
 using namespace au::enc::microsoft;
 
 void BmpImageEncoder::encode_impl(
     const Logger &logger,
-    const res::Image &input_image,
+    const res::ImageView &input_image,
     io::File &output_file) const
 {
     const auto width = input_image.width();
     const auto height = input_image.height();
-    const auto stride = ((width * 4) + 3) & ~3;
+    const auto stride = width * 4;
 
     // BITMAPFILEHEADER
     output_file.stream.write("BM"_b);
@@ -50,18 +52,19 @@ void BmpImageEncoder::encode_impl(
     output_file.stream.write_le<u32>(0);        // biClrUsed
     output_file.stream.write_le<u32>(0);        // biClrImportant
 
+    // 32-bit rows need no padding, and res::Pixel is laid out as BGRA, so
+    // the rows can be written as they are.
+    bstr data(stride * height);
     for (const auto y : algo::range(height))
     {
-        for (const auto x : algo::range(width))
-        {
-            const auto &c = input_image.at(x, y);
-            output_file.stream.write<u8>(c.b);
-            output_file.stream.write<u8>(c.g);
-            output_file.stream.write<u8>(c.r);
-            output_file.stream.write<u8>(c.a);
-        }
-        output_file.stream.write(bstr(stride - 4 * width));
+        const auto output_ptr = data.get<res::Pixel>() + y * width;
+        const auto row_ptr = input_image.get_row(y, output_ptr);
+        if (row_ptr != output_ptr)
+            std::memcpy(output_ptr, row_ptr, stride);
     }
+    output_file.stream.write(data);
 
     output_file.path.change_extension("bmp");
 }
+
+static auto _ = enc::register_image_encoder<BmpImageEncoder>("bmp");
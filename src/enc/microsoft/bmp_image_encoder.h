@@ -28,7 +28,7 @@ namespace microsoft {
     protected:
         void encode_impl(
             const Logger &logger,
-            const res::Image &input_image,
+            const res::ImageView &input_image,
             io::File &output_file) const override;
     };
 
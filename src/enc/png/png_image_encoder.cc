@@ -16,69 +16,1221 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "enc/png/png_image_encoder.h"
-#include <png.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <zlib.h>
 #include "algo/range.h"
+#include "algo/str.h"
+#include "enc/registry.h"
 #include "err.h"
-#include "io/memory_byte_stream.h"
 
 using namespace au;
 using namespace au::enc::png;
 
-static void write_handler(
-    png_structp png_ptr, png_bytep input, png_size_t size)
+namespace
 {
-    auto output_stream
-        = reinterpret_cast<io::BaseByteStream*>(png_get_io_ptr(png_ptr));
-    output_stream->write(bstr(input, size));
+    struct Preset final
+    {
+        std::string name;
+        std::string description;
+        int compression_level;
+        PngFilter filter;
+    };
+
+    struct Band final
+    {
+        size_t start;
+        size_t size;
+        bstr deflated;
+        uLong adler;
+    };
+
+    enum class ColorType : u8
+    {
+        Gray = 0,
+        Rgb = 2,
+        Palette = 3,
+        GrayAlpha = 4,
+        Rgba = 6,
+    };
+
+    // Maps up to 256 colors to their palette indices, remembering the order
+    // they were added in.
+    class ColorTable final
+    {
+    public:
+        ColorTable();
+        int find(const u32 color) const;
+        bool insert(const u32 color);
+
+        std::vector<u32> colors;
+
+    private:
+        size_t get_slot(const u32 color) const;
+
+        std::vector<u32> slot_colors;
+        std::vector<int> slot_indices;
+    };
+
+    struct Layout final
+    {
+        ColorType color_type;
+        size_t bpp;
+        ColorTable color_table;
+    };
+
+    // Narrows down the color types that can hold the pixels seen so far
+    // losslessly. If the palette is given, the pixels are expected to use
+    // only its colors, which keeps their order; otherwise the colors are
+    // collected as they come.
+    class ColorAnalysis final
+    {
+    public:
+        ColorAnalysis(const res::Palette *palette);
+
+        void add_row(const res::Pixel *row_ptr, const size_t width);
+
+        // Whether anything smaller than RGBA, or than RGB for images known
+        // to be opaque, might still do.
+        bool is_reducible(const bool is_opaque) const;
+
+        Layout get_layout() const;
+
+    private:
+        Layout layout;
+        bool fixed_palette;
+        bool fits_palette;
+        bool has_pixels;
+        u32 alpha_mask;
+        u32 color_difference;
+        u32 last_color;
+    };
+
+    // Streams large images: the rows are filtered as they arrive and
+    // deflated in batches, whose bands are deflated in parallel and written
+    // out as IDAT chunks. Opaque images are streamed as RGB and the others
+    // as RGBA. The first bands are held for as long as a smaller color type
+    // might do, up to max_held_pixel_count pixels; images that end before
+    // that go to the fallback sink like small images do, which encodes them
+    // as a whole with the reduced color type.
+    class StreamingBandSink final : public res::IImageBandSink
+    {
+    public:
+        StreamingBandSink(
+            io::File &output_file,
+            std::unique_ptr<res::IImageBandSink> fallback_sink,
+            const int compression_level,
+            const PngFilter filter,
+            const size_t thread_count,
+            const size_t min_streamed_pixel_count);
+
+        void begin(
+            const size_t width,
+            const size_t height,
+            const bool is_opaque) override;
+        void write_band(const res::ImageView &band) override;
+        void end() override;
+
+    private:
+        void start_streaming();
+        void stream_band(const res::ImageView &band);
+        void deflate_batch(const bool is_last);
+
+        io::File &output_file;
+        std::unique_ptr<res::IImageBandSink> fallback_sink;
+        const int compression_level;
+        const PngFilter filter;
+        const size_t thread_count;
+        const size_t min_streamed_pixel_count;
+
+        bool is_large;
+        bool is_opaque;
+        bool is_streaming;
+        size_t width, height;
+        size_t next_row;
+        std::unique_ptr<ColorAnalysis> analysis;
+        std::list<res::Image> held_bands;
+        size_t held_pixel_count;
+        Layout layout;
+        std::vector<res::Pixel> input_row;
+        bstr row, prev_row, scratch;
+
+        // the dictionary for the next batch followed by the filtered rows
+        // waiting to be deflated
+        bstr filtered_data;
+        size_t dictionary_size;
+        uLong adler;
+    };
+}
+
+static const bstr magic = "\x89PNG\x0D\x0A\x1A\x0A"_b;
+static const size_t max_palette_size = 256;
+static const size_t color_table_size = 1024;
+
+// Images are analyzed in blocks that stay in the cache, so that the check
+// of alpha and grayness can be vectorized separately from the color table
+// lookups without reading the image twice.
+static const size_t analysis_block_size = 4096;
+
+// Bands are big enough for deflate to find nearly all matches it would find
+// in a single stream, and small enough to keep all threads busy.
+static const size_t min_band_size = 256 * 1024;
+
+// Streamed rows are deflated in batches of about this size, which are split
+// into bands for the threads.
+static const size_t streamed_batch_size = 16 * min_band_size;
+
+// Large images are held for at most about this many pixels while they might
+// fit a smaller color type, which keeps the memory they take bounded.
+static const size_t max_held_pixel_count = 1024 * 1024;
+
+static const std::vector<std::pair<std::string, PngFilter>> filter_names
+{
+    {"none", PngFilter::None},
+    {"sub", PngFilter::Sub},
+    {"up", PngFilter::Up},
+    {"average", PngFilter::Average},
+    {"paeth", PngFilter::Paeth},
+    {"adaptive", PngFilter::Adaptive},
+};
+
+static const std::vector<Preset> presets
+{
+    {"fast", "zlib level 1, no filtering (default)", 1, PngFilter::None},
+    {"balanced", "zlib level 6, adaptive filtering", 6, PngFilter::Adaptive},
+    {"small", "zlib level 9, adaptive filtering", 9, PngFilter::Adaptive},
+};
+
+ColorTable::ColorTable() :
+    slot_colors(color_table_size),
+    slot_indices(color_table_size, -1)
+{
+}
+
+size_t ColorTable::get_slot(const u32 color) const
+{
+    auto slot = (color * 2654435761u) >> 22;
+    while (slot_indices[slot] != -1 && slot_colors[slot] != color)
+        slot = (slot + 1) & (color_table_size - 1);
+    return slot;
+}
+
+int ColorTable::find(const u32 color) const
+{
+    return slot_indices[get_slot(color)];
+}
+
+bool ColorTable::insert(const u32 color)
+{
+    const auto slot = get_slot(color);
+    if (slot_indices[slot] != -1)
+        return true;
+    if (colors.size() == max_palette_size)
+        return false;
+    slot_colors[slot] = color;
+    slot_indices[slot] = colors.size();
+    colors.push_back(color);
+    return true;
+}
+
+static inline u32 pixel_to_u32(const res::Pixel &c)
+{
+    return c.b | (c.g << 8) | (c.r << 16) | (static_cast<u32>(c.a) << 24);
+}
+
+ColorAnalysis::ColorAnalysis(const res::Palette *palette) :
+    fixed_palette(palette != nullptr),
+    fits_palette(true),
+    has_pixels(false),
+    alpha_mask(0xFFFFFFFF),
+    color_difference(0),
+    last_color(0)
+{
+    if (fixed_palette)
+        for (const auto &c : *palette)
+            layout.color_table.insert(pixel_to_u32(c));
+}
+
+void ColorAnalysis::add_row(const res::Pixel *row_ptr, const size_t width)
+{
+    if (!has_pixels)
+    {
+        last_color = ~pixel_to_u32(*row_ptr);
+        has_pixels = true;
+    }
+
+    auto &color_table = layout.color_table;
+    const auto row_end = row_ptr + width;
+    for (auto block_ptr = row_ptr; block_ptr < row_end; )
+    {
+        const auto block_end = block_ptr + std::min<size_t>(
+            analysis_block_size, row_end - block_ptr);
+
+        for (auto ptr = block_ptr; ptr < block_end; ptr++)
+        {
+            const auto color = pixel_to_u32(*ptr);
+            alpha_mask &= color;
+            color_difference |= (color ^ (color >> 8)) & 0xFFFF;
+        }
+
+        for (auto ptr = block_ptr; fits_palette && ptr < block_end; ptr++)
+        {
+            const auto color = pixel_to_u32(*ptr);
+            if (color == last_color)
+                continue;
+            last_color = color;
+            fits_palette = fixed_palette
+                ? color_table.find(color) != -1
+                : color_table.insert(color);
+        }
+
+        block_ptr = block_end;
+    }
+}
+
+bool ColorAnalysis::is_reducible(const bool is_opaque) const
+{
+    if (color_difference == 0 || fits_palette)
+        return true;
+    return !is_opaque && (alpha_mask >> 24) == 0xFF;
+}
+
+// Picks the smallest color type that represents the pixels losslessly.
+Layout ColorAnalysis::get_layout() const
+{
+    auto layout = this->layout;
+    const auto opaque = (alpha_mask >> 24) == 0xFF;
+    const auto gray = color_difference == 0;
+    if (gray && opaque)
+        layout.color_type = ColorType::Gray;
+    else if (fits_palette)
+        layout.color_type = ColorType::Palette;
+    else if (gray)
+        layout.color_type = ColorType::GrayAlpha;
+    else if (opaque)
+        layout.color_type = ColorType::Rgb;
+    else
+        layout.color_type = ColorType::Rgba;
+
+    layout.bpp
+        = layout.color_type == ColorType::Gray ? 1
+        : layout.color_type == ColorType::Palette ? 1
+        : layout.color_type == ColorType::GrayAlpha ? 2
+        : layout.color_type == ColorType::Rgb ? 3 : 4;
+    return layout;
+}
+
+static Layout analyze_image(
+    const res::ImageView &image, const res::Palette *palette)
+{
+    ColorAnalysis analysis(palette);
+    std::vector<res::Pixel> scratch(image.width());
+    for (const auto y : algo::range(image.height()))
+        analysis.add_row(image.get_row(y, scratch.data()), image.width());
+    return analysis.get_layout();
+}
+
+static Layout get_layout(const res::ImageView &image)
+{
+    const auto palette = image.get_source_palette();
+    if (palette && palette->size() <= max_palette_size)
+    {
+        auto layout = analyze_image(image, palette.get());
+        if (layout.color_type == ColorType::Palette
+            || layout.color_type == ColorType::Gray)
+        {
+            return layout;
+        }
+    }
+    return analyze_image(image, nullptr);
+}
+
+// Helper threads are taken from a budget shared by all encoders, so that
+// images encoded at once by the unpacker's workers don't each start a full
+// set of threads. Encoders that find the budget used up run alone.
+static std::atomic<size_t> &get_spare_thread_count()
+{
+    static std::atomic<size_t> spare_thread_count(
+        std::max<size_t>(1, std::thread::hardware_concurrency()) - 1);
+    return spare_thread_count;
+}
+
+static size_t acquire_helper_threads(const size_t wanted_count)
+{
+    auto &spare_thread_count = get_spare_thread_count();
+    auto available_count = spare_thread_count.load();
+    while (true)
+    {
+        const auto count = std::min(wanted_count, available_count);
+        if (spare_thread_count.compare_exchange_weak(
+            available_count, available_count - count))
+        {
+            return count;
+        }
+    }
+}
+
+static void release_helper_threads(const size_t count)
+{
+    get_spare_thread_count() += count;
+}
+
+// Runs the tasks on the calling thread and on up to thread_count - 1 helper
+// threads, or on as many helpers as the shared budget allows if
+// thread_count is 0.
+static void run_in_parallel(
+    const size_t task_count,
+    const size_t thread_count,
+    const std::function<void(size_t)> &task)
+{
+    std::atomic<size_t> next_task(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    const auto work = [&]()
+    {
+        while (true)
+        {
+            const size_t i = next_task++;
+            if (i >= task_count)
+                return;
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    if (task_count > 1)
+    {
+        const auto wanted_count = thread_count
+            ? std::min(thread_count, task_count) - 1
+            : task_count - 1;
+        const auto helper_count = thread_count
+            ? wanted_count
+            : acquire_helper_threads(wanted_count);
+        try
+        {
+            for (const auto i : algo::range(helper_count))
+                threads.push_back(std::thread(work));
+        }
+        catch (...)
+        {
+            // too many threads for the system; the rest runs here
+        }
+        work();
+        for (auto &thread : threads)
+            thread.join();
+        if (!thread_count)
+            release_helper_threads(helper_count);
+    }
+    else
+        work();
+    if (error)
+        std::rethrow_exception(error);
 }
 
-static void flush_handler(png_structp)
+static void convert_row(
+    const Layout &layout, const res::Pixel *input_ptr, u8 *output_ptr, size_t n)
+{
+    switch (layout.color_type)
+    {
+        case ColorType::Gray:
+            while (n--)
+                *output_ptr++ = (input_ptr++)->r;
+            break;
+
+        case ColorType::GrayAlpha:
+            while (n--)
+            {
+                *output_ptr++ = input_ptr->r;
+                *output_ptr++ = input_ptr->a;
+                input_ptr++;
+            }
+            break;
+
+        case ColorType::Palette:
+        {
+            auto last_color = ~pixel_to_u32(*input_ptr);
+            u8 last_index = 0;
+            while (n--)
+            {
+                const auto color = pixel_to_u32(*input_ptr++);
+                if (color != last_color)
+                {
+                    last_color = color;
+                    last_index = layout.color_table.find(color);
+                }
+                *output_ptr++ = last_index;
+            }
+            break;
+        }
+
+        case ColorType::Rgb:
+            while (n--)
+            {
+                *output_ptr++ = input_ptr->r;
+                *output_ptr++ = input_ptr->g;
+                *output_ptr++ = input_ptr->b;
+                input_ptr++;
+            }
+            break;
+
+        case ColorType::Rgba:
+            while (n--)
+            {
+                *output_ptr++ = input_ptr->r;
+                *output_ptr++ = input_ptr->g;
+                *output_ptr++ = input_ptr->b;
+                *output_ptr++ = input_ptr->a;
+                input_ptr++;
+            }
+            break;
+    }
+}
+
+static inline u8 paeth_predictor(const int a, const int b, const int c)
+{
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return a;
+    return pb <= pc ? b : c;
+}
+
+static void apply_filter(
+    const PngFilter filter,
+    const size_t bpp,
+    const u8 *row,
+    const u8 *prev_row,
+    u8 *output,
+    const size_t size)
+{
+    switch (filter)
+    {
+        case PngFilter::None:
+            std::memcpy(output, row, size);
+            break;
+
+        case PngFilter::Sub:
+            std::memcpy(output, row, bpp);
+            for (const auto i : algo::range(bpp, size))
+                output[i] = row[i] - row[i - bpp];
+            break;
+
+        case PngFilter::Up:
+            for (const auto i : algo::range(size))
+                output[i] = row[i] - prev_row[i];
+            break;
+
+        case PngFilter::Average:
+            for (const auto i : algo::range(bpp))
+                output[i] = row[i] - (prev_row[i] >> 1);
+            for (const auto i : algo::range(bpp, size))
+                output[i] = row[i] - ((row[i - bpp] + prev_row[i]) >> 1);
+            break;
+
+        case PngFilter::Paeth:
+            for (const auto i : algo::range(bpp))
+                output[i] = row[i] - prev_row[i];
+            for (const auto i : algo::range(bpp, size))
+            {
+                output[i] = row[i] - paeth_predictor(
+                    row[i - bpp], prev_row[i], prev_row[i - bpp]);
+            }
+            break;
+
+        default:
+            throw std::logic_error("Bad PNG filter");
+    }
+}
+
+// Picks the filter whose output has the smallest sum of absolute values,
+// which is the heuristic recommended by the PNG specification.
+static void apply_adaptive_filter(
+    const size_t bpp,
+    const u8 *row,
+    const u8 *prev_row,
+    u8 *output,
+    const size_t size,
+    bstr &scratch)
+{
+    size_t best_score = static_cast<size_t>(-1);
+    for (const auto i : algo::range(5))
+    {
+        const auto filter = static_cast<PngFilter>(i);
+        apply_filter(filter, bpp, row, prev_row, scratch.get<u8>(), size);
+        size_t score = 0;
+        for (const auto c : scratch)
+            score += std::abs(static_cast<s8>(c));
+        if (score < best_score)
+        {
+            best_score = score;
+            output[-1] = i;
+            std::memcpy(output, scratch.get<u8>(), size);
+        }
+    }
+}
+
+// Writes the filter type byte followed by the filtered row.
+static void filter_row(
+    const PngFilter filter,
+    const size_t bpp,
+    const u8 *row,
+    const u8 *prev_row,
+    u8 *output_ptr,
+    const size_t size,
+    bstr &scratch)
+{
+    if (filter == PngFilter::Adaptive)
+    {
+        apply_adaptive_filter(
+            bpp, row, prev_row, output_ptr + 1, size, scratch);
+        return;
+    }
+    *output_ptr = static_cast<u8>(filter);
+    apply_filter(filter, bpp, row, prev_row, output_ptr + 1, size);
+}
+
+static void filter_rows(
+    const res::ImageView &image,
+    const Layout &layout,
+    const PngFilter filter,
+    const size_t first_row,
+    const size_t row_count,
+    u8 *output_ptr)
+{
+    const auto width = image.width();
+    const auto bpp = layout.bpp;
+    const auto row_size = width * bpp;
+    bstr row(row_size);
+    bstr prev_row(row_size);
+    bstr scratch(filter == PngFilter::Adaptive ? row_size : 0);
+    std::vector<res::Pixel> input_row(width);
+    if (first_row)
+    {
+        convert_row(
+            layout,
+            image.get_row(first_row - 1, input_row.data()),
+            prev_row.get<u8>(),
+            width);
+    }
+
+    for (const auto y : algo::range(first_row, first_row + row_count))
+    {
+        convert_row(
+            layout,
+            image.get_row(y, input_row.data()),
+            row.get<u8>(),
+            width);
+        filter_row(
+            filter,
+            bpp,
+            row.get<u8>(),
+            prev_row.get<u8>(),
+            output_ptr,
+            row_size,
+            scratch);
+        output_ptr += row_size + 1;
+        std::swap(row, prev_row);
+    }
+}
+
+// Deflates the band as a piece of one raw deflate stream. The last 32K of
+// the preceding data serve as the dictionary and the band ends with a sync
+// flush, so the pieces can be concatenated as they are.
+static void deflate_band(
+    const bstr &input, Band &band, const int level, const bool is_last)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY)
+        != Z_OK)
+    {
+        throw std::logic_error("Failed to initialize deflate");
+    }
+
+    const auto input_ptr = input.get<const u8>() + band.start;
+    if (band.start)
+    {
+        const auto dict_size = std::min<size_t>(32 * 1024, band.start);
+        deflateSetDictionary(&stream, input_ptr - dict_size, dict_size);
+    }
+
+    band.deflated.resize(deflateBound(&stream, band.size) + 16);
+    stream.next_in = const_cast<u8*>(input_ptr);
+    stream.avail_in = band.size;
+    int ret;
+    while (true)
+    {
+        stream.next_out = band.deflated.get<u8>() + stream.total_out;
+        stream.avail_out = band.deflated.size() - stream.total_out;
+        ret = deflate(&stream, is_last ? Z_FINISH : Z_SYNC_FLUSH);
+        if (ret == Z_STREAM_ERROR || stream.avail_out)
+            break;
+        band.deflated.resize(band.deflated.size() * 2);
+    }
+    band.deflated.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (is_last ? ret != Z_STREAM_END : ret != Z_OK)
+        throw std::logic_error("Failed to deflate PNG data");
+
+    band.adler = adler32(1, input_ptr, band.size);
+}
+
+static inline u8 *write_be_u32(u8 *output_ptr, const u32 value)
+{
+    *output_ptr++ = value >> 24;
+    *output_ptr++ = value >> 16;
+    *output_ptr++ = value >> 8;
+    *output_ptr++ = value;
+    return output_ptr;
+}
+
+static u8 *begin_chunk(u8 *output_ptr, const char *type, const size_t size)
+{
+    output_ptr = write_be_u32(output_ptr, size);
+    std::memcpy(output_ptr, type, 4);
+    return output_ptr + 4;
+}
+
+static u8 *end_chunk(u8 *data_ptr, u8 *output_ptr)
+{
+    const auto type_ptr = data_ptr - 4;
+    return write_be_u32(
+        output_ptr, crc32(0, type_ptr, output_ptr - type_ptr));
+}
+
+static bstr get_zlib_header(const int level)
+{
+    const u8 cmf = 0x78;
+    u8 flg = (level <= 1 ? 0 : level <= 5 ? 1 : level == 6 ? 2 : 3) << 6;
+    flg += 31 - ((cmf << 8) | flg) % 31;
+    bstr header(2);
+    header[0] = cmf;
+    header[1] = flg;
+    return header;
+}
+
+static void write_chunk(
+    io::BaseByteStream &output,
+    const char *type,
+    const u8 *input_ptr,
+    const size_t size)
+{
+    bstr chunk(size + 12);
+    auto output_ptr = chunk.get<u8>();
+    const auto data_ptr = output_ptr = begin_chunk(output_ptr, type, size);
+    if (size)
+        std::memcpy(output_ptr, input_ptr, size);
+    end_chunk(data_ptr, output_ptr + size);
+    output.write(chunk);
+}
+
+StreamingBandSink::StreamingBandSink(
+    io::File &output_file,
+    std::unique_ptr<res::IImageBandSink> fallback_sink,
+    const int compression_level,
+    const PngFilter filter,
+    const size_t thread_count,
+    const size_t min_streamed_pixel_count) :
+        output_file(output_file),
+        fallback_sink(std::move(fallback_sink)),
+        compression_level(compression_level),
+        filter(filter),
+        thread_count(thread_count),
+        min_streamed_pixel_count(min_streamed_pixel_count),
+        is_large(false),
+        is_opaque(false),
+        is_streaming(false),
+        width(0),
+        height(0),
+        next_row(0),
+        held_pixel_count(0),
+        dictionary_size(0),
+        adler(1)
+{
+    layout.color_type = ColorType::Rgba;
+    layout.bpp = 4;
+}
+
+void StreamingBandSink::begin(
+    const size_t width, const size_t height, const bool is_opaque)
+{
+    if (!width || !height)
+        throw err::BadDataSizeError();
+    is_large = width * height >= min_streamed_pixel_count;
+    if (!is_large)
+    {
+        fallback_sink->begin(width, height, is_opaque);
+        return;
+    }
+
+    this->width = width;
+    this->height = height;
+    this->is_opaque = is_opaque;
+    next_row = 0;
+    is_streaming = false;
+    analysis = std::make_unique<ColorAnalysis>(nullptr);
+    held_bands.clear();
+    held_pixel_count = 0;
+    layout.color_type = is_opaque ? ColorType::Rgb : ColorType::Rgba;
+    layout.bpp = is_opaque ? 3 : 4;
+}
+
+void StreamingBandSink::write_band(const res::ImageView &band)
+{
+    if (!is_large)
+    {
+        fallback_sink->write_band(band);
+        return;
+    }
+    if (band.width() != width || next_row + band.height() > height)
+        throw err::BadDataSizeError();
+    next_row += band.height();
+
+    if (is_streaming)
+    {
+        stream_band(band);
+        return;
+    }
+
+    input_row.resize(width);
+    for (const auto y : algo::range(band.height()))
+        analysis->add_row(band.get_row(y, input_row.data()), width);
+    held_bands.push_back(res::Image(band));
+    held_pixel_count += width * band.height();
+    if (!analysis->is_reducible(is_opaque)
+        || held_pixel_count >= max_held_pixel_count)
+    {
+        start_streaming();
+    }
+}
+
+void StreamingBandSink::end()
+{
+    if (!is_large)
+    {
+        fallback_sink->end();
+        return;
+    }
+    if (next_row != height)
+        throw err::BadDataSizeError();
+
+    if (!is_streaming)
+    {
+        fallback_sink->begin(width, height, is_opaque);
+        while (!held_bands.empty())
+        {
+            fallback_sink->write_band(held_bands.front());
+            held_bands.pop_front();
+        }
+        fallback_sink->end();
+        return;
+    }
+
+    deflate_batch(true);
+    is_streaming = false;
+    write_chunk(output_file.stream, "IEND", nullptr, 0);
+    output_file.path.change_extension("png");
+}
+
+void StreamingBandSink::start_streaming()
+{
+    is_streaming = true;
+    analysis.reset();
+
+    const auto row_size = width * layout.bpp;
+    input_row.resize(width);
+    row.resize(row_size);
+    prev_row = bstr(row_size);
+    scratch.resize(filter == PngFilter::Adaptive ? row_size : 0);
+    filtered_data = bstr();
+    dictionary_size = 0;
+    adler = adler32(0, nullptr, 0);
+
+    bstr header(13);
+    auto header_ptr = header.get<u8>();
+    header_ptr = write_be_u32(header_ptr, width);
+    header_ptr = write_be_u32(header_ptr, height);
+    *header_ptr++ = 8; // bit depth
+    *header_ptr++ = static_cast<u8>(layout.color_type);
+    *header_ptr++ = 0; // compression method
+    *header_ptr++ = 0; // filter method
+    *header_ptr++ = 0; // interlace method
+    output_file.stream.write(magic);
+    write_chunk(output_file.stream, "IHDR", header.get<u8>(), header.size());
+
+    const auto zlib_header = get_zlib_header(compression_level);
+    write_chunk(
+        output_file.stream,
+        "IDAT",
+        zlib_header.get<u8>(),
+        zlib_header.size());
+
+    while (!held_bands.empty())
+    {
+        stream_band(held_bands.front());
+        held_bands.pop_front();
+    }
+}
+
+void StreamingBandSink::stream_band(const res::ImageView &band)
+{
+    const auto filtered_row_size = row.size() + 1;
+    for (const auto y : algo::range(band.height()))
+    {
+        const auto offset = filtered_data.size();
+        filtered_data.resize(offset + filtered_row_size);
+        convert_row(
+            layout,
+            band.get_row(y, input_row.data()),
+            row.get<u8>(),
+            width);
+        filter_row(
+            filter,
+            layout.bpp,
+            row.get<u8>(),
+            prev_row.get<u8>(),
+            filtered_data.get<u8>() + offset,
+            row.size(),
+            scratch);
+        std::swap(row, prev_row);
+
+        if (filtered_data.size() - dictionary_size >= streamed_batch_size)
+            deflate_batch(false);
+    }
+}
+
+void StreamingBandSink::deflate_batch(const bool is_last)
+{
+    const auto data_size = filtered_data.size() - dictionary_size;
+    const auto band_count = std::max<size_t>(
+        1, (data_size + min_band_size - 1) / min_band_size);
+    std::vector<Band> bands(band_count);
+    for (const auto i : algo::range(band_count))
+    {
+        bands[i].start = dictionary_size + i * min_band_size;
+        bands[i].size = std::min(
+            min_band_size, filtered_data.size() - bands[i].start);
+    }
+
+    run_in_parallel(band_count, thread_count, [&](const size_t i)
+    {
+        deflate_band(
+            filtered_data,
+            bands[i],
+            compression_level,
+            is_last && i == band_count - 1);
+    });
+
+    for (const auto &band : bands)
+    {
+        adler = adler32_combine(adler, band.adler, band.size);
+        write_chunk(
+            output_file.stream,
+            "IDAT",
+            band.deflated.get<u8>(),
+            band.deflated.size());
+    }
+
+    if (is_last)
+    {
+        u8 checksum[4];
+        write_be_u32(checksum, adler);
+        write_chunk(output_file.stream, "IDAT", checksum, 4);
+        filtered_data = bstr();
+        dictionary_size = 0;
+        return;
+    }
+
+    // the tail of this batch is the dictionary of the next one
+    dictionary_size = std::min<size_t>(32 * 1024, filtered_data.size());
+    filtered_data = filtered_data.substr(
+        filtered_data.size() - dictionary_size, dictionary_size);
+}
+
+struct PngImageEncoder::Priv final
+{
+    Priv(
+        const int compression_level,
+        const PngFilter filter,
+        const size_t thread_count,
+        const size_t min_streamed_pixel_count);
+
+    int compression_level;
+    PngFilter filter;
+    size_t thread_count;
+    size_t min_streamed_pixel_count;
+};
+
+PngImageEncoder::Priv::Priv(
+    const int compression_level,
+    const PngFilter filter,
+    const size_t thread_count,
+    const size_t min_streamed_pixel_count) :
+        compression_level(compression_level),
+        filter(filter),
+        thread_count(thread_count),
+        min_streamed_pixel_count(min_streamed_pixel_count)
+{
+}
+
+PngImageEncoder::PngImageEncoder(
+    const int compression_level,
+    const PngFilter filter,
+    const size_t thread_count,
+    const size_t min_streamed_pixel_count) :
+        p(new Priv(
+            compression_level,
+            filter,
+            thread_count,
+            min_streamed_pixel_count))
+{
+    // the settings live in Priv, which stays put when the encoder is moved
+    const auto priv = p.get();
+    add_arg_parser_decorator(
+        [](ArgParser &arg_parser)
+        {
+            {
+                auto sw = arg_parser.register_switch({"--png-preset"})
+                    ->set_value_name("PRESET")
+                    ->set_description(
+                        "Sets PNG compression level and filtering.");
+                for (const auto &preset : presets)
+                    sw->add_possible_value(preset.name, preset.description);
+            }
+
+            arg_parser.register_switch({"--png-level"})
+                ->set_value_name("NUM")
+                ->set_description(
+                    "Sets PNG compression level from 0 to 9 (overrides "
+                    "--png-preset).");
+
+            {
+                auto sw = arg_parser.register_switch({"--png-filter"})
+                    ->set_value_name("FILTER")
+                    ->set_description(
+                        "Sets PNG row filter (overrides --png-preset).");
+                for (const auto &item : filter_names)
+                    sw->add_possible_value(item.first);
+            }
+        },
+        [priv](const ArgParser &arg_parser)
+        {
+            if (arg_parser.has_switch("--png-preset"))
+            {
+                const auto name = arg_parser.get_switch("--png-preset");
+                const auto it = std::find_if(
+                    presets.begin(),
+                    presets.end(),
+                    [&](const Preset &preset) { return preset.name == name; });
+                if (it == presets.end())
+                    throw err::UsageError("Unknown PNG preset: " + name);
+                priv->compression_level = it->compression_level;
+                priv->filter = it->filter;
+            }
+
+            if (arg_parser.has_switch("--png-level"))
+            {
+                priv->compression_level = algo::from_string<int>(
+                    arg_parser.get_switch("--png-level"));
+                if (priv->compression_level < 0
+                    || priv->compression_level > 9)
+                {
+                    throw err::UsageError(
+                        "PNG compression level must be between 0 and 9.");
+                }
+            }
+
+            if (arg_parser.has_switch("--png-filter"))
+            {
+                const auto name = arg_parser.get_switch("--png-filter");
+                const auto it = std::find_if(
+                    filter_names.begin(),
+                    filter_names.end(),
+                    [&](const std::pair<std::string, PngFilter> &item)
+                    {
+                        return item.first == name;
+                    });
+                if (it == filter_names.end())
+                    throw err::UsageError("Unknown PNG filter: " + name);
+                priv->filter = it->second;
+            }
+        });
+}
+
+PngImageEncoder::PngImageEncoder(PngImageEncoder &&other) = default;
+
+PngImageEncoder::~PngImageEncoder()
 {
 }
 
 void PngImageEncoder::encode_impl(
     const Logger &logger,
-    const res::Image &input_image,
+    const res::ImageView &input_image,
     io::File &output_file) const
 {
-    png_structp png_ptr = png_create_write_struct(
-        PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-    if (!png_ptr)
-        throw std::logic_error("Failed to create PNG write structure");
-
-    png_infop info_ptr = png_create_info_struct(png_ptr);
-    if (!info_ptr)
-        throw std::logic_error("Failed to create PNG info structure");
-
     const auto width = input_image.width();
     const auto height = input_image.height();
     if (!width || !height)
         throw err::BadDataSizeError();
-    const auto bpp = 4;
-    const auto color_type = PNG_COLOR_TYPE_RGBA;
-    int transformations = PNG_TRANSFORM_BGR;
-
-    png_set_IHDR(
-        png_ptr, info_ptr, width, height, 8, color_type,
-        PNG_INTERLACE_NONE,
-        PNG_COMPRESSION_TYPE_BASE,
-        PNG_FILTER_TYPE_BASE);
-
-    // 0 = no compression, 9 = max compression
-    // 1 produces good file size and is still fast.
-    png_set_filter(png_ptr, 0, PNG_FILTER_NONE);
-    png_set_compression_level(png_ptr, 1);
-
-    png_set_write_fn(
-        png_ptr, &output_file.stream, &write_handler, &flush_handler);
-    png_write_info(png_ptr, info_ptr);
-
-    auto rows = std::make_unique<const u8*[]>(height);
-    for (const auto y : algo::range(height))
-        rows.get()[y] = reinterpret_cast<const u8*>(&input_image.at(0, y));
-    png_set_rows(png_ptr, info_ptr, const_cast<u8**>(rows.get()));
-    png_write_png(png_ptr, info_ptr, transformations, nullptr);
-    png_destroy_write_struct(&png_ptr, &info_ptr);
 
+    const auto layout = get_layout(input_image);
+    const auto &colors = layout.color_table.colors;
+    const auto is_palette = layout.color_type == ColorType::Palette;
+
+    // Filters do not help with indices, so the specification recommends
+    // leaving palette images unfiltered.
+    const auto actual_filter = is_palette && p->filter == PngFilter::Adaptive
+        ? PngFilter::None
+        : p->filter;
+
+    size_t transparent_count = 0;
+    if (is_palette)
+        for (const auto i : algo::range(colors.size()))
+            if ((colors[i] >> 24) != 0xFF)
+                transparent_count = i + 1;
+
+    const auto stride = width * layout.bpp + 1;
+    const auto rows_per_band = std::max<size_t>(1, min_band_size / stride);
+    const auto band_count = (height + rows_per_band - 1) / rows_per_band;
+    std::vector<Band> bands(band_count);
+    for (const auto i : algo::range(band_count))
+    {
+        const auto first_row = i * rows_per_band;
+        bands[i].start = first_row * stride;
+        bands[i].size = std::min(rows_per_band, height - first_row) * stride;
+    }
+
+    // Filtering goes first, since each band needs the filtered tail of the
+    // previous one as its deflate dictionary.
+    bstr filtered_data(height * stride);
+    run_in_parallel(band_count, p->thread_count, [&](const size_t i)
+    {
+        filter_rows(
+            input_image,
+            layout,
+            actual_filter,
+            bands[i].start / stride,
+            bands[i].size / stride,
+            filtered_data.get<u8>() + bands[i].start);
+    });
+    run_in_parallel(band_count, p->thread_count, [&](const size_t i)
+    {
+        deflate_band(
+            filtered_data,
+            bands[i],
+            p->compression_level,
+            i == band_count - 1);
+    });
+
+    const auto zlib_header = get_zlib_header(p->compression_level);
+    auto adler = bands[0].adler;
+    size_t output_size = magic.size() + 25 + 12;
+    if (is_palette)
+        output_size += 12 + colors.size() * 3;
+    if (transparent_count)
+        output_size += 12 + transparent_count;
+    for (const auto i : algo::range(band_count))
+    {
+        if (i)
+            adler = adler32_combine(adler, bands[i].adler, bands[i].size);
+        output_size += 12 + bands[i].deflated.size();
+    }
+    output_size += zlib_header.size() + 4;
+
+    bstr output(output_size);
+    auto output_ptr = output.get<u8>();
+    std::memcpy(output_ptr, magic.get<u8>(), magic.size());
+    output_ptr += magic.size();
+
+    auto data_ptr = output_ptr = begin_chunk(output_ptr, "IHDR", 13);
+    output_ptr = write_be_u32(output_ptr, width);
+    output_ptr = write_be_u32(output_ptr, height);
+    *output_ptr++ = 8; // bit depth
+    *output_ptr++ = static_cast<u8>(layout.color_type);
+    *output_ptr++ = 0; // compression method
+    *output_ptr++ = 0; // filter method
+    *output_ptr++ = 0; // interlace method
+    output_ptr = end_chunk(data_ptr, output_ptr);
+
+    if (is_palette)
+    {
+        data_ptr = output_ptr = begin_chunk(
+            output_ptr, "PLTE", colors.size() * 3);
+        for (const auto color : colors)
+        {
+            *output_ptr++ = color >> 16;
+            *output_ptr++ = color >> 8;
+            *output_ptr++ = color;
+        }
+        output_ptr = end_chunk(data_ptr, output_ptr);
+    }
+
+    if (transparent_count)
+    {
+        data_ptr = output_ptr = begin_chunk(
+            output_ptr, "tRNS", transparent_count);
+        for (const auto i : algo::range(transparent_count))
+            *output_ptr++ = colors[i] >> 24;
+        output_ptr = end_chunk(data_ptr, output_ptr);
+    }
+
+    for (const size_t i : algo::range(band_count))
+    {
+        const auto &deflated = bands[i].deflated;
+        const auto is_first = i == 0;
+        const auto is_last = i == band_count - 1;
+        data_ptr = output_ptr = begin_chunk(
+            output_ptr,
+            "IDAT",
+            deflated.size()
+                + (is_first ? zlib_header.size() : 0)
+                + (is_last ? 4 : 0));
+        if (is_first)
+        {
+            std::memcpy(output_ptr, zlib_header.get<u8>(), zlib_header.size());
+            output_ptr += zlib_header.size();
+        }
+        std::memcpy(output_ptr, deflated.get<u8>(), deflated.size());
+        output_ptr += deflated.size();
+        if (is_last)
+            output_ptr = write_be_u32(output_ptr, adler);
+        output_ptr = end_chunk(data_ptr, output_ptr);
+    }
+
+    data_ptr = output_ptr = begin_chunk(output_ptr, "IEND", 0);
+    output_ptr = end_chunk(data_ptr, output_ptr);
+
+    output_file.stream.write(output);
     output_file.path.change_extension("png");
 }
+
+std::unique_ptr<res::IImageBandSink> PngImageEncoder::create_band_sink_impl(
+    const Logger &logger, io::File &output_file) const
+{
+    return std::make_unique<StreamingBandSink>(
+        output_file,
+        BaseImageEncoder::create_band_sink_impl(logger, output_file),
+        p->compression_level,
+        p->filter,
+        p->thread_count,
+        p->min_streamed_pixel_count);
+}
+
+static auto _ = enc::register_image_encoder<PngImageEncoder>("png");
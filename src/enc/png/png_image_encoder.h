@@ -23,13 +23,51 @@ namespace au {
 namespace enc {
 namespace png {
 
+    enum class PngFilter : u8
+    {
+        None = 0,
+        Sub = 1,
+        Up = 2,
+        Average = 3,
+        Paeth = 4,
+        Adaptive = 5, // picks the best filter for each row
+    };
+
+    // Filters and deflates bands of rows on separate threads, joining the
+    // deflate streams like pigz does, so large images don't wait on a
+    // single deflate. Band sinks for images of at least
+    // min_streamed_pixel_count pixels deflate the rows in batches as they
+    // arrive instead, so the image is never held in memory; such images are
+    // saved as RGB if they are declared opaque and as RGBA otherwise.
+    // Unless a thread count is given, the helper threads come from a budget
+    // shared by all encoders, which keeps their number bounded when many
+    // images are encoded at once.
     class PngImageEncoder final : public BaseImageEncoder
     {
+    public:
+        PngImageEncoder(
+            const int compression_level = 1,
+            const PngFilter filter = PngFilter::None,
+            const size_t thread_count = 0,
+            const size_t min_streamed_pixel_count = 16 * 1024 * 1024);
+
+        // Moved encoders keep the settings parsed from the command line.
+        PngImageEncoder(PngImageEncoder &&other);
+
+        ~PngImageEncoder();
+
     protected:
         void encode_impl(
             const Logger &logger,
-            const res::Image &input_image,
+            const res::ImageView &input_image,
             io::File &output_file) const override;
+
+        std::unique_ptr<res::IImageBandSink> create_band_sink_impl(
+            const Logger &logger, io::File &output_file) const override;
+
+    private:
+        struct Priv;
+        std::unique_ptr<Priv> p;
     };
 
 } } }
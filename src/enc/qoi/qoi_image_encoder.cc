@@ -0,0 +1,160 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "enc/qoi/qoi_image_encoder.h"
+#include "algo/range.h"
+#include "enc/registry.h"
+
+using namespace au;
+using namespace au::enc::qoi;
+
+// Implements the "Quite OK Image" format, which is lossless like PNG but
+// encodes an order of magnitude faster.
+
+static const u8 op_index = 0x00;
+static const u8 op_diff = 0x40;
+static const u8 op_luma = 0x80;
+static const u8 op_run = 0xC0;
+static const u8 op_rgb = 0xFE;
+static const u8 op_rgba = 0xFF;
+static const size_t max_run = 62;
+
+static inline size_t get_hash(const res::Pixel &c)
+{
+    return (c.r * 3 + c.g * 5 + c.b * 7 + c.a * 11) & 63;
+}
+
+static inline void write_be_u32(u8 *&output_ptr, const u32 value)
+{
+    *output_ptr++ = value >> 24;
+    *output_ptr++ = value >> 16;
+    *output_ptr++ = value >> 8;
+    *output_ptr++ = value;
+}
+
+void QoiImageEncoder::encode_impl(
+    const Logger &logger,
+    const res::ImageView &input_image,
+    io::File &output_file) const
+{
+    const auto width = input_image.width();
+    const auto height = input_image.height();
+
+    // Worst case is one QOI_OP_RGBA per pixel, plus header and end marker.
+    bstr output(14 + width * height * 5 + 8);
+    auto output_ptr = output.get<u8>();
+
+    *output_ptr++ = 'q';
+    *output_ptr++ = 'o';
+    *output_ptr++ = 'i';
+    *output_ptr++ = 'f';
+    write_be_u32(output_ptr, width);
+    write_be_u32(output_ptr, height);
+    *output_ptr++ = 4; // channels
+    *output_ptr++ = 0; // sRGB with linear alpha
+
+    res::Pixel index[64] = {};
+    res::Pixel prev = {0, 0, 0, 0xFF};
+    size_t run = 0;
+    std::vector<res::Pixel> scratch(width);
+    for (const auto y : algo::range(height))
+    {
+        const auto row_ptr = input_image.get_row(y, scratch.data());
+        for (const auto x : algo::range(width))
+        {
+            const auto &c = row_ptr[x];
+            if (c == prev)
+            {
+                run++;
+                if (run == max_run)
+                {
+                    *output_ptr++ = op_run | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run)
+            {
+                *output_ptr++ = op_run | (run - 1);
+                run = 0;
+            }
+
+            const auto hash = get_hash(c);
+            if (index[hash] == c)
+            {
+                *output_ptr++ = op_index | hash;
+            }
+            else
+            {
+                index[hash] = c;
+                if (c.a == prev.a)
+                {
+                    const s8 dr = c.r - prev.r;
+                    const s8 dg = c.g - prev.g;
+                    const s8 db = c.b - prev.b;
+                    const s8 dr_dg = dr - dg;
+                    const s8 db_dg = db - dg;
+                    if (dr >= -2 && dr <= 1
+                        && dg >= -2 && dg <= 1
+                        && db >= -2 && db <= 1)
+                    {
+                        *output_ptr++ = op_diff
+                            | (dr + 2) << 4
+                            | (dg + 2) << 2
+                            | (db + 2);
+                    }
+                    else if (dg >= -32 && dg <= 31
+                        && dr_dg >= -8 && dr_dg <= 7
+                        && db_dg >= -8 && db_dg <= 7)
+                    {
+                        *output_ptr++ = op_luma | (dg + 32);
+                        *output_ptr++ = (dr_dg + 8) << 4 | (db_dg + 8);
+                    }
+                    else
+                    {
+                        *output_ptr++ = op_rgb;
+                        *output_ptr++ = c.r;
+                        *output_ptr++ = c.g;
+                        *output_ptr++ = c.b;
+                    }
+                }
+                else
+                {
+                    *output_ptr++ = op_rgba;
+                    *output_ptr++ = c.r;
+                    *output_ptr++ = c.g;
+                    *output_ptr++ = c.b;
+                    *output_ptr++ = c.a;
+                }
+            }
+            prev = c;
+        }
+    }
+    if (run)
+        *output_ptr++ = op_run | (run - 1);
+
+    for (const auto i : algo::range(7))
+        *output_ptr++ = 0;
+    *output_ptr++ = 1;
+
+    output.resize(output_ptr - output.get<u8>());
+    output_file.stream.write(output);
+    output_file.path.change_extension("qoi");
+}
+
+static auto _ = enc::register_image_encoder<QoiImageEncoder>("qoi");
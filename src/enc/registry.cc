@@ -0,0 +1,81 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "enc/registry.h"
+#include <algorithm>
+#include <map>
+#include "enc/base_image_encoder.h"
+#include "err.h"
+
+using namespace au::enc;
+
+struct Registry::Priv final
+{
+    std::map<std::string, ImageEncoderCreator> image_encoder_map;
+};
+
+Registry::Registry() : p(new Priv)
+{
+}
+
+Registry::~Registry()
+{
+}
+
+const std::vector<std::string> Registry::get_image_encoder_names() const
+{
+    std::vector<std::string> names;
+    for (auto &item : p->image_encoder_map)
+        names.push_back(item.first);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+bool Registry::has_image_encoder(const std::string &name) const
+{
+    return p->image_encoder_map.find(name) != p->image_encoder_map.end();
+}
+
+std::shared_ptr<BaseImageEncoder>
+    Registry::create_image_encoder(const std::string &name) const
+{
+    if (!has_image_encoder(name))
+        throw err::UsageError("Unknown image format: " + name);
+    return p->image_encoder_map[name]();
+}
+
+void Registry::add_image_encoder(
+    const std::string &name, ImageEncoderCreator creator)
+{
+    if (has_image_encoder(name))
+    {
+        throw std::logic_error(
+            "Image encoder with name " + name + " was already registered.");
+    }
+    p->image_encoder_map[name] = creator;
+}
+
+Registry &Registry::instance()
+{
+    static Registry instance;
+    return instance;
+}
+
+std::unique_ptr<Registry> Registry::create_mock()
+{
+    return std::unique_ptr<Registry>(new Registry());
+}
@@ -0,0 +1,64 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "enc/truevision/tga_image_encoder.h"
+#include <cstring>
+#include "algo/range.h"
+#include "enc/registry.h"
+#include "err.h"
+
+using namespace au;
+using namespace au::enc::truevision;
+
+void TgaImageEncoder::encode_impl(
+    const Logger &logger,
+    const res::ImageView &input_image,
+    io::File &output_file) const
+{
+    const auto width = input_image.width();
+    const auto height = input_image.height();
+    if (width > 0xFFFF || height > 0xFFFF)
+        throw err::BadDataSizeError();
+
+    output_file.stream.write<u8>(0);        // id size
+    output_file.stream.write<u8>(0);        // palette type
+    output_file.stream.write<u8>(2);        // data type: uncompressed RGB
+    output_file.stream.write_le<u16>(0);    // palette start
+    output_file.stream.write_le<u16>(0);    // palette size
+    output_file.stream.write<u8>(0);        // palette depth
+    output_file.stream.write_le<u16>(0);    // x
+    output_file.stream.write_le<u16>(0);    // y
+    output_file.stream.write_le<u16>(width);
+    output_file.stream.write_le<u16>(height);
+    output_file.stream.write<u8>(32);       // depth
+    output_file.stream.write<u8>(0x28);     // 8-bit alpha, top to bottom
+
+    // res::Pixel is laid out as BGRA, which is what 32-bit TGA stores.
+    bstr data(width * height * sizeof(res::Pixel));
+    for (const auto y : algo::range(height))
+    {
+        const auto output_ptr = data.get<res::Pixel>() + y * width;
+        const auto row_ptr = input_image.get_row(y, output_ptr);
+        if (row_ptr != output_ptr)
+            std::memcpy(output_ptr, row_ptr, width * sizeof(res::Pixel));
+    }
+    output_file.stream.write(data);
+
+    output_file.path.change_extension("tga");
+}
+
+static auto _ = enc::register_image_encoder<TgaImageEncoder>("tga");
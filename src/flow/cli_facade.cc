@@ -23,8 +23,12 @@
 #include "arg_parser.h"
 #include "dec/idecoder.h"
 #include "dec/registry.h"
+#include "enc/base_image_encoder.h"
+#include "enc/registry.h"
+#include "err.h"
 #include "flow/file_saver_hdd.h"
 #include "flow/parallel_unpacker.h"
+#include "flow/server.h"
 #include "io/file_system.h"
 #include "version.h"
 #include "virtual_file_system.h"
@@ -38,13 +42,23 @@ namespace
     {
         std::string decoder;
         io::path output_dir;
+        io::path trace_path;
+        std::string image_format;
         std::vector<io::path> input_paths;
         bool overwrite;
         bool enable_nested_decoding;
+        bool enable_deduplication;
+        bool passthrough_standard_formats;
+        bool enable_memory_accounting;
+        bool show_progress;
+        io::path stats_path;
+        int progress_interval;
         bool enable_virtual_file_system;
         bool should_show_help;
         bool should_show_version;
         bool should_list_decoders;
+        bool should_serve;
+        int serve_cache_size;
         int verbosity = 3;
         unsigned int thread_count;
     };
@@ -138,6 +152,21 @@ See --help --dec=DECODER to get detailed help for given decoder.
 )");
     }
 
+    const auto image_encoder = enc::Registry::instance()
+        .create_image_encoder(options.image_format);
+    const auto image_encoder_decorators
+        = image_encoder->get_arg_parser_decorators();
+    if (!image_encoder_decorators.empty())
+    {
+        ArgParser encoder_arg_parser;
+        for (const auto &decorator : image_encoder_decorators)
+            decorator.register_cli_options(encoder_arg_parser);
+        logger.info(
+            "Options specific to --image-format=%s:\n\n",
+            options.image_format.c_str());
+        encoder_arg_parser.print_help(logger);
+    }
+
     logger.info(
 R"(Contact:
 
@@ -202,9 +231,77 @@ void CliFacade::Priv::register_cli_options()
     arg_parser.register_flag({"--no-recurse"})
         ->set_description("Disables automatic decoding of nested files.");
 
+    arg_parser.register_flag({"--dedup"})
+        ->set_description(
+            "Converts files with identical contents only once. "
+            "Might produce wrong results for formats that depend on "
+            "neighboring files.");
+
+    {
+        auto sw = arg_parser.register_switch({"--image-format"})
+            ->set_value_name("FORMAT")
+            ->set_description(
+                "Selects the format converted images are saved in (defaults "
+                "to png). bmp, qoi and tga are much faster to write.");
+        for (const auto &name
+            : enc::Registry::instance().get_image_encoder_names())
+        {
+            sw->add_possible_value(name);
+        }
+    }
+
+    arg_parser.register_flag({"--passthrough-standard-formats"})
+        ->set_description(
+            "Saves nested PNG, JPEG, WebP and WAV files as they are instead "
+            "of converting them.");
+
+    arg_parser.register_switch({"--trace"})
+        ->set_value_name("FILE")
+        ->set_description(
+            "Saves timings of decoding phases to given file in Chrome trace "
+            "format and prints a per-decoder summary.");
+
+    arg_parser.register_flag({"--memory-stats"})
+        ->set_description(
+            "Prints peak RSS at the end, and the tasks that held the most "
+            "memory in builds configured with -Dmemory_accounting=ON.");
+
+    arg_parser.register_flag({"--progress"})
+        ->set_description(
+            "Periodically prints the number of processed tasks, throughput "
+            "and estimated time left.");
+
+    arg_parser.register_switch({"--stats-file"})
+        ->set_value_name("FILE")
+        ->set_description(
+            "Periodically saves progress counters to given file as JSON.");
+
+    arg_parser.register_switch({"--progress-interval"})
+        ->set_value_name("SECONDS")
+        ->set_description(
+            "Sets how often --progress and --stats-file report (defaults "
+            "to 5).");
+
     arg_parser.register_flag({"--no-vfs"})
         ->set_description("Disables virtual file system lookups.");
 
+    arg_parser.register_switch({"--vfs-cache-size"})
+        ->set_value_name("MB")
+        ->set_description(
+            "Sets how much memory is used to keep files fetched through the "
+            "virtual file system (defaults to 32, 0 disables).");
+
+    arg_parser.register_flag({"--serve"})
+        ->set_description(
+            "Instead of unpacking, answers requests on the standard input "
+            "and output, keeping recently used archives open. See "
+            "tools/serve-client for the protocol.");
+
+    arg_parser.register_switch({"--serve-cache"})
+        ->set_value_name("NUM")
+        ->set_description(
+            "Sets how many archives --serve keeps open (defaults to 16).");
+
     arg_parser.register_flag({"--version"})
         ->set_description("Shows arc_unpacker version.");
 }
@@ -219,6 +316,16 @@ void CliFacade::Priv::parse_cli_options()
     options.should_list_decoders
         = arg_parser.has_flag("-l") || arg_parser.has_flag("--list-decoders");
 
+    options.should_serve = arg_parser.has_flag("--serve");
+    options.serve_cache_size = 16;
+    if (arg_parser.has_switch("--serve-cache"))
+    {
+        options.serve_cache_size = algo::from_string<int>(
+            arg_parser.get_switch("--serve-cache"));
+        if (options.serve_cache_size <= 0)
+            throw err::UsageError("Serve cache size must be positive.");
+    }
+
     options.overwrite
         = !arg_parser.has_flag("-r") && !arg_parser.has_flag("--rename");
 
@@ -234,6 +341,40 @@ void CliFacade::Priv::parse_cli_options()
     }
 
     options.enable_nested_decoding = !arg_parser.has_flag("--no-recurse");
+    options.enable_deduplication = arg_parser.has_flag("--dedup");
+    options.passthrough_standard_formats
+        = arg_parser.has_flag("--passthrough-standard-formats");
+    options.enable_memory_accounting = arg_parser.has_flag("--memory-stats");
+
+    options.image_format = "png";
+    if (arg_parser.has_switch("--image-format"))
+    {
+        options.image_format = arg_parser.get_switch("--image-format");
+        const auto &encoder_registry = enc::Registry::instance();
+        if (!encoder_registry.has_image_encoder(options.image_format))
+        {
+            throw err::UsageError(
+                "Unknown image format: " + options.image_format);
+        }
+    }
+
+    if (arg_parser.has_switch("--trace"))
+        options.trace_path = arg_parser.get_switch("--trace");
+
+    options.show_progress = arg_parser.has_flag("--progress");
+    if (arg_parser.has_switch("--stats-file"))
+        options.stats_path = arg_parser.get_switch("--stats-file");
+    options.progress_interval = 5;
+    if (arg_parser.has_switch("--progress-interval"))
+    {
+        options.progress_interval = algo::from_string<int>(
+            arg_parser.get_switch("--progress-interval"));
+        if (options.progress_interval <= 0)
+        {
+            throw err::UsageError(
+                "Progress interval must be a positive number.");
+        }
+    }
 
     if (arg_parser.has_switch("-t"))
         options.thread_count = algo::from_string<int>(
@@ -246,6 +387,14 @@ void CliFacade::Priv::parse_cli_options()
 
     if (arg_parser.has_flag("--no-vfs"))
         VirtualFileSystem::disable();
+    if (arg_parser.has_switch("--vfs-cache-size"))
+    {
+        const auto cache_size = algo::from_string<int>(
+            arg_parser.get_switch("--vfs-cache-size"));
+        if (cache_size < 0)
+            throw err::UsageError("VFS cache size cannot be negative.");
+        VirtualFileSystem::set_cache_size(cache_size * 1024_z * 1024);
+    }
 
     if (arg_parser.has_switch("-o"))
         options.output_dir = arg_parser.get_switch("-o");
@@ -294,6 +443,16 @@ int CliFacade::Priv::run() const
         return 0;
     }
 
+    if (options.should_serve)
+    {
+        // the standard output carries responses, so logging must stay off
+        logger.mute();
+        Server server(
+            registry, options.decoder, arguments, options.serve_cache_size);
+        server.run(stdin, stdout);
+        return 0;
+    }
+
     if (options.input_paths.size() < 1)
     {
         logger.err("Error: required more arguments.\n\n");
@@ -314,6 +473,15 @@ int CliFacade::Priv::run() const
         options.enable_nested_decoding,
         arguments,
         available_decoders);
+    context.enable_deduplication = options.enable_deduplication;
+    context.passthrough_standard_formats
+        = options.passthrough_standard_formats;
+    context.image_format = options.image_format;
+    context.trace_path = options.trace_path;
+    context.enable_memory_accounting = options.enable_memory_accounting;
+    context.show_progress = options.show_progress;
+    context.stats_path = options.stats_path;
+    context.progress_interval = options.progress_interval;
 
     ParallelUnpacker unpacker(context);
     for (const auto &input_path : options.input_paths)
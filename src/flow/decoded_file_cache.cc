@@ -0,0 +1,178 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/decoded_file_cache.h"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include "algo/crypt/md5.h"
+#include "algo/format.h"
+
+using namespace au;
+using namespace au::flow;
+
+namespace
+{
+    struct CacheEntry final
+    {
+        bstr content;
+        bool keep_path;
+        std::string extension;
+    };
+}
+
+struct DecodedFileCache::Priv final
+{
+    Priv(const size_t max_size);
+
+    // Expects the mutex to be held.
+    void insert(const std::string &key, const CacheEntry &entry);
+
+    std::mutex mutex;
+    std::condition_variable pending_done;
+    std::set<std::string> pending_keys;
+    std::map<std::string, CacheEntry> entries;
+    std::deque<std::string> insertion_order;
+    size_t max_size;
+    size_t size;
+    size_t hit_count;
+};
+
+DecodedFileCache::Priv::Priv(const size_t max_size)
+    : max_size(max_size), size(0), hit_count(0)
+{
+}
+
+void DecodedFileCache::Priv::insert(
+    const std::string &key, const CacheEntry &entry)
+{
+    if (entry.content.size() > max_size)
+        return;
+    if (entries.find(key) != entries.end())
+        return;
+    while (size + entry.content.size() > max_size && !insertion_order.empty())
+    {
+        const auto it = entries.find(insertion_order.front());
+        size -= it->second.content.size();
+        entries.erase(it);
+        insertion_order.pop_front();
+    }
+    entries[key] = entry;
+    insertion_order.push_back(key);
+    size += entry.content.size();
+}
+
+static std::string make_key(
+    const std::vector<std::string> &decoder_chain, io::File &input_file)
+{
+    const auto old_pos = input_file.stream.pos();
+    const auto content = input_file.stream.seek(0).read_to_eof();
+    input_file.stream.seek(old_pos);
+    std::string key;
+    for (const auto &decoder_name : decoder_chain)
+        key += decoder_name + ">";
+    return key + algo::format(
+        ":%llu:", static_cast<unsigned long long>(content.size()))
+        + algo::crypt::md5(content).str();
+}
+
+// The cached result can be reused only if the output name is derived from
+// the input name; decoders that rename their output based on the content
+// are always run.
+static bool make_entry(
+    const io::File &input_file, io::File &output_file, CacheEntry &entry)
+{
+    entry.keep_path = output_file.path == input_file.path;
+    entry.extension = output_file.path.extension();
+    if (!entry.keep_path)
+    {
+        auto expected_path = input_file.path;
+        expected_path.change_extension(entry.extension);
+        if (!(expected_path == output_file.path))
+            return false;
+    }
+    const auto old_pos = output_file.stream.pos();
+    entry.content = output_file.stream.seek(0).read_to_eof();
+    output_file.stream.seek(old_pos);
+    return true;
+}
+
+DecodedFileCache::DecodedFileCache(const size_t max_size)
+    : p(new Priv(max_size))
+{
+}
+
+DecodedFileCache::~DecodedFileCache()
+{
+}
+
+std::shared_ptr<io::File> DecodedFileCache::get_or_create(
+    const std::vector<std::string> &decoder_chain,
+    io::File &input_file,
+    const DecodedFileFactory factory)
+{
+    const auto key = make_key(decoder_chain, input_file);
+
+    {
+        std::unique_lock<std::mutex> lock(p->mutex);
+        p->pending_done.wait(lock, [&]()
+        {
+            return p->pending_keys.find(key) == p->pending_keys.end();
+        });
+        const auto it = p->entries.find(key);
+        if (it != p->entries.end())
+        {
+            ++p->hit_count;
+            auto path = input_file.path;
+            if (!it->second.keep_path)
+                path.change_extension(it->second.extension);
+            return std::make_shared<io::File>(path, it->second.content);
+        }
+        p->pending_keys.insert(key);
+    }
+
+    std::shared_ptr<io::File> output_file;
+    CacheEntry entry;
+    bool cacheable = false;
+    try
+    {
+        output_file = factory();
+        cacheable = output_file && make_entry(input_file, *output_file, entry);
+    }
+    catch (...)
+    {
+        std::unique_lock<std::mutex> lock(p->mutex);
+        p->pending_keys.erase(key);
+        p->pending_done.notify_all();
+        throw;
+    }
+
+    std::unique_lock<std::mutex> lock(p->mutex);
+    if (cacheable)
+        p->insert(key, entry);
+    p->pending_keys.erase(key);
+    p->pending_done.notify_all();
+    return output_file;
+}
+
+size_t DecodedFileCache::get_hit_count() const
+{
+    std::unique_lock<std::mutex> lock(p->mutex);
+    return p->hit_count;
+}
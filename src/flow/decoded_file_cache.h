@@ -0,0 +1,52 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "io/file.h"
+
+namespace au {
+namespace flow {
+
+    using DecodedFileFactory = std::function<std::shared_ptr<io::File>()>;
+
+    // Remembers conversion results keyed by the chain of decoders that led to
+    // the input file and its contents, so that identical files found in many
+    // archives are converted only once. Callers asking for a key that is
+    // being converted wait for that conversion instead of repeating it.
+    class DecodedFileCache final
+    {
+    public:
+        DecodedFileCache(const size_t max_size);
+        ~DecodedFileCache();
+
+        std::shared_ptr<io::File> get_or_create(
+            const std::vector<std::string> &decoder_chain,
+            io::File &input_file,
+            const DecodedFileFactory factory);
+
+        size_t get_hit_count() const;
+
+    private:
+        struct Priv;
+        std::unique_ptr<Priv> p;
+    };
+
+} }
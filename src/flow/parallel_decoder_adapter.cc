@@ -17,8 +17,9 @@
 
 #include "flow/parallel_decoder_adapter.h"
 #include "algo/naming_strategies.h"
+#include "enc/base_image_encoder.h"
 #include "enc/microsoft/wav_audio_encoder.h"
-#include "enc/png/png_image_encoder.h"
+#include "enc/registry.h"
 #include "flow/vfs_bridge.h"
 
 using namespace au;
@@ -26,8 +27,11 @@ using namespace au::flow;
 
 ParallelDecoderAdapter::ParallelDecoderAdapter(
     const std::shared_ptr<const BaseParallelUnpackingTask> parent_task,
-    const std::shared_ptr<io::File> input_file)
-    : parent_task(parent_task), input_file(input_file)
+    const std::shared_ptr<io::File> input_file,
+    const std::string &decoder_name) :
+        parent_task(parent_task),
+        input_file(input_file),
+        decoder_name(decoder_name)
 {
 }
 
@@ -35,11 +39,32 @@ ParallelDecoderAdapter::~ParallelDecoderAdapter()
 {
 }
 
+static uoff_t get_size(const io::File &file)
+{
+    return file.stream.size();
+}
+
+static uoff_t get_size(const res::Image &image)
+{
+    return image.width() * image.height() * 4;
+}
+
+static uoff_t get_size(const res::Audio &audio)
+{
+    return audio.samples.size();
+}
+
 void ParallelDecoderAdapter::visit(const dec::BaseArchiveDecoder &decoder)
 {
+    auto &tracer = parent_task->task_context.tracer;
+    const auto decoder_name = this->decoder_name;
     auto input_file = this->input_file;
-    auto meta = std::shared_ptr<dec::ArchiveMeta>(
-        decoder.read_meta(parent_task->logger, *input_file));
+    std::shared_ptr<dec::ArchiveMeta> meta;
+    {
+        TraceSpan span(
+            tracer, "read_meta", decoder_name, get_size(*input_file));
+        meta = decoder.read_meta(parent_task->logger, *input_file);
+    }
     parent_task->logger.info(
         "archive contains %d files.\n", meta->entries.size());
 
@@ -54,50 +79,150 @@ void ParallelDecoderAdapter::visit(const dec::BaseArchiveDecoder &decoder)
     {
         parent_task->save_file(
             input_file,
-            [meta, &entry, &decoder, vfs_bridge]
+            [meta, &entry, &decoder, vfs_bridge, &tracer, decoder_name]
             (io::File &input_file_copy, const Logger &logger)
             {
-                return decoder.read_file(
+                TraceSpan span(tracer, "read_file", decoder_name);
+                auto output_file = decoder.read_file(
                     logger, input_file_copy, *meta, *entry);
+                if (output_file)
+                    span.set_bytes_out(get_size(*output_file));
+                return output_file;
             },
             decoder,
+            decoder_name,
             entry->path.str());
     }
 }
 
-void ParallelDecoderAdapter::visit(const dec::BaseFileDecoder &decoder)
+void ParallelDecoderAdapter::save_converted_file(
+    const dec::BaseDecoder &decoder,
+    const DecoderFileFactory file_factory) const
 {
+    const auto &task_context = parent_task->task_context;
+    if (!task_context.unpacker_context.enable_deduplication)
+    {
+        parent_task->save_file(
+            input_file, file_factory, decoder, decoder_name);
+        return;
+    }
+
+    // Keyed on every decoder the input went through, not just the last one.
+    auto decoder_chain = parent_task->decoder_chain;
+    decoder_chain.push_back(decoder_name);
+    auto &decoded_file_cache = task_context.decoded_file_cache;
     parent_task->save_file(
         input_file,
-        [&decoder](io::File &input_file_copy, const Logger &logger)
+        [&decoded_file_cache, decoder_chain, file_factory]
+        (io::File &input_file_copy, const Logger &logger)
         {
-            return decoder.decode(logger, input_file_copy);
+            return decoded_file_cache.get_or_create(
+                decoder_chain,
+                input_file_copy,
+                [&]() { return file_factory(input_file_copy, logger); });
         },
-        decoder);
+        decoder,
+        decoder_name);
 }
 
-void ParallelDecoderAdapter::visit(const dec::BaseImageDecoder &decoder)
+void ParallelDecoderAdapter::visit(const dec::BaseFileDecoder &decoder)
 {
-    parent_task->save_file(
-        input_file,
-        [&decoder](io::File &input_file_copy, const Logger &logger)
+    auto &tracer = parent_task->task_context.tracer;
+    const auto decoder_name = this->decoder_name;
+    save_converted_file(
+        decoder,
+        [&decoder, &tracer, decoder_name]
+        (io::File &input_file_copy, const Logger &logger)
         {
+            TraceSpan span(
+                tracer, "decode", decoder_name, get_size(input_file_copy));
             auto output_file = decoder.decode(logger, input_file_copy);
-            const auto encoder = enc::png::PngImageEncoder();
-            return encoder.encode(logger, output_file, input_file_copy.path);
-        },
-        decoder);
+            if (output_file)
+                span.set_bytes_out(get_size(*output_file));
+            return output_file;
+        });
+}
+
+void ParallelDecoderAdapter::visit(const dec::BaseImageDecoder &decoder)
+{
+    auto &tracer = parent_task->task_context.tracer;
+    const auto decoder_name = this->decoder_name;
+    const auto &unpacker_context = parent_task->task_context.unpacker_context;
+    const std::shared_ptr<enc::BaseImageEncoder> encoder
+        = enc::Registry::instance().create_image_encoder(
+            unpacker_context.image_format);
+    ArgParser encoder_arg_parser;
+    const auto decorators = encoder->get_arg_parser_decorators();
+    for (const auto &decorator : decorators)
+        decorator.register_cli_options(encoder_arg_parser);
+    encoder_arg_parser.parse(unpacker_context.arguments);
+    for (const auto &decorator : decorators)
+        decorator.parse_cli_options(encoder_arg_parser);
+    save_converted_file(
+        decoder,
+        [&decoder, &tracer, decoder_name, encoder]
+        (io::File &input_file_copy, const Logger &logger)
+        {
+            // Decoders that can produce the image in bands feed the encoder
+            // directly, so very large images are never held in memory.
+            if (decoder.supports_band_decoding())
+            {
+                TraceSpan span(
+                    tracer,
+                    "decode_bands",
+                    decoder_name,
+                    get_size(input_file_copy));
+                auto encoded_file = std::make_unique<io::File>(
+                    input_file_copy.path, ""_b);
+                const auto sink = encoder->create_band_sink(
+                    logger, *encoded_file);
+                decoder.decode_bands(logger, input_file_copy, *sink);
+                span.set_bytes_out(get_size(*encoded_file));
+                return encoded_file;
+            }
+
+            const auto output_file = [&]()
+            {
+                TraceSpan span(
+                    tracer, "decode", decoder_name, get_size(input_file_copy));
+                auto output_file = decoder.decode(logger, input_file_copy);
+                span.set_bytes_out(get_size(output_file));
+                return output_file;
+            }();
+
+            TraceSpan span(
+                tracer, "encode", decoder_name, get_size(output_file));
+            auto encoded_file = encoder->encode(
+                logger, output_file, input_file_copy.path);
+            span.set_bytes_out(get_size(*encoded_file));
+            return encoded_file;
+        });
 }
 
 void ParallelDecoderAdapter::visit(const dec::BaseAudioDecoder &decoder)
 {
-    parent_task->save_file(
-        input_file,
-        [&decoder](io::File &input_file_copy, const Logger &logger)
+    auto &tracer = parent_task->task_context.tracer;
+    const auto decoder_name = this->decoder_name;
+    save_converted_file(
+        decoder,
+        [&decoder, &tracer, decoder_name]
+        (io::File &input_file_copy, const Logger &logger)
         {
-            auto output_file = decoder.decode(logger, input_file_copy);
+            const auto output_file = [&]()
+            {
+                TraceSpan span(
+                    tracer, "decode", decoder_name, get_size(input_file_copy));
+                auto output_file = decoder.decode(logger, input_file_copy);
+                span.set_bytes_out(get_size(output_file));
+                return output_file;
+            }();
+
+            TraceSpan span(
+                tracer, "encode", decoder_name, get_size(output_file));
             const auto encoder = enc::microsoft::WavAudioEncoder();
-            return encoder.encode(logger, output_file, input_file_copy.path);
-        },
-        decoder);
+            auto encoded_file = encoder.encode(
+                logger, output_file, input_file_copy.path);
+            span.set_bytes_out(get_size(*encoded_file));
+            return encoded_file;
+        });
 }
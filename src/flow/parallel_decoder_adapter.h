@@ -28,7 +28,8 @@ namespace flow {
     public:
         ParallelDecoderAdapter(
             const std::shared_ptr<const BaseParallelUnpackingTask> parent_task,
-            const std::shared_ptr<io::File> input_file);
+            const std::shared_ptr<io::File> input_file,
+            const std::string &decoder_name);
         ~ParallelDecoderAdapter();
 
         void visit(const dec::BaseArchiveDecoder &decoder) override;
@@ -37,8 +38,13 @@ namespace flow {
         void visit(const dec::BaseAudioDecoder &decoder) override;
 
     private:
+        void save_converted_file(
+            const dec::BaseDecoder &decoder,
+            const DecoderFileFactory file_factory) const;
+
         const std::shared_ptr<const BaseParallelUnpackingTask> parent_task;
         const std::shared_ptr<io::File> input_file;
+        const std::string decoder_name;
     };
 
 } }
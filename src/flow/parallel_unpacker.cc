@@ -18,8 +18,8 @@
 #include "flow/parallel_unpacker.h"
 #include <chrono>
 #include <set>
-#include <stack>
 #include "algo/format.h"
+#include "algo/range.h"
 #include "dec/idecoder.h"
 #include "err.h"
 #include "flow/parallel_decoder_adapter.h"
@@ -28,11 +28,29 @@ using namespace au;
 using namespace au::flow;
 
 static const auto max_depth = 10;
+static const auto decoded_file_cache_size = 64 * 1024 * 1024;
+static const auto max_memory_consumers = 10;
 static int task_count = 0;
 static std::mutex mutex;
 
 namespace
 {
+    // Attributes spans and memory allocated by the current thread to given
+    // task for as long as it works, counts the task as running and keeps its
+    // log lines together.
+    class TaskWorkScope final
+    {
+    public:
+        TaskWorkScope(const BaseParallelUnpackingTask &task);
+        ~TaskWorkScope();
+
+    private:
+        const BaseParallelUnpackingTask &task;
+        TraceTaskScope trace_scope;
+        memory::AccountScope memory_scope;
+        Logger::GroupScope log_group;
+    };
+
     struct DecodeInputFileTask final : public BaseParallelUnpackingTask
     {
         DecodeInputFileTask(
@@ -59,6 +77,7 @@ namespace
             const std::shared_ptr<io::File> input_file,
             const DecoderFileFactory file_factory,
             const std::shared_ptr<const dec::IDecoder> origin_decoder,
+            const std::string &origin_decoder_name,
             const std::string &target_name);
 
         bool work() const override;
@@ -70,55 +89,66 @@ namespace
     };
 }
 
+TaskWorkScope::TaskWorkScope(const BaseParallelUnpackingTask &task) :
+    task(task),
+    trace_scope(task.task_id),
+    memory_scope(task.memory_account)
+{
+    task.task_context.progress.add_running_task();
+}
+
+TaskWorkScope::~TaskWorkScope()
+{
+    task.task_context.progress.add_done_task();
+    if (task.memory_account)
+    {
+        task.task_context.tracer.add_counter(
+            "tracked memory", memory::get_tracked_bytes());
+    }
+}
+
+static double to_megabytes(const long long bytes)
+{
+    return bytes / 1024.0 / 1024.0;
+}
+
+// Decoders of formats that are fine to keep as they are, since converting
+// them would only take time and produce an equivalent file.
+static const std::set<std::string> standard_format_decoder_names
+{
+    "google/webp",
+    "jpeg/jpeg",
+    "microsoft/wav",
+    "png/png",
+};
+
 static bool save(
     const BaseParallelUnpackingTask &task, std::shared_ptr<io::File> file)
 {
+    TraceSpan span(task.task_context.tracer, "save", "", file->stream.size());
+    span.set_bytes_out(file->stream.size());
     try
     {
         const auto full_path
             = task.task_context.unpacker_context.file_saver.save(file);
+        task.task_context.progress.add_bytes_written(file->stream.size());
         task.logger.success("saved to %s\n", full_path.c_str());
-        task.logger.flush();
         return true;
     }
     catch (const err::IoError &e)
     {
         task.logger.err(
             "error saving (%s)\n", e.what() ? e.what() : "unknown error");
-        task.logger.flush();
         return false;
     }
 }
 
-static std::set<std::string> collect_linked_decoders(
-    const dec::IDecoder &base_decoder, const dec::Registry &registry)
-{
-    std::set<std::string> known_formats;
-    std::vector<std::shared_ptr<dec::IDecoder>> linked_decoders;
-    std::stack<const dec::IDecoder*> decoders_to_inspect;
-    decoders_to_inspect.push(&base_decoder);
-    while (!decoders_to_inspect.empty())
-    {
-        const auto decoder_to_inspect = decoders_to_inspect.top();
-        decoders_to_inspect.pop();
-        for (const auto &format : decoder_to_inspect->get_linked_formats())
-        {
-            if (known_formats.find(format) != known_formats.end())
-                continue;
-            known_formats.insert(format);
-            auto linked_decoder = registry.create_decoder(format);
-            decoders_to_inspect.push(linked_decoder.get());
-            linked_decoders.push_back(std::move(linked_decoder));
-        }
-    }
-    return std::set<std::string>(known_formats.begin(), known_formats.end());
-}
-
 static std::shared_ptr<dec::IDecoder> guess_decoder(
     const BaseParallelUnpackingTask &task,
     const std::set<std::string> &decoders_to_check,
     io::File &file,
-    const TaskSourceType source_type)
+    const TaskSourceType source_type,
+    std::string &decoder_name)
 {
     task.logger.info(
         "guessing decoder among %d decoders...\n", decoders_to_check.size());
@@ -126,6 +156,8 @@ static std::shared_ptr<dec::IDecoder> guess_decoder(
     std::map<std::string, std::shared_ptr<dec::IDecoder>> matching_decoders;
     for (const auto &name : decoders_to_check)
     {
+        TraceSpan span(
+            task.task_context.tracer, "recognition", name, file.stream.size());
         const auto current_decoder
             = task.task_context.unpacker_context.registry.create_decoder(name);
         if (current_decoder->is_recognized(file))
@@ -134,8 +166,9 @@ static std::shared_ptr<dec::IDecoder> guess_decoder(
 
     if (matching_decoders.size() == 1)
     {
-        task.logger.success(
-            "recognized as %s.\n", matching_decoders.begin()->first.c_str());
+        decoder_name = matching_decoders.begin()->first;
+        task.task_context.progress.add_decoder_hit(decoder_name);
+        task.logger.success("recognized as %s.\n", decoder_name.c_str());
         return matching_decoders.begin()->second;
     }
 
@@ -185,10 +218,16 @@ ParallelUnpackerContext::ParallelUnpackerContext(
 ParallelTaskContext::ParallelTaskContext(
     ParallelUnpacker &unpacker,
     const ParallelUnpackerContext &unpacker_context,
-    TaskScheduler &task_scheduler) :
+    TaskScheduler &task_scheduler,
+    DecodedFileCache &decoded_file_cache,
+    Tracer &tracer,
+    ProgressCounters &progress) :
         unpacker(unpacker),
         unpacker_context(unpacker_context),
-        task_scheduler(task_scheduler)
+        task_scheduler(task_scheduler),
+        decoded_file_cache(decoded_file_cache),
+        tracer(tracer),
+        progress(progress)
 {
 }
 
@@ -205,13 +244,23 @@ BaseParallelUnpackingTask::BaseParallelUnpackingTask(
         parent_task(parent_task),
         decoders_to_check(decoders_to_check)
 {
+    if (parent_task)
+        decoder_chain = parent_task->decoder_chain;
     mutex.lock();
-    const auto task_id = task_count++;
+    task_id = task_count++;
     mutex.unlock();
+    memory_account = memory::create_account(task_id, base_name.str());
+    task_context.progress.add_queued_task();
     logger.set_prefix(
         algo::format("[task %d] %s: ", task_id, base_name.c_str()));
 }
 
+BaseParallelUnpackingTask::~BaseParallelUnpackingTask()
+{
+    if (memory_account)
+        memory::close_account(memory_account);
+}
+
 size_t BaseParallelUnpackingTask::get_depth() const
 {
     auto depth = 0;
@@ -228,6 +277,7 @@ void BaseParallelUnpackingTask::save_file(
     const std::shared_ptr<io::File> input_file,
     const DecoderFileFactory file_factory,
     const dec::BaseDecoder &origin_decoder,
+    const std::string &origin_decoder_name,
     const std::string &target_name) const
 {
     task_context.task_scheduler.push_front(
@@ -241,6 +291,7 @@ void BaseParallelUnpackingTask::save_file(
             input_file,
             file_factory,
             origin_decoder.shared_from_this(),
+            origin_decoder_name,
             target_name));
 }
 
@@ -263,6 +314,7 @@ DecodeInputFileTask::DecodeInputFileTask(
 
 bool DecodeInputFileTask::work() const
 {
+    TaskWorkScope work_scope(*this);
     std::shared_ptr<io::File> input_file;
     try
     {
@@ -272,6 +324,8 @@ bool DecodeInputFileTask::work() const
             logger.err("no input file (?)\n");
             return false;
         }
+        if (source_type == TaskSourceType::InitialUserInput)
+            task_context.progress.add_bytes_read(input_file->stream.size());
     }
     catch (const std::exception &e)
     {
@@ -283,8 +337,12 @@ bool DecodeInputFileTask::work() const
     {
         logger.info("initial recognition...\n");
 
+        std::string decoder_name;
         const auto decoder = guess_decoder(
-            *this, decoders_to_check, *input_file, source_type);
+            *this, decoders_to_check, *input_file, source_type, decoder_name);
+
+        if (memory_account)
+            memory_account->set_decoder_name(decoder_name);
 
         if (!decoder)
         {
@@ -293,6 +351,16 @@ bool DecodeInputFileTask::work() const
                 : false;
         }
 
+        if (source_type == TaskSourceType::NestedDecoding
+            && task_context.unpacker_context.passthrough_standard_formats
+            && standard_format_decoder_names.find(decoder_name)
+                != standard_format_decoder_names.end())
+        {
+            logger.info("standard format, saving as is\n");
+            input_file->guess_extension();
+            return save(*this, input_file);
+        }
+
         ArgParser decoder_arg_parser;
         const auto decorators = decoder->get_arg_parser_decorators();
         for (const auto &decorator : decorators)
@@ -301,7 +369,8 @@ bool DecodeInputFileTask::work() const
         for (const auto &decorator : decorators)
             decorator.parse_cli_options(decoder_arg_parser);
 
-        ParallelDecoderAdapter adapter(shared_from_this(), input_file);
+        ParallelDecoderAdapter adapter(
+            shared_from_this(), input_file, decoder_name);
         decoder->accept(adapter);
         return true;
     }
@@ -323,6 +392,7 @@ ProcessOutputFileTask::ProcessOutputFileTask(
     const std::shared_ptr<io::File> input_file,
     const DecoderFileFactory file_factory,
     const std::shared_ptr<const dec::IDecoder> origin_decoder,
+    const std::string &origin_decoder_name,
     const std::string &target_name) :
         BaseParallelUnpackingTask(
             task_context,
@@ -335,10 +405,17 @@ ProcessOutputFileTask::ProcessOutputFileTask(
         origin_decoder(origin_decoder),
         target_name(target_name)
 {
+    decoder_chain.push_back(origin_decoder_name);
+    if (memory_account && parent_task && parent_task->memory_account)
+    {
+        memory_account->set_decoder_name(
+            parent_task->memory_account->get_decoder_name());
+    }
 }
 
 bool ProcessOutputFileTask::work() const
 {
+    TaskWorkScope work_scope(*this);
     logger.info(
         target_name.empty()
             ? "decoding...\n"
@@ -364,6 +441,7 @@ bool ProcessOutputFileTask::work() const
                 target_name.c_str());
             return false;
         }
+        task_context.progress.add_bytes_decoded(output_file->stream.size());
     }
     catch (const std::exception &e)
     {
@@ -394,8 +472,8 @@ bool ProcessOutputFileTask::work() const
     if (!task_context.unpacker_context.enable_nested_decoding)
         return save(*this, output_file);
 
-    auto linked_decoders = collect_linked_decoders(
-        *origin_decoder, task_context.unpacker_context.registry);
+    auto linked_decoders = task_context.unpacker_context.registry
+        .get_linked_decoder_names(*origin_decoder);
     linked_decoders.insert(
         decoders_to_check.begin(), decoders_to_check.end());
 
@@ -428,6 +506,9 @@ struct ParallelUnpacker::Priv final
 
     const ParallelUnpackerContext &unpacker_context;
     TaskScheduler task_scheduler;
+    DecodedFileCache decoded_file_cache;
+    Tracer tracer;
+    ProgressCounters progress;
     ParallelTaskContext task_context;
 };
 
@@ -435,8 +516,20 @@ ParallelUnpacker::Priv::Priv(
     ParallelUnpacker &unpacker,
     const ParallelUnpackerContext &unpacker_context) :
         unpacker_context(unpacker_context),
-        task_context(unpacker, unpacker_context, task_scheduler)
+        decoded_file_cache(decoded_file_cache_size),
+        progress(unpacker_context.registry.get_decoder_names()),
+        task_context(
+            unpacker,
+            unpacker_context,
+            task_scheduler,
+            decoded_file_cache,
+            tracer,
+            progress)
 {
+    if (!unpacker_context.trace_path.str().empty())
+        tracer.enable();
+    if (unpacker_context.enable_memory_accounting)
+        memory::enable_accounting();
 }
 
 ParallelUnpacker::ParallelUnpacker(
@@ -465,7 +558,16 @@ void ParallelUnpacker::add_input_file(
 bool ParallelUnpacker::run(const size_t thread_count)
 {
     const auto begin = std::chrono::steady_clock::now();
-    const auto results = p->task_scheduler.run(thread_count);
+    TaskSchedulerResult results;
+    {
+        ProgressReporter progress_reporter(
+            p->progress,
+            p->unpacker_context.logger,
+            p->unpacker_context.show_progress,
+            p->unpacker_context.stats_path,
+            std::chrono::seconds(p->unpacker_context.progress_interval));
+        results = p->task_scheduler.run(thread_count);
+    }
     const auto end = std::chrono::steady_clock::now();
     const auto diff
         = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin);
@@ -492,8 +594,77 @@ bool ParallelUnpacker::run(const size_t thread_count)
 
     logger.log(
         Logger::MessageType::Summary,
-        "%d saved files)\n",
+        "%d saved files",
         p->unpacker_context.file_saver.get_saved_file_count());
 
+    if (p->unpacker_context.enable_deduplication)
+    {
+        logger.log(
+            Logger::MessageType::Summary,
+            ", %d duplicates",
+            p->decoded_file_cache.get_hit_count());
+    }
+
+    logger.log(Logger::MessageType::Summary, ")\n");
+
+    if (p->unpacker_context.enable_memory_accounting
+        && !memory::accounting_enabled())
+    {
+        logger.log(
+            Logger::MessageType::Summary,
+            "Peak RSS: %.1fM (per-task accounting requires a build "
+            "configured with -Dmemory_accounting=ON)\n",
+            to_megabytes(memory::get_peak_rss()));
+    }
+    else if (p->unpacker_context.enable_memory_accounting)
+    {
+        logger.log(
+            Logger::MessageType::Summary,
+            "Peak RSS: %.1fM, peak tracked memory: %.1fM\n",
+            to_megabytes(memory::get_peak_rss()),
+            to_megabytes(memory::get_peak_tracked_bytes()));
+        const auto accounts = memory::get_top_accounts(max_memory_consumers);
+        for (const auto i : algo::range(accounts.size()))
+        {
+            const auto &account = accounts[i];
+            if (!account.peak_bytes)
+                break;
+            const auto description = algo::format(
+                "[task %d] %s (%s): peak %.1fM, %.1fM still held",
+                static_cast<int>(account.task_id),
+                account.name.c_str(),
+                account.decoder_name.empty()
+                    ? "-"
+                    : account.decoder_name.c_str(),
+                to_megabytes(account.peak_bytes),
+                to_megabytes(account.current_bytes));
+            logger.log(
+                Logger::MessageType::Summary, "%s\n", description.c_str());
+            p->tracer.set_metadata(
+                algo::format("memory consumer %d", static_cast<int>(i + 1)),
+                description);
+        }
+    }
+
+    if (p->tracer.enabled())
+    {
+        p->tracer.set_metadata(
+            "peak RSS",
+            algo::format("%.1fM", to_megabytes(memory::get_peak_rss())));
+        p->tracer.print_summary(logger);
+        try
+        {
+            p->tracer.save(p->unpacker_context.trace_path);
+            logger.log(
+                Logger::MessageType::Summary,
+                "Trace saved to %s\n",
+                p->unpacker_context.trace_path.c_str());
+        }
+        catch (const std::exception &e)
+        {
+            logger.err("Error saving trace (%s)\n", e.what());
+        }
+    }
+
     return results.error_count == 0;
 }
@@ -22,9 +22,13 @@
 #include <set>
 #include "dec/base_decoder.h"
 #include "dec/registry.h"
+#include "flow/decoded_file_cache.h"
 #include "flow/ifile_saver.h"
+#include "flow/progress.h"
 #include "flow/task_scheduler.h"
+#include "flow/tracer.h"
 #include "logger.h"
+#include "memory_accounting.h"
 
 namespace au {
 namespace flow {
@@ -57,6 +61,33 @@ namespace flow {
         const bool enable_nested_decoding;
         const std::vector<std::string> arguments;
         const std::set<std::string> decoders_to_check;
+
+        // Reuses conversion results for files with identical contents.
+        // Off by default since decoders that consult the virtual file system
+        // may produce different results for the same input.
+        bool enable_deduplication = false;
+
+        // Saves nested files that are already in a standard format (PNG,
+        // JPEG, WebP, WAV) as they are instead of converting them.
+        bool passthrough_standard_formats = false;
+
+        // Name of the enc::Registry image encoder that converted images are
+        // saved with.
+        std::string image_format = "png";
+
+        // If not empty, timings of the unpacking phases are saved there in
+        // Chrome trace event format.
+        io::path trace_path;
+
+        // Attributes memory held by buffers and images to the tasks that
+        // allocated them and reports the top consumers after the run.
+        bool enable_memory_accounting = false;
+
+        // Periodically prints the progress of the run, and/or saves it to
+        // stats_path as JSON, every progress_interval seconds.
+        bool show_progress = false;
+        io::path stats_path;
+        int progress_interval = 5;
     };
 
     struct ParallelTaskContext final
@@ -64,11 +95,17 @@ namespace flow {
         ParallelTaskContext(
             ParallelUnpacker &unpacker,
             const ParallelUnpackerContext &unpacker_context,
-            TaskScheduler &task_scheduler);
+            TaskScheduler &task_scheduler,
+            DecodedFileCache &decoded_file_cache,
+            Tracer &tracer,
+            ProgressCounters &progress);
 
         ParallelUnpacker &unpacker;
         const ParallelUnpackerContext &unpacker_context;
         TaskScheduler &task_scheduler;
+        DecodedFileCache &decoded_file_cache;
+        Tracer &tracer;
+        ProgressCounters &progress;
     };
 
     struct BaseParallelUnpackingTask :
@@ -82,7 +119,7 @@ namespace flow {
             const std::shared_ptr<const BaseParallelUnpackingTask> parent_task,
             const std::set<std::string> &decoders_to_check);
 
-        virtual ~BaseParallelUnpackingTask() {}
+        virtual ~BaseParallelUnpackingTask();
 
         size_t get_depth() const;
 
@@ -90,14 +127,21 @@ namespace flow {
             const std::shared_ptr<io::File> input_file,
             const DecoderFileFactory,
             const dec::BaseDecoder &origin_decoder,
+            const std::string &origin_decoder_name,
             const std::string &custom_name = "") const;
 
+        size_t task_id;
+        memory::Account *memory_account;
         Logger logger;
         ParallelTaskContext &task_context;
         const TaskSourceType source_type;
         const io::path base_name;
         const std::shared_ptr<const BaseParallelUnpackingTask> parent_task;
         const std::set<std::string> decoders_to_check;
+
+        // Names of the decoders that produced the input of this task,
+        // outermost first.
+        std::vector<std::string> decoder_chain;
     };
 
     class ParallelUnpacker final
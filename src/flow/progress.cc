@@ -0,0 +1,317 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/progress.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "algo/format.h"
+#include "io/file_byte_stream.h"
+
+using namespace au;
+using namespace au::flow;
+
+using ProgressClock = std::chrono::steady_clock;
+
+static double to_megabytes(const uoff_t bytes)
+{
+    return bytes / 1024.0 / 1024.0;
+}
+
+static std::string format_duration(const double seconds)
+{
+    const auto total = static_cast<int>(seconds + 0.5);
+    if (total >= 3600)
+    {
+        return algo::format(
+            "%d:%02d:%02d", total / 3600, (total / 60) % 60, total % 60);
+    }
+    return algo::format("%d:%02d", total / 60, total % 60);
+}
+
+size_t ProgressSnapshot::get_queue_depth() const
+{
+    return tasks_queued > tasks_running + tasks_done
+        ? tasks_queued - tasks_running - tasks_done
+        : 0;
+}
+
+double ProgressSnapshot::get_eta() const
+{
+    if (!tasks_done || elapsed_time <= 0)
+        return -1;
+    const auto rate = tasks_done / elapsed_time;
+    const auto remaining = tasks_queued > tasks_done
+        ? tasks_queued - tasks_done
+        : 0;
+    return remaining / rate;
+}
+
+struct ProgressCounters::Priv final
+{
+    Priv(const std::vector<std::string> &decoder_names);
+
+    const ProgressClock::time_point start;
+    std::atomic<size_t> tasks_queued;
+    std::atomic<size_t> tasks_running;
+    std::atomic<size_t> tasks_done;
+    std::atomic<uoff_t> bytes_read;
+    std::atomic<uoff_t> bytes_decoded;
+    std::atomic<uoff_t> bytes_written;
+
+    // never modified after construction, so it can be read without locking
+    std::map<std::string, std::unique_ptr<std::atomic<size_t>>> decoder_hits;
+};
+
+ProgressCounters::Priv::Priv(const std::vector<std::string> &decoder_names) :
+    start(ProgressClock::now()),
+    tasks_queued(0),
+    tasks_running(0),
+    tasks_done(0),
+    bytes_read(0),
+    bytes_decoded(0),
+    bytes_written(0)
+{
+    for (const auto &name : decoder_names)
+        decoder_hits[name].reset(new std::atomic<size_t>(0));
+}
+
+ProgressCounters::ProgressCounters(
+    const std::vector<std::string> &decoder_names)
+        : p(new Priv(decoder_names))
+{
+}
+
+ProgressCounters::~ProgressCounters()
+{
+}
+
+void ProgressCounters::add_queued_task()
+{
+    p->tasks_queued.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ProgressCounters::add_running_task()
+{
+    p->tasks_running.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ProgressCounters::add_done_task()
+{
+    p->tasks_done.fetch_add(1, std::memory_order_relaxed);
+    p->tasks_running.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ProgressCounters::add_bytes_read(const uoff_t size)
+{
+    p->bytes_read.fetch_add(size, std::memory_order_relaxed);
+}
+
+void ProgressCounters::add_bytes_decoded(const uoff_t size)
+{
+    p->bytes_decoded.fetch_add(size, std::memory_order_relaxed);
+}
+
+void ProgressCounters::add_bytes_written(const uoff_t size)
+{
+    p->bytes_written.fetch_add(size, std::memory_order_relaxed);
+}
+
+void ProgressCounters::add_decoder_hit(const std::string &decoder_name)
+{
+    const auto it = p->decoder_hits.find(decoder_name);
+    if (it != p->decoder_hits.end())
+        it->second->fetch_add(1, std::memory_order_relaxed);
+}
+
+ProgressSnapshot ProgressCounters::get_snapshot() const
+{
+    ProgressSnapshot snapshot;
+    snapshot.elapsed_time = std::chrono::duration<double>(
+        ProgressClock::now() - p->start).count();
+    // read in the order opposite to updates so that the queue depth doesn't
+    // go negative
+    snapshot.tasks_done = p->tasks_done;
+    snapshot.tasks_running = p->tasks_running;
+    snapshot.tasks_queued = p->tasks_queued;
+    snapshot.bytes_read = p->bytes_read;
+    snapshot.bytes_decoded = p->bytes_decoded;
+    snapshot.bytes_written = p->bytes_written;
+    for (const auto &kv : p->decoder_hits)
+    {
+        const size_t hits = *kv.second;
+        if (hits)
+            snapshot.decoder_hits[kv.first] = hits;
+    }
+    return snapshot;
+}
+
+void flow::print_progress(
+    const Logger &logger, const ProgressSnapshot &snapshot)
+{
+    const auto time = std::max(snapshot.elapsed_time, 0.001);
+    const auto eta = snapshot.get_eta();
+    logger.log(
+        Logger::MessageType::Summary,
+        "[%s] %d/%d tasks done, %d running, %d queued (%.1f/s); "
+            "read %.1fM (%.1fM/s), decoded %.1fM (%.1fM/s), "
+            "written %.1fM (%.1fM/s); ETA %s\n",
+        format_duration(snapshot.elapsed_time).c_str(),
+        static_cast<int>(snapshot.tasks_done),
+        static_cast<int>(snapshot.tasks_queued),
+        static_cast<int>(snapshot.tasks_running),
+        static_cast<int>(snapshot.get_queue_depth()),
+        snapshot.tasks_done / time,
+        to_megabytes(snapshot.bytes_read),
+        to_megabytes(snapshot.bytes_read) / time,
+        to_megabytes(snapshot.bytes_decoded),
+        to_megabytes(snapshot.bytes_decoded) / time,
+        to_megabytes(snapshot.bytes_written),
+        to_megabytes(snapshot.bytes_written) / time,
+        eta < 0 ? "?" : format_duration(eta).c_str());
+}
+
+void flow::save_progress(
+    const io::path &path, const ProgressSnapshot &snapshot)
+{
+    io::FileByteStream output_stream(path, io::FileMode::Write);
+    output_stream.write(algo::format(
+        "{\n"
+            "\"elapsed_time\":%.3f,\n"
+            "\"eta\":%.3f,\n"
+            "\"tasks\":{\"queued\":%llu,\"running\":%llu,\"done\":%llu,"
+                "\"queue_depth\":%llu},\n"
+            "\"bytes\":{\"read\":%llu,\"decoded\":%llu,\"written\":%llu},\n"
+            "\"decoder_hits\":{",
+        snapshot.elapsed_time,
+        snapshot.get_eta(),
+        static_cast<unsigned long long>(snapshot.tasks_queued),
+        static_cast<unsigned long long>(snapshot.tasks_running),
+        static_cast<unsigned long long>(snapshot.tasks_done),
+        static_cast<unsigned long long>(snapshot.get_queue_depth()),
+        static_cast<unsigned long long>(snapshot.bytes_read),
+        static_cast<unsigned long long>(snapshot.bytes_decoded),
+        static_cast<unsigned long long>(snapshot.bytes_written)));
+    bool first = true;
+    for (const auto &kv : snapshot.decoder_hits)
+    {
+        // decoder names consist of lowercase letters, digits, '-', '_' and '/'
+        output_stream.write(algo::format(
+            "%s\"%s\":%llu",
+            first ? "" : ",",
+            kv.first.c_str(),
+            static_cast<unsigned long long>(kv.second)));
+        first = false;
+    }
+    output_stream.write("}\n}\n");
+}
+
+struct ProgressReporter::Priv final
+{
+    Priv(
+        const ProgressCounters &counters,
+        const Logger &logger,
+        const bool show_progress,
+        const io::path &stats_path,
+        const std::chrono::milliseconds interval);
+    ~Priv();
+
+    void run();
+    void report(const bool final) const;
+
+    const ProgressCounters &counters;
+    const Logger &logger;
+    const bool show_progress;
+    const io::path stats_path;
+    const std::chrono::milliseconds interval;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping;
+    std::thread thread;
+};
+
+ProgressReporter::Priv::Priv(
+    const ProgressCounters &counters,
+    const Logger &logger,
+    const bool show_progress,
+    const io::path &stats_path,
+    const std::chrono::milliseconds interval) :
+        counters(counters),
+        logger(logger),
+        show_progress(show_progress),
+        stats_path(stats_path),
+        interval(interval),
+        stopping(false)
+{
+    if (show_progress || !stats_path.str().empty())
+        thread = std::thread([this]() { run(); });
+}
+
+ProgressReporter::Priv::~Priv()
+{
+    if (!thread.joinable())
+        return;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_one();
+    thread.join();
+    report(true);
+}
+
+void ProgressReporter::Priv::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!condition.wait_for(lock, interval, [&]() { return stopping; }))
+        report(false);
+}
+
+void ProgressReporter::Priv::report(const bool final) const
+{
+    const auto snapshot = counters.get_snapshot();
+    // the summary printed after the run makes the final console report
+    // redundant
+    if (show_progress && !final)
+        print_progress(logger, snapshot);
+    if (!stats_path.str().empty())
+    {
+        try
+        {
+            save_progress(stats_path, snapshot);
+        }
+        catch (const std::exception &e)
+        {
+            logger.err("Error saving stats (%s)\n", e.what());
+        }
+    }
+}
+
+ProgressReporter::ProgressReporter(
+    const ProgressCounters &counters,
+    const Logger &logger,
+    const bool show_progress,
+    const io::path &stats_path,
+    const std::chrono::milliseconds interval)
+        : p(new Priv(counters, logger, show_progress, stats_path, interval))
+{
+}
+
+ProgressReporter::~ProgressReporter()
+{
+}
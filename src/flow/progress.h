@@ -0,0 +1,95 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "io/path.h"
+#include "logger.h"
+#include "types.h"
+
+namespace au {
+namespace flow {
+
+    struct ProgressSnapshot final
+    {
+        double elapsed_time; // in seconds
+        size_t tasks_queued;
+        size_t tasks_running;
+        size_t tasks_done;
+        uoff_t bytes_read;
+        uoff_t bytes_decoded;
+        uoff_t bytes_written;
+        std::map<std::string, size_t> decoder_hits;
+
+        size_t get_queue_depth() const;
+
+        // Estimated from the rate of finished tasks; negative if unknown.
+        double get_eta() const;
+    };
+
+    // Counters updated by the unpacking workers. Updates are relaxed atomic
+    // increments, and the per-decoder counters are created up front so that
+    // workers never need a lock.
+    class ProgressCounters final
+    {
+    public:
+        ProgressCounters(const std::vector<std::string> &decoder_names);
+        ~ProgressCounters();
+
+        void add_queued_task();
+        void add_running_task();
+        void add_done_task();
+        void add_bytes_read(const uoff_t size);
+        void add_bytes_decoded(const uoff_t size);
+        void add_bytes_written(const uoff_t size);
+        void add_decoder_hit(const std::string &decoder_name);
+
+        ProgressSnapshot get_snapshot() const;
+
+    private:
+        struct Priv;
+        std::unique_ptr<Priv> p;
+    };
+
+    // Periodically prints the progress to the console and/or saves it as
+    // a JSON snapshot, from its own thread, for as long as it lives.
+    class ProgressReporter final
+    {
+    public:
+        ProgressReporter(
+            const ProgressCounters &counters,
+            const Logger &logger,
+            const bool show_progress,
+            const io::path &stats_path,
+            const std::chrono::milliseconds interval);
+        ~ProgressReporter();
+
+    private:
+        struct Priv;
+        std::unique_ptr<Priv> p;
+    };
+
+    void print_progress(const Logger &logger, const ProgressSnapshot &snapshot);
+    void save_progress(const io::path &path, const ProgressSnapshot &snapshot);
+
+} }
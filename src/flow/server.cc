@@ -0,0 +1,283 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/server.h"
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+#include "algo/range.h"
+#include "archive_handle.h"
+#include "err.h"
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+#endif
+
+using namespace au;
+using namespace au::flow;
+
+// requests only carry a few paths; anything larger than this comes from
+// a broken or hostile client and is rejected before anything is allocated
+static const u32 max_request_size = 1024 * 1024;
+
+namespace
+{
+    struct OpenArchive final
+    {
+        std::shared_ptr<const ArchiveHandle> handle;
+        uoff_t size;
+        std::time_t last_write_time;
+    };
+
+    using ArchiveList = std::list<std::pair<std::string, OpenArchive>>;
+}
+
+// Reads and drops the given number of bytes in small chunks.
+static bool skip_input(std::FILE *input, u32 size)
+{
+    u8 buffer[4096];
+    while (size)
+    {
+        const auto chunk_size = std::min<u32>(size, sizeof(buffer));
+        if (std::fread(buffer, 1, chunk_size, input) != chunk_size)
+            return false;
+        size -= chunk_size;
+    }
+    return true;
+}
+
+static void write_response(std::FILE *output, const bstr &response)
+{
+    const u32 response_size = response.size();
+    for (const auto i : {0, 8, 16, 24})
+        std::fputc((response_size >> i) & 0xFF, output);
+    std::fwrite(response.get<u8>(), 1, response.size(), output);
+    std::fflush(output);
+}
+
+static std::vector<std::string> split_fields(const bstr &message)
+{
+    std::vector<std::string> fields;
+    const auto str = message.str();
+    size_t start = 0;
+    while (true)
+    {
+        const auto end = str.find('\0', start);
+        fields.push_back(str.substr(start, end - start));
+        if (end == std::string::npos)
+            break;
+        start = end + 1;
+    }
+    return fields;
+}
+
+static bstr join_fields(const std::vector<bstr> &fields)
+{
+    bstr message;
+    for (const auto i : algo::range(fields.size()))
+    {
+        if (i)
+            message += '\0';
+        message += fields[i];
+    }
+    return message;
+}
+
+static bstr respond_with_file(io::File &file, const std::string &output_path)
+{
+    const auto content = file.stream.seek(0).read_to_eof();
+    if (output_path.empty())
+        return join_fields({"ok"_b, bstr(file.path.str()), content});
+    io::create_directories(io::path(output_path).parent());
+    io::FileByteStream(output_path, io::FileMode::Write).write(content);
+    return join_fields({"ok"_b, bstr(output_path)});
+}
+
+struct Server::Priv final
+{
+    Priv(
+        const dec::Registry &registry,
+        const std::string &decoder_name,
+        const std::vector<std::string> &decoder_arguments,
+        const size_t max_open_archives);
+
+    std::shared_ptr<const ArchiveHandle> open_archive(const io::path &path);
+    bstr handle_request(const std::vector<std::string> &fields);
+
+    const dec::Registry &registry;
+    const std::string decoder_name;
+    const std::vector<std::string> decoder_arguments;
+    const size_t max_open_archives;
+    bool quit_requested;
+
+    // most recently used archives come first
+    ArchiveList archives;
+    std::unordered_map<std::string, ArchiveList::iterator> archive_map;
+};
+
+Server::Priv::Priv(
+    const dec::Registry &registry,
+    const std::string &decoder_name,
+    const std::vector<std::string> &decoder_arguments,
+    const size_t max_open_archives) :
+        registry(registry),
+        decoder_name(decoder_name),
+        decoder_arguments(decoder_arguments),
+        max_open_archives(max_open_archives),
+        quit_requested(false)
+{
+}
+
+std::shared_ptr<const ArchiveHandle> Server::Priv::open_archive(
+    const io::path &path)
+{
+    const auto key = io::absolute(path).str();
+    const auto size = io::file_size(path);
+    const auto last_write_time = io::last_write_time(path);
+
+    const auto it = archive_map.find(key);
+    if (it != archive_map.end())
+    {
+        const auto &archive = it->second->second;
+        if (archive.size == size && archive.last_write_time == last_write_time)
+        {
+            archives.splice(archives.begin(), archives, it->second);
+            return archive.handle;
+        }
+        archives.erase(it->second);
+        archive_map.erase(it);
+    }
+
+    OpenArchive archive;
+    archive.handle = std::make_shared<const ArchiveHandle>(
+        path, decoder_name, decoder_arguments, registry);
+    archive.size = size;
+    archive.last_write_time = last_write_time;
+    archives.push_front({key, archive});
+    archive_map[key] = archives.begin();
+
+    while (archives.size() > max_open_archives)
+    {
+        archive_map.erase(archives.back().first);
+        archives.pop_back();
+    }
+    return archive.handle;
+}
+
+bstr Server::Priv::handle_request(const std::vector<std::string> &fields)
+{
+    const auto &command = fields.at(0);
+    const auto arg = [&](const size_t i)
+    {
+        return i < fields.size() ? fields[i] : std::string();
+    };
+
+    if (command == "quit")
+    {
+        quit_requested = true;
+        return "ok"_b;
+    }
+
+    if (command == "list" && fields.size() == 2)
+    {
+        const auto handle = open_archive(fields[1]);
+        std::vector<bstr> response {"ok"_b};
+        for (const auto &entry_name : handle->get_entry_names())
+            response.push_back(bstr(entry_name.str()));
+        return join_fields(response);
+    }
+
+    if (command == "extract" && (fields.size() == 3 || fields.size() == 4))
+    {
+        const auto output_file = open_archive(fields[1])->read(fields[2]);
+        if (!output_file)
+            throw err::CorruptDataError("Entry holds no data");
+        return respond_with_file(*output_file, arg(3));
+    }
+
+    if (command == "decode" && (fields.size() == 2 || fields.size() == 3))
+    {
+        ArchiveReadOptions options;
+        options.enable_nested_decoding = true;
+        options.enable_conversion = true;
+        io::File input_file(fields[1], io::FileMode::Read);
+        const auto output_file = decode_file(
+            input_file, options, decoder_arguments, registry);
+        return respond_with_file(*output_file, arg(2));
+    }
+
+    throw err::UsageError("Bad request: " + command);
+}
+
+Server::Server(
+    const dec::Registry &registry,
+    const std::string &decoder_name,
+    const std::vector<std::string> &decoder_arguments,
+    const size_t max_open_archives) :
+        p(new Priv(
+            registry, decoder_name, decoder_arguments, max_open_archives))
+{
+}
+
+Server::~Server()
+{
+}
+
+bstr Server::handle_request(const bstr &request)
+{
+    try
+    {
+        return p->handle_request(split_fields(request));
+    }
+    catch (const std::exception &e)
+    {
+        return join_fields({"error"_b, bstr(std::string(e.what()))});
+    }
+}
+
+void Server::run(std::FILE *input, std::FILE *output)
+{
+    #ifdef _WIN32
+        _setmode(_fileno(input), _O_BINARY);
+        _setmode(_fileno(output), _O_BINARY);
+    #endif
+
+    while (!p->quit_requested)
+    {
+        u8 size_bytes[4];
+        if (std::fread(size_bytes, 1, 4, input) != 4)
+            break;
+        u32 size = 0;
+        for (const auto i : {3, 2, 1, 0})
+            size = (size << 8) | size_bytes[i];
+        if (size > max_request_size)
+        {
+            if (!skip_input(input, size))
+                break;
+            write_response(output, join_fields(
+                {"error"_b, bstr(std::string("Request is too large"))}));
+            continue;
+        }
+        bstr request(size);
+        if (size && std::fread(request.get<u8>(), 1, size, input) != size)
+            break;
+
+        write_response(output, handle_request(request));
+    }
+}
@@ -0,0 +1,68 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "dec/registry.h"
+#include "types.h"
+
+namespace au {
+namespace flow {
+
+    // Answers requests sent over a size-prefixed protocol, keeping
+    // recently used archives open so that their tables are read only once.
+    //
+    // Every message is a little endian u32 size followed by that many bytes
+    // holding NUL-separated fields. Requests larger than 1 MiB are skipped
+    // and answered with an error. The requests are:
+    //
+    // - list ARCHIVE
+    // - extract ARCHIVE ENTRY [OUTPUT_PATH]
+    // - decode FILE [OUTPUT_PATH]
+    // - quit
+    //
+    // Responses start with "ok" or with "error" followed by a message.
+    // list responds with the entry names. extract responds with the entry
+    // name and its raw content, and decode with the name and content of the
+    // converted file. If OUTPUT_PATH is given, the content is saved there
+    // instead and only the path is sent back.
+    class Server final
+    {
+    public:
+        Server(
+            const dec::Registry &registry,
+            const std::string &decoder_name,
+            const std::vector<std::string> &decoder_arguments,
+            const size_t max_open_archives);
+
+        ~Server();
+
+        bstr handle_request(const bstr &request);
+
+        // Serves requests until the input ends or the client sends quit.
+        void run(std::FILE *input, std::FILE *output);
+
+    private:
+        struct Priv;
+        std::unique_ptr<Priv> p;
+    };
+
+} }
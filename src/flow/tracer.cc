@@ -0,0 +1,429 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/tracer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <set>
+#include "algo/format.h"
+#include "algo/range.h"
+#include "io/file_byte_stream.h"
+
+using namespace au;
+using namespace au::flow;
+
+namespace
+{
+    struct Span final
+    {
+        std::string phase;
+        std::string decoder_name;
+        size_t task_id;
+        TraceClock::time_point start;
+        TraceClock::time_point end;
+        uoff_t bytes_in;
+        uoff_t bytes_out;
+    };
+
+    struct Counter final
+    {
+        std::string name;
+        TraceClock::time_point time;
+        long long value;
+    };
+
+    struct ThreadBuffer final
+    {
+        size_t thread_id;
+        std::mutex mutex; // uncontended except when saving
+        std::vector<Span> spans;
+        std::vector<Counter> counters;
+    };
+
+    struct ThreadState final
+    {
+        size_t tracer_generation = 0;
+        ThreadBuffer *buffer = nullptr;
+        size_t task_id = 0;
+    };
+}
+
+static std::atomic<size_t> tracer_generation_counter(0);
+static thread_local ThreadState thread_state;
+
+static std::string escape(const std::string &input)
+{
+    std::string output;
+    output.reserve(input.size());
+    for (const auto c : input)
+    {
+        if (c == '"' || c == '\\')
+        {
+            output += '\\';
+            output += c;
+        }
+        else if (static_cast<u8>(c) < 0x20)
+            output += algo::format("\\u%04x", c);
+        else
+            output += c;
+    }
+    return output;
+}
+
+static double to_seconds(const TraceClock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+        .count() / 1000000.0;
+}
+
+struct Tracer::Priv final
+{
+    Priv();
+    ThreadBuffer &get_thread_buffer();
+    std::vector<std::pair<size_t, Span>> collect_spans() const;
+    std::vector<Counter> collect_counters() const;
+
+    std::atomic<bool> enabled;
+    const size_t generation;
+    const TraceClock::time_point start;
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::map<std::string, std::string> metadata;
+};
+
+Tracer::Priv::Priv() :
+    enabled(false),
+    generation(++tracer_generation_counter),
+    start(TraceClock::now())
+{
+}
+
+ThreadBuffer &Tracer::Priv::get_thread_buffer()
+{
+    if (thread_state.tracer_generation != generation)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->thread_id = buffers.size();
+        thread_state.tracer_generation = generation;
+        thread_state.buffer = buffer.get();
+        buffers.push_back(std::move(buffer));
+    }
+    return *thread_state.buffer;
+}
+
+std::vector<std::pair<size_t, Span>> Tracer::Priv::collect_spans() const
+{
+    std::vector<std::pair<size_t, Span>> spans;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (const auto &buffer : buffers)
+    {
+        std::unique_lock<std::mutex> buffer_lock(buffer->mutex);
+        for (const auto &span : buffer->spans)
+            spans.push_back({buffer->thread_id, span});
+    }
+    return spans;
+}
+
+std::vector<Counter> Tracer::Priv::collect_counters() const
+{
+    std::vector<Counter> counters;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (const auto &buffer : buffers)
+    {
+        std::unique_lock<std::mutex> buffer_lock(buffer->mutex);
+        counters.insert(
+            counters.end(), buffer->counters.begin(), buffer->counters.end());
+    }
+    std::sort(
+        counters.begin(),
+        counters.end(),
+        [](const Counter &a, const Counter &b) { return a.time < b.time; });
+    return counters;
+}
+
+Tracer::Tracer() : p(new Priv())
+{
+}
+
+Tracer::~Tracer()
+{
+}
+
+bool Tracer::enabled() const
+{
+    return p->enabled;
+}
+
+void Tracer::enable()
+{
+    p->enabled = true;
+}
+
+void Tracer::add_span(
+    const std::string &phase,
+    const std::string &decoder_name,
+    const TraceClock::time_point start,
+    const TraceClock::time_point end,
+    const uoff_t bytes_in,
+    const uoff_t bytes_out)
+{
+    if (!p->enabled)
+        return;
+    auto &buffer = p->get_thread_buffer();
+    std::unique_lock<std::mutex> lock(buffer.mutex);
+    buffer.spans.push_back(Span
+    {
+        phase,
+        decoder_name,
+        thread_state.task_id,
+        start,
+        end,
+        bytes_in,
+        bytes_out,
+    });
+}
+
+void Tracer::add_counter(const std::string &name, const long long value)
+{
+    if (!p->enabled)
+        return;
+    auto &buffer = p->get_thread_buffer();
+    std::unique_lock<std::mutex> lock(buffer.mutex);
+    buffer.counters.push_back(Counter{name, TraceClock::now(), value});
+}
+
+void Tracer::set_metadata(const std::string &key, const std::string &value)
+{
+    std::unique_lock<std::mutex> lock(p->mutex);
+    p->metadata[key] = value;
+}
+
+std::vector<TraceSummaryRow> Tracer::summarize() const
+{
+    std::map<
+        std::pair<std::string, std::string>,
+        std::vector<const Span*>> groups;
+    const auto spans = p->collect_spans();
+    for (const auto &item : spans)
+    {
+        const auto &span = item.second;
+        groups[{span.decoder_name, span.phase}].push_back(&span);
+    }
+
+    std::vector<TraceSummaryRow> rows;
+    for (auto &kv : groups)
+    {
+        auto &group = kv.second;
+        std::sort(
+            group.begin(),
+            group.end(),
+            [](const Span *a, const Span *b)
+            {
+                return a->end - a->start < b->end - b->start;
+            });
+
+        TraceSummaryRow row;
+        row.decoder_name = kv.first.first;
+        row.phase = kv.first.second;
+        row.count = group.size();
+        row.total_time = 0;
+        row.bytes_in = 0;
+        row.bytes_out = 0;
+        for (const auto span : group)
+        {
+            row.total_time += to_seconds(span->end - span->start);
+            row.bytes_in += span->bytes_in;
+            row.bytes_out += span->bytes_out;
+        }
+        row.mean_time = row.total_time / row.count;
+        const auto p99_index = static_cast<size_t>(
+            std::ceil(group.size() * 0.99)) - 1;
+        row.p99_time = to_seconds(
+            group[p99_index]->end - group[p99_index]->start);
+        rows.push_back(row);
+    }
+
+    std::sort(
+        rows.begin(),
+        rows.end(),
+        [](const TraceSummaryRow &a, const TraceSummaryRow &b)
+        {
+            return a.total_time > b.total_time;
+        });
+    return rows;
+}
+
+void Tracer::print_summary(const Logger &logger) const
+{
+    static const size_t max_rows = 25;
+    const auto rows = summarize();
+    if (rows.empty())
+        return;
+
+    logger.log(
+        Logger::MessageType::Summary,
+        "%-32s %-12s %7s %9s %9s %9s %10s %10s\n",
+        "Decoder", "Phase", "Count", "Total", "Mean", "P99", "In", "Out");
+    for (const auto i : algo::range(std::min(rows.size(), max_rows)))
+    {
+        const auto &row = rows[i];
+        logger.log(
+            Logger::MessageType::Summary,
+            "%-32s %-12s %7d %8.3fs %7.2fms %7.2fms %9.1fM %9.1fM\n",
+            row.decoder_name.empty() ? "-" : row.decoder_name.c_str(),
+            row.phase.c_str(),
+            static_cast<int>(row.count),
+            row.total_time,
+            row.mean_time * 1000.0,
+            row.p99_time * 1000.0,
+            row.bytes_in / 1024.0 / 1024.0,
+            row.bytes_out / 1024.0 / 1024.0);
+    }
+    if (rows.size() > max_rows)
+    {
+        logger.log(
+            Logger::MessageType::Summary,
+            "(%d more rows omitted)\n",
+            static_cast<int>(rows.size() - max_rows));
+    }
+}
+
+void Tracer::save(const io::path &path) const
+{
+    const auto spans = p->collect_spans();
+    std::set<size_t> thread_ids;
+    for (const auto &item : spans)
+        thread_ids.insert(item.first);
+
+    io::FileByteStream output_stream(path, io::FileMode::Write);
+    output_stream.write("{\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto thread_id : thread_ids)
+    {
+        output_stream.write(algo::format(
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":\"worker %d\"}}",
+            first ? "" : ",\n",
+            static_cast<int>(thread_id),
+            static_cast<int>(thread_id)));
+        first = false;
+    }
+    for (const auto &item : spans)
+    {
+        const auto &span = item.second;
+        const auto start = std::chrono::duration_cast<
+            std::chrono::microseconds>(span.start - p->start).count();
+        const auto duration = std::chrono::duration_cast<
+            std::chrono::microseconds>(span.end - span.start).count();
+        output_stream.write(algo::format(
+            "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                "\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"task\":%d,\"bytes_in\":%llu,\"bytes_out\":%llu}}",
+            first ? "" : ",\n",
+            escape(span.decoder_name.empty()
+                ? span.phase
+                : span.phase + " " + span.decoder_name).c_str(),
+            escape(span.phase).c_str(),
+            static_cast<long long>(start),
+            static_cast<long long>(duration),
+            static_cast<int>(item.first),
+            static_cast<int>(span.task_id),
+            static_cast<unsigned long long>(span.bytes_in),
+            static_cast<unsigned long long>(span.bytes_out)));
+        first = false;
+    }
+    for (const auto &counter : p->collect_counters())
+    {
+        const auto time = std::chrono::duration_cast<
+            std::chrono::microseconds>(counter.time - p->start).count();
+        output_stream.write(algo::format(
+            "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%lld,\"pid\":1,"
+                "\"args\":{\"value\":%lld}}",
+            first ? "" : ",\n",
+            escape(counter.name).c_str(),
+            static_cast<long long>(time),
+            counter.value));
+        first = false;
+    }
+    output_stream.write("\n],\"displayTimeUnit\":\"ms\"");
+
+    std::unique_lock<std::mutex> lock(p->mutex);
+    if (!p->metadata.empty())
+    {
+        output_stream.write(",\"otherData\":{");
+        first = true;
+        for (const auto &kv : p->metadata)
+        {
+            output_stream.write(algo::format(
+                "%s\n\"%s\":\"%s\"",
+                first ? "" : ",",
+                escape(kv.first).c_str(),
+                escape(kv.second).c_str()));
+            first = false;
+        }
+        output_stream.write("\n}");
+    }
+    output_stream.write("}\n");
+}
+
+TraceSpan::TraceSpan(
+    Tracer &tracer,
+    const std::string &phase,
+    const std::string &decoder_name,
+    const uoff_t bytes_in) :
+        tracer(tracer),
+        enabled(tracer.enabled()),
+        phase(enabled ? phase : ""),
+        decoder_name(enabled ? decoder_name : ""),
+        start(enabled ? TraceClock::now() : TraceClock::time_point()),
+        bytes_in(bytes_in),
+        bytes_out(0)
+{
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (!enabled)
+        return;
+    tracer.add_span(
+        phase, decoder_name, start, TraceClock::now(), bytes_in, bytes_out);
+}
+
+void TraceSpan::set_bytes_in(const uoff_t bytes_in)
+{
+    this->bytes_in = bytes_in;
+}
+
+void TraceSpan::set_bytes_out(const uoff_t bytes_out)
+{
+    this->bytes_out = bytes_out;
+}
+
+TraceTaskScope::TraceTaskScope(const size_t task_id)
+    : previous_task_id(thread_state.task_id)
+{
+    thread_state.task_id = task_id;
+}
+
+TraceTaskScope::~TraceTaskScope()
+{
+    thread_state.task_id = previous_task_id;
+}
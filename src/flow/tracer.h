@@ -0,0 +1,120 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "io/path.h"
+#include "logger.h"
+#include "types.h"
+
+namespace au {
+namespace flow {
+
+    using TraceClock = std::chrono::steady_clock;
+
+    struct TraceSummaryRow final
+    {
+        std::string decoder_name;
+        std::string phase;
+        size_t count;
+        double total_time; // in seconds
+        double mean_time;
+        double p99_time;
+        uoff_t bytes_in;
+        uoff_t bytes_out;
+    };
+
+    // Collects timed spans of the unpacking pipeline. Each thread records
+    // into its own buffer, so recording doesn't contend with other workers.
+    // The spans can be saved in the Chrome trace event format, which the
+    // about:tracing page of Chrome opens, or aggregated per decoder and
+    // phase.
+    class Tracer final
+    {
+    public:
+        Tracer();
+        ~Tracer();
+
+        bool enabled() const;
+        void enable();
+
+        void add_span(
+            const std::string &phase,
+            const std::string &decoder_name,
+            const TraceClock::time_point start,
+            const TraceClock::time_point end,
+            const uoff_t bytes_in,
+            const uoff_t bytes_out);
+
+        // Records a sample of a value that changes over time, such as memory
+        // usage.
+        void add_counter(const std::string &name, const long long value);
+
+        // Adds a free-form key-value pair to the saved trace.
+        void set_metadata(const std::string &key, const std::string &value);
+
+        std::vector<TraceSummaryRow> summarize() const;
+        void print_summary(const Logger &logger) const;
+        void save(const io::path &path) const;
+
+    private:
+        struct Priv;
+        std::unique_ptr<Priv> p;
+    };
+
+    // Attributes spans recorded by the current thread to given task for as
+    // long as the scope lives.
+    class TraceTaskScope final
+    {
+    public:
+        TraceTaskScope(const size_t task_id);
+        ~TraceTaskScope();
+
+    private:
+        const size_t previous_task_id;
+    };
+
+    // RAII helper that measures its own lifetime and records it as a span.
+    // Does nothing if the tracer is disabled.
+    class TraceSpan final
+    {
+    public:
+        TraceSpan(
+            Tracer &tracer,
+            const std::string &phase,
+            const std::string &decoder_name,
+            const uoff_t bytes_in = 0);
+        ~TraceSpan();
+
+        void set_bytes_in(const uoff_t bytes_in);
+        void set_bytes_out(const uoff_t bytes_out);
+
+    private:
+        Tracer &tracer;
+        const bool enabled;
+        const std::string phase;
+        const std::string decoder_name;
+        const TraceClock::time_point start;
+        uoff_t bytes_in;
+        uoff_t bytes_out;
+    };
+
+} }
@@ -16,10 +16,118 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "flow/vfs_bridge.h"
+#include <mutex>
+#include <unordered_map>
+#include "algo/naming_strategies.h"
+#include "algo/str.h"
 
 using namespace au;
 using namespace au::flow;
 
+namespace
+{
+    // Resolves lookups against the archive entries, indexing their target
+    // names on first use.
+    class ArchiveResolver final : public IVirtualFileResolver
+    {
+    public:
+        ArchiveResolver(
+            const Logger &logger,
+            const std::shared_ptr<const dec::BaseArchiveDecoder> decoder,
+            const std::shared_ptr<dec::ArchiveMeta> meta,
+            const std::shared_ptr<io::File> input_file,
+            const io::path &base_name);
+
+        io::path find(
+            const VirtualFileKey key_type,
+            const std::string &key) const override;
+
+        std::unique_ptr<io::File> open(const io::path &path) const override;
+
+    private:
+        void build_index() const;
+
+        const Logger logger;
+        const std::shared_ptr<const dec::BaseArchiveDecoder> decoder;
+        const std::shared_ptr<dec::ArchiveMeta> meta;
+        const std::shared_ptr<io::File> input_file;
+        const io::path base_name;
+
+        mutable std::once_flag indexed;
+        mutable std::unordered_map<std::string, io::path> paths_by_stem;
+        mutable std::unordered_map<std::string, io::path> paths_by_name;
+        mutable std::unordered_map<std::string, const dec::ArchiveEntry*>
+            entries_by_path;
+    };
+}
+
+// Keeps the lexicographically first path, like the VFS does across files.
+static void index_path(
+    std::unordered_map<std::string, io::path> &index,
+    const std::string &key,
+    const io::path &path)
+{
+    const auto it = index.find(key);
+    if (it == index.end())
+        index[key] = path;
+    else if (path < it->second)
+        it->second = path;
+}
+
+ArchiveResolver::ArchiveResolver(
+    const Logger &logger,
+    const std::shared_ptr<const dec::BaseArchiveDecoder> decoder,
+    const std::shared_ptr<dec::ArchiveMeta> meta,
+    const std::shared_ptr<io::File> input_file,
+    const io::path &base_name) :
+        logger(logger),
+        decoder(decoder),
+        meta(meta),
+        input_file(input_file),
+        base_name(base_name)
+{
+}
+
+void ArchiveResolver::build_index() const
+{
+    for (const auto &entry : meta->entries)
+    {
+        const io::path path(algo::lower(algo::apply_naming_strategy(
+            decoder->naming_strategy(), base_name, entry->path).str()));
+        // later entries with the same path shadow earlier ones
+        entries_by_path[path.str()] = entry.get();
+        index_path(paths_by_stem, path.stem(), path);
+        index_path(paths_by_name, path.name(), path);
+    }
+}
+
+io::path ArchiveResolver::find(
+    const VirtualFileKey key_type, const std::string &key) const
+{
+    std::call_once(indexed, [&]() { build_index(); });
+    if (key_type == VirtualFileKey::Path)
+    {
+        return entries_by_path.find(key) != entries_by_path.end()
+            ? io::path(key)
+            : io::path();
+    }
+    const auto &index = key_type == VirtualFileKey::Stem
+        ? paths_by_stem
+        : paths_by_name;
+    const auto it = index.find(key);
+    return it != index.end() ? it->second : io::path();
+}
+
+std::unique_ptr<io::File> ArchiveResolver::open(const io::path &path) const
+{
+    std::call_once(indexed, [&]() { build_index(); });
+    const auto it = entries_by_path.find(path.str());
+    if (it == entries_by_path.end())
+        return nullptr;
+    io::File file_copy(*input_file);
+    return decoder->read_file(logger, file_copy, *meta, *it->second);
+}
+
 struct VirtualFileSystemBridge::Priv final
 {
     Priv(
@@ -28,48 +136,25 @@ struct VirtualFileSystemBridge::Priv final
         const std::shared_ptr<dec::ArchiveMeta> meta,
         const std::shared_ptr<io::File> input_file,
         const io::path &base_name) :
-            logger(logger),
-            decoder(decoder),
-            meta(meta),
-            base_name(base_name),
-            decoder_refcount(decoder.shared_from_this())
+            resolver(std::make_shared<ArchiveResolver>(
+                logger,
+                std::static_pointer_cast<const dec::BaseArchiveDecoder>(
+                    decoder.shared_from_this()),
+                meta,
+                input_file,
+                base_name))
     {
-        for (const auto &entry : meta->entries)
-        {
-            VirtualFileSystem::register_file(
-                get_target_name(entry->path),
-                [&logger, input_file, meta, &entry, &decoder]()
-                {
-                    io::File file_copy(*input_file);
-                    return decoder.read_file(logger, file_copy, *meta, *entry);
-                });
-        }
+        VirtualFileSystem::register_resolver(resolver);
     }
 
     ~Priv()
     {
-        for (const auto &entry : meta->entries)
-        {
-            VirtualFileSystem::unregister_file(
-                get_target_name(entry->path));
-        }
+        VirtualFileSystem::unregister_resolver(resolver);
     }
 
-    io::path get_target_name(const io::path &input_path) const
-    {
-        return algo::apply_naming_strategy(
-            decoder.naming_strategy(), base_name, input_path);
-    }
-
-    const Logger logger;
-    const dec::BaseArchiveDecoder &decoder;
-    const std::shared_ptr<dec::ArchiveMeta> meta;
-    const io::path base_name;
-
-    // Prolongs decoder life to match those of the bridge. Avoids
-    // the need to downcast to shared_ptr<BaseArchiveDecoder>.
-    // TODO: probably not needed after we get long-lived task chains
-    const std::shared_ptr<const dec::IDecoder> decoder_refcount;
+    // The resolver owns the decoder, so it may outlive the bridge while
+    // a lookup is in progress.
+    const std::shared_ptr<const IVirtualFileResolver> resolver;
 };
 
 VirtualFileSystemBridge::VirtualFileSystemBridge(
@@ -0,0 +1,64 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "io/assets.h"
+#include <mutex>
+#include <unordered_map>
+#include "io/file.h"
+#include "io/program_path.h"
+
+using namespace au;
+
+namespace
+{
+    struct Asset final
+    {
+        std::once_flag created;
+        std::shared_ptr<const void> value;
+    };
+}
+
+static std::mutex mutex;
+static std::unordered_map<std::string, std::shared_ptr<Asset>> assets;
+
+std::shared_ptr<const void> io::get_derived_asset_impl(
+    const std::string &key,
+    const std::function<std::shared_ptr<const void>()> &factory)
+{
+    std::shared_ptr<Asset> asset;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto &slot = assets[key];
+        if (!slot)
+            slot = std::make_shared<Asset>();
+        asset = slot;
+    }
+    // if the factory throws, the next call tries again
+    std::call_once(asset->created, [&]() { asset->value = factory(); });
+    return asset->value;
+}
+
+std::shared_ptr<const bstr> io::read_asset(const path &relative_path)
+{
+    return get_derived_asset<bstr>(
+        "file:" + relative_path.str(),
+        [&]()
+        {
+            File file(get_assets_dir_path() / relative_path, FileMode::Read);
+            return file.stream.seek(0).read_to_eof();
+        });
+}
@@ -0,0 +1,53 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include "io/path.h"
+#include "types.h"
+
+namespace au {
+namespace io {
+
+    // Returns contents of a file in the etc/ assets directory. Each file is
+    // read only once per process, and the contents are shared immutably
+    // between threads.
+    std::shared_ptr<const bstr> read_asset(const path &relative_path);
+
+    std::shared_ptr<const void> get_derived_asset_impl(
+        const std::string &key,
+        const std::function<std::shared_ptr<const void>()> &factory);
+
+    // Memoizes a value derived from assets, such as a decoded image or
+    // a lookup table. The factory runs only once per key, even if several
+    // threads ask for the same key at once.
+    template<typename T> std::shared_ptr<const T> get_derived_asset(
+        const std::string &key, const std::function<T()> &factory)
+    {
+        return std::static_pointer_cast<const T>(get_derived_asset_impl(
+            key + ":" + typeid(T).name(),
+            [&]() -> std::shared_ptr<const void>
+            {
+                return std::make_shared<const T>(factory());
+            }));
+    }
+
+} }
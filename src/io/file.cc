@@ -36,6 +36,12 @@ static const std::vector<std::pair<bstr, std::string>> magic_definitions
     {"\x00\x00\x00\x14""ftypisom"_b, "mp4"},
 };
 
+// RIFF containers are told apart by the form type that follows their size.
+static const std::vector<std::pair<bstr, std::string>> riff_definitions
+{
+    {"WEBP"_b, "webp"},
+};
+
 File::File(File &other_file) :
     stream_holder(other_file.stream.clone()),
     stream(*stream_holder),
@@ -71,6 +77,18 @@ File::~File()
 void File::guess_extension()
 {
     const auto old_pos = stream.pos();
+    if (stream.size() >= 12 && stream.seek(0).read(4) == "RIFF"_b)
+    {
+        const auto form_type = stream.seek(8).read(4);
+        for (const auto &def : riff_definitions)
+        {
+            if (form_type != def.first)
+                continue;
+            path.change_extension(def.second);
+            stream.seek(old_pos);
+            return;
+        }
+    }
     for (const auto &def : magic_definitions)
     {
         const auto magic = def.first;
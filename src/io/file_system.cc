@@ -46,6 +46,16 @@ path io::absolute(const path &p)
     return boost::filesystem::absolute(p.str()).string();
 }
 
+uoff_t io::file_size(const path &p)
+{
+    return boost::filesystem::file_size(p.str());
+}
+
+std::time_t io::last_write_time(const path &p)
+{
+    return boost::filesystem::last_write_time(p.str());
+}
+
 void io::create_directories(const path &p)
 {
     const auto bp = boost::filesystem::path(p.str());
@@ -57,3 +67,8 @@ void io::remove(const path &p)
 {
     boost::filesystem::remove(p.str());
 }
+
+void io::rename(const path &old_path, const path &new_path)
+{
+    boost::filesystem::rename(old_path.str(), new_path.str());
+}
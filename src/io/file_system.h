@@ -18,7 +18,9 @@
 #pragma once
 
 #include <boost/filesystem.hpp>
+#include <ctime>
 #include "io/path.h"
+#include "types.h"
 
 namespace au {
 namespace io {
@@ -28,9 +30,12 @@ namespace io {
     bool is_directory(const path &p);
     bool is_regular_file(const path &p);
     path absolute(const path &p);
+    uoff_t file_size(const path &p);
+    std::time_t last_write_time(const path &p);
 
     void create_directories(const path &p);
     void remove(const path &p);
+    void rename(const path &old_path, const path &new_path);
 
     template<typename T> class BaseDirectoryRange final
     {
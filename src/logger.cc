@@ -16,30 +16,370 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "logger.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <iostream>
 #include <mutex>
+#include <thread>
+#include <vector>
 #include "algo/format.h"
+#include "algo/range.h"
 #include "algo/str.h"
 
 using namespace au;
 
-static std::mutex mutex;
+static const auto ring_capacity = 256;
+static const auto idle_timeout = std::chrono::milliseconds(50);
+
+namespace
+{
+    enum class RecordType : unsigned char
+    {
+        Text,
+        Color,
+        Flush,
+    };
+
+    struct Record final
+    {
+        RecordType type = RecordType::Text;
+        size_t sequence = 0;
+        bool use_stderr = false;
+        Logger::Color color = Logger::Color::Original;
+        std::string prefix;
+        std::string text;
+    };
+
+    // Lock-free queue with a single producer (the logging thread) and a
+    // single consumer (the writer thread). Records are moved in and out of
+    // preallocated slots.
+    class RecordRing final
+    {
+    public:
+        RecordRing();
+
+        bool push(Record &record);
+        bool pop(Record &record);
+        bool empty() const;
+
+        std::atomic<bool> abandoned;
+
+    private:
+        std::array<Record, ring_capacity> slots;
+        std::atomic<size_t> head;
+        std::atomic<size_t> tail;
+    };
+
+    // Records of the logging thread that are held back while a group is
+    // open, and the ring they go through once it closes.
+    struct ThreadState final
+    {
+        ~ThreadState();
+
+        std::shared_ptr<RecordRing> ring;
+        std::vector<Record> group;
+        size_t group_depth = 0;
+    };
+
+    struct LaterSequence final
+    {
+        bool operator ()(const Record &a, const Record &b) const
+        {
+            return a.sequence > b.sequence;
+        }
+    };
+}
+
+namespace au {
+
+    // Drains the rings of all logging threads and writes the messages to
+    // the console, so that workers never wait for console I/O. Records are
+    // numbered when they are published and written strictly in that order,
+    // so a record that is late to reach its ring holds back the later ones.
+    class LogWriter final
+    {
+    public:
+        LogWriter();
+        ~LogWriter();
+
+        // Numbers the records consecutively and hands them to the writer
+        // thread. Returns the number of the last one.
+        size_t publish(ThreadState &state, Record *records, const size_t n);
+
+        void wait_until_written(const size_t sequence);
+        static void write(const Record &record);
+
+    private:
+        RecordRing &get_ring(ThreadState &state);
+        void run();
+        bool drain();
+        bool write_pending();
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::condition_variable written_condition;
+        std::vector<std::shared_ptr<RecordRing>> rings;
+        std::atomic<size_t> sequence;
+        size_t written_sequence;
+        bool stopping;
+        std::thread thread;
+
+        // used only by the writer thread
+        std::vector<Record> pending;
+        Record popped_record;
+    };
+
+}
+
+// Messages logged before the writer is constructed or after it is destroyed
+// are written synchronously.
+static std::atomic<bool> writer_alive(false);
+static std::mutex sync_mutex;
+static LogWriter writer;
+
+static ThreadState &get_thread_state()
+{
+    static thread_local ThreadState state;
+    return state;
+}
+
+RecordRing::RecordRing() : abandoned(false), head(0), tail(0)
+{
+}
+
+bool RecordRing::push(Record &record)
+{
+    const auto tail = this->tail.load(std::memory_order_relaxed);
+    if (tail - head.load(std::memory_order_acquire) == ring_capacity)
+        return false;
+    slots[tail % ring_capacity] = std::move(record);
+    this->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool RecordRing::pop(Record &record)
+{
+    const auto head = this->head.load(std::memory_order_relaxed);
+    if (head == tail.load(std::memory_order_acquire))
+        return false;
+    record = std::move(slots[head % ring_capacity]);
+    this->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool RecordRing::empty() const
+{
+    return head.load() == tail.load();
+}
+
+ThreadState::~ThreadState()
+{
+    if (!group.empty() && writer_alive)
+        writer.publish(*this, group.data(), group.size());
+    if (ring)
+        ring->abandoned = true;
+}
+
+LogWriter::LogWriter() : sequence(0), written_sequence(0), stopping(false)
+{
+    writer_alive = true;
+}
+
+LogWriter::~LogWriter()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_one();
+    if (thread.joinable())
+        thread.join();
+    writer_alive = false;
+}
+
+RecordRing &LogWriter::get_ring(ThreadState &state)
+{
+    if (!state.ring)
+    {
+        state.ring = std::make_shared<RecordRing>();
+        std::unique_lock<std::mutex> lock(mutex);
+        rings.push_back(state.ring);
+        if (!thread.joinable())
+            thread = std::thread([this]() { run(); });
+    }
+    return *state.ring;
+}
+
+size_t LogWriter::publish(ThreadState &state, Record *records, const size_t n)
+{
+    auto &ring = get_ring(state);
+    const auto first_sequence = sequence.fetch_add(n);
+    for (const auto i : algo::range(n))
+    {
+        records[i].sequence = first_sequence + i;
+        while (!ring.push(records[i]))
+        {
+            condition.notify_one();
+            std::this_thread::yield();
+        }
+    }
+    condition.notify_one();
+    return first_sequence + n - 1;
+}
+
+void LogWriter::wait_until_written(const size_t sequence)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    written_condition.wait(
+        lock, [&]() { return written_sequence > sequence; });
+}
+
+void LogWriter::run()
+{
+    while (true)
+    {
+        bool should_stop;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            should_stop = stopping;
+        }
+        if (drain())
+            continue;
+        if (should_stop)
+            break;
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!stopping)
+            condition.wait_for(lock, idle_timeout);
+    }
+
+    // every published record has arrived by now
+    while (!pending.empty())
+    {
+        std::pop_heap(pending.begin(), pending.end(), LaterSequence());
+        write(pending.back());
+        pending.pop_back();
+    }
+    std::cout.flush();
+}
+
+bool LogWriter::drain()
+{
+    bool received = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = rings.begin();
+        while (it != rings.end())
+        {
+            const auto abandoned = (*it)->abandoned.load();
+            while ((*it)->pop(popped_record))
+            {
+                pending.push_back(std::move(popped_record));
+                std::push_heap(pending.begin(), pending.end(), LaterSequence());
+                received = true;
+            }
+            if (abandoned && (*it)->empty())
+                it = rings.erase(it);
+            else
+                ++it;
+        }
+    }
+    return write_pending() || received;
+}
+
+// Writes the pending records that follow the ones written so far without a
+// gap. The rest wait for the records that were published before them.
+bool LogWriter::write_pending()
+{
+    auto next_sequence = written_sequence;
+    while (!pending.empty() && pending.front().sequence == next_sequence)
+    {
+        std::pop_heap(pending.begin(), pending.end(), LaterSequence());
+        write(pending.back());
+        pending.pop_back();
+        ++next_sequence;
+    }
+    if (next_sequence == written_sequence)
+        return false;
+    std::cout.flush();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        written_sequence = next_sequence;
+    }
+    written_condition.notify_all();
+    return true;
+}
+
+void LogWriter::write(const Record &record)
+{
+    if (record.type == RecordType::Flush)
+    {
+        std::cout.flush();
+        std::cerr.flush();
+        return;
+    }
+    if (record.type == RecordType::Color)
+    {
+        Logger::apply_color(record.color);
+        return;
+    }
+    auto &out = record.use_stderr ? std::cerr : std::cout;
+    for (const auto &line : algo::split(record.text, '\n', true))
+    {
+        out << record.prefix;
+        if (record.color != Logger::Color::Original)
+            Logger::apply_color(record.color);
+        out << line;
+        if (record.color != Logger::Color::Original)
+            Logger::apply_color(Logger::Color::Original);
+    }
+}
+
+// Hands the record to the writer thread, or holds it back while the calling
+// thread has a group open. Returns whether it was handed over and under what
+// number.
+static bool dispatch(Record &record, size_t &sequence)
+{
+    auto &state = get_thread_state();
+    if (state.group_depth)
+    {
+        state.group.push_back(std::move(record));
+        return false;
+    }
+    if (writer_alive)
+    {
+        sequence = writer.publish(state, &record, 1);
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(sync_mutex);
+    LogWriter::write(record);
+    return false;
+}
+
+static void dispatch(Record &record)
+{
+    size_t sequence;
+    dispatch(record, sequence);
+}
 
 struct Logger::Priv final
 {
-    Priv(Logger &logger);
+    Priv();
     void log(
-        const MessageType type, const std::string fmt, std::va_list args) const;
+        const MessageType type, const char *fmt, std::va_list args) const;
+    void log(const MessageType type, const std::string &fmt) const;
+    void write(const MessageType type, const std::string &text) const;
 
-    Logger &logger;
     Color colors[6];
     int muted = 0;
     bool colors_enabled = true;
     std::string prefix;
 };
 
-Logger::Priv::Priv(Logger &logger) : logger(logger)
+Logger::Priv::Priv()
 {
     colors[MessageType::Summary] = Color::Original;
     colors[MessageType::Info] = Color::Original;
@@ -50,34 +390,39 @@ Logger::Priv::Priv(Logger &logger) : logger(logger)
 }
 
 void Logger::Priv::log(
-    const MessageType type, const std::string fmt, std::va_list args) const
+    const MessageType type, const char *fmt, std::va_list args) const
 {
-    std::unique_lock<std::mutex> lock(mutex);
     if (muted & (1 << type))
         return;
-    auto *out = &std::cout;
-    if (type == MessageType::Warning || type == MessageType::Error)
-        out = &std::cerr;
-    const auto output = algo::format(fmt, args);
-    for (const auto line : algo::split(output, '\n', true))
-    {
-        (*out) << prefix;
-        if (colors_enabled && colors[type] != Color::Original)
-            logger.set_color(colors[type]);
-        (*out) << line;
-        if (colors_enabled && colors[type] != Color::Original)
-            logger.set_color(Color::Original);
-    }
+    write(type, algo::format(fmt, args));
+}
+
+void Logger::Priv::log(const MessageType type, const std::string &fmt) const
+{
+    if (muted & (1 << type))
+        return;
+    write(type, algo::format(fmt));
 }
 
-Logger::Logger(const Logger &other_logger) : p(new Priv(*this))
+void Logger::Priv::write(const MessageType type, const std::string &text) const
+{
+    Record record;
+    record.use_stderr
+        = type == MessageType::Warning || type == MessageType::Error;
+    record.color = colors_enabled ? colors[type] : Color::Original;
+    record.prefix = prefix;
+    record.text = text;
+    dispatch(record);
+}
+
+Logger::Logger(const Logger &other_logger) : p(new Priv())
 {
     p->muted = other_logger.p->muted;
     p->colors_enabled = other_logger.p->colors_enabled;
     p->prefix = other_logger.p->prefix;
 }
 
-Logger::Logger() : p(new Priv(*this))
+Logger::Logger() : p(new Priv())
 {
     unmute();
 }
@@ -86,13 +431,20 @@ Logger::~Logger()
 {
 }
 
+void Logger::set_color(const Color c)
+{
+    Record record;
+    record.type = RecordType::Color;
+    record.color = c;
+    dispatch(record);
+}
+
 void Logger::set_prefix(const std::string &prefix)
 {
     p->prefix = prefix;
 }
 
-void Logger::log(
-    const MessageType message_type, const std::string fmt, ...) const
+void Logger::log(const MessageType message_type, const char *fmt, ...) const
 {
     std::va_list args;
     va_start(args, fmt);
@@ -100,7 +452,13 @@ void Logger::log(
     va_end(args);
 }
 
-void Logger::info(const std::string fmt, ...) const
+void Logger::log(
+    const MessageType message_type, const std::string &str) const
+{
+    p->log(message_type, str);
+}
+
+void Logger::info(const char *fmt, ...) const
 {
     std::va_list args;
     va_start(args, fmt);
@@ -108,7 +466,12 @@ void Logger::info(const std::string fmt, ...) const
     va_end(args);
 }
 
-void Logger::success(const std::string fmt, ...) const
+void Logger::info(const std::string &str) const
+{
+    p->log(MessageType::Info, str);
+}
+
+void Logger::success(const char *fmt, ...) const
 {
     std::va_list args;
     va_start(args, fmt);
@@ -116,7 +479,12 @@ void Logger::success(const std::string fmt, ...) const
     va_end(args);
 }
 
-void Logger::warn(const std::string fmt, ...) const
+void Logger::success(const std::string &str) const
+{
+    p->log(MessageType::Success, str);
+}
+
+void Logger::warn(const char *fmt, ...) const
 {
     std::va_list args;
     va_start(args, fmt);
@@ -124,7 +492,12 @@ void Logger::warn(const std::string fmt, ...) const
     va_end(args);
 }
 
-void Logger::err(const std::string fmt, ...) const
+void Logger::warn(const std::string &str) const
+{
+    p->log(MessageType::Warning, str);
+}
+
+void Logger::err(const char *fmt, ...) const
 {
     std::va_list args;
     va_start(args, fmt);
@@ -132,7 +505,12 @@ void Logger::err(const std::string fmt, ...) const
     va_end(args);
 }
 
-void Logger::debug(const std::string fmt, ...) const
+void Logger::err(const std::string &str) const
+{
+    p->log(MessageType::Error, str);
+}
+
+void Logger::debug(const char *fmt, ...) const
 {
     std::va_list args;
     va_start(args, fmt);
@@ -140,10 +518,52 @@ void Logger::debug(const std::string fmt, ...) const
     va_end(args);
 }
 
+void Logger::debug(const std::string &str) const
+{
+    p->log(MessageType::Debug, str);
+}
+
 void Logger::flush() const
 {
-    std::cout.flush();
-    // stderr should be nonbuffered
+    // messages held back by an open group go out first, together
+    auto &state = get_thread_state();
+    const auto group_depth = state.group_depth;
+    if (group_depth && !state.group.empty() && writer_alive)
+    {
+        writer.publish(state, state.group.data(), state.group.size());
+        state.group.clear();
+    }
+    state.group_depth = 0;
+
+    Record record;
+    record.type = RecordType::Flush;
+    size_t sequence;
+    if (dispatch(record, sequence))
+        writer.wait_until_written(sequence);
+    state.group_depth = group_depth;
+}
+
+Logger::GroupScope::GroupScope()
+{
+    ++get_thread_state().group_depth;
+}
+
+Logger::GroupScope::~GroupScope()
+{
+    auto &state = get_thread_state();
+    if (--state.group_depth || state.group.empty())
+        return;
+    if (writer_alive)
+    {
+        writer.publish(state, state.group.data(), state.group.size());
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(sync_mutex);
+        for (const auto &record : state.group)
+            LogWriter::write(record);
+    }
+    state.group.clear();
 }
 
 void Logger::mute()
@@ -61,14 +61,38 @@ namespace au {
         Logger(const Logger &other_logger);
         ~Logger();
 
+        // Holds back the messages logged by the calling thread while it
+        // lives and writes them together once it ends, so that the lines of
+        // one task are not interleaved with those of others. Scopes can be
+        // nested; only the outermost one releases the messages.
+        class GroupScope final
+        {
+        public:
+            GroupScope();
+            ~GroupScope();
+        };
+
+        // Messages are formatted on the calling thread and written to the
+        // console by a single background thread, in the order they were
+        // logged (or, inside a group, in the order the group ended). Muted
+        // messages are not formatted at all. Strings are format strings too.
         void set_color(const Color c);
         void set_prefix(const std::string &prefix);
-        void log(const MessageType type, const std::string fmt, ...) const;
-        void info(const std::string str, ...) const;
-        void success(const std::string str, ...) const;
-        void warn(const std::string str, ...) const;
-        void err(const std::string str, ...) const;
-        void debug(const std::string str, ...) const;
+        void log(const MessageType type, const char *fmt, ...) const;
+        void log(const MessageType type, const std::string &str) const;
+        void info(const char *fmt, ...) const;
+        void info(const std::string &str) const;
+        void success(const char *fmt, ...) const;
+        void success(const std::string &str) const;
+        void warn(const char *fmt, ...) const;
+        void warn(const std::string &str) const;
+        void err(const char *fmt, ...) const;
+        void err(const std::string &str) const;
+        void debug(const char *fmt, ...) const;
+        void debug(const std::string &str) const;
+
+        // Blocks until all messages logged so far are written, including
+        // the ones held back by an open group.
         void flush() const;
 
         void mute();
@@ -81,6 +105,9 @@ namespace au {
         void enable_colors();
 
     private:
+        static void apply_color(const Color c);
+        friend class LogWriter;
+
         struct Priv;
         std::unique_ptr<Priv> p;
     };
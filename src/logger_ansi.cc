@@ -45,7 +45,7 @@ static std::string get_ansi_color(const Logger::Color c)
     return "";
 }
 
-void Logger::set_color(const Logger::Color c)
+void Logger::apply_color(const Logger::Color c)
 {
     if (isatty(STDIN_FILENO))
         std::cout << get_ansi_color(c);
@@ -19,6 +19,6 @@
 
 using namespace au;
 
-void Logger::set_color(const Color c)
+void Logger::apply_color(const Color c)
 {
 }
@@ -73,7 +73,7 @@ static WORD get_win_color(const Logger::Color c)
     throw std::logic_error("Unknown color");
 }
 
-void Logger::set_color(const Logger::Color c)
+void Logger::apply_color(const Logger::Color c)
 {
     HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
     SetConsoleTextAttribute(hConsole, get_win_color(c));
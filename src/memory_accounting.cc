@@ -0,0 +1,290 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "memory_accounting.h"
+#include <algorithm>
+#include <set>
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+using namespace au;
+using namespace au::memory;
+
+namespace
+{
+    struct AccountRegistry final
+    {
+        std::mutex mutex;
+        std::set<Account*> open_accounts;
+        std::vector<AccountSummary> closed_summaries;
+    };
+}
+
+// Closed accounts are only kept for the report of the top consumers.
+static const size_t max_closed_summaries = 100;
+
+static std::atomic<bool> enabled(false);
+static std::atomic<long long> tracked_bytes(0);
+static std::atomic<long long> peak_tracked_bytes(0);
+static thread_local Account *current_account = nullptr;
+
+static AccountRegistry &get_registry()
+{
+    // intentionally leaked: buffers released during static destruction may
+    // still close the accounts
+    static auto registry = new AccountRegistry();
+    return *registry;
+}
+
+static AccountSummary summarize(const Account &account)
+{
+    return AccountSummary
+    {
+        account.task_id,
+        account.name,
+        account.get_decoder_name(),
+        account.current_bytes,
+        account.peak_bytes,
+    };
+}
+
+static bool has_higher_peak(const AccountSummary &a, const AccountSummary &b)
+{
+    return a.peak_bytes > b.peak_bytes;
+}
+
+static void update_peak(std::atomic<long long> &peak, const long long value)
+{
+    auto old_peak = peak.load(std::memory_order_relaxed);
+    while (value > old_peak
+        && !peak.compare_exchange_weak(
+            old_peak, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+Account::Account(const size_t task_id, const std::string &name) :
+    task_id(task_id),
+    name(name),
+    current_bytes(0),
+    peak_bytes(0),
+    reference_count(1)
+{
+}
+
+void Account::acquire()
+{
+    reference_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Account::release()
+{
+    if (reference_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete this;
+}
+
+void Account::charge(const size_t size)
+{
+    update_peak(
+        peak_bytes,
+        current_bytes.fetch_add(size, std::memory_order_relaxed) + size);
+    update_peak(
+        peak_tracked_bytes,
+        tracked_bytes.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+void Account::discharge(const size_t size)
+{
+    current_bytes.fetch_sub(size, std::memory_order_relaxed);
+    tracked_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void Account::set_decoder_name(const std::string &decoder_name)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    this->decoder_name = decoder_name;
+}
+
+std::string Account::get_decoder_name() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return decoder_name;
+}
+
+void memory::enable_accounting()
+{
+    #if AU_MEMORY_ACCOUNTING
+        enabled = true;
+    #endif
+}
+
+bool memory::accounting_enabled()
+{
+    return enabled;
+}
+
+Account *memory::create_account(const size_t task_id, const std::string &name)
+{
+    if (!enabled)
+        return nullptr;
+    const auto account = new Account(task_id, name);
+    auto &registry = get_registry();
+    std::unique_lock<std::mutex> lock(registry.mutex);
+    registry.open_accounts.insert(account);
+    return account;
+}
+
+void memory::close_account(Account *account)
+{
+    {
+        auto &registry = get_registry();
+        std::unique_lock<std::mutex> lock(registry.mutex);
+        registry.open_accounts.erase(account);
+        auto &summaries = registry.closed_summaries;
+        summaries.push_back(summarize(*account));
+        if (summaries.size() > max_closed_summaries * 2)
+        {
+            std::sort(summaries.begin(), summaries.end(), has_higher_peak);
+            summaries.resize(max_closed_summaries);
+        }
+    }
+    account->release();
+}
+
+Account *memory::get_current_account()
+{
+    return current_account;
+}
+
+long long memory::get_tracked_bytes()
+{
+    return tracked_bytes;
+}
+
+long long memory::get_peak_tracked_bytes()
+{
+    return peak_tracked_bytes;
+}
+
+std::vector<AccountSummary> memory::get_top_accounts(const size_t max_count)
+{
+    std::vector<AccountSummary> summaries;
+    {
+        auto &registry = get_registry();
+        std::unique_lock<std::mutex> lock(registry.mutex);
+        summaries = registry.closed_summaries;
+        for (const auto account : registry.open_accounts)
+            summaries.push_back(summarize(*account));
+    }
+    std::sort(summaries.begin(), summaries.end(), has_higher_peak);
+    if (summaries.size() > max_count)
+        summaries.resize(max_count);
+    return summaries;
+}
+
+unsigned long long memory::get_peak_rss()
+{
+    #ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(
+            GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return 0;
+        }
+        return counters.PeakWorkingSetSize;
+    #else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage))
+            return 0;
+        #ifdef __APPLE__
+            return usage.ru_maxrss;
+        #else
+            return usage.ru_maxrss * 1024ull;
+        #endif
+    #endif
+}
+
+AccountScope::AccountScope(Account *account)
+    : previous_account(current_account)
+{
+    current_account = account;
+}
+
+AccountScope::~AccountScope()
+{
+    current_account = previous_account;
+}
+
+Charge::Charge(const size_t size) : account(current_account), size(0)
+{
+    if (account)
+        account->acquire();
+    set(size);
+}
+
+Charge::Charge(const Charge &other) : Charge(other.size)
+{
+}
+
+Charge::Charge(Charge &&other) : account(other.account), size(other.size)
+{
+    other.account = nullptr;
+    other.size = 0;
+}
+
+Charge::~Charge()
+{
+    set(0);
+    if (account)
+        account->release();
+}
+
+Charge &Charge::operator =(const Charge &other)
+{
+    set(other.size);
+    return *this;
+}
+
+Charge &Charge::operator =(Charge &&other)
+{
+    if (this == &other)
+        return *this;
+    set(0);
+    if (account)
+        account->release();
+    account = other.account;
+    size = other.size;
+    other.account = nullptr;
+    other.size = 0;
+    return *this;
+}
+
+void Charge::set(const size_t size)
+{
+    if (account)
+    {
+        if (size > this->size)
+            account->charge(size - this->size);
+        else if (size < this->size)
+            account->discharge(this->size - size);
+    }
+    this->size = size;
+}
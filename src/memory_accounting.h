@@ -0,0 +1,203 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace au {
+namespace memory {
+
+    // Opt-in accounting of the memory held by bstr buffers and image
+    // contents. Each allocation is charged to the account that was current
+    // on the allocating thread, and released from the same account no matter
+    // which thread frees it.
+    //
+    // bstr and Grid only track their memory in builds configured with
+    // -Dmemory_accounting=ON (AU_MEMORY_ACCOUNTING), so that other builds
+    // don't pay for it. Elsewhere no accounts are ever created.
+    class Account final
+    {
+    public:
+        Account(const size_t task_id, const std::string &name);
+
+        void charge(const size_t size);
+        void discharge(const size_t size);
+
+        // Accounts are freed once their task closed them and no allocator
+        // or charge refers to them anymore.
+        void acquire();
+        void release();
+
+        void set_decoder_name(const std::string &decoder_name);
+        std::string get_decoder_name() const;
+
+        const size_t task_id;
+        const std::string name;
+        std::atomic<long long> current_bytes;
+        std::atomic<long long> peak_bytes;
+
+    private:
+        mutable std::mutex mutex;
+        std::string decoder_name;
+        std::atomic<size_t> reference_count;
+    };
+
+    struct AccountSummary final
+    {
+        size_t task_id;
+        std::string name;
+        std::string decoder_name;
+        long long current_bytes;
+        long long peak_bytes;
+    };
+
+    // Accounting cannot be turned off once enabled, since buffers allocated
+    // while it was on must be released from their accounts. Enabling it has
+    // no effect in builds without AU_MEMORY_ACCOUNTING.
+    void enable_accounting();
+    bool accounting_enabled();
+
+    // Returns nullptr if accounting is disabled. The account must be closed
+    // when its task ends; only the summaries of the closed accounts with the
+    // highest peaks are kept after that.
+    Account *create_account(const size_t task_id, const std::string &name);
+    void close_account(Account *account);
+    Account *get_current_account();
+
+    long long get_tracked_bytes();
+    long long get_peak_tracked_bytes();
+    std::vector<AccountSummary> get_top_accounts(const size_t max_count);
+
+    unsigned long long get_peak_rss();
+
+    // Makes given account current for the calling thread for as long as the
+    // scope lives.
+    class AccountScope final
+    {
+    public:
+        AccountScope(Account *account);
+        ~AccountScope();
+
+    private:
+        Account *previous_account;
+    };
+
+    // Allocator for containers whose size changes often. The account is
+    // chosen at construction and travels with the buffer on moves and swaps.
+    template<typename T> class TrackingAllocator final
+    {
+    public:
+        using value_type = T;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        TrackingAllocator() : account(get_current_account())
+        {
+            if (account)
+                account->acquire();
+        }
+
+        TrackingAllocator(const TrackingAllocator &other)
+            : account(other.account)
+        {
+            if (account)
+                account->acquire();
+        }
+
+        template<typename U> TrackingAllocator(
+            const TrackingAllocator<U> &other) : account(other.account)
+        {
+            if (account)
+                account->acquire();
+        }
+
+        ~TrackingAllocator()
+        {
+            if (account)
+                account->release();
+        }
+
+        TrackingAllocator &operator =(const TrackingAllocator &other)
+        {
+            if (other.account)
+                other.account->acquire();
+            if (account)
+                account->release();
+            account = other.account;
+            return *this;
+        }
+
+        TrackingAllocator select_on_container_copy_construction() const
+        {
+            return TrackingAllocator();
+        }
+
+        T *allocate(const size_t n)
+        {
+            const auto ptr = std::allocator<T>().allocate(n);
+            if (account)
+                account->charge(n * sizeof(T));
+            return ptr;
+        }
+
+        void deallocate(T *ptr, const size_t n)
+        {
+            if (account)
+                account->discharge(n * sizeof(T));
+            std::allocator<T>().deallocate(ptr, n);
+        }
+
+        template<typename U> bool operator ==(
+            const TrackingAllocator<U> &other) const
+        {
+            return account == other.account;
+        }
+
+        template<typename U> bool operator !=(
+            const TrackingAllocator<U> &other) const
+        {
+            return account != other.account;
+        }
+
+        Account *account;
+    };
+
+    // Charges a fixed amount of memory, for containers that are resized
+    // rarely and can't use TrackingAllocator.
+    class Charge final
+    {
+    public:
+        Charge(const size_t size = 0);
+        Charge(const Charge &other);
+        Charge(Charge &&other);
+        ~Charge();
+
+        Charge &operator =(const Charge &other);
+        Charge &operator =(Charge &&other);
+        void set(const size_t size);
+
+    private:
+        Account *account;
+        size_t size;
+    };
+
+} }
@@ -0,0 +1,39 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "res/image_view.h"
+
+namespace au {
+namespace res {
+
+    // Receives an image as bands of full rows, from top to bottom, so that
+    // it never needs to be held in memory at once.
+    class IImageBandSink
+    {
+    public:
+        virtual ~IImageBandSink() {}
+        // Producers that know every pixel will be opaque say so up front,
+        // so that the sink can pick its format before seeing the rows.
+        virtual void begin(
+            const size_t width, const size_t height, const bool is_opaque) = 0;
+        virtual void write_band(const ImageView &band) = 0;
+        virtual void end() = 0;
+    };
+
+} }
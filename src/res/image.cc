@@ -17,23 +17,177 @@
 
 #include "res/image.h"
 #include <algorithm>
+#include <cstring>
 #include "algo/format.h"
 #include "algo/range.h"
 #include "err.h"
+#include "res/image_view.h"
+#include "res/simd.h"
 
 using namespace au;
 using namespace au::res;
 
 static const Pixel transparent_pixel = {0, 0, 0, 0};
 
-Image::Image(const Image &other) : Grid(other)
+// Row kernels below work on pixels read as little endian numbers, where
+// alpha is the top byte and red is the byte below it.
+static const u32 color_mask = 0x00FFFFFF;
+
+#ifdef AU_HAVE_SSE2
+    static inline __m128i load_pixels(const Pixel *ptr)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    }
+
+    static inline void store_pixels(Pixel *ptr, const __m128i value)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), value);
+    }
+#endif
+
+static void reverse_pixels(Pixel *ptr, const size_t n)
+{
+    auto left_ptr = ptr;
+    auto right_ptr = ptr + n;
+    #ifdef AU_HAVE_SSE2
+        while (right_ptr - left_ptr >= 8)
+        {
+            right_ptr -= 4;
+            const auto left = load_pixels(left_ptr);
+            const auto right = load_pixels(right_ptr);
+            store_pixels(left_ptr, _mm_shuffle_epi32(right, 0x1B));
+            store_pixels(right_ptr, _mm_shuffle_epi32(left, 0x1B));
+            left_ptr += 4;
+        }
+    #endif
+    std::reverse(left_ptr, right_ptr);
+}
+
+static void invert_pixels(Pixel *ptr, const size_t n)
+{
+    size_t i = 0;
+    #ifdef AU_HAVE_SSE2
+        const auto mask = _mm_set1_epi32(color_mask);
+        for (; i + 4 <= n; i += 4)
+            store_pixels(ptr + i, _mm_xor_si128(load_pixels(ptr + i), mask));
+    #endif
+    for (; i < n; i++)
+    {
+        ptr[i].r ^= 0xFF;
+        ptr[i].g ^= 0xFF;
+        ptr[i].b ^= 0xFF;
+    }
+}
+
+static void copy_mask(Pixel *target_ptr, const Pixel *mask_ptr, const size_t n)
+{
+    size_t i = 0;
+    #ifdef AU_HAVE_SSE2
+        const auto mask = _mm_set1_epi32(color_mask);
+        for (; i + 4 <= n; i += 4)
+        {
+            store_pixels(target_ptr + i, _mm_or_si128(
+                _mm_and_si128(load_pixels(target_ptr + i), mask),
+                _mm_andnot_si128(
+                    mask, _mm_slli_epi32(load_pixels(mask_ptr + i), 8))));
+        }
+    #endif
+    for (; i < n; i++)
+        target_ptr[i].a = mask_ptr[i].r;
+}
+
+static void overwrite_non_transparent(
+    Pixel *target_ptr, const Pixel *source_ptr, const size_t n)
+{
+    size_t i = 0;
+    #ifdef AU_HAVE_SSE2
+        const auto alpha_mask = _mm_set1_epi32(~color_mask);
+        const auto zero = _mm_setzero_si128();
+        for (; i + 4 <= n; i += 4)
+        {
+            const auto source = load_pixels(source_ptr + i);
+            const auto transparent = _mm_cmpeq_epi32(
+                _mm_and_si128(source, alpha_mask), zero);
+            store_pixels(target_ptr + i, _mm_or_si128(
+                _mm_and_si128(transparent, load_pixels(target_ptr + i)),
+                _mm_andnot_si128(transparent, source)));
+        }
+    #endif
+    for (; i < n; i++)
+        if (source_ptr[i].a)
+            target_ptr[i] = source_ptr[i];
+}
+
+static void add_pixels(
+    Pixel *target_ptr, const Pixel *source_ptr, const size_t n)
+{
+    size_t i = 0;
+    #ifdef AU_HAVE_SSE2
+        const auto mask = _mm_set1_epi32(color_mask);
+        for (; i + 4 <= n; i += 4)
+        {
+            store_pixels(target_ptr + i, _mm_add_epi8(
+                load_pixels(target_ptr + i),
+                _mm_and_si128(load_pixels(source_ptr + i), mask)));
+        }
+    #endif
+    for (; i < n; i++)
+    {
+        target_ptr[i].r += source_ptr[i].r;
+        target_ptr[i].g += source_ptr[i].g;
+        target_ptr[i].b += source_ptr[i].b;
+    }
+}
+
+// Copies get the pixels rather than the indices.
+static const Image &with_pixels(const Image &image)
 {
+    image.begin();
+    return image;
 }
 
-Image::Image(const size_t width, const size_t height) : Grid(width, height)
+Image::Image(const Image &other) :
+    Grid(with_pixels(other)),
+    source_palette(other.source_palette),
+    has_pixels(true)
 {
 }
 
+Image::Image(Image &&other) :
+    Grid(std::move(other)),
+    source_palette(std::move(other.source_palette)),
+    indices(std::move(other.indices)),
+    colors(std::move(other.colors)),
+    #if AU_MEMORY_ACCOUNTING
+        indices_charge(std::move(other.indices_charge)),
+    #endif
+    has_pixels(other.has_pixels.load())
+{
+    other.indices = bstr();
+    other.colors.clear();
+    other.has_pixels = true;
+}
+
+Image::Image(const size_t width, const size_t height) :
+    Grid(width, height),
+    has_pixels(true)
+{
+}
+
+Image::Image(const ImageView &view) :
+    Grid(view.width(), view.height()),
+    source_palette(view.get_source_palette()),
+    has_pixels(true)
+{
+    for (const auto y : algo::range(_height))
+    {
+        const auto row_ptr = content.data() + y * _width;
+        const auto source_ptr = view.get_row(y, row_ptr);
+        if (source_ptr != row_ptr)
+            std::memcpy(row_ptr, source_ptr, _width * sizeof(Pixel));
+    }
+}
+
 Image::Image(
     const size_t width,
     const size_t height,
@@ -60,14 +214,34 @@ Image::Image(
 {
 }
 
+// Indices past the end of the palette keep their gray value but become
+// transparent, same as with apply_palette().
 Image::Image(
     const size_t width,
     const size_t height,
     const bstr &input,
-    const Palette &palette)
-        : Image(width, height, input, PixelFormat::Gray8)
+    const Palette &palette) :
+        Grid(std::vector<Pixel>(), width, height),
+        source_palette(std::make_shared<const Palette>(palette)),
+        colors(256),
+        has_pixels(false)
 {
-    apply_palette(palette);
+    if (input.size() < width * height)
+        throw err::BadDataSizeError();
+    for (const auto i : algo::range(256))
+    {
+        if (static_cast<size_t>(i) < palette.size())
+            colors[i] = palette[i];
+        else
+        {
+            colors[i].b = colors[i].g = colors[i].r = i;
+            colors[i].a = 0;
+        }
+    }
+    indices = bstr(input.get<const u8>(), width * height);
+    #if AU_MEMORY_ACCOUNTING
+        indices_charge.set(indices.size());
+    #endif
 }
 
 Image::Image(
@@ -75,77 +249,207 @@ Image::Image(
     const size_t height,
     io::BaseByteStream &input_stream,
     const Palette &palette)
-        : Image(width, height, input_stream, PixelFormat::Gray8)
+        : Image(width, height, input_stream.read(width * height), palette)
 {
-    apply_palette(palette);
+}
+
+Image &Image::operator =(const Image &other)
+{
+    Grid::operator =(with_pixels(other));
+    source_palette = other.source_palette;
+    has_pixels = true;
+    drop_indices();
+    return *this;
+}
+
+Image &Image::operator =(Image &&other)
+{
+    if (this == &other)
+        return *this;
+    Grid::operator =(std::move(other));
+    source_palette = std::move(other.source_palette);
+    indices = std::move(other.indices);
+    colors = std::move(other.colors);
+    #if AU_MEMORY_ACCOUNTING
+        indices_charge = std::move(other.indices_charge);
+    #endif
+    has_pixels = other.has_pixels.load();
+    other.indices = bstr();
+    other.colors.clear();
+    other.has_pixels = true;
+    return *this;
+}
+
+const Pixel *Image::get_pixels(
+    const size_t x, const size_t y, const size_t count, Pixel *scratch) const
+{
+    if (has_pixels.load(std::memory_order_acquire))
+        return &Grid::at(x, y);
+    read_indexed_pixels(
+        indices.get<const u8>() + x + y * _width,
+        scratch,
+        count,
+        colors.data());
+    return scratch;
+}
+
+void Image::expand_indices() const
+{
+    std::lock_guard<std::mutex> lock(expansion_mutex);
+    if (has_pixels.load(std::memory_order_relaxed))
+        return;
+    content.resize(_width * _height);
+    read_indexed_pixels(indices.get<const u8>(), content, colors.data());
+    update_content_charge();
+    has_pixels.store(true, std::memory_order_release);
+}
+
+void Image::drop_indices()
+{
+    materialize();
+    indices = bstr();
+    colors = std::vector<Pixel>();
+    #if AU_MEMORY_ACCOUNTING
+        indices_charge.set(0);
+    #endif
 }
 
 Image &Image::invert()
 {
-    for (const auto y : algo::range(_height))
-    for (const auto x : algo::range(_width))
-    {
-        at(x, y).r ^= 0xFF;
-        at(x, y).g ^= 0xFF;
-        at(x, y).b ^= 0xFF;
-    }
+    expand();
+    invert_pixels(content.data(), _width * _height);
     return *this;
 }
 
 Image &Image::flip_vertically()
 {
+    expand();
+    const auto row_size = _width * sizeof(Pixel);
+    std::vector<Pixel> row(_width);
     for (const auto y : algo::range(_height >> 1))
-    for (const auto x : algo::range(_width))
     {
-        const auto t = at(x, _height - 1 - y);
-        at(x, _height - 1 - y) = at(x, y);
-        at(x, y) = t;
+        const auto top_ptr = content.data() + y * _width;
+        const auto bottom_ptr = content.data() + (_height - 1 - y) * _width;
+        std::memcpy(row.data(), top_ptr, row_size);
+        std::memcpy(top_ptr, bottom_ptr, row_size);
+        std::memcpy(bottom_ptr, row.data(), row_size);
     }
     return *this;
 }
 
 Image &Image::flip_horizontally()
 {
+    expand();
     for (const auto y : algo::range(_height))
-    for (const auto x : algo::range(_width >> 1))
-    {
-        const auto t = at(_width - 1 - x, y);
-        at(_width - 1 - x, y) = at(x, y);
-        at(x, y) = t;
-    }
+        reverse_pixels(content.data() + y * _width, _width);
     return *this;
 }
 
 Image &Image::offset(const int x_offset, const int y_offset)
 {
-    res::Image old_image(*this);
-    crop(_width + x_offset, _height + y_offset);
-    for (auto &c : content)
-        c = transparent_pixel;
-    return overlay(old_image, x_offset, y_offset, OverlayKind::OverwriteAll);
+    const int new_width = static_cast<int>(_width) + x_offset;
+    const int new_height = static_cast<int>(_height) + y_offset;
+    if (new_width <= 0 || new_height <= 0)
+        throw err::BadDataSizeError();
+    if (!x_offset && !y_offset)
+        return *this;
+    expand();
+
+    // Offsets of mixed signs are applied one axis at a time so that both
+    // steps can shift the rows in place.
+    if ((x_offset < 0 && y_offset > 0) || (x_offset > 0 && y_offset < 0))
+    {
+        offset(x_offset, 0);
+        return offset(0, y_offset);
+    }
+
+    const auto old_width = _width;
+    const auto old_height = _height;
+    if (x_offset >= 0 && y_offset >= 0)
+    {
+        content.resize(new_width * new_height);
+        for (auto y = old_height; y-- > 0; )
+        {
+            const auto source = content.begin() + y * old_width;
+            std::copy_backward(
+                source,
+                source + old_width,
+                content.begin() + (y + y_offset) * new_width + new_width);
+        }
+        std::fill(
+            content.begin(),
+            content.begin() + y_offset * new_width,
+            transparent_pixel);
+        for (const auto y : algo::range(y_offset, new_height))
+        {
+            const auto target = content.begin() + y * new_width;
+            std::fill(target, target + x_offset, transparent_pixel);
+        }
+    }
+    else
+    {
+        for (const auto y : algo::range(new_height))
+        {
+            const auto source
+                = content.begin() + (y - y_offset) * old_width - x_offset;
+            std::copy(
+                source, source + new_width, content.begin() + y * new_width);
+        }
+        content.resize(new_width * new_height);
+    }
+
+    _width = new_width;
+    _height = new_height;
+    update_content_charge();
+    return *this;
 }
 
 Image &Image::crop(const size_t new_width, const size_t new_height)
 {
-    std::vector<Pixel> old_content(content.begin(), content.end());
     if (!new_width || !new_height)
         throw err::BadDataSizeError();
+    expand();
     const auto old_width = _width;
-    const auto old_height = _height;
-    _width = new_width;
-    _height = new_height;
+    const auto common_width = std::min(_width, new_width);
+    const auto common_height = std::min(_height, new_height);
+
+    // Rows are shifted within the same buffer: front to back when they get
+    // narrower, back to front when they get wider.
+    if (new_width < old_width)
+    {
+        for (const auto y : algo::range(1, common_height))
+        {
+            const auto source = content.begin() + y * old_width;
+            std::copy(
+                source, source + common_width, content.begin() + y * new_width);
+        }
+    }
     content.resize(new_width * new_height);
-    for (const auto y : algo::range(std::min(old_height, new_height)))
-    for (const auto x : algo::range(std::min(old_width, new_width)))
+    if (new_width > old_width)
     {
-        content[y * new_width + x] = old_content[y * old_width + x];
+        for (auto y = common_height; y-- > 1; )
+        {
+            const auto source = content.begin() + y * old_width;
+            std::copy_backward(
+                source,
+                source + common_width,
+                content.begin() + y * new_width + common_width);
+        }
+        for (const auto y : algo::range(common_height))
+        {
+            const auto target = content.begin() + y * new_width;
+            std::fill(
+                target + common_width, target + new_width, transparent_pixel);
+        }
     }
-    for (const auto y : algo::range(old_height, new_height))
-    for (const auto x : algo::range(new_width))
-        content[y * new_width + x] = transparent_pixel;
-    for (const auto y : algo::range(old_height))
-    for (const auto x : algo::range(old_width, new_width))
-        content[y * new_width + x] = transparent_pixel;
+
+    std::fill(
+        content.begin() + common_height * new_width,
+        content.end(),
+        transparent_pixel);
+    _width = new_width;
+    _height = new_height;
+    update_content_charge();
     return *this;
 }
 
@@ -153,25 +457,39 @@ Image &Image::apply_mask(const Image &other)
 {
     if (other.width() != _width || other.height() != _height)
         throw std::logic_error("Mask image size is different from image size");
-    for (const auto y : algo::range(_height))
-    for (const auto x : algo::range(_width))
-        at(x, y).a = other.at(x, y).r;
+    expand();
+    copy_mask(content.data(), other.begin(), _width * _height);
     return *this;
 }
 
 Image &Image::apply_palette(const Palette &palette)
 {
+    expand();
     const auto palette_size = palette.size();
-    for (auto &c : content)
+    if (palette_size >= 256)
     {
-        if (c.r < palette_size)
+        for (auto &c : content)
             c = palette[c.r];
-        else
-            c.a = 0;
     }
+    else
+    {
+        for (auto &c : content)
+        {
+            if (c.r < palette_size)
+                c = palette[c.r];
+            else
+                c.a = 0;
+        }
+    }
+    source_palette = std::make_shared<const Palette>(palette);
     return *this;
 }
 
+std::shared_ptr<const Palette> Image::get_source_palette() const
+{
+    return source_palette;
+}
+
 Image &Image::overlay(
     const Image &other,
     const OverlayKind overlay_kind)
@@ -191,37 +509,26 @@ Image &Image::overlay(
     const int y2 = std::min<int>(height(), target_y + other.height());
     const int source_x = -target_x;
     const int source_y = -target_y;
-    if (overlay_kind == OverlayKind::OverwriteAll)
-    {
-        for (const auto y : algo::range(y1, y2))
-        for (const auto x : algo::range(x1, x2))
-            at(x, y) = other.at(source_x + x, source_y + y);
-    }
-    else if (overlay_kind == OverlayKind::OverwriteNonTransparent)
-    {
-        for (const auto y : algo::range(y1, y2))
-        for (const auto x : algo::range(x1, x2))
-        {
-            const auto &source_pixel = other.at(source_x + x, source_y + y);
-            if (source_pixel.a)
-                at(x, y) = source_pixel;
-        }
-    }
-    else if (overlay_kind == OverlayKind::AddSimple)
+    if (overlay_kind != OverlayKind::OverwriteAll
+        && overlay_kind != OverlayKind::OverwriteNonTransparent
+        && overlay_kind != OverlayKind::AddSimple)
     {
-        for (const auto y : algo::range(y1, y2))
-        for (const auto x : algo::range(x1, x2))
-        {
-            auto &target_pixel = at(x, y);
-            const auto &source_pixel = other.at(source_x + x, source_y + y);
-            target_pixel.r += source_pixel.r;
-            target_pixel.g += source_pixel.g;
-            target_pixel.b += source_pixel.b;
-        }
+        throw std::logic_error("Unknown overlay kind");
     }
-    else
+    if (x1 >= x2)
+        return *this;
+
+    const auto row_width = x2 - x1;
+    for (const auto y : algo::range(y1, y2))
     {
-        throw std::logic_error("Unknown overlay kind");
+        const auto target_ptr = &at(x1, y);
+        const auto source_ptr = &other.at(source_x + x1, source_y + y);
+        if (overlay_kind == OverlayKind::OverwriteAll)
+            std::memmove(target_ptr, source_ptr, row_width * sizeof(Pixel));
+        else if (overlay_kind == OverlayKind::OverwriteNonTransparent)
+            overwrite_non_transparent(target_ptr, source_ptr, row_width);
+        else
+            add_pixels(target_ptr, source_ptr, row_width);
     }
     return *this;
 }
@@ -17,7 +17,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include "algo/grid.h"
 #include "io/base_byte_stream.h"
 #include "res/palette.h"
@@ -27,6 +29,12 @@
 namespace au {
 namespace res {
 
+    class ImageView;
+
+    // Images built from palette indices keep the indices and expand them to
+    // pixels only when the pixels are first accessed. get_pixels() expands
+    // just the requested pixels, so reading the image through views, as the
+    // encoders do, never expands it as a whole.
     class Image final : public algo::Grid<Pixel>
     {
     public:
@@ -38,9 +46,13 @@ namespace res {
         };
 
         Image(const Image &other);
+        Image(Image &&other);
 
         Image(const size_t width, const size_t height);
 
+        // Copies the view with all its transforms applied.
+        explicit Image(const ImageView &view);
+
         Image(
             const size_t width,
             const size_t height,
@@ -65,6 +77,54 @@ namespace res {
             io::BaseByteStream &input_stream,
             const Palette &palette);
 
+        Image &operator =(const Image &other);
+        Image &operator =(Image &&other);
+
+        Pixel &at(const size_t x, const size_t y)
+        {
+            expand();
+            return Grid::at(x, y);
+        }
+
+        const Pixel &at(const size_t x, const size_t y) const
+        {
+            materialize();
+            return Grid::at(x, y);
+        }
+
+        Pixel *begin()
+        {
+            expand();
+            return Grid::begin();
+        }
+
+        Pixel *end()
+        {
+            expand();
+            return Grid::end();
+        }
+
+        const Pixel *begin() const
+        {
+            materialize();
+            return Grid::begin();
+        }
+
+        const Pixel *end() const
+        {
+            materialize();
+            return Grid::end();
+        }
+
+        // Returns count pixels of the given row starting at x. If the image
+        // still holds palette indices, they are expanded to the scratch
+        // buffer instead.
+        const Pixel *get_pixels(
+            const size_t x,
+            const size_t y,
+            const size_t count,
+            Pixel *scratch) const;
+
         Image &flip_vertically();
         Image &flip_horizontally();
         Image &offset(const int x, const int y);
@@ -81,6 +141,44 @@ namespace res {
             const int target_x,
             const int target_y,
             const OverlayKind overlay_kind);
+
+        // Returns the palette last passed to apply_palette(), if any.
+        // Encoders can use it to write indexed images in the original color
+        // order, but must check that the pixels still match it.
+        std::shared_ptr<const Palette> get_source_palette() const;
+
+    private:
+        // Makes sure that the pixels are there and drops the indices, since
+        // the pixels may change from now on.
+        void expand()
+        {
+            if (!colors.empty())
+                drop_indices();
+        }
+
+        // Makes sure that the pixels are there. Safe to call from several
+        // threads; the indices stay, as other threads may be reading them.
+        void materialize() const
+        {
+            if (!has_pixels.load(std::memory_order_acquire))
+                expand_indices();
+        }
+
+        void expand_indices() const;
+        void drop_indices();
+
+        std::shared_ptr<const Palette> source_palette;
+
+        // palette indices and the 256 colors they stand for, both empty
+        // once the image is expanded
+        bstr indices;
+        std::vector<Pixel> colors;
+        #if AU_MEMORY_ACCOUNTING
+            memory::Charge indices_charge;
+        #endif
+
+        mutable std::atomic<bool> has_pixels;
+        mutable std::mutex expansion_mutex;
     };
 
 } }
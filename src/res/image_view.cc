@@ -0,0 +1,90 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "res/image_view.h"
+#include <cstring>
+#include "algo/range.h"
+#include "err.h"
+
+using namespace au;
+using namespace au::res;
+
+ImageView::ImageView(const Image &image) :
+    image(&image),
+    mask(nullptr),
+    x(0),
+    y(0),
+    _width(image.width()),
+    _height(image.height()),
+    flipped(false)
+{
+}
+
+ImageView &ImageView::crop(
+    const size_t x, const size_t y, const size_t width, const size_t height)
+{
+    if (x + width > _width || y + height > _height)
+        throw err::BadDataSizeError();
+    this->x += x;
+    this->y += flipped ? _height - y - height : y;
+    _width = width;
+    _height = height;
+    return *this;
+}
+
+ImageView &ImageView::flip_vertically()
+{
+    flipped = !flipped;
+    return *this;
+}
+
+ImageView &ImageView::apply_mask(const Image &mask)
+{
+    if (mask.width() != image->width() || mask.height() != image->height())
+        throw std::logic_error("Mask image size is different from image size");
+    this->mask = &mask;
+    return *this;
+}
+
+size_t ImageView::width() const
+{
+    return _width;
+}
+
+size_t ImageView::height() const
+{
+    return _height;
+}
+
+std::shared_ptr<const Palette> ImageView::get_source_palette() const
+{
+    return image->get_source_palette();
+}
+
+const Pixel *ImageView::get_row(const size_t y, Pixel *scratch) const
+{
+    const auto source_y = this->y + (flipped ? _height - 1 - y : y);
+    const auto row_ptr = image->get_pixels(x, source_y, _width, scratch);
+    if (!mask)
+        return row_ptr;
+    const auto mask_ptr = &mask->at(x, source_y);
+    if (row_ptr != scratch)
+        std::memcpy(scratch, row_ptr, _width * sizeof(Pixel));
+    for (const auto i : algo::range(_width))
+        scratch[i].a = mask_ptr[i].r;
+    return scratch;
+}
@@ -0,0 +1,65 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "res/image.h"
+
+namespace au {
+namespace res {
+
+    // Read-only window over an image that applies crops, flips and masks
+    // only as its rows are read, so a chain of them costs one pass. Encoders
+    // read their input through it; Image(const ImageView &) materializes it.
+    // The viewed images must outlive the view.
+    class ImageView final
+    {
+    public:
+        ImageView(const Image &image);
+
+        // Coordinates are relative to the view, including earlier crops
+        // and flips, and must lie inside it.
+        ImageView &crop(
+            const size_t x,
+            const size_t y,
+            const size_t width,
+            const size_t height);
+
+        ImageView &flip_vertically();
+
+        // Takes alpha from the red channel of the mask, like
+        // Image::apply_mask(). The mask must have the size of the viewed
+        // image and is cropped and flipped along with it.
+        ImageView &apply_mask(const Image &mask);
+
+        size_t width() const;
+        size_t height() const;
+        std::shared_ptr<const Palette> get_source_palette() const;
+
+        // Returns the row either in place or copied to the scratch buffer,
+        // which must have room for width() pixels.
+        const Pixel *get_row(const size_t y, Pixel *scratch) const;
+
+    private:
+        const Image *image;
+        const Image *mask;
+        size_t x, y;
+        size_t _width, _height;
+        bool flipped;
+    };
+
+} }
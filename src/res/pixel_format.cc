@@ -16,9 +16,11 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "res/pixel_format.h"
+#include <algorithm>
 #include <cstring>
 #include "algo/format.h"
 #include "algo/range.h"
+#include "res/simd.h"
 
 namespace au {
 namespace res {
@@ -255,8 +257,495 @@ namespace res {
         return c;
     }
 
+    namespace
+    {
+        struct Channel final
+        {
+            u8 shift;
+            u8 bits;
+        };
+
+        // Describes where the channels are in a pixel read as a little
+        // endian number. Alpha with no bits is always opaque.
+        struct Layout final
+        {
+            Channel b, g, r, a;
+            bool inverted_alpha;
+        };
+
+        // Moves each channel of a pixel to its byte in the output with a
+        // mask and a pair of shifts. The right shift is arithmetic, which
+        // spreads one-bit alpha to the whole byte.
+        struct Conversion final
+        {
+            u32 masks[4];
+            int left_shifts[4];
+            int right_shifts[4];
+            size_t channel_count;
+            u32 or_mask;
+            u32 xor_mask;
+        };
+
+        using ReadPixelsFunc = void (*)(const u8 *, Pixel *, size_t);
+    }
+
+    template<PixelFormat fmt> static void read_pixels_scalar(
+        const u8 *input_ptr, Pixel *output_ptr, size_t n)
+    {
+        while (n--)
+            *output_ptr++ = read_pixel<fmt>(input_ptr);
+    }
+
+    static ReadPixelsFunc get_scalar_func(const PixelFormat fmt)
+    {
+        using PF = PixelFormat;
+        switch (fmt)
+        {
+            case PF::Gray8:     return read_pixels_scalar<PF::Gray8>;
+            case PF::BGR555X:   return read_pixels_scalar<PF::BGR555X>;
+            case PF::BGR565:    return read_pixels_scalar<PF::BGR565>;
+            case PF::BGR888:    return read_pixels_scalar<PF::BGR888>;
+            case PF::BGR888X:   return read_pixels_scalar<PF::BGR888X>;
+            case PF::BGRA4444:  return read_pixels_scalar<PF::BGRA4444>;
+            case PF::BGRA5551:  return read_pixels_scalar<PF::BGRA5551>;
+            case PF::BGRA8888:  return read_pixels_scalar<PF::BGRA8888>;
+            case PF::BGRnA4444: return read_pixels_scalar<PF::BGRnA4444>;
+            case PF::BGRnA5551: return read_pixels_scalar<PF::BGRnA5551>;
+            case PF::BGRnA8888: return read_pixels_scalar<PF::BGRnA8888>;
+            case PF::RGB555X:   return read_pixels_scalar<PF::RGB555X>;
+            case PF::RGB565:    return read_pixels_scalar<PF::RGB565>;
+            case PF::RGB888:    return read_pixels_scalar<PF::RGB888>;
+            case PF::RGB888X:   return read_pixels_scalar<PF::RGB888X>;
+            case PF::RGBA4444:  return read_pixels_scalar<PF::RGBA4444>;
+            case PF::RGBA5551:  return read_pixels_scalar<PF::RGBA5551>;
+            case PF::RGBA8888:  return read_pixels_scalar<PF::RGBA8888>;
+            case PF::RGBnA4444: return read_pixels_scalar<PF::RGBnA4444>;
+            case PF::RGBnA5551: return read_pixels_scalar<PF::RGBnA5551>;
+            case PF::RGBnA8888: return read_pixels_scalar<PF::RGBnA8888>;
+            default:
+                throw std::logic_error(
+                    algo::format("Unsupported pixel format: %d", fmt));
+        }
+    }
+
+    static Layout get_layout(const PixelFormat fmt)
+    {
+        using PF = PixelFormat;
+        switch (fmt)
+        {
+            case PF::Gray8:
+                return {{0, 8}, {0, 8}, {0, 8}, {0, 0}, false};
+            case PF::BGR555X:
+                return {{0, 5}, {5, 5}, {10, 5}, {0, 0}, false};
+            case PF::BGR565:
+                return {{0, 5}, {5, 6}, {11, 5}, {0, 0}, false};
+            case PF::BGR888:
+            case PF::BGR888X:
+                return {{0, 8}, {8, 8}, {16, 8}, {0, 0}, false};
+            case PF::BGRA4444:
+                return {{0, 4}, {4, 4}, {8, 4}, {12, 4}, false};
+            case PF::BGRA5551:
+                return {{0, 5}, {5, 5}, {10, 5}, {15, 1}, false};
+            case PF::BGRA8888:
+                return {{0, 8}, {8, 8}, {16, 8}, {24, 8}, false};
+            case PF::BGRnA4444:
+                return {{0, 4}, {4, 4}, {8, 4}, {12, 4}, true};
+            case PF::BGRnA5551:
+                return {{0, 5}, {5, 5}, {10, 5}, {15, 1}, true};
+            case PF::BGRnA8888:
+                return {{0, 8}, {8, 8}, {16, 8}, {24, 8}, true};
+            case PF::RGB555X:
+                return {{10, 5}, {5, 5}, {0, 5}, {0, 0}, false};
+            case PF::RGB565:
+                return {{11, 5}, {5, 6}, {0, 5}, {0, 0}, false};
+            case PF::RGB888:
+            case PF::RGB888X:
+                return {{16, 8}, {8, 8}, {0, 8}, {0, 0}, false};
+            case PF::RGBA4444:
+                return {{8, 4}, {4, 4}, {0, 4}, {12, 4}, false};
+            case PF::RGBA5551:
+                return {{10, 5}, {5, 5}, {0, 5}, {15, 1}, false};
+            case PF::RGBA8888:
+                return {{16, 8}, {8, 8}, {0, 8}, {24, 8}, false};
+            case PF::RGBnA4444:
+                return {{8, 4}, {4, 4}, {0, 4}, {12, 4}, true};
+            case PF::RGBnA5551:
+                return {{10, 5}, {5, 5}, {0, 5}, {15, 1}, true};
+            case PF::RGBnA8888:
+                return {{16, 8}, {8, 8}, {0, 8}, {24, 8}, true};
+            default:
+                throw std::logic_error(
+                    algo::format("Unsupported pixel format: %d", fmt));
+        }
+    }
+
+    static Conversion get_conversion(const PixelFormat fmt)
+    {
+        const auto layout = get_layout(fmt);
+        const Channel channels[] = {layout.b, layout.g, layout.r, layout.a};
+        Conversion conversion;
+        conversion.channel_count = 0;
+        for (const auto i : algo::range(4))
+        {
+            const auto &channel = channels[i];
+            if (!channel.bits)
+                continue;
+            const u32 mask = ((1ull << channel.bits) - 1) << channel.shift;
+            int left_shift, right_shift;
+            if (channel.bits == 1)
+            {
+                left_shift = 31 - channel.shift;
+                right_shift = 7;
+            }
+            else
+            {
+                const int move = i * 8 + 8 - channel.bits - channel.shift;
+                left_shift = std::max(0, move);
+                right_shift = std::max(0, -move);
+            }
+
+            // Channels that move by the same amount share one mask, which
+            // turns most 32-bit and 24-bit formats into a single step.
+            size_t j = 0;
+            while (j < conversion.channel_count
+                && (conversion.left_shifts[j] != left_shift
+                    || conversion.right_shifts[j] != right_shift))
+            {
+                j++;
+            }
+            if (j == conversion.channel_count)
+            {
+                conversion.masks[j] = 0;
+                conversion.left_shifts[j] = left_shift;
+                conversion.right_shifts[j] = right_shift;
+                conversion.channel_count++;
+            }
+            conversion.masks[j] |= mask;
+        }
+        conversion.or_mask = layout.a.bits ? 0 : 0xFF000000;
+        conversion.xor_mask = layout.inverted_alpha ? 0xFF000000 : 0;
+        return conversion;
+    }
+
+#ifdef AU_HAVE_SSE2
+    namespace
+    {
+        struct Sse2Conversion final
+        {
+            Sse2Conversion(const Conversion &conversion);
+
+            __m128i masks[4];
+            __m128i left_shifts[4];
+            __m128i right_shifts[4];
+            size_t channel_count;
+            __m128i or_mask;
+            __m128i xor_mask;
+        };
+    }
+
+    Sse2Conversion::Sse2Conversion(const Conversion &conversion) :
+        channel_count(conversion.channel_count),
+        or_mask(_mm_set1_epi32(conversion.or_mask)),
+        xor_mask(_mm_set1_epi32(conversion.xor_mask))
+    {
+        for (const auto i : algo::range(channel_count))
+        {
+            masks[i] = _mm_set1_epi32(conversion.masks[i]);
+            left_shifts[i] = _mm_cvtsi32_si128(conversion.left_shifts[i]);
+            right_shifts[i] = _mm_cvtsi32_si128(conversion.right_shifts[i]);
+        }
+    }
+
+    static inline void convert_sse2(
+        const Sse2Conversion &conversion, const __m128i input, Pixel *output)
+    {
+        auto result = conversion.or_mask;
+        for (const auto i : algo::range(conversion.channel_count))
+        {
+            const auto channel = _mm_and_si128(input, conversion.masks[i]);
+            result = _mm_or_si128(result, _mm_sra_epi32(
+                _mm_sll_epi32(channel, conversion.left_shifts[i]),
+                conversion.right_shifts[i]));
+        }
+        result = _mm_xor_si128(result, conversion.xor_mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output), result);
+    }
+
+    // Returns how many pixels were read; the caller reads the rest.
+    static size_t read_pixels_sse2(
+        const PixelFormat fmt,
+        const u8 *input_ptr,
+        Pixel *output_ptr,
+        const size_t n)
+    {
+        const Sse2Conversion conversion(get_conversion(fmt));
+        const auto zero = _mm_setzero_si128();
+        const auto bpp = pixel_format_to_bpp(fmt);
+        size_t i = 0;
+        if (bpp == 1)
+        {
+            for (; i + 16 <= n; i += 16)
+            {
+                const auto input = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(input_ptr + i));
+                const auto lo = _mm_unpacklo_epi8(input, zero);
+                const auto hi = _mm_unpackhi_epi8(input, zero);
+                convert_sse2(
+                    conversion, _mm_unpacklo_epi16(lo, zero), output_ptr + i);
+                convert_sse2(
+                    conversion,
+                    _mm_unpackhi_epi16(lo, zero),
+                    output_ptr + i + 4);
+                convert_sse2(
+                    conversion,
+                    _mm_unpacklo_epi16(hi, zero),
+                    output_ptr + i + 8);
+                convert_sse2(
+                    conversion,
+                    _mm_unpackhi_epi16(hi, zero),
+                    output_ptr + i + 12);
+            }
+        }
+        else if (bpp == 2)
+        {
+            for (; i + 8 <= n; i += 8)
+            {
+                const auto input = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(input_ptr + i * 2));
+                convert_sse2(
+                    conversion,
+                    _mm_unpacklo_epi16(input, zero),
+                    output_ptr + i);
+                convert_sse2(
+                    conversion,
+                    _mm_unpackhi_epi16(input, zero),
+                    output_ptr + i + 4);
+            }
+        }
+        else if (bpp == 3)
+        {
+            // Each pixel k is moved from byte 3k to byte 4k; the load covers
+            // 16 bytes, so two more pixels must follow.
+            const auto mask = _mm_set_epi32(0, 0, 0, 0xFFFFFF);
+            for (; i + 6 <= n; i += 4)
+            {
+                const auto input = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(input_ptr + i * 3));
+                const auto spread = _mm_or_si128(
+                    _mm_or_si128(
+                        _mm_and_si128(input, mask),
+                        _mm_and_si128(
+                            _mm_slli_si128(input, 1),
+                            _mm_slli_si128(mask, 4))),
+                    _mm_or_si128(
+                        _mm_and_si128(
+                            _mm_slli_si128(input, 2),
+                            _mm_slli_si128(mask, 8)),
+                        _mm_and_si128(
+                            _mm_slli_si128(input, 3),
+                            _mm_slli_si128(mask, 12))));
+                convert_sse2(conversion, spread, output_ptr + i);
+            }
+        }
+        else if (bpp == 4)
+        {
+            for (; i + 4 <= n; i += 4)
+            {
+                const auto input = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(input_ptr + i * 4));
+                convert_sse2(conversion, input, output_ptr + i);
+            }
+        }
+        return i;
+    }
+#endif
+
+#ifdef AU_HAVE_AVX2
+    namespace
+    {
+        struct Avx2Conversion final
+        {
+            __m256i masks[4];
+            __m128i left_shifts[4];
+            __m128i right_shifts[4];
+            size_t channel_count;
+            __m256i or_mask;
+            __m256i xor_mask;
+        };
+    }
+
+    AU_TARGET_AVX2 static Avx2Conversion get_avx2_conversion(
+        const Conversion &conversion)
+    {
+        Avx2Conversion ret;
+        ret.channel_count = conversion.channel_count;
+        ret.or_mask = _mm256_set1_epi32(conversion.or_mask);
+        ret.xor_mask = _mm256_set1_epi32(conversion.xor_mask);
+        for (const auto i : algo::range(ret.channel_count))
+        {
+            ret.masks[i] = _mm256_set1_epi32(conversion.masks[i]);
+            ret.left_shifts[i] = _mm_cvtsi32_si128(conversion.left_shifts[i]);
+            ret.right_shifts[i]
+                = _mm_cvtsi32_si128(conversion.right_shifts[i]);
+        }
+        return ret;
+    }
+
+    AU_TARGET_AVX2 static inline void convert_avx2(
+        const Avx2Conversion &conversion, const __m256i input, Pixel *output)
+    {
+        auto result = conversion.or_mask;
+        for (const auto i : algo::range(conversion.channel_count))
+        {
+            const auto channel = _mm256_and_si256(input, conversion.masks[i]);
+            result = _mm256_or_si256(result, _mm256_sra_epi32(
+                _mm256_sll_epi32(channel, conversion.left_shifts[i]),
+                conversion.right_shifts[i]));
+        }
+        result = _mm256_xor_si256(result, conversion.xor_mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), result);
+    }
+
+    AU_TARGET_AVX2 static inline __m128i load_m128i(const u8 *input_ptr)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(input_ptr));
+    }
+
+    // Returns how many pixels were read; the caller reads the rest.
+    AU_TARGET_AVX2 static size_t read_pixels_avx2(
+        const PixelFormat fmt,
+        const u8 *input_ptr,
+        Pixel *output_ptr,
+        const size_t n)
+    {
+        const auto conversion = get_avx2_conversion(get_conversion(fmt));
+        const auto bpp = pixel_format_to_bpp(fmt);
+        size_t i = 0;
+        if (bpp == 1)
+        {
+            for (; i + 16 <= n; i += 16)
+            {
+                const auto input = load_m128i(input_ptr + i);
+                convert_avx2(
+                    conversion, _mm256_cvtepu8_epi32(input), output_ptr + i);
+                convert_avx2(
+                    conversion,
+                    _mm256_cvtepu8_epi32(_mm_srli_si128(input, 8)),
+                    output_ptr + i + 8);
+            }
+        }
+        else if (bpp == 2)
+        {
+            for (; i + 16 <= n; i += 16)
+            {
+                convert_avx2(
+                    conversion,
+                    _mm256_cvtepu16_epi32(load_m128i(input_ptr + i * 2)),
+                    output_ptr + i);
+                convert_avx2(
+                    conversion,
+                    _mm256_cvtepu16_epi32(load_m128i(input_ptr + i * 2 + 16)),
+                    output_ptr + i + 8);
+            }
+        }
+        else if (bpp == 3)
+        {
+            // Same as with SSE2, with each 128-bit lane holding 4 pixels.
+            const auto mask = _mm256_set_epi32(
+                0, 0, 0, 0xFFFFFF, 0, 0, 0, 0xFFFFFF);
+            for (; i + 10 <= n; i += 8)
+            {
+                const auto input = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(load_m128i(input_ptr + i * 3)),
+                    load_m128i(input_ptr + i * 3 + 12),
+                    1);
+                const auto spread = _mm256_or_si256(
+                    _mm256_or_si256(
+                        _mm256_and_si256(input, mask),
+                        _mm256_and_si256(
+                            _mm256_slli_si256(input, 1),
+                            _mm256_slli_si256(mask, 4))),
+                    _mm256_or_si256(
+                        _mm256_and_si256(
+                            _mm256_slli_si256(input, 2),
+                            _mm256_slli_si256(mask, 8)),
+                        _mm256_and_si256(
+                            _mm256_slli_si256(input, 3),
+                            _mm256_slli_si256(mask, 12))));
+                convert_avx2(conversion, spread, output_ptr + i);
+            }
+        }
+        else if (bpp == 4)
+        {
+            for (; i + 8 <= n; i += 8)
+            {
+                const auto input = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(input_ptr + i * 4));
+                convert_avx2(conversion, input, output_ptr + i);
+            }
+        }
+        return i;
+    }
+#endif
+
+    static void read_indexed_pixels_scalar(
+        const u8 *input_ptr, const Pixel *colors, Pixel *output_ptr, size_t n)
+    {
+        while (n--)
+            *output_ptr++ = colors[*input_ptr++];
+    }
+
+#ifdef AU_HAVE_AVX2
+    // Returns how many pixels were read; the caller reads the rest.
+    AU_TARGET_AVX2 static size_t read_indexed_pixels_avx2(
+        const u8 *input_ptr,
+        const Pixel *colors,
+        Pixel *output_ptr,
+        const size_t n)
+    {
+        const auto table = reinterpret_cast<const int*>(colors);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            const auto input = load_m128i(input_ptr + i);
+            const auto lo = _mm256_i32gather_epi32(
+                table, _mm256_cvtepu8_epi32(input), 4);
+            const auto hi = _mm256_i32gather_epi32(
+                table, _mm256_cvtepu8_epi32(_mm_srli_si128(input, 8)), 4);
+            _mm256_storeu_si256(
+                reinterpret_cast<__m256i*>(output_ptr + i), lo);
+            _mm256_storeu_si256(
+                reinterpret_cast<__m256i*>(output_ptr + i + 8), hi);
+        }
+        return i;
+    }
+#endif
+
+    std::vector<PixelKernel> get_supported_pixel_kernels()
+    {
+        std::vector<PixelKernel> kernels {PixelKernel::Scalar};
+        #ifdef AU_HAVE_SSE2
+            kernels.push_back(PixelKernel::Sse2);
+        #endif
+        #ifdef AU_HAVE_AVX2
+            if (__builtin_cpu_supports("avx2"))
+                kernels.push_back(PixelKernel::Avx2);
+        #endif
+        return kernels;
+    }
+
     void read_pixels(
         const u8 *input_ptr, std::vector<Pixel> &output, const PixelFormat fmt)
+    {
+        static const auto kernel = get_supported_pixel_kernels().back();
+        read_pixels(input_ptr, output, fmt, kernel);
+    }
+
+    void read_pixels(
+        const u8 *input_ptr,
+        std::vector<Pixel> &output,
+        const PixelFormat fmt,
+        const PixelKernel kernel)
     {
         // save those precious CPU cycles
         if (fmt == PixelFormat::BGRA8888)
@@ -265,37 +754,88 @@ namespace res {
             return;
         }
 
-        // I don't think there is a better alternative to this
-        using PF = PixelFormat;
-        std::function<void(const u8 *, std::vector<Pixel> &)> impl;
-        switch (fmt)
+        const auto read_rest = get_scalar_func(fmt);
+        const auto n = output.size();
+        size_t done = 0;
+        switch (kernel)
         {
-            case PF::Gray8:     impl = read_pixels<PF::Gray8>; break;
-            case PF::BGR555X:   impl = read_pixels<PF::BGR555X>; break;
-            case PF::BGR565:    impl = read_pixels<PF::BGR565>; break;
-            case PF::BGR888:    impl = read_pixels<PF::BGR888>; break;
-            case PF::BGR888X:   impl = read_pixels<PF::BGR888X>; break;
-            case PF::BGRA4444:  impl = read_pixels<PF::BGRA4444>; break;
-            case PF::BGRA5551:  impl = read_pixels<PF::BGRA5551>; break;
-            case PF::BGRA8888:  impl = read_pixels<PF::BGRA8888>; break;
-            case PF::BGRnA4444: impl = read_pixels<PF::BGRnA4444>; break;
-            case PF::BGRnA5551: impl = read_pixels<PF::BGRnA5551>; break;
-            case PF::BGRnA8888: impl = read_pixels<PF::BGRnA8888>; break;
-            case PF::RGB555X:   impl = read_pixels<PF::RGB555X>; break;
-            case PF::RGB565:    impl = read_pixels<PF::RGB565>; break;
-            case PF::RGB888:    impl = read_pixels<PF::RGB888>; break;
-            case PF::RGB888X:   impl = read_pixels<PF::RGB888X>; break;
-            case PF::RGBA4444:  impl = read_pixels<PF::RGBA4444>; break;
-            case PF::RGBA5551:  impl = read_pixels<PF::RGBA5551>; break;
-            case PF::RGBA8888:  impl = read_pixels<PF::RGBA8888>; break;
-            case PF::RGBnA4444: impl = read_pixels<PF::RGBnA4444>; break;
-            case PF::RGBnA5551: impl = read_pixels<PF::RGBnA5551>; break;
-            case PF::RGBnA8888: impl = read_pixels<PF::RGBnA8888>; break;
+            case PixelKernel::Scalar:
+                break;
+
+            #ifdef AU_HAVE_SSE2
+                case PixelKernel::Sse2:
+                    done = read_pixels_sse2(fmt, input_ptr, output.data(), n);
+                    break;
+            #endif
+
+            #ifdef AU_HAVE_AVX2
+                case PixelKernel::Avx2:
+                    done = read_pixels_avx2(fmt, input_ptr, output.data(), n);
+                    break;
+            #endif
+
             default:
-                throw std::logic_error(
-                    algo::format("Unsupported pixel format: %d", fmt));
+                throw std::logic_error("Unsupported pixel kernel");
+        }
+        read_rest(
+            input_ptr + done * pixel_format_to_bpp(fmt),
+            output.data() + done,
+            n - done);
+    }
+
+    void read_indexed_pixels(
+        const u8 *input_ptr, std::vector<Pixel> &output, const Pixel *colors)
+    {
+        read_indexed_pixels(input_ptr, output.data(), output.size(), colors);
+    }
+
+    void read_indexed_pixels(
+        const u8 *input_ptr,
+        std::vector<Pixel> &output,
+        const Pixel *colors,
+        const PixelKernel kernel)
+    {
+        read_indexed_pixels(
+            input_ptr, output.data(), output.size(), colors, kernel);
+    }
+
+    void read_indexed_pixels(
+        const u8 *input_ptr,
+        Pixel *output_ptr,
+        const size_t count,
+        const Pixel *colors)
+    {
+        static const auto kernel = get_supported_pixel_kernels().back();
+        read_indexed_pixels(input_ptr, output_ptr, count, colors, kernel);
+    }
+
+    void read_indexed_pixels(
+        const u8 *input_ptr,
+        Pixel *output_ptr,
+        const size_t count,
+        const Pixel *colors,
+        const PixelKernel kernel)
+    {
+        size_t done = 0;
+        switch (kernel)
+        {
+            // SSE2 has no table lookups, so it shares the scalar loop.
+            case PixelKernel::Scalar:
+            case PixelKernel::Sse2:
+                break;
+
+            #ifdef AU_HAVE_AVX2
+                case PixelKernel::Avx2:
+                    done = read_indexed_pixels_avx2(
+                        input_ptr, colors, output_ptr, count);
+                    break;
+            #endif
+
+            default:
+                throw std::logic_error("Unsupported pixel kernel");
         }
-        impl(input_ptr, output);
+        read_indexed_pixels_scalar(
+            input_ptr + done, colors, output_ptr + done, count - done);
     }
 
 } }
@@ -90,11 +90,54 @@ namespace res {
             c = read_pixel<fmt>(input_ptr);
     }
 
+    // Implementations of read_pixels() for different instruction sets.
+    enum class PixelKernel : u8
+    {
+        Scalar,
+        Sse2,
+        Avx2,
+    };
+
+    // Returns the kernels that can run on this CPU, the fastest one last.
+    std::vector<PixelKernel> get_supported_pixel_kernels();
+
+    // Uses the fastest kernel supported by the CPU.
     void read_pixels(
         const u8 *input_ptr,
         std::vector<Pixel> &output,
         const PixelFormat fmt);
 
+    void read_pixels(
+        const u8 *input_ptr,
+        std::vector<Pixel> &output,
+        const PixelFormat fmt,
+        const PixelKernel kernel);
+
+    // Replaces 8-bit indices with the colors from a table of 256 entries.
+    void read_indexed_pixels(
+        const u8 *input_ptr,
+        std::vector<Pixel> &output,
+        const Pixel *colors);
+
+    void read_indexed_pixels(
+        const u8 *input_ptr,
+        std::vector<Pixel> &output,
+        const Pixel *colors,
+        const PixelKernel kernel);
+
+    void read_indexed_pixels(
+        const u8 *input_ptr,
+        Pixel *output_ptr,
+        const size_t count,
+        const Pixel *colors);
+
+    void read_indexed_pixels(
+        const u8 *input_ptr,
+        Pixel *output_ptr,
+        const size_t count,
+        const Pixel *colors,
+        const PixelKernel kernel);
+
     template<PixelFormat fmt> inline Pixel read_pixel(
         io::BaseByteStream &input_stream)
     {
@@ -0,0 +1,35 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// Instruction sets for the vectorized code in res/. SSE2 is used whenever
+// the compiler targets it. AVX2 code is compiled for a target chosen per
+// function, which only GCC and Clang support, and may only run after the
+// CPU was checked with __builtin_cpu_supports.
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define AU_HAVE_SSE2
+    #include <emmintrin.h>
+#endif
+
+#if defined(AU_HAVE_SSE2) && defined(__GNUC__)
+    #define AU_HAVE_AVX2
+    #define AU_TARGET_AVX2 __attribute__((target("avx2")))
+    #include <immintrin.h>
+#endif
@@ -19,6 +19,9 @@
 
 #include <string>
 #include <vector>
+#if AU_MEMORY_ACCOUNTING
+    #include "memory_accounting.h"
+#endif
 
 namespace au {
 
@@ -121,7 +124,11 @@ namespace au {
         const u8 &at(const size_t pos) const;
 
     private:
-        std::vector<u8> v;
+        #if AU_MEMORY_ACCOUNTING
+            std::vector<u8, memory::TrackingAllocator<u8>> v;
+        #else
+            std::vector<u8> v;
+        #endif
     };
 
     constexpr size_t operator "" _z(unsigned long long int value)
@@ -16,122 +16,452 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "virtual_file_system.h"
+#include <algorithm>
+#include <list>
 #include <map>
 #include <mutex>
 #include <set>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
 #include "algo/str.h"
 #include "err.h"
 #include "io/file_system.h"
 
 using namespace au;
 
-static std::mutex mutex;
-static std::map<io::path, std::function<std::unique_ptr<io::File>()>> factories;
-static std::set<io::path> directories;
+namespace
+{
+    using FileFactory = std::function<std::unique_ptr<io::File>()>;
+
+    struct RegisteredFile final
+    {
+        FileFactory factory;
+        // distinguishes files registered under the same path over time
+        size_t generation;
+    };
+
+    struct RegisteredResolver final
+    {
+        std::shared_ptr<const IVirtualFileResolver> resolver;
+        size_t generation;
+    };
+
+    // Maps lowercase stems or names to the paths of registered files. Paths
+    // are kept sorted so that the lookups don't depend on registration order.
+    using FactoryIndex = std::unordered_map<std::string, std::set<io::path>>;
+
+    // Maps lowercase stems, names or paths to the first matching file found
+    // in a directory.
+    using DirectoryIndex = std::unordered_map<std::string, io::path>;
+
+    struct DirectoryContent final
+    {
+        DirectoryIndex by_stem;
+        DirectoryIndex by_name;
+        DirectoryIndex by_path;
+    };
+
+    // Directory contents are scanned on first lookup.
+    struct Directory final
+    {
+        Directory(const io::path &path);
+
+        const io::path path;
+        std::once_flag scanned;
+        DirectoryContent content;
+    };
+
+    // Keeps contents of recently materialized registered files, so that
+    // decoders that fetch the same palette for many images don't have it
+    // decoded each time. Entries are keyed on the registration generation of
+    // the file or resolver they came from along with the path, so that
+    // same-named entries of different archives don't replace each other.
+    class FileCache final
+    {
+    public:
+        FileCache(const size_t max_size);
+
+        std::unique_ptr<io::File> get(
+            const size_t generation, const io::path &path);
+        void insert(
+            const size_t generation, const io::path &path, io::File &file);
+        void erase(const size_t generation);
+        void clear();
+        void set_max_size(const size_t max_size);
+
+    private:
+        struct Entry final
+        {
+            std::string key;
+            size_t generation;
+            io::path path;
+            bstr content;
+        };
+
+        void erase(const std::list<Entry>::iterator it);
+        void shrink(const size_t max_size);
+
+        std::mutex mutex;
+        std::list<Entry> entries; // most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t size;
+        size_t max_size;
+    };
+}
+
+static const auto default_cache_size = 32 * 1024 * 1024;
+
+// lookups run concurrently; only the factories and directory scans may
+// take long, and these run without holding the lock
+static std::shared_timed_mutex mutex;
+static std::unordered_map<std::string, RegisteredFile> factories;
+static FactoryIndex factories_by_stem;
+static FactoryIndex factories_by_name;
+static std::vector<RegisteredResolver> resolvers;
+static std::map<io::path, std::shared_ptr<Directory>> directories;
+static size_t generation = 0;
 static bool enabled = true;
+static FileCache file_cache(default_cache_size);
 
-void VirtualFileSystem::disable()
+Directory::Directory(const io::path &path) : path(path)
 {
-    std::unique_lock<std::mutex> lock(mutex);
-    enabled = false;
 }
 
-void VirtualFileSystem::enable()
+FileCache::FileCache(const size_t max_size) : size(0), max_size(max_size)
 {
-    std::unique_lock<std::mutex> lock(mutex);
-    enabled = true;
 }
 
-void VirtualFileSystem::clear()
+static std::string get_cache_key(
+    const size_t generation, const io::path &path)
 {
-    directories.clear();
-    factories.clear();
+    return std::to_string(generation) + ":" + path.str();
 }
 
-void VirtualFileSystem::register_file(
-    const io::path &path,
-    const std::function<std::unique_ptr<io::File>()> factory)
+std::unique_ptr<io::File> FileCache::get(
+    const size_t generation, const io::path &path)
 {
     std::unique_lock<std::mutex> lock(mutex);
-    if (enabled)
-        factories[io::path(algo::lower(path.str()))] = factory;
+    const auto it = index.find(get_cache_key(generation, path));
+    if (it == index.end())
+        return nullptr;
+    entries.splice(entries.begin(), entries, it->second);
+    return std::make_unique<io::File>(
+        entries.front().path, entries.front().content);
 }
 
-void VirtualFileSystem::unregister_file(const io::path &path)
+void FileCache::insert(
+    const size_t generation, const io::path &path, io::File &file)
 {
     std::unique_lock<std::mutex> lock(mutex);
-    factories.erase(io::path(algo::lower(path.str())));
+    if (file.stream.size() > max_size)
+        return;
+    const auto key = get_cache_key(generation, path);
+    const auto it = index.find(key);
+    if (it != index.end())
+        erase(it->second);
+    const auto old_pos = file.stream.pos();
+    entries.push_front(Entry
+    {
+        key,
+        generation,
+        file.path,
+        file.stream.seek(0).read_to_eof(),
+    });
+    file.stream.seek(old_pos);
+    index[key] = entries.begin();
+    size += entries.front().content.size();
+    shrink(max_size);
 }
 
-void VirtualFileSystem::register_directory(const io::path &path)
+void FileCache::erase(const size_t generation)
 {
     std::unique_lock<std::mutex> lock(mutex);
-    if (enabled)
-        directories.insert(path);
+    auto it = entries.begin();
+    while (it != entries.end())
+    {
+        const auto next = std::next(it);
+        if (it->generation == generation)
+            erase(it);
+        it = next;
+    }
 }
 
-void VirtualFileSystem::unregister_directory(const io::path &path)
+void FileCache::clear()
 {
     std::unique_lock<std::mutex> lock(mutex);
-    directories.erase(path);
+    shrink(0);
 }
 
-std::unique_ptr<io::File> VirtualFileSystem::get_by_stem(
-    const std::string &stem)
+void FileCache::set_max_size(const size_t max_size)
 {
     std::unique_lock<std::mutex> lock(mutex);
-    if (!enabled)
-        return nullptr;
+    this->max_size = max_size;
+    shrink(max_size);
+}
 
-    const auto check = algo::lower(stem);
-    for (const auto &kv : factories)
-        if (kv.first.stem() == check)
-            return kv.second();
+void FileCache::erase(const std::list<Entry>::iterator it)
+{
+    size -= it->content.size();
+    index.erase(it->key);
+    entries.erase(it);
+}
 
-    for (const auto &directory : directories)
-    for (const auto &other_path : io::recursive_directory_range(directory))
-        if (algo::lower(other_path.stem()) == check)
-            return std::make_unique<io::File>(other_path, io::FileMode::Read);
+void FileCache::shrink(const size_t max_size)
+{
+    while (size > max_size && !entries.empty())
+        erase(std::prev(entries.end()));
+}
 
-    return nullptr;
+static std::string get_key(const io::path &path)
+{
+    return algo::lower(path.str());
 }
 
-std::unique_ptr<io::File> VirtualFileSystem::get_by_name(
-    const std::string &name)
+static void remove_from_index(
+    FactoryIndex &index, const std::string &key, const io::path &path)
 {
-    std::unique_lock<std::mutex> lock(mutex);
-    if (!enabled)
-        return nullptr;
+    const auto it = index.find(key);
+    if (it == index.end())
+        return;
+    it->second.erase(path);
+    if (it->second.empty())
+        index.erase(it);
+}
 
-    const auto check = algo::lower(name);
-    for (const auto &kv : factories)
-        if (kv.first.name() == check)
-            return kv.second();
+static void scan_directory(Directory &directory)
+{
+    auto &content = directory.content;
+    for (const auto &path : io::recursive_directory_range(directory.path))
+    {
+        if (io::is_directory(path))
+            continue;
+        content.by_stem.emplace(algo::lower(path.stem()), path);
+        content.by_name.emplace(algo::lower(path.name()), path);
+        content.by_path.emplace(get_key(path), path);
+    }
+}
 
-    for (const auto &directory : directories)
-    for (const auto &other_path : io::recursive_directory_range(directory))
-        if (algo::lower(other_path.name()) == check)
-            return std::make_unique<io::File>(other_path, io::FileMode::Read);
+static const DirectoryIndex &get_directory_index(
+    const DirectoryContent &content, const VirtualFileKey key_type)
+{
+    if (key_type == VirtualFileKey::Stem)
+        return content.by_stem;
+    if (key_type == VirtualFileKey::Name)
+        return content.by_name;
+    return content.by_path;
+}
+
+static std::unique_ptr<io::File> open_cached(
+    const io::path &path, const size_t generation, const FileFactory factory)
+{
+    auto file = file_cache.get(generation, path);
+    if (file)
+        return file;
+    file = factory();
+    if (file)
+        file_cache.insert(generation, path, *file);
+    return file;
+}
 
+static std::unique_ptr<io::File> open_from_directories(
+    const std::vector<std::shared_ptr<Directory>> &directories,
+    const VirtualFileKey key_type,
+    const std::string &key)
+{
+    for (const auto &directory : directories)
+    {
+        std::call_once(
+            directory->scanned, [&]() { scan_directory(*directory); });
+        const auto &paths = get_directory_index(directory->content, key_type);
+        const auto it = paths.find(key);
+        if (it != paths.end())
+            return std::make_unique<io::File>(it->second, io::FileMode::Read);
+    }
     return nullptr;
 }
 
-std::unique_ptr<io::File> VirtualFileSystem::get_by_path(const io::path &path)
+// Looks the key up in the registered files and resolvers, or, if there's no
+// match, in the registered directories. Among registered files and
+// resolvers, the lexicographically first path wins; if several provide the
+// same path, the one registered last wins, like a file registered again
+// under the same path replaces the previous one.
+static std::unique_ptr<io::File> find_file(
+    const VirtualFileKey key_type, const std::string &key)
 {
-    std::unique_lock<std::mutex> lock(mutex);
-    if (!enabled)
-        return nullptr;
+    io::path best_path;
+    RegisteredFile registered_file;
+    std::vector<RegisteredResolver> resolvers_to_check;
+    std::vector<std::shared_ptr<Directory>> directories_to_check;
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        if (!enabled)
+            return nullptr;
+        if (key_type == VirtualFileKey::Path)
+        {
+            if (factories.find(key) != factories.end())
+                best_path = key;
+        }
+        else
+        {
+            const auto &index = key_type == VirtualFileKey::Stem
+                ? factories_by_stem
+                : factories_by_name;
+            const auto it = index.find(key);
+            if (it != index.end())
+                best_path = *it->second.begin();
+        }
+        if (!best_path.str().empty())
+            registered_file = factories.at(best_path.str());
+        resolvers_to_check = resolvers;
+        for (const auto &kv : directories)
+            directories_to_check.push_back(kv.second);
+    }
 
-    const auto check = io::path(algo::lower(path.str()));
-    if (factories.find(check) != factories.end())
-        return factories[check]();
+    // resolvers may need to build their indexes, so they run without the
+    // lock
+    const RegisteredResolver *best_resolver = nullptr;
+    for (const auto &registered_resolver : resolvers_to_check)
+    {
+        const auto path = registered_resolver.resolver->find(key_type, key);
+        if (path.str().empty())
+            continue;
+        if (best_path.str().empty()
+            || path < best_path
+            || (path == best_path && registered_resolver.generation
+                > (best_resolver
+                    ? best_resolver->generation
+                    : registered_file.generation)))
+        {
+            best_path = path;
+            best_resolver = &registered_resolver;
+        }
+    }
 
-    for (const auto &directory : directories)
-    for (const auto &other_path : io::recursive_directory_range(directory))
+    if (best_resolver)
     {
-        if (io::path(algo::lower(other_path.str())) == check)
-            return std::make_unique<io::File>(other_path, io::FileMode::Read);
+        const auto resolver = best_resolver->resolver;
+        return open_cached(
+            best_path,
+            best_resolver->generation,
+            [&]() { return resolver->open(best_path); });
     }
+    if (!best_path.str().empty())
+    {
+        return open_cached(
+            best_path, registered_file.generation, registered_file.factory);
+    }
+    return open_from_directories(directories_to_check, key_type, key);
+}
 
-    return nullptr;
+void VirtualFileSystem::disable()
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    enabled = false;
+}
+
+void VirtualFileSystem::enable()
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    enabled = true;
+}
+
+void VirtualFileSystem::set_cache_size(const size_t max_size)
+{
+    file_cache.set_max_size(max_size);
+}
+
+void VirtualFileSystem::clear()
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    directories.clear();
+    factories.clear();
+    factories_by_stem.clear();
+    factories_by_name.clear();
+    resolvers.clear();
+    file_cache.clear();
+}
+
+void VirtualFileSystem::register_file(
+    const io::path &path, const FileFactory factory)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    if (!enabled)
+        return;
+    const io::path lower_path(get_key(path));
+    const auto it = factories.find(lower_path.str());
+    if (it != factories.end())
+        file_cache.erase(it->second.generation);
+    factories[lower_path.str()] = RegisteredFile{factory, ++generation};
+    factories_by_stem[lower_path.stem()].insert(lower_path);
+    factories_by_name[lower_path.name()].insert(lower_path);
+}
+
+void VirtualFileSystem::unregister_file(const io::path &path)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    const io::path lower_path(get_key(path));
+    const auto it = factories.find(lower_path.str());
+    if (it == factories.end())
+        return;
+    file_cache.erase(it->second.generation);
+    factories.erase(it);
+    remove_from_index(factories_by_stem, lower_path.stem(), lower_path);
+    remove_from_index(factories_by_name, lower_path.name(), lower_path);
+}
+
+void VirtualFileSystem::register_resolver(
+    const std::shared_ptr<const IVirtualFileResolver> resolver)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    if (enabled)
+        resolvers.push_back(RegisteredResolver{resolver, ++generation});
+}
+
+void VirtualFileSystem::unregister_resolver(
+    const std::shared_ptr<const IVirtualFileResolver> resolver)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    for (const auto &registered_resolver : resolvers)
+        if (registered_resolver.resolver == resolver)
+            file_cache.erase(registered_resolver.generation);
+    resolvers.erase(
+        std::remove_if(
+            resolvers.begin(),
+            resolvers.end(),
+            [&](const RegisteredResolver &registered_resolver)
+            {
+                return registered_resolver.resolver == resolver;
+            }),
+        resolvers.end());
+}
+
+void VirtualFileSystem::register_directory(const io::path &path)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    if (enabled && directories.find(path) == directories.end())
+        directories[path] = std::make_shared<Directory>(path);
+}
+
+void VirtualFileSystem::unregister_directory(const io::path &path)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+    directories.erase(path);
+}
+
+std::unique_ptr<io::File> VirtualFileSystem::get_by_stem(
+    const std::string &stem)
+{
+    return find_file(VirtualFileKey::Stem, algo::lower(stem));
+}
+
+std::unique_ptr<io::File> VirtualFileSystem::get_by_name(
+    const std::string &name)
+{
+    return find_file(VirtualFileKey::Name, algo::lower(name));
+}
+
+std::unique_ptr<io::File> VirtualFileSystem::get_by_path(const io::path &path)
+{
+    return find_file(VirtualFileKey::Path, get_key(path));
 }
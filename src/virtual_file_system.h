@@ -21,14 +21,44 @@
 #include <memory>
 #include "io/file.h"
 #include "io/path.h"
+#include "types.h"
 
 namespace au {
 
+    enum class VirtualFileKey : u8
+    {
+        Stem,
+        Name,
+        Path,
+    };
+
+    // Provides a whole set of files, such as entries of an archive, that are
+    // looked up only when needed instead of being registered one by one.
+    class IVirtualFileResolver
+    {
+    public:
+        virtual ~IVirtualFileResolver() {}
+
+        // Returns the lowercase path of the first file whose lowercase stem,
+        // name or path equals the key, or an empty path if there's none.
+        virtual io::path find(
+            const VirtualFileKey key_type, const std::string &key) const = 0;
+
+        // Materializes a file found with find().
+        virtual std::unique_ptr<io::File> open(const io::path &path) const = 0;
+    };
+
+    // Lets decoders find files related to the one being decoded, such as
+    // palettes or masks, among registered archive entries and directories.
+    // Factories of registered files are called without holding any lock,
+    // and their results are kept in a bounded cache until the file is
+    // unregistered.
     class VirtualFileSystem final
     {
     public:
         static void enable();
         static void disable();
+        static void set_cache_size(const size_t max_size);
 
         static void clear();
         static void register_file(
@@ -36,6 +66,11 @@ namespace au {
             const std::function<std::unique_ptr<io::File>()> factory);
         static void unregister_file(const io::path &path);
 
+        static void register_resolver(
+            const std::shared_ptr<const IVirtualFileResolver> resolver);
+        static void unregister_resolver(
+            const std::shared_ptr<const IVirtualFileResolver> resolver);
+
         static void register_directory(const io::path &path);
         static void unregister_directory(const io::path &path);
 
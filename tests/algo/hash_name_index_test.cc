@@ -0,0 +1,69 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "algo/hash_name_index.h"
+#include "test_support/catch.h"
+#include "types.h"
+
+using namespace au;
+
+static u32 hash_size(const std::string &name)
+{
+    return name.size();
+}
+
+TEST_CASE("HashNameIndex", "[algo]")
+{
+    SECTION("Empty index")
+    {
+        const algo::HashNameIndex<u32> index;
+        REQUIRE(index.empty());
+        REQUIRE(index.find(0) == nullptr);
+    }
+
+    SECTION("Looking up names")
+    {
+        const std::vector<std::string> names {"cc", "a", "dddd"};
+        const algo::HashNameIndex<u32> index(names, hash_size);
+        REQUIRE(index.size() == 3);
+        REQUIRE(index.find(0) == nullptr);
+        REQUIRE(index.find(3) == nullptr);
+        REQUIRE(index.find(5) == nullptr);
+        REQUIRE(*index.find(1) == "a");
+        REQUIRE(*index.find(2) == "cc");
+        REQUIRE(*index.find(4) == "dddd");
+    }
+
+    SECTION("Entries are sorted by hash")
+    {
+        const std::vector<std::string> names {"ccc", "a", "bb"};
+        const algo::HashNameIndex<u32> index(names, hash_size);
+        std::vector<u32> hashes;
+        for (const auto &entry : index)
+            hashes.push_back(entry.first);
+        REQUIRE(hashes == std::vector<u32>({1, 2, 3}));
+    }
+
+    SECTION("Colliding hashes keep the last name")
+    {
+        const std::vector<std::string> names {"ab", "x", "cd", "ef", "y"};
+        const algo::HashNameIndex<u32> index(names, hash_size);
+        REQUIRE(index.size() == 2);
+        REQUIRE(*index.find(1) == "y");
+        REQUIRE(*index.find(2) == "ef");
+    }
+}
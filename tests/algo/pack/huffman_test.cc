@@ -0,0 +1,41 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "algo/pack/huffman.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+
+using namespace au;
+using namespace au::algo::pack;
+
+TEST_CASE("Huffman decoding", "[algo][pack]")
+{
+    // 1 = node, 0 = leaf followed by 8-bit value; leaves 'a' (0), 'b' (1)
+    const HuffmanTree huffman_tree("\x98\x4C\x40"_b);
+
+    SECTION("Decoding up to target size")
+    {
+        tests::compare_binary(
+            decode_huffman(huffman_tree, "\x60"_b, 4), "abba"_b);
+    }
+
+    SECTION("Decoding stops at the end of input")
+    {
+        tests::compare_binary(
+            decode_huffman(huffman_tree, "\x60"_b, 100), "abbaaaaa"_b);
+    }
+}
@@ -0,0 +1,338 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "archive_handle.h"
+#include <algorithm>
+#include <thread>
+#include "algo/range.h"
+#include "dec/base_archive_decoder.h"
+#include "dec/base_file_decoder.h"
+#include "dec/base_image_decoder.h"
+#include "err.h"
+#include "io/memory_byte_stream.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+#include "test_support/file_support.h"
+
+using namespace au;
+using namespace au::dec;
+
+namespace
+{
+    class TestFileDecoder final : public BaseFileDecoder
+    {
+    protected:
+        bool is_recognized_impl(io::File &input_file) const override;
+
+        std::unique_ptr<io::File> decode_impl(
+            const Logger &logger, io::File &input_file) const override;
+    };
+
+    // Strips the ".packed" extension, leaving the rest to test/test-file.
+    class TestPackedFileDecoder final : public BaseFileDecoder
+    {
+    public:
+        std::vector<std::string> get_linked_formats() const override;
+
+    protected:
+        bool is_recognized_impl(io::File &input_file) const override;
+
+        std::unique_ptr<io::File> decode_impl(
+            const Logger &logger, io::File &input_file) const override;
+    };
+
+    class TestImageDecoder final : public BaseImageDecoder
+    {
+    protected:
+        bool is_recognized_impl(io::File &input_file) const override;
+
+        res::Image decode_impl(
+            const Logger &logger, io::File &input_file) const override;
+    };
+
+    class TestArchiveDecoder final : public BaseArchiveDecoder
+    {
+    public:
+        std::vector<std::string> get_linked_formats() const override;
+
+    protected:
+        bool is_recognized_impl(io::File &input_file) const override;
+
+        std::unique_ptr<ArchiveMeta> read_meta_impl(
+            const Logger &logger, io::File &input_file) const override;
+
+        std::unique_ptr<io::File> read_file_impl(
+            const Logger &logger,
+            io::File &input_file,
+            const ArchiveMeta &m,
+            const ArchiveEntry &e) const override;
+    };
+}
+
+static std::unique_ptr<Registry> create_registry()
+{
+    auto registry = Registry::create_mock();
+    registry->add_decoder(
+        "test/test-archive",
+        []() { return std::make_shared<TestArchiveDecoder>(); });
+    registry->add_decoder(
+        "test/test-file",
+        []() { return std::make_shared<TestFileDecoder>(); });
+    registry->add_decoder(
+        "test/test-packed",
+        []() { return std::make_shared<TestPackedFileDecoder>(); });
+    registry->add_decoder(
+        "test/test-image",
+        []() { return std::make_shared<TestImageDecoder>(); });
+    return registry;
+}
+
+static bstr make_archive(
+    std::initializer_list<std::shared_ptr<io::File>> input_files)
+{
+    io::MemoryByteStream tmp_stream;
+    for (auto &input_file : input_files)
+    {
+        const auto content = input_file->stream.seek(0).read_to_eof();
+        tmp_stream.write(input_file->path.str());
+        tmp_stream.write<u8>(0);
+        tmp_stream.write_le<u32>(content.size());
+        tmp_stream.write(content);
+    }
+    return tmp_stream.seek(0).read_to_eof();
+}
+
+bool TestFileDecoder::is_recognized_impl(io::File &input_file) const
+{
+    return input_file.path.has_extension("lower");
+}
+
+std::unique_ptr<io::File> TestFileDecoder::decode_impl(
+    const Logger &logger, io::File &input_file) const
+{
+    auto content = input_file.stream.seek(0).read_to_eof().str();
+    std::transform(content.begin(), content.end(), content.begin(), ::toupper);
+    auto output_file = std::make_unique<io::File>(input_file.path, content);
+    output_file->path.change_extension("txt");
+    return output_file;
+}
+
+std::vector<std::string> TestPackedFileDecoder::get_linked_formats() const
+{
+    return {"test/test-file"};
+}
+
+bool TestPackedFileDecoder::is_recognized_impl(io::File &input_file) const
+{
+    return input_file.path.has_extension("packed");
+}
+
+std::unique_ptr<io::File> TestPackedFileDecoder::decode_impl(
+    const Logger &logger, io::File &input_file) const
+{
+    return std::make_unique<io::File>(
+        input_file.path.parent() / input_file.path.stem(),
+        input_file.stream.seek(0).read_to_eof());
+}
+
+bool TestImageDecoder::is_recognized_impl(io::File &input_file) const
+{
+    return input_file.path.has_extension("img");
+}
+
+res::Image TestImageDecoder::decode_impl(
+    const Logger &logger, io::File &input_file) const
+{
+    return res::Image(1, 1);
+}
+
+std::vector<std::string> TestArchiveDecoder::get_linked_formats() const
+{
+    return {"test/test-file", "test/test-image"};
+}
+
+bool TestArchiveDecoder::is_recognized_impl(io::File &input_file) const
+{
+    return input_file.path.has_extension("arc");
+}
+
+std::unique_ptr<ArchiveMeta> TestArchiveDecoder::read_meta_impl(
+    const Logger &logger, io::File &input_file) const
+{
+    input_file.stream.seek(0);
+    auto meta = std::make_unique<ArchiveMeta>();
+    while (input_file.stream.left())
+    {
+        auto entry = std::make_unique<PlainArchiveEntry>();
+        entry->path = input_file.stream.read_to_zero().str();
+        entry->size = input_file.stream.read_le<u32>();
+        entry->offset = input_file.stream.pos();
+        input_file.stream.skip(entry->size);
+        meta->entries.push_back(std::move(entry));
+    }
+    return meta;
+}
+
+std::unique_ptr<io::File> TestArchiveDecoder::read_file_impl(
+    const Logger &logger,
+    io::File &input_file,
+    const ArchiveMeta &,
+    const ArchiveEntry &e) const
+{
+    const auto entry = static_cast<const PlainArchiveEntry*>(&e);
+    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
+    return std::make_unique<io::File>(entry->path, data);
+}
+
+TEST_CASE("ArchiveHandle", "[core]")
+{
+    const auto registry = create_registry();
+    const auto input_file = std::make_shared<io::File>(
+        "archive.arc",
+        make_archive(
+            {
+                tests::stub_file("plain.txt", "plain"_b),
+                tests::stub_file("dir/script.lower", "script"_b),
+                tests::stub_file("image.img", "image"_b),
+            }));
+
+    SECTION("Listing entries")
+    {
+        const ArchiveHandle handle(input_file, "", {}, *registry);
+        REQUIRE(handle.get_decoder_name() == "test/test-archive");
+        const auto entry_names = handle.get_entry_names();
+        REQUIRE(entry_names.size() == 3);
+        tests::compare_paths(entry_names[0], "plain.txt");
+        tests::compare_paths(entry_names[1], "dir/script.lower");
+        tests::compare_paths(entry_names[2], "image.img");
+        REQUIRE(handle.has_entry("dir/script.lower"));
+        REQUIRE(!handle.has_entry("script.lower"));
+    }
+
+    SECTION("Reading entries as they are")
+    {
+        const ArchiveHandle handle(input_file, "", {}, *registry);
+        const auto output_file = handle.read("dir/script.lower");
+        tests::compare_paths(output_file->path, "dir/script.lower");
+        REQUIRE(output_file->stream.seek(0).read_to_eof() == "script"_b);
+        REQUIRE(handle.read("image.img")->stream.seek(0).read_to_eof()
+            == "image"_b);
+    }
+
+    SECTION("Reading entries with nested decoding")
+    {
+        const ArchiveHandle handle(input_file, "", {}, *registry);
+        ArchiveReadOptions options;
+        options.enable_nested_decoding = true;
+        const auto output_file = handle.read("dir/script.lower", options);
+        tests::compare_paths(output_file->path, "dir/script.txt");
+        REQUIRE(output_file->stream.seek(0).read_to_eof() == "SCRIPT"_b);
+
+        // conversion is enabled separately
+        const auto image_file = handle.read("image.img", options);
+        REQUIRE(image_file->stream.seek(0).read_to_eof() == "image"_b);
+    }
+
+    SECTION("Reading entries with conversion")
+    {
+        const ArchiveHandle handle(input_file, "", {}, *registry);
+        ArchiveReadOptions options;
+        options.enable_conversion = true;
+        const auto output_file = handle.read("image.img", options);
+        tests::compare_paths(output_file->path, "image.png");
+        REQUIRE(output_file->stream.seek(1).read(3) == "PNG"_b);
+    }
+
+    SECTION("Reading entries with conversion to another image format")
+    {
+        const ArchiveHandle handle(input_file, "", {}, *registry);
+        ArchiveReadOptions options;
+        options.enable_conversion = true;
+        options.image_format = "qoi";
+        const auto output_file = handle.read("image.img", options);
+        tests::compare_paths(output_file->path, "image.qoi");
+        REQUIRE(output_file->stream.seek(0).read(4) == "qoif"_b);
+    }
+
+    SECTION("Reading entries concurrently")
+    {
+        const ArchiveHandle handle(input_file, "", {}, *registry);
+        std::vector<std::thread> threads;
+        std::vector<bstr> results(8);
+        for (const auto i : algo::range(results.size()))
+        {
+            threads.push_back(std::thread([&, i]()
+            {
+                for (const auto j : algo::range(100))
+                {
+                    results[i] = handle.read(i % 2 ? "plain.txt" : "image.img")
+                        ->stream.seek(0).read_to_eof();
+                }
+            }));
+        }
+        for (auto &thread : threads)
+            thread.join();
+        for (const auto i : algo::range(results.size()))
+            REQUIRE(results[i] == (i % 2 ? "plain"_b : "image"_b));
+    }
+
+    SECTION("Reading missing entries")
+    {
+        const ArchiveHandle handle(input_file, "", {}, *registry);
+        REQUIRE_THROWS_AS(handle.read("missing.txt"), err::FileNotFoundError);
+    }
+
+    SECTION("Opening files that aren't archives")
+    {
+        const auto text_file = std::make_shared<io::File>("a.txt", "a"_b);
+        REQUIRE_THROWS_AS(
+            ArchiveHandle(text_file, "", {}, *registry),
+            err::RecognitionError);
+        REQUIRE_THROWS_AS(
+            ArchiveHandle(input_file, "test/test-image", {}, *registry),
+            err::RecognitionError);
+        REQUIRE_THROWS_AS(
+            ArchiveHandle(input_file, "test/unknown", {}, *registry),
+            err::UsageError);
+    }
+}
+
+TEST_CASE("Decoding standalone files", "[core]")
+{
+    const auto registry = create_registry();
+    ArchiveReadOptions options;
+    options.enable_nested_decoding = true;
+    options.enable_conversion = true;
+
+    SECTION("Outputs are decoded with the linked decoders")
+    {
+        io::File input_file("dir/script.lower.packed", "script"_b);
+        const auto output_file
+            = decode_file(input_file, options, {}, *registry);
+        tests::compare_paths(output_file->path, "dir/script.txt");
+        REQUIRE(output_file->stream.seek(0).read_to_eof() == "SCRIPT"_b);
+    }
+
+    SECTION("Outputs are not decoded with unrelated decoders")
+    {
+        io::File input_file("dir/image.img.packed", "image"_b);
+        const auto output_file
+            = decode_file(input_file, options, {}, *registry);
+        tests::compare_paths(output_file->path, "dir/image.img");
+        REQUIRE(output_file->stream.seek(0).read_to_eof() == "image"_b);
+    }
+}
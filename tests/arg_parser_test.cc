@@ -231,4 +231,26 @@ TEST_CASE("ArgParser", "[core]")
         REQUIRE(stray[0] == "stray1");
         REQUIRE(stray[1] == "stray2");
     }
+
+    SECTION("Retrieving used options")
+    {
+        ArgParser ap;
+        ap.register_switch({"--switch1", "-s"});
+        ap.register_flag({"--flag1"});
+        ap.register_switch({"--switch2"});
+        ap.register_flag({"--flag2"});
+        const std::vector<std::string> args
+        {
+            "stray",
+            "--flag2",
+            "--unknown",
+            "-s=value",
+        };
+        ap.parse(args);
+
+        const auto used_options = ap.get_used_options();
+        REQUIRE(used_options.size() == 2);
+        REQUIRE(used_options[0] == "--switch1=value");
+        REQUIRE(used_options[1] == "--flag2");
+    }
 }
@@ -41,6 +41,22 @@ TEST_CASE("CLI facade", "[core]")
         io::remove("./AYU_03.png");
     }
 
+    SECTION("Converting single files to another image format")
+    {
+        const flow::CliFacade cli_facade(
+            logger,
+            {
+                "./tests/dec/real_live/files/g00/AYU_03.g00",
+                "--dec=real-live/g00",
+                "--image-format=tga"
+            });
+
+        cli_facade.run();
+
+        REQUIRE(io::is_regular_file("./AYU_03.tga"));
+        io::remove("./AYU_03.tga");
+    }
+
     SECTION("Unpacking archives with CLI facade")
     {
         const flow::CliFacade cli_facade(
@@ -0,0 +1,255 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "dec/archive_meta_cache.h"
+#include "algo/range.h"
+#include "arg_parser.h"
+#include "dec/registry.h"
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+#include "io/memory_byte_stream.h"
+#include "test_support/catch.h"
+
+using namespace au;
+using namespace au::dec;
+
+static const io::path test_dir = "meta_cache_test";
+
+namespace
+{
+    class TestArchiveDecoder final : public BaseArchiveDecoder
+    {
+    public:
+        TestArchiveDecoder();
+        mutable size_t table_reads;
+
+    protected:
+        bool is_recognized_impl(io::File &input_file) const override;
+
+        std::unique_ptr<ArchiveMeta> read_meta_impl(
+            const Logger &logger, io::File &input_file) const override;
+
+        std::unique_ptr<io::File> read_file_impl(
+            const Logger &logger,
+            io::File &input_file,
+            const ArchiveMeta &m,
+            const ArchiveEntry &e) const override;
+
+        bool supports_meta_cache() const override;
+
+        void write_cached_meta(
+            io::BaseByteStream &output,
+            const ArchiveMeta &meta) const override;
+
+        std::unique_ptr<ArchiveMeta> read_cached_meta(
+            io::BaseByteStream &input) const override;
+
+        std::string get_meta_cache_id() const override;
+    };
+}
+
+TestArchiveDecoder::TestArchiveDecoder() : table_reads(0)
+{
+}
+
+bool TestArchiveDecoder::is_recognized_impl(io::File &input_file) const
+{
+    return true;
+}
+
+std::unique_ptr<ArchiveMeta> TestArchiveDecoder::read_meta_impl(
+    const Logger &logger, io::File &input_file) const
+{
+    table_reads++;
+    auto meta = std::make_unique<ArchiveMeta>();
+    auto entry = std::make_unique<PlainArchiveEntry>();
+    entry->path = "file.txt";
+    entry->offset = 0;
+    entry->size = input_file.stream.size();
+    meta->entries.push_back(std::move(entry));
+    return meta;
+}
+
+std::unique_ptr<io::File> TestArchiveDecoder::read_file_impl(
+    const Logger &logger,
+    io::File &input_file,
+    const ArchiveMeta &m,
+    const ArchiveEntry &e) const
+{
+    return nullptr;
+}
+
+bool TestArchiveDecoder::supports_meta_cache() const
+{
+    return true;
+}
+
+void TestArchiveDecoder::write_cached_meta(
+    io::BaseByteStream &output, const ArchiveMeta &meta) const
+{
+    write_cached_plain_meta(output, meta);
+}
+
+std::unique_ptr<ArchiveMeta> TestArchiveDecoder::read_cached_meta(
+    io::BaseByteStream &input) const
+{
+    return read_cached_plain_meta(input);
+}
+
+std::string TestArchiveDecoder::get_meta_cache_id() const
+{
+    return "test/test";
+}
+
+static void configure(
+    const BaseArchiveDecoder &decoder, const std::vector<std::string> &args)
+{
+    ArgParser arg_parser;
+    const auto decorators = decoder.get_arg_parser_decorators();
+    for (const auto &decorator : decorators)
+        decorator.register_cli_options(arg_parser);
+    arg_parser.parse(args);
+    for (const auto &decorator : decorators)
+        decorator.parse_cli_options(arg_parser);
+}
+
+static void write_file(const io::path &path, const bstr &content)
+{
+    io::FileByteStream(path, io::FileMode::Write).write(content);
+}
+
+TEST_CASE("Archive meta cache", "[dec]")
+{
+    io::create_directories(test_dir);
+    const auto archive_path = test_dir / "test.arc";
+    write_file(archive_path, "content"_b);
+
+    SECTION("Plain tables survive serialization")
+    {
+        ArchiveMeta meta;
+        auto entry = std::make_unique<PlainArchiveEntry>();
+        entry->path = "dir/file.txt";
+        entry->offset = 0x123456789;
+        entry->size = 5;
+        meta.entries.push_back(std::move(entry));
+
+        io::MemoryByteStream stream;
+        write_cached_plain_meta(stream, meta);
+        const auto meta_copy = read_cached_plain_meta(stream.seek(0));
+        REQUIRE(meta_copy->entries.size() == 1);
+        const auto entry_copy = static_cast<const PlainArchiveEntry*>(
+            meta_copy->entries[0].get());
+        REQUIRE(entry_copy->path == io::path("dir/file.txt"));
+        REQUIRE(entry_copy->offset == 0x123456789);
+        REQUIRE(entry_copy->size == 5);
+    }
+
+    SECTION("Files that don't come from disk have no key")
+    {
+        const io::File input_file("test.arc", "content"_b);
+        REQUIRE(ArchiveMetaCache::get_key(input_file, "id", {}).empty());
+
+        // even if a file of the same size exists under the same path
+        const io::File nested_file(archive_path, "CONTENT"_b);
+        REQUIRE(ArchiveMetaCache::get_key(nested_file, "id", {}).empty());
+    }
+
+    SECTION("Keys depend on decoder options")
+    {
+        io::File input_file(archive_path, io::FileMode::Read);
+        const auto key1 = ArchiveMetaCache::get_key(input_file, "id", {});
+        const auto key2 = ArchiveMetaCache::get_key(input_file, "id", {"-x"});
+        const auto key3 = ArchiveMetaCache::get_key(input_file, "id2", {});
+        REQUIRE(!key1.empty());
+        REQUIRE(key1 != key2);
+        REQUIRE(key1 != key3);
+    }
+
+    SECTION("Keys depend on files named by options")
+    {
+        io::File input_file(archive_path, io::FileMode::Read);
+        const auto names_path = test_dir / "names.txt";
+        const auto option = "--file-names=" + names_path.str();
+        write_file(names_path, "a.txt"_b);
+        const auto key1 = ArchiveMetaCache::get_key(input_file, "id", {option});
+        write_file(names_path, "a.txt\nb.txt"_b);
+        const auto key2 = ArchiveMetaCache::get_key(input_file, "id", {option});
+        REQUIRE(!key1.empty());
+        REQUIRE(key1 != key2);
+    }
+
+    SECTION("Registered decoders are identified by name")
+    {
+        const auto &registry = Registry::instance();
+        const auto decoder = registry.create_decoder("twilight-frontier/tfpk");
+        REQUIRE(registry.get_decoder_name(*decoder)
+            == "twilight-frontier/tfpk");
+        REQUIRE(registry.get_decoder_name(TestArchiveDecoder()).empty());
+    }
+
+    SECTION("Storing and loading entries")
+    {
+        const ArchiveMetaCache cache(test_dir / "cache");
+        REQUIRE(!cache.load("key"));
+        cache.store("key", "data"_b);
+        const auto stream = cache.load("key");
+        REQUIRE(stream);
+        REQUIRE(stream->read_to_eof() == "data"_b);
+        REQUIRE(!cache.load("other key"));
+    }
+
+    SECTION("Decoders read tables from the cache")
+    {
+        Logger dummy_logger;
+        dummy_logger.mute();
+        const TestArchiveDecoder decoder;
+        configure(decoder, {"--meta-cache=" + (test_dir / "cache").str()});
+
+        for (const auto i : algo::range(2))
+        {
+            io::File input_file(archive_path, io::FileMode::Read);
+            const auto meta = decoder.read_meta(dummy_logger, input_file);
+            REQUIRE(meta->entries.size() == 1);
+            REQUIRE(meta->entries[0]->path == io::path("file.txt"));
+        }
+        REQUIRE(decoder.table_reads == 1);
+
+        // changing the archive invalidates the cached table
+        write_file(archive_path, "new content"_b);
+        io::File input_file(archive_path, io::FileMode::Read);
+        const auto meta = decoder.read_meta(dummy_logger, input_file);
+        REQUIRE(decoder.table_reads == 2);
+        REQUIRE(static_cast<const PlainArchiveEntry*>(
+            meta->entries[0].get())->size == 11);
+    }
+
+    SECTION("Decoders don't use the cache unless asked to")
+    {
+        Logger dummy_logger;
+        dummy_logger.mute();
+        const TestArchiveDecoder decoder;
+        configure(decoder, {});
+        for (const auto i : algo::range(2))
+        {
+            io::File input_file(archive_path, io::FileMode::Read);
+            decoder.read_meta(dummy_logger, input_file);
+        }
+        REQUIRE(decoder.table_reads == 2);
+    }
+
+    boost::filesystem::remove_all(test_dir.str());
+}
@@ -17,6 +17,7 @@
 
 #include "dec/kaguya/an00_image_archive_decoder.h"
 #include "algo/range.h"
+#include "arg_parser.h"
 #include "test_support/catch.h"
 #include "test_support/decoder_support.h"
 #include "test_support/image_support.h"
@@ -55,6 +56,28 @@ TEST_CASE("Atelier Kaguya AN00 image archives", "[dec]")
     }
 
     const auto decoder = An00ImageArchiveDecoder();
-    const auto actual_files = tests::unpack(decoder, input_file);
-    tests::compare_images(actual_files, expected_images);
+
+    SECTION("Default image format")
+    {
+        const auto actual_files = tests::unpack(decoder, input_file);
+        for (const auto &file : actual_files)
+            REQUIRE(file->path.has_extension("png"));
+        tests::compare_images(actual_files, expected_images);
+    }
+
+    SECTION("Image format picked with --image-format")
+    {
+        ArgParser arg_parser;
+        const auto decorators = decoder.get_arg_parser_decorators();
+        for (const auto &decorator : decorators)
+            decorator.register_cli_options(arg_parser);
+        arg_parser.parse({"--image-format=bmp"});
+        for (const auto &decorator : decorators)
+            decorator.parse_cli_options(arg_parser);
+
+        const auto actual_files = tests::unpack(decoder, input_file);
+        for (const auto &file : actual_files)
+            REQUIRE(file->path.has_extension("bmp"));
+        tests::compare_images(actual_files, expected_images);
+    }
 }
@@ -16,6 +16,11 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "dec/microsoft/bmp_image_decoder.h"
+#include "algo/range.h"
+#include "dec/png/png_image_decoder.h"
+#include "enc/microsoft/bmp_image_encoder.h"
+#include "enc/png/png_image_encoder.h"
+#include "test_support/allocation_support.h"
 #include "test_support/catch.h"
 #include "test_support/decoder_support.h"
 #include "test_support/file_support.h"
@@ -34,6 +39,8 @@ static void do_test(
     const auto expected_file = tests::file_from_path(dir + expected_path);
     const auto actual_image = tests::decode(decoder, *input_file);
     tests::compare_images(actual_image, *expected_file);
+    const auto banded_image = tests::decode_bands(decoder, *input_file);
+    tests::compare_images(banded_image, actual_image);
 }
 
 TEST_CASE("Microsoft BMP images", "[dec]")
@@ -130,3 +137,141 @@ TEST_CASE("Microsoft BMP images", "[dec]")
         do_test("pal8topdown.bmp", "pal8-out.png");
     }
 }
+
+TEST_CASE("Microsoft BMP images are not copied while decoding", "[dec]")
+{
+    const auto decoder = BmpImageDecoder();
+    const auto input_file = tests::file_from_path(dir + "rgb24.bmp");
+    const auto expected_image = tests::decode(decoder, *input_file);
+    const auto pixels_size = expected_image.width()
+        * expected_image.height()
+        * sizeof(res::Pixel);
+
+    // only the pixels of the returned image are allocated
+    const tests::AllocationCounter counter(pixels_size);
+    const auto actual_image = tests::decode(decoder, *input_file);
+    REQUIRE(counter.get_count() == 1);
+}
+
+TEST_CASE("Microsoft BMP images are decoded in bands", "[dec]")
+{
+    const auto decoder = BmpImageDecoder();
+    REQUIRE(decoder.supports_band_decoding());
+
+    // Big enough to be split into several bands.
+    res::Image input_image(1024, 1500);
+    for (const auto y : algo::range(input_image.height()))
+    for (const auto x : algo::range(input_image.width()))
+    {
+        auto &c = input_image.at(x, y);
+        c.r = x;
+        c.g = y;
+        c.b = x ^ y;
+        c.a = x + y;
+    }
+
+    Logger dummy_logger;
+    dummy_logger.mute();
+    const auto input_file = enc::microsoft::BmpImageEncoder().encode(
+        dummy_logger, input_image, "test.bmp");
+    const auto banded_image = tests::decode_bands(decoder, *input_file);
+    tests::compare_images(banded_image, input_image);
+}
+
+TEST_CASE("Microsoft BMP images with transparent bands", "[dec]")
+{
+    const auto decoder = BmpImageDecoder();
+    Logger dummy_logger;
+    dummy_logger.mute();
+
+    // Big enough to be split into several bands.
+    res::Image input_image(1024, 1500);
+    for (const auto y : algo::range(input_image.height()))
+    for (const auto x : algo::range(input_image.width()))
+    {
+        auto &c = input_image.at(x, y);
+        c.r = x;
+        c.g = y;
+        c.b = x ^ y;
+        c.a = 0;
+    }
+
+    SECTION("Transparent bands followed by opaque ones are kept as they are")
+    {
+        for (const auto x : algo::range(input_image.width()))
+            input_image.at(x, 1400).a = 0xFF;
+        const auto input_file = enc::microsoft::BmpImageEncoder().encode(
+            dummy_logger, input_image, "test.bmp");
+        tests::compare_images(
+            tests::decode_bands(decoder, *input_file), input_image);
+    }
+
+    SECTION("Images that are entirely transparent are made opaque")
+    {
+        const auto input_file = enc::microsoft::BmpImageEncoder().encode(
+            dummy_logger, input_image, "test.bmp");
+        for (auto &c : input_image)
+            c.a = 0xFF;
+        tests::compare_images(
+            tests::decode_bands(decoder, *input_file), input_image);
+    }
+}
+
+// Streams the image from a BMP file to a PNG band sink, checking that
+// neither the decoder nor the sink collects the whole image.
+static void do_streaming_test(
+    const res::Image &input_image, const res::Image &expected_image)
+{
+    const auto decoder = BmpImageDecoder();
+    Logger dummy_logger;
+    dummy_logger.mute();
+    const auto input_file = enc::microsoft::BmpImageEncoder().encode(
+        dummy_logger, input_image, "test.bmp");
+    const enc::png::PngImageEncoder encoder(
+        1, enc::png::PngFilter::None, 1, 0);
+    io::File output_file("test.dat", ""_b);
+    const auto sink = encoder.create_band_sink(dummy_logger, output_file);
+
+    const auto pixels_size = input_image.width()
+        * input_image.height()
+        * sizeof(res::Pixel);
+    {
+        const tests::AllocationCounter counter(pixels_size);
+        decoder.decode_bands(dummy_logger, *input_file, *sink);
+        REQUIRE(counter.get_count() == 0);
+    }
+
+    const auto output_image = dec::png::PngImageDecoder().decode(
+        dummy_logger, output_file);
+    tests::compare_images(output_image, expected_image);
+}
+
+TEST_CASE("Microsoft BMP images are streamed without being held", "[dec]")
+{
+    // Big enough to take several bands and more than a PNG band sink holds
+    // while it looks for a smaller color type. The image would fit a palette,
+    // so the sink keeps looking until it has held as much as it may.
+    res::Image input_image(2048, 2048);
+    for (const auto y : algo::range(input_image.height()))
+    for (const auto x : algo::range(input_image.width()))
+    {
+        auto &c = input_image.at(x, y);
+        c.r = x / 256;
+        c.g = y / 256;
+        c.b = 0;
+        c.a = 0xFF;
+    }
+
+    SECTION("Opaque images")
+    {
+        do_streaming_test(input_image, input_image);
+    }
+
+    SECTION("Images with an unused alpha channel")
+    {
+        auto transparent_image = input_image;
+        for (auto &c : transparent_image)
+            c.a = 0;
+        do_streaming_test(transparent_image, input_image);
+    }
+}
@@ -59,4 +59,17 @@ TEST_CASE("Microsoft BMP images encoding", "[enc]")
             = bmp_decoder.decode(dummy_logger, *output_file);
         tests::compare_images(input_image, output_image);
     }
+
+    SECTION("Flipped and cropped view")
+    {
+        const auto bmp_decoder = dec::microsoft::BmpImageDecoder();
+        const auto input_image = tests::get_opaque_test_image();
+        res::ImageView view(input_image);
+        view.flip_vertically().crop(3, 5, 20, 10);
+        const auto output_file
+            = bmp_encoder.encode(dummy_logger, view, "test.dat");
+        const auto output_image
+            = bmp_decoder.decode(dummy_logger, *output_file);
+        tests::compare_images(res::Image(view), output_image);
+    }
 }
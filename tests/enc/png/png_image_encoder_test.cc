@@ -0,0 +1,439 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "enc/png/png_image_encoder.h"
+#include <thread>
+#include "algo/range.h"
+#include "dec/png/png_image_decoder.h"
+#include "err.h"
+#include "test_support/catch.h"
+#include "test_support/image_support.h"
+
+using namespace au;
+using namespace au::enc::png;
+
+// Big enough to be split into several bands.
+static res::Image create_test_image()
+{
+    res::Image image(400, 700);
+    for (const auto y : algo::range(image.height()))
+    for (const auto x : algo::range(image.width()))
+    {
+        auto &c = image.at(x, y);
+        c.r = x;
+        c.g = y;
+        c.b = (x * y) ^ (x + y);
+        c.a = x < 50 ? 0 : 0xFF - y;
+    }
+    return image;
+}
+
+// Returns the encoded file, so that the callers can inspect its chunks.
+static bstr do_test(
+    const res::Image &input_image,
+    const PngImageEncoder &encoder)
+{
+    Logger dummy_logger;
+    dummy_logger.mute();
+    const auto output_file
+        = encoder.encode(dummy_logger, input_image, "test.dat");
+    REQUIRE(output_file->path.name() == "test.png");
+    const auto output_image = dec::png::PngImageDecoder().decode(
+        dummy_logger, *output_file);
+    tests::compare_images(input_image, output_image);
+    return output_file->stream.seek(0).read_to_eof();
+}
+
+static int get_color_type(const bstr &png_data)
+{
+    return png_data.at(25);
+}
+
+static bool has_chunk(const bstr &png_data, const std::string &type)
+{
+    return png_data.find(bstr(type)) != bstr::npos;
+}
+
+static res::Image create_palette_test_image(
+    const res::Palette &palette, const size_t color_count)
+{
+    bstr indices(256 * 100);
+    for (const auto i : algo::range(indices.size()))
+        indices[i] = (i / 7) % color_count;
+    return res::Image(256, 100, indices, palette);
+}
+
+static void configure(PngImageEncoder &encoder, const std::string &argument)
+{
+    ArgParser arg_parser;
+    const auto decorators = encoder.get_arg_parser_decorators();
+    for (const auto &decorator : decorators)
+        decorator.register_cli_options(arg_parser);
+    arg_parser.parse({argument});
+    for (const auto &decorator : decorators)
+        decorator.parse_cli_options(arg_parser);
+}
+
+TEST_CASE("PNG images encoding", "[enc]")
+{
+    const auto input_image = create_test_image();
+
+    SECTION("Small image")
+    {
+        do_test(tests::get_transparent_test_image(), PngImageEncoder());
+    }
+
+    SECTION("Single thread")
+    {
+        do_test(input_image, PngImageEncoder(1, PngFilter::None, 1));
+    }
+
+    SECTION("Several threads")
+    {
+        do_test(input_image, PngImageEncoder(1, PngFilter::None, 4));
+    }
+
+    SECTION("Filters")
+    {
+        for (const auto filter :
+            {
+                PngFilter::None,
+                PngFilter::Sub,
+                PngFilter::Up,
+                PngFilter::Average,
+                PngFilter::Paeth,
+                PngFilter::Adaptive,
+            })
+        {
+            INFO("Filter " << static_cast<int>(filter));
+            do_test(input_image, PngImageEncoder(6, filter, 3));
+        }
+    }
+
+    SECTION("Compression levels")
+    {
+        for (const auto level : {0, 9})
+        {
+            INFO("Level " << level);
+            do_test(input_image, PngImageEncoder(level, PngFilter::Up, 2));
+        }
+    }
+
+    SECTION("Masked and flipped view")
+    {
+        const auto mask = tests::get_transparent_test_image();
+        auto base_image = mask;
+        base_image.invert();
+        res::ImageView view(base_image);
+        view.apply_mask(mask).flip_vertically();
+        Logger dummy_logger;
+        dummy_logger.mute();
+        const auto output_file = PngImageEncoder().encode(
+            dummy_logger, view, "test.dat");
+        const auto output_image = dec::png::PngImageDecoder().decode(
+            dummy_logger, *output_file);
+        tests::compare_images(res::Image(view), output_image);
+    }
+
+    SECTION("Command line options")
+    {
+        PngImageEncoder encoder;
+        configure(encoder, "--png-preset=small");
+        do_test(input_image, encoder);
+        configure(encoder, "--png-filter=paeth");
+        configure(encoder, "--png-level=0");
+        do_test(input_image, encoder);
+        REQUIRE_THROWS_AS(
+            configure(encoder, "--png-level=10"), err::UsageError);
+        REQUIRE_THROWS_AS(
+            configure(encoder, "--png-filter=xyz"), err::UsageError);
+        REQUIRE_THROWS_AS(
+            configure(encoder, "--png-preset=xyz"), err::UsageError);
+    }
+
+    SECTION("Moved encoders keep their command line options")
+    {
+        PngImageEncoder encoder;
+        auto moved_encoder = std::move(encoder);
+        configure(moved_encoder, "--png-level=0");
+        REQUIRE(do_test(input_image, moved_encoder)
+            == do_test(input_image, PngImageEncoder(0)));
+    }
+
+    SECTION("Many images encoded at once")
+    {
+        Logger dummy_logger;
+        dummy_logger.mute();
+        std::vector<std::thread> threads;
+        for (const auto i : algo::range(8))
+        {
+            threads.push_back(std::thread([&]()
+            {
+                PngImageEncoder(1).encode(
+                    dummy_logger, input_image, "test.dat");
+            }));
+        }
+        for (auto &thread : threads)
+            thread.join();
+        do_test(input_image, PngImageEncoder());
+    }
+}
+
+TEST_CASE("PNG color type reduction", "[enc]")
+{
+    const PngImageEncoder encoder(6, PngFilter::Adaptive, 2);
+
+    SECTION("Gray")
+    {
+        auto input_image = create_test_image();
+        for (auto &c : input_image)
+        {
+            c.g = c.b = c.r;
+            c.a = 0xFF;
+        }
+        const auto png_data = do_test(input_image, encoder);
+        REQUIRE(get_color_type(png_data) == 0);
+        REQUIRE(!has_chunk(png_data, "PLTE"));
+    }
+
+    SECTION("Gray with alpha")
+    {
+        auto input_image = create_test_image();
+        for (auto &c : input_image)
+            c.g = c.b = c.r;
+        REQUIRE(get_color_type(do_test(input_image, encoder)) == 4);
+    }
+
+    SECTION("RGB")
+    {
+        auto input_image = create_test_image();
+        for (auto &c : input_image)
+            c.a = 0xFF;
+        REQUIRE(get_color_type(do_test(input_image, encoder)) == 2);
+    }
+
+    SECTION("RGBA")
+    {
+        const auto input_image = create_test_image();
+        REQUIRE(get_color_type(do_test(input_image, encoder)) == 6);
+    }
+
+    SECTION("Palette collected from the pixels")
+    {
+        auto input_image = create_test_image();
+        for (auto &c : input_image)
+        {
+            c.r &= 0xC0;
+            c.g &= 0xC0;
+            c.b = 0;
+            c.a = c.a < 0x80 ? 0x80 : 0xFF;
+        }
+        const auto png_data = do_test(input_image, encoder);
+        REQUIRE(get_color_type(png_data) == 3);
+        REQUIRE(has_chunk(png_data, "PLTE"));
+        REQUIRE(has_chunk(png_data, "tRNS"));
+    }
+
+    SECTION("Palette of the source image")
+    {
+        res::Palette palette(256);
+        for (const auto i : algo::range(palette.size()))
+        {
+            palette[i].r = 0xFF - i;
+            palette[i].g = i;
+            palette[i].b = i * 3;
+            palette[i].a = 0xFF;
+        }
+        const auto input_image = create_palette_test_image(palette, 256);
+        const auto png_data = do_test(input_image, encoder);
+        REQUIRE(get_color_type(png_data) == 3);
+        REQUIRE(!has_chunk(png_data, "tRNS"));
+
+        // The PLTE chunk follows the 13-byte IHDR chunk.
+        const auto plte_pos = png_data.find("PLTE"_b);
+        REQUIRE(plte_pos == 37);
+        for (const auto i : algo::range(palette.size()))
+        {
+            INFO("Color " << i);
+            REQUIRE(png_data.at(plte_pos + 4 + i * 3) == 0xFF - i);
+            REQUIRE(png_data.at(plte_pos + 5 + i * 3) == i);
+        }
+    }
+
+    SECTION("Source palette no longer matching the pixels")
+    {
+        res::Palette palette(16);
+        for (const auto i : algo::range(palette.size()))
+        {
+            palette[i].r = i * 16;
+            palette[i].g = 0;
+            palette[i].b = 0;
+            palette[i].a = 0xFF;
+        }
+
+        SECTION("Pixels still fit in a palette")
+        {
+            auto input_image = create_palette_test_image(palette, 16);
+            input_image.at(5, 5).g = 0x12;
+            REQUIRE(get_color_type(do_test(input_image, encoder)) == 3);
+        }
+
+        SECTION("Too many colors for a palette")
+        {
+            auto input_image = create_palette_test_image(palette, 16);
+            for (const auto x : algo::range(input_image.width()))
+                input_image.at(x, 10).b = x;
+            input_image.at(0, 0).b = 0xFF;
+            input_image.at(1, 0).g = 0xFF;
+            REQUIRE(get_color_type(do_test(input_image, encoder)) == 2);
+        }
+    }
+}
+
+// Feeds the image to a band sink in bands of the given height and returns
+// the encoded file after checking that it decodes back to the image.
+static bstr do_band_test(
+    const res::Image &input_image,
+    const PngImageEncoder &encoder,
+    const size_t rows_per_band,
+    const bool is_opaque = false)
+{
+    Logger dummy_logger;
+    dummy_logger.mute();
+    io::File output_file("test.dat", ""_b);
+    const auto sink = encoder.create_band_sink(dummy_logger, output_file);
+    sink->begin(input_image.width(), input_image.height(), is_opaque);
+    for (size_t y = 0; y < input_image.height(); y += rows_per_band)
+    {
+        res::ImageView band(input_image);
+        band.crop(
+            0,
+            y,
+            input_image.width(),
+            std::min(rows_per_band, input_image.height() - y));
+        sink->write_band(band);
+    }
+    sink->end();
+    REQUIRE(output_file.path.name() == "test.png");
+    const auto output_image = dec::png::PngImageDecoder().decode(
+        dummy_logger, output_file);
+    tests::compare_images(input_image, output_image);
+    return output_file.stream.seek(0).read_to_eof();
+}
+
+TEST_CASE("PNG images encoding through band sinks", "[enc]")
+{
+    const auto input_image = create_test_image();
+
+    SECTION("Images below the threshold are encoded as a whole")
+    {
+        const PngImageEncoder encoder(1, PngFilter::None, 1);
+        Logger dummy_logger;
+        dummy_logger.mute();
+        const auto expected_data = encoder
+            .encode(dummy_logger, input_image, "test.dat")
+            ->stream.seek(0).read_to_eof();
+        REQUIRE(do_band_test(input_image, encoder, 64) == expected_data);
+    }
+
+    SECTION("Images above the threshold are streamed")
+    {
+        const PngImageEncoder encoder(1, PngFilter::None, 1, 0);
+        const auto png_data = do_band_test(input_image, encoder, 64);
+        REQUIRE(get_color_type(png_data) == 6);
+    }
+
+    SECTION("Images that fit a smaller color type are encoded as a whole")
+    {
+        auto opaque_image = input_image;
+        for (auto &c : opaque_image)
+            c.a = 0xFF;
+        const PngImageEncoder encoder(1, PngFilter::None, 1, 0);
+        Logger dummy_logger;
+        dummy_logger.mute();
+        const auto expected_data = encoder
+            .encode(dummy_logger, opaque_image, "test.dat")
+            ->stream.seek(0).read_to_eof();
+        const auto png_data = do_band_test(opaque_image, encoder, 64);
+        REQUIRE(get_color_type(png_data) == 2);
+        REQUIRE(png_data == expected_data);
+    }
+
+    SECTION("Streaming in several batches on several threads")
+    {
+        res::Image large_image(1024, 1500);
+        for (const auto y : algo::range(large_image.height()))
+        for (const auto x : algo::range(large_image.width()))
+        {
+            auto &c = large_image.at(x, y);
+            c.r = x;
+            c.g = y;
+            c.b = x ^ y;
+            c.a = x + y;
+        }
+        for (const auto thread_count : {1, 4})
+        {
+            INFO("Threads " << thread_count);
+            const PngImageEncoder encoder(
+                1, PngFilter::Paeth, thread_count, 0);
+            const auto png_data = do_band_test(large_image, encoder, 100);
+            REQUIRE(get_color_type(png_data) == 6);
+        }
+    }
+
+    SECTION("Large images are held only in part")
+    {
+        // few enough colors for a palette, but too many pixels to wait for
+        // the end of the image
+        res::Image large_image(1024, 1500);
+        for (const auto y : algo::range(large_image.height()))
+        for (const auto x : algo::range(large_image.width()))
+        {
+            auto &c = large_image.at(x, y);
+            c.r = x / 128;
+            c.g = y / 256;
+            c.b = 0;
+            c.a = 0xFF;
+        }
+        const PngImageEncoder encoder(1, PngFilter::None, 1, 0);
+        REQUIRE(get_color_type(do_band_test(large_image, encoder, 100)) == 6);
+        REQUIRE(get_color_type(
+            do_band_test(large_image, encoder, 100, true)) == 2);
+    }
+
+    SECTION("Streaming with filters")
+    {
+        for (const auto i : algo::range(6))
+        {
+            const PngImageEncoder encoder(
+                6, static_cast<PngFilter>(i), 1, 0);
+            do_band_test(input_image, encoder, 1);
+        }
+    }
+
+    SECTION("Streaming rejects bands that do not fit")
+    {
+        const PngImageEncoder encoder(1, PngFilter::None, 1, 0);
+        Logger dummy_logger;
+        dummy_logger.mute();
+        io::File output_file("test.dat", ""_b);
+        const auto sink = encoder.create_band_sink(dummy_logger, output_file);
+        sink->begin(input_image.width(), input_image.height() - 1, false);
+        REQUIRE_THROWS_AS(
+            sink->write_band(input_image), err::BadDataSizeError);
+    }
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "enc/qoi/qoi_image_encoder.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+
+using namespace au;
+using namespace au::enc::qoi;
+
+static res::Pixel make_pixel(const u8 r, const u8 g, const u8 b, const u8 a)
+{
+    res::Pixel pixel;
+    pixel.r = r;
+    pixel.g = g;
+    pixel.b = b;
+    pixel.a = a;
+    return pixel;
+}
+
+TEST_CASE("QOI images encoding", "[enc]")
+{
+    Logger dummy_logger;
+    dummy_logger.mute();
+    const auto qoi_encoder = QoiImageEncoder();
+
+    res::Image input_image(6, 1);
+    input_image.at(0, 0) = make_pixel(0, 0, 0, 0xFF);      // run
+    input_image.at(1, 0) = make_pixel(1, 1, 1, 0xFF);      // diff
+    input_image.at(2, 0) = make_pixel(16, 21, 26, 0xFF);   // luma
+    input_image.at(3, 0) = make_pixel(0, 0, 0, 0);         // index
+    input_image.at(4, 0) = make_pixel(200, 100, 50, 128);  // rgba
+    input_image.at(5, 0) = make_pixel(200, 100, 50, 128);  // run
+    const auto output_file
+        = qoi_encoder.encode(dummy_logger, input_image, "test.dat");
+    REQUIRE(output_file->path.name() == "test.qoi");
+    tests::compare_binary(
+        output_file->stream.seek(0).read_to_eof(),
+        "qoif\x00\x00\x00\x06\x00\x00\x00\x01\x04\x00"
+        "\xC0\x7F\xB4\x3D\x00\xFF\xC8\x64\x32\x80\xC0"
+        "\x00\x00\x00\x00\x00\x00\x00\x01"_b);
+}
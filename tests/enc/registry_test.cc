@@ -0,0 +1,37 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "enc/registry.h"
+#include "enc/base_image_encoder.h"
+#include "err.h"
+#include "test_support/catch.h"
+
+using namespace au;
+
+TEST_CASE("Image encoder registry", "[enc]")
+{
+    const auto &registry = enc::Registry::instance();
+    for (const auto &name : {"bmp", "png", "qoi", "tga"})
+    {
+        INFO(name);
+        REQUIRE(registry.has_image_encoder(name));
+        REQUIRE(registry.create_image_encoder(name));
+    }
+    REQUIRE(!registry.has_image_encoder("xyz"));
+    REQUIRE_THROWS_AS(
+        registry.create_image_encoder("xyz"), err::UsageError);
+}
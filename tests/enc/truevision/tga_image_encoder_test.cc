@@ -0,0 +1,59 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "enc/truevision/tga_image_encoder.h"
+#include "dec/truevision/tga_image_decoder.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+#include "test_support/image_support.h"
+
+using namespace au;
+using namespace au::enc::truevision;
+
+TEST_CASE("Truevision TGA images encoding", "[enc]")
+{
+    Logger dummy_logger;
+    dummy_logger.mute();
+    const auto tga_encoder = TgaImageEncoder();
+
+    SECTION("Small image")
+    {
+        res::Image input_image(1, 1);
+        input_image.at(0, 0).r = 1;
+        input_image.at(0, 0).g = 2;
+        input_image.at(0, 0).b = 3;
+        input_image.at(0, 0).a = 4;
+        const auto output_file
+            = tga_encoder.encode(dummy_logger, input_image, "test.dat");
+        REQUIRE(output_file->path.name() == "test.tga");
+        tests::compare_binary(
+            output_file->stream.seek(0).read_to_eof(),
+            "\x00\x00\x02\x00\x00\x00\x00\x00\x00\x00\x00\x00\x01\x00\x01\x00"
+            "\x20\x28\x03\x02\x01\x04"_b);
+    }
+
+    SECTION("Bigger image")
+    {
+        const auto tga_decoder = dec::truevision::TgaImageDecoder();
+        const auto input_image = tests::get_opaque_test_image();
+        const auto output_file
+            = tga_encoder.encode(dummy_logger, input_image, "test.dat");
+        const auto output_image
+            = tga_decoder.decode(dummy_logger, *output_file);
+        tests::compare_images(input_image, output_image);
+    }
+}
@@ -0,0 +1,185 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/decoded_file_cache.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "err.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+
+using namespace au;
+
+static flow::DecodedFileFactory make_factory(
+    io::File &input_file, const io::path &output_path, int &call_count)
+{
+    return [&input_file, output_path, &call_count]()
+    {
+        ++call_count;
+        const auto content = input_file.stream.seek(0).read_to_eof();
+        return std::make_shared<io::File>(output_path, content + "_used"_b);
+    };
+}
+
+TEST_CASE("Decoded file cache", "[flow]")
+{
+    flow::DecodedFileCache cache(1024);
+    int call_count = 0;
+
+    SECTION("Identical contents are converted once")
+    {
+        io::File input_file1("dir1/input.dat", "content"_b);
+        io::File input_file2("dir2/other.dat", "content"_b);
+        const auto output_file1 = cache.get_or_create(
+            {"test/test"},
+            input_file1,
+            make_factory(input_file1, "dir1/input.png", call_count));
+        const auto output_file2 = cache.get_or_create(
+            {"test/test"},
+            input_file2,
+            make_factory(input_file2, "dir2/other.png", call_count));
+        REQUIRE(call_count == 1);
+        REQUIRE(cache.get_hit_count() == 1);
+        tests::compare_paths(output_file1->path, "dir1/input.png");
+        tests::compare_paths(output_file2->path, "dir2/other.png");
+        REQUIRE(output_file1->stream.seek(0).read_to_eof() == "content_used"_b);
+        REQUIRE(output_file2->stream.seek(0).read_to_eof() == "content_used"_b);
+    }
+
+    SECTION("Different contents are converted separately")
+    {
+        io::File input_file1("input.dat", "content1"_b);
+        io::File input_file2("input.dat", "content2"_b);
+        cache.get_or_create(
+            {"test/test"},
+            input_file1,
+            make_factory(input_file1, "input.png", call_count));
+        cache.get_or_create(
+            {"test/test"},
+            input_file2,
+            make_factory(input_file2, "input.png", call_count));
+        REQUIRE(call_count == 2);
+    }
+
+    SECTION("Different decoders are not mixed up")
+    {
+        io::File input_file("input.dat", "content"_b);
+        cache.get_or_create(
+            {"test/test1"},
+            input_file,
+            make_factory(input_file, "input.png", call_count));
+        cache.get_or_create(
+            {"test/test2"},
+            input_file,
+            make_factory(input_file, "input.png", call_count));
+        REQUIRE(call_count == 2);
+    }
+
+    SECTION("Different decoder chains are not mixed up")
+    {
+        io::File input_file("input.dat", "content"_b);
+        cache.get_or_create(
+            {"test/archive1", "test/test"},
+            input_file,
+            make_factory(input_file, "input.png", call_count));
+        cache.get_or_create(
+            {"test/archive2", "test/test"},
+            input_file,
+            make_factory(input_file, "input.png", call_count));
+        REQUIRE(call_count == 2);
+    }
+
+    SECTION("Concurrent requests wait for the conversion in progress")
+    {
+        io::File input_file1("input.dat", "content"_b);
+        io::File input_file2("input.dat", "content"_b);
+        std::atomic<bool> started(false);
+        std::thread thread([&]()
+        {
+            cache.get_or_create(
+                {"test/test"},
+                input_file1,
+                [&]()
+                {
+                    started = true;
+                    std::this_thread::sleep_for(
+                        std::chrono::milliseconds(50));
+                    return make_factory(
+                        input_file1, "input.png", call_count)();
+                });
+        });
+        while (!started)
+            std::this_thread::yield();
+        const auto output_file = cache.get_or_create(
+            {"test/test"},
+            input_file2,
+            make_factory(input_file2, "input.png", call_count));
+        thread.join();
+        REQUIRE(call_count == 1);
+        REQUIRE(cache.get_hit_count() == 1);
+        REQUIRE(output_file->stream.seek(0).read_to_eof() == "content_used"_b);
+    }
+
+    SECTION("Failed conversions do not block later requests")
+    {
+        io::File input_file("input.dat", "content"_b);
+        REQUIRE_THROWS(cache.get_or_create(
+            {"test/test"},
+            input_file,
+            []() -> std::shared_ptr<io::File>
+            {
+                throw err::CorruptDataError("test");
+            }));
+        cache.get_or_create(
+            {"test/test"},
+            input_file,
+            make_factory(input_file, "input.png", call_count));
+        REQUIRE(call_count == 1);
+    }
+
+    SECTION("Outputs with content-dependent names are not cached")
+    {
+        io::File input_file1("input1.dat", "content"_b);
+        io::File input_file2("input2.dat", "content"_b);
+        cache.get_or_create(
+            {"test/test"},
+            input_file1,
+            make_factory(input_file1, "unrelated.png", call_count));
+        const auto output_file = cache.get_or_create(
+            {"test/test"},
+            input_file2,
+            make_factory(input_file2, "unrelated.png", call_count));
+        REQUIRE(call_count == 2);
+        tests::compare_paths(output_file->path, "unrelated.png");
+    }
+
+    SECTION("Cache size is bounded")
+    {
+        flow::DecodedFileCache small_cache(10);
+        io::File input_file("input.dat", "content"_b);
+        small_cache.get_or_create(
+            {"test/test"},
+            input_file,
+            make_factory(input_file, "input.png", call_count));
+        small_cache.get_or_create(
+            {"test/test"},
+            input_file,
+            make_factory(input_file, "input.png", call_count));
+        REQUIRE(call_count == 2);
+    }
+}
@@ -0,0 +1,103 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/progress.h"
+#include <thread>
+#include <vector>
+#include "algo/range.h"
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+#include "test_support/catch.h"
+
+using namespace au;
+
+TEST_CASE("Progress counters", "[flow]")
+{
+    flow::ProgressCounters counters({"test/test1", "test/test2"});
+
+    SECTION("Tasks and bytes are counted")
+    {
+        std::vector<std::thread> threads;
+        for (const auto i : algo::range(4))
+        {
+            threads.push_back(std::thread([&]()
+            {
+                for (const auto j : algo::range(100))
+                {
+                    counters.add_queued_task();
+                    counters.add_running_task();
+                    counters.add_bytes_read(1);
+                    counters.add_bytes_decoded(2);
+                    counters.add_bytes_written(3);
+                    counters.add_done_task();
+                }
+            }));
+        }
+        for (auto &thread : threads)
+            thread.join();
+        counters.add_queued_task();
+        counters.add_queued_task();
+        counters.add_running_task();
+
+        const auto snapshot = counters.get_snapshot();
+        REQUIRE(snapshot.tasks_queued == 402);
+        REQUIRE(snapshot.tasks_running == 1);
+        REQUIRE(snapshot.tasks_done == 400);
+        REQUIRE(snapshot.get_queue_depth() == 1);
+        REQUIRE(snapshot.bytes_read == 400);
+        REQUIRE(snapshot.bytes_decoded == 800);
+        REQUIRE(snapshot.bytes_written == 1200);
+    }
+
+    SECTION("Decoder hits are counted per decoder")
+    {
+        counters.add_decoder_hit("test/test1");
+        counters.add_decoder_hit("test/test1");
+        counters.add_decoder_hit("unknown");
+        const auto snapshot = counters.get_snapshot();
+        REQUIRE(snapshot.decoder_hits.size() == 1);
+        REQUIRE(snapshot.decoder_hits.at("test/test1") == 2);
+    }
+
+    SECTION("ETA is extrapolated from finished tasks")
+    {
+        flow::ProgressSnapshot snapshot;
+        snapshot.elapsed_time = 10;
+        snapshot.tasks_queued = 30;
+        snapshot.tasks_running = 0;
+        snapshot.tasks_done = 0;
+        REQUIRE(snapshot.get_eta() < 0);
+        snapshot.tasks_done = 10;
+        REQUIRE(snapshot.get_eta() == Approx(20));
+    }
+
+    SECTION("Snapshots are saved as JSON")
+    {
+        counters.add_queued_task();
+        counters.add_bytes_read(5);
+        counters.add_decoder_hit("test/test2");
+        const io::path path = "stats.json";
+        flow::save_progress(path, counters.get_snapshot());
+        const auto content
+            = io::FileByteStream(path, io::FileMode::Read).read_to_eof().str();
+        io::remove(path);
+        REQUIRE(content.find("\"queued\":1") != std::string::npos);
+        REQUIRE(content.find("\"read\":5") != std::string::npos);
+        REQUIRE(content.find("\"decoder_hits\":{\"test/test2\":1}")
+            != std::string::npos);
+    }
+}
@@ -0,0 +1,218 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/server.h"
+#include "dec/base_archive_decoder.h"
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+#include "io/memory_byte_stream.h"
+#include "test_support/catch.h"
+
+using namespace au;
+using namespace au::dec;
+
+static const io::path test_dir = "server_test";
+
+namespace
+{
+    class TestArchiveDecoder final : public BaseArchiveDecoder
+    {
+    protected:
+        bool is_recognized_impl(io::File &input_file) const override;
+
+        std::unique_ptr<ArchiveMeta> read_meta_impl(
+            const Logger &logger, io::File &input_file) const override;
+
+        std::unique_ptr<io::File> read_file_impl(
+            const Logger &logger,
+            io::File &input_file,
+            const ArchiveMeta &m,
+            const ArchiveEntry &e) const override;
+    };
+}
+
+bool TestArchiveDecoder::is_recognized_impl(io::File &input_file) const
+{
+    return input_file.path.has_extension("arc");
+}
+
+// every line of the archive is an entry named after its number
+std::unique_ptr<ArchiveMeta> TestArchiveDecoder::read_meta_impl(
+    const Logger &logger, io::File &input_file) const
+{
+    auto meta = std::make_unique<ArchiveMeta>();
+    while (input_file.stream.left())
+    {
+        auto entry = std::make_unique<PlainArchiveEntry>();
+        entry->offset = input_file.stream.pos();
+        entry->size = input_file.stream.read_line().size();
+        entry->path = std::to_string(meta->entries.size()) + ".txt";
+        meta->entries.push_back(std::move(entry));
+    }
+    return meta;
+}
+
+std::unique_ptr<io::File> TestArchiveDecoder::read_file_impl(
+    const Logger &logger,
+    io::File &input_file,
+    const ArchiveMeta &,
+    const ArchiveEntry &e) const
+{
+    const auto entry = static_cast<const PlainArchiveEntry*>(&e);
+    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
+    return std::make_unique<io::File>(entry->path, data);
+}
+
+static std::unique_ptr<Registry> create_registry()
+{
+    auto registry = Registry::create_mock();
+    registry->add_decoder(
+        "test/test-archive",
+        []() { return std::make_shared<TestArchiveDecoder>(); });
+    return registry;
+}
+
+static bstr make_request(const std::vector<std::string> &fields)
+{
+    bstr request;
+    for (const auto &field : fields)
+    {
+        if (!request.empty())
+            request += '\0';
+        request += bstr(field);
+    }
+    return request;
+}
+
+static void write_file(const io::path &path, const bstr &content)
+{
+    io::FileByteStream(path, io::FileMode::Write).write(content);
+}
+
+TEST_CASE("Server", "[flow]")
+{
+    const auto registry = create_registry();
+    io::create_directories(test_dir);
+    const auto archive_path = (test_dir / "test.arc").str();
+    write_file(archive_path, "first\nsecond\n"_b);
+    flow::Server server(*registry, "", {}, 2);
+
+    SECTION("Listing archives")
+    {
+        REQUIRE(server.handle_request(make_request({"list", archive_path}))
+            == "ok\x00" "0.txt\x00" "1.txt"_b);
+    }
+
+    SECTION("Extracting entries")
+    {
+        REQUIRE(server.handle_request(
+            make_request({"extract", archive_path, "1.txt"}))
+                == "ok\x00" "1.txt\x00" "second"_b);
+    }
+
+    SECTION("Extracting entries to files")
+    {
+        const auto output_path = (test_dir / "out" / "entry.txt").str();
+        REQUIRE(server.handle_request(
+            make_request({"extract", archive_path, "0.txt", output_path}))
+                == bstr("ok\x00"_b) + bstr(output_path));
+        io::FileByteStream output_stream(output_path, io::FileMode::Read);
+        REQUIRE(output_stream.read_to_eof() == "first"_b);
+    }
+
+    SECTION("Archives are reopened after they change")
+    {
+        server.handle_request(make_request({"list", archive_path}));
+        write_file(archive_path, "first\nsecond\nthird\n"_b);
+        REQUIRE(server.handle_request(
+            make_request({"extract", archive_path, "2.txt"}))
+                == "ok\x00" "2.txt\x00" "third"_b);
+    }
+
+    SECTION("Reporting errors")
+    {
+        const auto response = server.handle_request(
+            make_request({"extract", archive_path, "9.txt"}));
+        REQUIRE(response.substr(0, 6) == "error\x00"_b);
+        REQUIRE(server.handle_request(make_request({"bogus"}))
+            .substr(0, 6) == "error\x00"_b);
+    }
+
+    SECTION("Serving requests from a stream")
+    {
+        std::FILE *input = std::tmpfile();
+        std::FILE *output = std::tmpfile();
+        for (const auto &request : {
+            make_request({"extract", archive_path, "0.txt"}),
+            make_request({"quit"}),
+            make_request({"list", archive_path})})
+        {
+            io::MemoryByteStream stream;
+            stream.write_le<u32>(request.size());
+            stream.write(request);
+            const auto message = stream.seek(0).read_to_eof();
+            std::fwrite(message.get<u8>(), 1, message.size(), input);
+        }
+        std::rewind(input);
+        server.run(input, output);
+
+        std::rewind(output);
+        bstr response(1024);
+        response.resize(std::fread(response.get<u8>(), 1, 1024, output));
+        io::MemoryByteStream response_stream(response);
+        REQUIRE(response_stream.read_le<u32>() == 14);
+        REQUIRE(response_stream.read(14) == "ok\x00" "0.txt\x00" "first"_b);
+        REQUIRE(response_stream.read_le<u32>() == 2);
+        REQUIRE(response_stream.read(2) == "ok"_b);
+        REQUIRE(response_stream.left() == 0);
+        std::fclose(input);
+        std::fclose(output);
+    }
+
+    SECTION("Rejecting oversized requests")
+    {
+        std::FILE *input = std::tmpfile();
+        std::FILE *output = std::tmpfile();
+        for (const auto &request : {
+            bstr(1024 * 1024 + 1),
+            make_request({"list", archive_path})})
+        {
+            io::MemoryByteStream stream;
+            stream.write_le<u32>(request.size());
+            stream.write(request);
+            const auto message = stream.seek(0).read_to_eof();
+            std::fwrite(message.get<u8>(), 1, message.size(), input);
+        }
+        std::rewind(input);
+        server.run(input, output);
+
+        std::rewind(output);
+        bstr response(1024);
+        response.resize(std::fread(response.get<u8>(), 1, 1024, output));
+        io::MemoryByteStream response_stream(response);
+        const auto error_size = response_stream.read_le<u32>();
+        REQUIRE(response_stream.read(error_size).substr(0, 6)
+            == "error\x00"_b);
+        REQUIRE(response_stream.read_le<u32>() == 14);
+        REQUIRE(response_stream.read(14) == "ok\x00" "0.txt\x00" "1.txt"_b);
+        REQUIRE(response_stream.left() == 0);
+        std::fclose(input);
+        std::fclose(output);
+    }
+
+    boost::filesystem::remove_all(test_dir.str());
+}
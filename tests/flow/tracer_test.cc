@@ -0,0 +1,86 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flow/tracer.h"
+#include <thread>
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+#include "test_support/catch.h"
+
+using namespace au;
+
+TEST_CASE("Tracer", "[flow]")
+{
+    flow::Tracer tracer;
+
+    SECTION("Disabled tracer records nothing")
+    {
+        {
+            flow::TraceSpan span(tracer, "decode", "test/test", 5);
+        }
+        REQUIRE(tracer.summarize().empty());
+    }
+
+    SECTION("Spans are aggregated per decoder and phase")
+    {
+        tracer.enable();
+        {
+            flow::TraceTaskScope task_scope(1);
+            flow::TraceSpan span1(tracer, "decode", "test/test1", 5);
+            span1.set_bytes_out(10);
+            flow::TraceSpan span2(tracer, "decode", "test/test1", 7);
+            span2.set_bytes_out(20);
+        }
+        std::thread([&]()
+        {
+            flow::TraceSpan span(tracer, "decode", "test/test2", 1);
+        }).join();
+
+        const auto rows = tracer.summarize();
+        REQUIRE(rows.size() == 2);
+        const auto &row1 = rows[0].decoder_name == "test/test1"
+            ? rows[0] : rows[1];
+        const auto &row2 = rows[0].decoder_name == "test/test1"
+            ? rows[1] : rows[0];
+        REQUIRE(row1.phase == "decode");
+        REQUIRE(row1.count == 2);
+        REQUIRE(row1.bytes_in == 12);
+        REQUIRE(row1.bytes_out == 30);
+        REQUIRE(row1.p99_time >= row1.mean_time);
+        REQUIRE(row2.decoder_name == "test/test2");
+        REQUIRE(row2.count == 1);
+    }
+
+    SECTION("Spans are saved in trace event format")
+    {
+        tracer.enable();
+        {
+            flow::TraceTaskScope task_scope(3);
+            flow::TraceSpan span(tracer, "read_meta", "test/\"quoted\"", 5);
+        }
+        const io::path path = "trace.json";
+        tracer.save(path);
+        const auto content
+            = io::FileByteStream(path, io::FileMode::Read).read_to_eof().str();
+        io::remove(path);
+        REQUIRE(content.find("\"traceEvents\"") != std::string::npos);
+        REQUIRE(content.find("\"ph\":\"X\"") != std::string::npos);
+        REQUIRE(content.find("\"name\":\"read_meta test/\\\"quoted\\\"\"")
+            != std::string::npos);
+        REQUIRE(content.find("\"task\":3") != std::string::npos);
+    }
+}
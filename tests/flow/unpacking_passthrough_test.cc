@@ -0,0 +1,126 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "dec/base_archive_decoder.h"
+#include "dec/png/png_image_decoder.h"
+#include "io/memory_byte_stream.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+#include "test_support/file_support.h"
+#include "test_support/flow_support.h"
+
+using namespace au;
+using namespace au::dec;
+
+namespace
+{
+    class TestArchiveDecoder final : public BaseArchiveDecoder
+    {
+    public:
+        std::vector<std::string> get_linked_formats() const override;
+
+    protected:
+        bool is_recognized_impl(io::File &input_file) const override;
+
+        std::unique_ptr<ArchiveMeta> read_meta_impl(
+            const Logger &logger, io::File &input_file) const override;
+
+        std::unique_ptr<io::File> read_file_impl(
+            const Logger &logger,
+            io::File &input_file,
+            const ArchiveMeta &m,
+            const ArchiveEntry &e) const override;
+    };
+}
+
+std::vector<std::string> TestArchiveDecoder::get_linked_formats() const
+{
+    return {"png/png"};
+}
+
+bool TestArchiveDecoder::is_recognized_impl(io::File &input_file) const
+{
+    return input_file.path.has_extension("arc");
+}
+
+std::unique_ptr<ArchiveMeta> TestArchiveDecoder::read_meta_impl(
+    const Logger &logger, io::File &input_file) const
+{
+    auto meta = std::make_unique<ArchiveMeta>();
+    auto entry = std::make_unique<PlainArchiveEntry>();
+    entry->path = "image.dat";
+    entry->offset = 4;
+    entry->size = input_file.stream.size() - 4;
+    meta->entries.push_back(std::move(entry));
+    return meta;
+}
+
+std::unique_ptr<io::File> TestArchiveDecoder::read_file_impl(
+    const Logger &logger,
+    io::File &input_file,
+    const ArchiveMeta &,
+    const ArchiveEntry &e) const
+{
+    const auto entry = static_cast<const PlainArchiveEntry*>(&e);
+    const auto data = input_file.stream.seek(entry->offset).read(entry->size);
+    return std::make_unique<io::File>(entry->path, data);
+}
+
+static std::unique_ptr<Registry> create_registry()
+{
+    auto registry = Registry::create_mock();
+    registry->add_decoder(
+        "test/test-archive",
+        []() { return std::make_shared<TestArchiveDecoder>(); });
+    registry->add_decoder(
+        "png/png",
+        []() { return std::make_shared<png::PngImageDecoder>(); });
+    return registry;
+}
+
+TEST_CASE("Unpacking nested files in standard formats", "[flow]")
+{
+    const auto registry = create_registry();
+    const auto png_file = tests::file_from_path(
+        "tests/dec/png/files/usagi_opaque.png");
+    const auto png_content = png_file->stream.seek(0).read_to_eof();
+    io::File dummy_file("archive.arc", "ARC\x00"_b + png_content);
+
+    SECTION("Converting by default")
+    {
+        const auto saved_files
+            = tests::flow_unpack(*registry, true, dummy_file);
+        REQUIRE(saved_files.size() == 1);
+        tests::compare_paths(saved_files[0]->path, "archive.arc/image.png");
+        REQUIRE(saved_files[0]->stream.read_to_eof() != png_content);
+    }
+
+    SECTION("Passing through")
+    {
+        const auto saved_files = tests::flow_unpack(
+            *registry,
+            true,
+            dummy_file,
+            [](flow::ParallelUnpackerContext &context)
+            {
+                context.passthrough_standard_formats = true;
+            });
+        REQUIRE(saved_files.size() == 1);
+        tests::compare_paths(saved_files[0]->path, "archive.arc/image.png");
+        REQUIRE(saved_files[0]->stream.read_to_eof() == png_content);
+    }
+}
@@ -0,0 +1,69 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "io/assets.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "algo/range.h"
+#include "test_support/catch.h"
+
+using namespace au;
+
+TEST_CASE("Reading assets", "[io]")
+{
+    SECTION("Files are read once")
+    {
+        const auto data1 = io::read_asset("xp3/karakara.dat");
+        const auto data2 = io::read_asset("xp3/karakara.dat");
+        REQUIRE(data1->size() == 4096);
+        REQUIRE(data1 == data2);
+    }
+
+    SECTION("Missing files")
+    {
+        REQUIRE_THROWS(io::read_asset("xp3/nonexistent.dat"));
+    }
+
+    SECTION("Derived values are created once")
+    {
+        std::atomic<int> calls(0);
+        std::vector<std::thread> threads;
+        std::vector<std::shared_ptr<const int>> results(4);
+        for (const auto i : algo::range(results.size()))
+        {
+            threads.push_back(std::thread([&, i]()
+            {
+                results[i] = io::get_derived_asset<int>(
+                    "test",
+                    [&]()
+                    {
+                        ++calls;
+                        return 5;
+                    });
+            }));
+        }
+        for (auto &thread : threads)
+            thread.join();
+        REQUIRE(calls == 1);
+        for (const auto &result : results)
+        {
+            REQUIRE(result == results[0]);
+            REQUIRE(*result == 5);
+        }
+    }
+}
@@ -62,6 +62,8 @@ TEST_CASE("File", "[io]")
         test_guessing_extension("\x89PNG"_b, "png");
         test_guessing_extension("BM"_b, "bmp");
         test_guessing_extension("RIFF"_b, "wav");
+        test_guessing_extension("RIFF\x00\x00\x00\x00WAVE"_b, "wav");
+        test_guessing_extension("RIFF\x00\x00\x00\x00WEBP"_b, "webp");
         test_guessing_extension("OggS"_b, "ogg");
         test_guessing_extension("\xFF\xD8\xFF"_b, "jpeg");
     }
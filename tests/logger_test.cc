@@ -0,0 +1,196 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "logger.h"
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "algo/format.h"
+#include "algo/range.h"
+#include "algo/str.h"
+#include "test_support/catch.h"
+
+using namespace au;
+
+namespace
+{
+    class CoutCapture final
+    {
+    public:
+        CoutCapture(const Logger &logger) :
+            logger(logger), old_buffer(std::cout.rdbuf())
+        {
+            logger.flush();
+            std::cout.rdbuf(stream.rdbuf());
+        }
+
+        ~CoutCapture()
+        {
+            std::cout.rdbuf(old_buffer);
+        }
+
+        std::string get()
+        {
+            logger.flush();
+            return stream.str();
+        }
+
+    private:
+        const Logger &logger;
+        std::streambuf *old_buffer;
+        std::stringstream stream;
+    };
+}
+
+TEST_CASE("Logger", "[core]")
+{
+    Logger logger;
+    logger.disable_colors();
+
+    SECTION("Formatting")
+    {
+        CoutCapture capture(logger);
+        logger.info("%d %s\n", 5, "test");
+        logger.info(std::string("100%%\n"));
+        REQUIRE(capture.get() == "5 test\n100%\n");
+    }
+
+    SECTION("Prefixes")
+    {
+        CoutCapture capture(logger);
+        logger.set_prefix("> ");
+        logger.info("line 1\nline 2\n");
+        REQUIRE(capture.get() == "> line 1\n> line 2\n");
+    }
+
+    SECTION("Muting")
+    {
+        CoutCapture capture(logger);
+        logger.mute(Logger::MessageType::Info);
+        logger.info("muted\n");
+        logger.success("unmuted\n");
+        REQUIRE(capture.get() == "unmuted\n");
+    }
+
+    SECTION("Messages from many threads")
+    {
+        static const auto thread_count = 4;
+        static const auto message_count = 1000;
+        CoutCapture capture(logger);
+        std::vector<std::thread> threads;
+        for (const auto i : algo::range(thread_count))
+        {
+            threads.push_back(std::thread([&, i]()
+            {
+                Logger thread_logger(logger);
+                thread_logger.set_prefix(algo::format("%d:", i));
+                for (const auto j : algo::range(message_count))
+                    thread_logger.info("%d\n%d\n", j, j);
+            }));
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        const auto lines = algo::split(capture.get(), '\n', false);
+        REQUIRE(lines.size() == thread_count * message_count * 2);
+        int last_message[thread_count];
+        for (const auto i : algo::range(thread_count))
+            last_message[i] = -1;
+        for (const auto i : algo::range(0, lines.size(), 2))
+        {
+            // lines of a single message are never split
+            REQUIRE(lines[i] == lines[i + 1]);
+            const auto parts = algo::split(lines[i], ':', false);
+            const auto thread_number = std::stoi(parts.at(0));
+            const auto message_number = std::stoi(parts.at(1));
+            REQUIRE(message_number == last_message[thread_number] + 1);
+            last_message[thread_number] = message_number;
+        }
+    }
+
+    SECTION("Messages are written in the order they were logged")
+    {
+        static const auto message_count = 2000;
+        CoutCapture capture(logger);
+        std::atomic<int> turn(0);
+        std::vector<std::thread> threads;
+        for (const auto i : algo::range(2))
+        {
+            threads.push_back(std::thread([&, i]()
+            {
+                Logger thread_logger(logger);
+                for (const auto j : algo::range(i, message_count, 2))
+                {
+                    while (turn != j)
+                        std::this_thread::yield();
+                    thread_logger.info("%d\n", j);
+                    turn = j + 1;
+                }
+            }));
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        const auto lines = algo::split(capture.get(), '\n', false);
+        REQUIRE(lines.size() == message_count);
+        for (const auto i : algo::range(message_count))
+            REQUIRE(std::stoi(lines[i]) == static_cast<int>(i));
+    }
+
+    SECTION("Messages of a group are written together")
+    {
+        static const auto thread_count = 4;
+        static const auto message_count = 500;
+        CoutCapture capture(logger);
+        std::vector<std::thread> threads;
+        for (const auto i : algo::range(thread_count))
+        {
+            threads.push_back(std::thread([&, i]()
+            {
+                Logger thread_logger(logger);
+                thread_logger.set_prefix(algo::format("%d:", i));
+                Logger::GroupScope group;
+                for (const auto j : algo::range(message_count))
+                    thread_logger.info("%d\n", j);
+            }));
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        const auto lines = algo::split(capture.get(), '\n', false);
+        REQUIRE(lines.size() == thread_count * message_count);
+        for (const auto i : algo::range(0, lines.size(), message_count))
+        {
+            const auto thread_number = algo::split(lines[i], ':', false)[0];
+            for (const auto j : algo::range(message_count))
+            {
+                REQUIRE(lines[i + j] == algo::format(
+                    "%s:%d", thread_number.c_str(), static_cast<int>(j)));
+            }
+        }
+    }
+
+    SECTION("Flushing releases the messages of an open group")
+    {
+        CoutCapture capture(logger);
+        Logger::GroupScope group;
+        logger.info("held back\n");
+        REQUIRE(capture.get() == "held back\n");
+    }
+}
@@ -0,0 +1,129 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "memory_accounting.h"
+#include <thread>
+#include "res/image.h"
+#include "test_support/catch.h"
+#include "types.h"
+
+using namespace au;
+
+#if AU_MEMORY_ACCOUNTING
+
+TEST_CASE("Memory accounting", "[core]")
+{
+    memory::enable_accounting();
+    REQUIRE(memory::accounting_enabled());
+    const auto account = memory::create_account(0, "test");
+    REQUIRE(account);
+
+    SECTION("Buffers are charged to the current account")
+    {
+        {
+            memory::AccountScope scope(account);
+            const bstr buffer(1000);
+            REQUIRE(account->current_bytes == 1000);
+        }
+        REQUIRE(account->current_bytes == 0);
+        REQUIRE(account->peak_bytes == 1000);
+    }
+
+    SECTION("Buffers outside of any scope are not charged")
+    {
+        const bstr buffer(1000);
+        REQUIRE(account->current_bytes == 0);
+    }
+
+    SECTION("Moved buffers stay charged to their account")
+    {
+        std::unique_ptr<bstr> buffer;
+        {
+            memory::AccountScope scope(account);
+            bstr tmp(1000);
+            buffer.reset(new bstr());
+            *buffer = std::move(tmp);
+        }
+        REQUIRE(account->current_bytes == 1000);
+        std::thread([&]() { buffer.reset(); }).join();
+        REQUIRE(account->current_bytes == 0);
+    }
+
+    SECTION("Copies are charged to the copying account")
+    {
+        const auto other_account = memory::create_account(1, "other");
+        memory::AccountScope scope(account);
+        const bstr buffer(1000);
+        {
+            memory::AccountScope other_scope(other_account);
+            const bstr copy(buffer);
+            REQUIRE(other_account->current_bytes == 1000);
+        }
+        REQUIRE(account->current_bytes == 1000);
+        REQUIRE(other_account->current_bytes == 0);
+    }
+
+    SECTION("Image contents are charged")
+    {
+        memory::AccountScope scope(account);
+        res::Image image(10, 10);
+        REQUIRE(account->current_bytes == 10 * 10 * 4);
+        image.crop(20, 10);
+        REQUIRE(account->current_bytes == 20 * 10 * 4);
+    }
+
+    SECTION("Top accounts are sorted by peak usage")
+    {
+        const auto big_account = memory::create_account(2, "big");
+        {
+            memory::AccountScope scope(big_account);
+            const bstr buffer(1024 * 1024 * 100);
+        }
+        const auto accounts = memory::get_top_accounts(1);
+        REQUIRE(accounts.size() == 1);
+        REQUIRE(accounts[0].task_id == 2);
+        REQUIRE(accounts[0].peak_bytes == 1024 * 1024 * 100);
+    }
+
+    SECTION("Closed accounts outlive their buffers and stay in the report")
+    {
+        const auto closed_account = memory::create_account(3, "closed");
+        std::unique_ptr<bstr> buffer;
+        {
+            memory::AccountScope scope(closed_account);
+            buffer.reset(new bstr(1024 * 1024 * 200));
+        }
+        memory::close_account(closed_account);
+        buffer->resize(1024 * 1024 * 300);
+        buffer.reset();
+        const auto accounts = memory::get_top_accounts(1);
+        REQUIRE(accounts.size() == 1);
+        REQUIRE(accounts[0].task_id == 3);
+        REQUIRE(accounts[0].current_bytes == 1024 * 1024 * 200);
+    }
+}
+
+#else
+
+TEST_CASE("Memory accounting", "[core]")
+{
+    memory::enable_accounting();
+    REQUIRE(!memory::accounting_enabled());
+    REQUIRE(!memory::create_account(0, "test"));
+}
+
+#endif
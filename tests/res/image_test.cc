@@ -16,7 +16,12 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "res/image.h"
+#include <thread>
 #include "algo/range.h"
+#include "err.h"
+#include "io/memory_byte_stream.h"
+#include "res/image_view.h"
+#include "test_support/allocation_support.h"
 #include "test_support/catch.h"
 
 using namespace au;
@@ -269,3 +274,365 @@ TEST_CASE("Image offsetting", "[res]")
         }
     }
 }
+
+TEST_CASE("Image offsetting by mixed signs", "[res]")
+{
+    auto image = create_test_image(5, 5);
+    image.offset(2, -3);
+    REQUIRE(image.width() == 7);
+    REQUIRE(image.height() == 2);
+    for (const auto x : algo::range(image.width()))
+    for (const auto y : algo::range(image.height()))
+    {
+        if (x < 2)
+        {
+            REQUIRE(image.at(x, y).r == 0);
+            REQUIRE(image.at(x, y).a == 0);
+        }
+        else
+        {
+            REQUIRE(image.at(x, y).r == x - 2);
+            REQUIRE(image.at(x, y).g == y + 3);
+        }
+    }
+    REQUIRE_THROWS(image.offset(-7, 0));
+}
+
+TEST_CASE("Image copying and moving", "[res]")
+{
+    SECTION("Copying")
+    {
+        const auto image = create_test_image(5, 6);
+        const tests::AllocationCounter counter(5 * 6 * sizeof(res::Pixel));
+        const auto copy = image;
+        REQUIRE(counter.get_count() == 1);
+        REQUIRE(copy.width() == 5);
+        REQUIRE(copy.height() == 6);
+        for (const auto x : algo::range(copy.width()))
+        for (const auto y : algo::range(copy.height()))
+        {
+            REQUIRE(copy.at(x, y).r == x);
+            REQUIRE(copy.at(x, y).g == y);
+        }
+    }
+
+    SECTION("Moving")
+    {
+        auto image = create_test_image(5, 6);
+        auto other_image = create_test_image(5, 6);
+        res::Image assigned(1, 1);
+        const tests::AllocationCounter counter(5 * 6 * sizeof(res::Pixel));
+        const auto moved = std::move(image);
+        assigned = std::move(other_image);
+        REQUIRE(counter.get_count() == 0);
+        REQUIRE(moved.width() == 5);
+        REQUIRE(moved.height() == 6);
+        REQUIRE(assigned.width() == 5);
+        REQUIRE(assigned.height() == 6);
+        REQUIRE(image.width() == 0);
+        REQUIRE(image.height() == 0);
+        for (const auto x : algo::range(moved.width()))
+        for (const auto y : algo::range(moved.height()))
+        {
+            REQUIRE(moved.at(x, y).r == x);
+            REQUIRE(moved.at(x, y).g == y);
+            REQUIRE(assigned.at(x, y).r == x);
+            REQUIRE(assigned.at(x, y).g == y);
+        }
+    }
+}
+
+static void do_test_crop(const size_t new_width, const size_t new_height)
+{
+    const auto orig_width = 5;
+    const auto orig_height = 5;
+    auto image = create_test_image(orig_width, orig_height);
+    image.crop(new_width, new_height);
+    REQUIRE(image.width() == new_width);
+    REQUIRE(image.height() == new_height);
+    for (const auto x : algo::range(image.width()))
+    for (const auto y : algo::range(image.height()))
+    {
+        if (x < orig_width && y < orig_height)
+        {
+            REQUIRE(image.at(x, y).r == x);
+            REQUIRE(image.at(x, y).g == y);
+        }
+        else
+        {
+            REQUIRE(image.at(x, y).r == 0);
+            REQUIRE(image.at(x, y).g == 0);
+            REQUIRE(image.at(x, y).a == 0);
+        }
+    }
+}
+
+TEST_CASE("Image cropping along one axis only", "[res]")
+{
+    SECTION("Narrower and taller")
+    {
+        do_test_crop(3, 7);
+    }
+
+    SECTION("Wider and shorter")
+    {
+        do_test_crop(7, 3);
+    }
+
+    SECTION("Same width")
+    {
+        do_test_crop(5, 3);
+    }
+}
+
+TEST_CASE("Image from palette indices", "[res]")
+{
+    res::Palette palette(3);
+    palette[0] = {1, 2, 3, 4};
+    palette[1] = {5, 6, 7, 8};
+    palette[2] = {9, 10, 11, 12};
+    bstr indices(40);
+    for (const auto i : algo::range(indices.size()))
+        indices[i] = i % 5;
+
+    const auto check = [&](const res::Image &image)
+    {
+        REQUIRE(image.get_source_palette());
+        for (const auto i : algo::range(indices.size()))
+        {
+            const auto &actual = image.at(i % 8, i / 8);
+            if (indices[i] < palette.size())
+            {
+                REQUIRE(actual == palette[indices[i]]);
+            }
+            else
+            {
+                // indices past the end of the palette become transparent
+                const res::Pixel expected
+                    = {indices[i], indices[i], indices[i], 0};
+                REQUIRE(actual == expected);
+            }
+        }
+    };
+
+    SECTION("From bytes")
+    {
+        check(res::Image(8, 5, indices, palette));
+    }
+
+    SECTION("From a stream")
+    {
+        io::MemoryByteStream stream(indices);
+        check(res::Image(8, 5, stream, palette));
+    }
+
+    SECTION("Same as applying the palette afterwards")
+    {
+        const res::Image expected(8, 5, indices, palette);
+        res::Image actual(8, 5, indices, res::PixelFormat::Gray8);
+        actual.apply_palette(palette);
+        REQUIRE(actual.get_source_palette());
+        for (const auto y : algo::range(5))
+        for (const auto x : algo::range(8))
+            REQUIRE(actual.at(x, y) == expected.at(x, y));
+    }
+
+    SECTION("Not enough indices")
+    {
+        REQUIRE_THROWS_AS(
+            res::Image(8, 6, indices, palette), err::BadDataSizeError);
+    }
+}
+
+TEST_CASE("Images kept as palette indices", "[res]")
+{
+    // Big enough for the pixels to stand out from the other allocations.
+    const size_t width = 64;
+    const size_t height = 32;
+    const auto pixels_size = width * height * sizeof(res::Pixel);
+    res::Palette palette(256);
+    for (const auto i : algo::range(palette.size()))
+        palette[i] = {static_cast<u8>(i), 2, 3, static_cast<u8>(~i)};
+    bstr indices(width * height);
+    for (const auto i : algo::range(indices.size()))
+        indices[i] = i * 7;
+
+    const auto check = [&](const res::Image &image)
+    {
+        for (const auto y : algo::range(height))
+        for (const auto x : algo::range(width))
+            REQUIRE(image.at(x, y) == palette[indices[y * width + x]]);
+    };
+
+    SECTION("Expanded only when the pixels are accessed")
+    {
+        const tests::AllocationCounter counter(pixels_size);
+        const res::Image image(width, height, indices, palette);
+        const res::ImageView view(image);
+        std::vector<res::Pixel> scratch(width);
+        for (const auto y : algo::range(height))
+        {
+            const auto row_ptr = view.get_row(y, scratch.data());
+            for (const auto x : algo::range(width))
+                REQUIRE(row_ptr[x] == palette[indices[y * width + x]]);
+        }
+        REQUIRE(counter.get_count() == 0);
+        check(image);
+        REQUIRE(counter.get_count() == 1);
+        REQUIRE(view.get_row(1, scratch.data()) == &image.at(0, 1));
+    }
+
+    SECTION("Copied and moved")
+    {
+        res::Image image(width, height, indices, palette);
+        const auto copy = image;
+        check(copy);
+        res::Image other_image(width, height, indices, palette);
+        res::Image assigned(1, 1);
+        const tests::AllocationCounter counter(pixels_size);
+        const auto moved = std::move(image);
+        assigned = std::move(other_image);
+        REQUIRE(counter.get_count() == 0);
+        check(moved);
+        check(assigned);
+    }
+
+    SECTION("Modified after being expanded")
+    {
+        res::Image image(width, height, indices, palette);
+        image.invert();
+        for (const auto y : algo::range(height))
+        for (const auto x : algo::range(width))
+        {
+            auto expected = palette[indices[y * width + x]];
+            expected.r ^= 0xFF;
+            expected.g ^= 0xFF;
+            expected.b ^= 0xFF;
+            REQUIRE(image.at(x, y) == expected);
+        }
+    }
+
+    SECTION("Expanded by several threads at once")
+    {
+        const res::Image image(width, height, indices, palette);
+        std::vector<const res::Pixel*> pixels(4);
+        std::vector<std::thread> threads;
+        for (const auto i : algo::range(pixels.size()))
+        {
+            threads.push_back(std::thread([&, i]()
+            {
+                pixels[i] = image.begin();
+            }));
+        }
+        for (auto &thread : threads)
+            thread.join();
+        for (const auto i : algo::range(pixels.size()))
+            REQUIRE(pixels[i] == image.begin());
+        check(image);
+    }
+}
+
+// Odd widths leave pixels after the vectorized part of each row.
+static res::Image create_noise_image(const size_t width, const size_t height)
+{
+    res::Image image(width, height);
+    u32 seed = width * 31 + height;
+    for (auto &c : image)
+    {
+        for (const auto i : algo::range(4))
+        {
+            seed = seed * 1103515245 + 12345;
+            c[i] = seed >> 16;
+        }
+        if (c.a < 0x40)
+            c.a = 0;
+    }
+    return image;
+}
+
+static void compare_images(const res::Image &actual, const res::Image &expected)
+{
+    REQUIRE(actual.width() == expected.width());
+    REQUIRE(actual.height() == expected.height());
+    for (const auto y : algo::range(expected.height()))
+    for (const auto x : algo::range(expected.width()))
+    {
+        INFO("Pixel " << x << "x" << y);
+        REQUIRE(actual.at(x, y) == expected.at(x, y));
+    }
+}
+
+TEST_CASE("Image row transforms", "[res]")
+{
+    const auto width = 13;
+    const auto height = 7;
+    auto image = create_noise_image(width, height);
+    const auto original = image;
+    const auto other = create_noise_image(width + 2, height + 1);
+    auto expected = original;
+
+    SECTION("Flipping vertically")
+    {
+        for (const auto y : algo::range(height))
+        for (const auto x : algo::range(width))
+            expected.at(x, y) = original.at(x, height - 1 - y);
+        image.flip_vertically();
+    }
+
+    SECTION("Flipping horizontally")
+    {
+        for (const auto y : algo::range(height))
+        for (const auto x : algo::range(width))
+            expected.at(x, y) = original.at(width - 1 - x, y);
+        image.flip_horizontally();
+    }
+
+    SECTION("Inverting")
+    {
+        for (auto &c : expected)
+        {
+            c.r ^= 0xFF;
+            c.g ^= 0xFF;
+            c.b ^= 0xFF;
+        }
+        image.invert();
+    }
+
+    SECTION("Applying mask")
+    {
+        auto mask = other;
+        mask.crop(width, height);
+        for (const auto y : algo::range(height))
+        for (const auto x : algo::range(width))
+            expected.at(x, y).a = mask.at(x, y).r;
+        image.apply_mask(mask);
+    }
+
+    SECTION("Overlaying non-transparent pixels")
+    {
+        for (const auto y : algo::range(1, height))
+        for (const auto x : algo::range(2, width))
+        {
+            const auto &c = other.at(x - 2, y - 1);
+            if (c.a)
+                expected.at(x, y) = c;
+        }
+        image.overlay(
+            other, 2, 1, res::Image::OverlayKind::OverwriteNonTransparent);
+    }
+
+    SECTION("Overlaying by adding")
+    {
+        for (const auto y : algo::range(height))
+        for (const auto x : algo::range(width))
+        {
+            const auto &c = other.at(x + 1, y + 1);
+            expected.at(x, y).r += c.r;
+            expected.at(x, y).g += c.g;
+            expected.at(x, y).b += c.b;
+        }
+        image.overlay(other, -1, -1, res::Image::OverlayKind::AddSimple);
+    }
+
+    compare_images(image, expected);
+}
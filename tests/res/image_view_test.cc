@@ -0,0 +1,141 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "res/image_view.h"
+#include "algo/range.h"
+#include "err.h"
+#include "test_support/catch.h"
+#include "test_support/image_support.h"
+
+using namespace au;
+
+static res::Image create_test_image(const size_t width, const size_t height)
+{
+    res::Image image(width, height);
+    for (const auto y : algo::range(height))
+    for (const auto x : algo::range(width))
+    {
+        image.at(x, y).b = x;
+        image.at(x, y).g = y;
+        image.at(x, y).r = x * y;
+        image.at(x, y).a = 0xFF;
+    }
+    return image;
+}
+
+static res::Image crop(
+    const res::Image &image,
+    const size_t x,
+    const size_t y,
+    const size_t width,
+    const size_t height)
+{
+    res::Image output(width, height);
+    for (const auto y2 : algo::range(height))
+    for (const auto x2 : algo::range(width))
+        output.at(x2, y2) = image.at(x + x2, y + y2);
+    return output;
+}
+
+TEST_CASE("Image views", "[res]")
+{
+    const auto image = create_test_image(12, 9);
+
+    SECTION("Unchanged")
+    {
+        const res::ImageView view(image);
+        std::vector<res::Pixel> scratch(view.width());
+        REQUIRE(view.get_row(3, scratch.data()) == &image.at(0, 3));
+        tests::compare_images(res::Image(view), image);
+    }
+
+    SECTION("Cropping")
+    {
+        res::ImageView view(image);
+        view.crop(2, 3, 7, 4).crop(1, 1, 5, 2);
+        tests::compare_images(res::Image(view), crop(image, 3, 4, 5, 2));
+    }
+
+    SECTION("Flipping")
+    {
+        auto expected_image = image;
+        expected_image.flip_vertically();
+        tests::compare_images(
+            res::Image(res::ImageView(image).flip_vertically()),
+            expected_image);
+    }
+
+    SECTION("Cropping flipped view")
+    {
+        auto expected_image = image;
+        expected_image.flip_vertically();
+        tests::compare_images(
+            res::Image(res::ImageView(image).flip_vertically().crop(
+                2, 1, 6, 5)),
+            crop(expected_image, 2, 1, 6, 5));
+    }
+
+    SECTION("Masking")
+    {
+        const auto mask = create_test_image(12, 9);
+        auto expected_image = image;
+        expected_image.apply_mask(mask);
+
+        res::ImageView view(image);
+        view.apply_mask(mask);
+        std::vector<res::Pixel> scratch(view.width());
+        REQUIRE(view.get_row(3, scratch.data()) == scratch.data());
+        tests::compare_images(res::Image(view), expected_image);
+    }
+
+    SECTION("Chaining all transforms")
+    {
+        const auto mask = create_test_image(12, 9);
+        auto expected_image = image;
+        expected_image.apply_mask(mask);
+        expected_image = crop(expected_image, 1, 2, 10, 6);
+        expected_image.flip_vertically();
+        expected_image = crop(expected_image, 3, 0, 4, 4);
+
+        res::ImageView view(image);
+        view.crop(1, 2, 10, 6).flip_vertically().apply_mask(mask);
+        view.crop(3, 0, 4, 4);
+        tests::compare_images(res::Image(view), expected_image);
+    }
+
+    SECTION("Cropping outside the view")
+    {
+        res::ImageView view(image);
+        REQUIRE_THROWS_AS(view.crop(5, 0, 8, 9), err::BadDataSizeError);
+        REQUIRE_THROWS_AS(view.crop(0, 5, 12, 5), err::BadDataSizeError);
+    }
+
+    SECTION("Mask of different size")
+    {
+        res::ImageView view(image);
+        REQUIRE_THROWS(view.apply_mask(create_test_image(12, 8)));
+    }
+
+    SECTION("Keeping source palette")
+    {
+        const res::Palette palette(4);
+        const res::Image indexed_image(4, 1, "\x00\x01\x02\x03"_b, palette);
+        const res::ImageView view(indexed_image);
+        const res::Image output_image(view);
+        REQUIRE(output_image.get_source_palette());
+    }
+}
@@ -49,6 +49,67 @@ static void test_read(
     compare_pixels(actual_pixel, expected_pixel);
 }
 
+// Compares every kernel against the scalar one, with pixel counts that leave
+// tails of different sizes after the vectorized part.
+static void test_kernels(const res::PixelFormat fmt)
+{
+    const auto bpp = res::pixel_format_to_bpp(fmt);
+    for (const auto pixel_count : {0, 1, 5, 9, 17, 31, 67, 300})
+    {
+        bstr input(pixel_count * bpp);
+        u32 seed = 0x12345678;
+        for (auto &c : input)
+        {
+            seed = seed * 1103515245 + 12345;
+            c = seed >> 16;
+        }
+
+        std::vector<res::Pixel> expected_pixels(pixel_count);
+        res::read_pixels(
+            input.get<u8>(),
+            expected_pixels,
+            fmt,
+            res::PixelKernel::Scalar);
+        for (const auto kernel : res::get_supported_pixel_kernels())
+        {
+            INFO(algo::format(
+                "Format %d, kernel %d, %d pixels",
+                static_cast<int>(fmt),
+                static_cast<int>(kernel),
+                pixel_count));
+            std::vector<res::Pixel> actual_pixels(pixel_count);
+            res::read_pixels(input.get<u8>(), actual_pixels, fmt, kernel);
+            for (const auto i : algo::range(pixel_count))
+                compare_pixels(actual_pixels[i], expected_pixels[i]);
+        }
+    }
+}
+
+static void test_indexed_kernels()
+{
+    std::vector<res::Pixel> colors(256);
+    for (const auto i : algo::range(colors.size()))
+        colors[i] = {static_cast<u8>(i), static_cast<u8>(~i), 0x12, 0x34};
+    for (const auto pixel_count : {0, 1, 15, 17, 35, 300})
+    {
+        bstr input(pixel_count);
+        for (const auto i : algo::range(pixel_count))
+            input[i] = i * 37;
+        for (const auto kernel : res::get_supported_pixel_kernels())
+        {
+            INFO(algo::format(
+                "Kernel %d, %d pixels",
+                static_cast<int>(kernel),
+                pixel_count));
+            std::vector<res::Pixel> actual_pixels(pixel_count);
+            res::read_indexed_pixels(
+                input.get<u8>(), actual_pixels, colors.data(), kernel);
+            for (const auto i : algo::range(pixel_count))
+                compare_pixels(actual_pixels[i], colors[input[i]]);
+        }
+    }
+}
+
 TEST_CASE("PixelFormat", "[res]")
 {
     SECTION("Pixel format count")
@@ -126,4 +187,20 @@ TEST_CASE("PixelFormat", "[res]")
         test_read(
             0b11111110000000010000001000000011, PF::RGBnA8888, {1, 2, 3, 1});
     }
+
+    SECTION("Reading with each kernel")
+    {
+        const auto kernels = res::get_supported_pixel_kernels();
+        REQUIRE(kernels.front() == res::PixelKernel::Scalar);
+        for (const auto i : algo::range(
+            static_cast<int>(res::PixelFormat::Count)))
+        {
+            test_kernels(static_cast<res::PixelFormat>(i));
+        }
+    }
+
+    SECTION("Reading indices with each kernel")
+    {
+        test_indexed_kernels();
+    }
 }
@@ -0,0 +1,90 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "test_support/allocation_support.h"
+#include <cstdlib>
+#include <new>
+
+using namespace au;
+using namespace au::tests;
+
+// replacing the global allocation functions is the only way to observe
+// copies made deep inside the code under test; counting is limited to the
+// threads that asked for it
+static thread_local AllocationCounter *current_counter = nullptr;
+
+static void *allocate(const size_t size)
+{
+    AllocationCounter::register_allocation(size);
+    const auto ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+AllocationCounter::AllocationCounter(const size_t min_size)
+    : previous(current_counter), min_size(min_size), count(0)
+{
+    current_counter = this;
+}
+
+AllocationCounter::~AllocationCounter()
+{
+    current_counter = previous;
+}
+
+size_t AllocationCounter::get_count() const
+{
+    return count;
+}
+
+void AllocationCounter::register_allocation(const size_t size)
+{
+    for (auto counter = current_counter; counter; counter = counter->previous)
+        if (size >= counter->min_size)
+            counter->count++;
+}
+
+void *operator new(const size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new[](const size_t size)
+{
+    return allocate(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const size_t) noexcept
+{
+    std::free(ptr);
+}
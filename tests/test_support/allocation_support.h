@@ -0,0 +1,45 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+
+namespace au {
+namespace tests {
+
+    // Counts allocations of at least the given size made by the current
+    // thread for as long as the counter exists, for checking that large
+    // buffers such as pixel data are moved rather than copied.
+    class AllocationCounter final
+    {
+    public:
+        AllocationCounter(const size_t min_size);
+        ~AllocationCounter();
+
+        size_t get_count() const;
+
+        // Called by the replaced global allocation functions.
+        static void register_allocation(const size_t size);
+
+    private:
+        AllocationCounter *const previous;
+        const size_t min_size;
+        size_t count;
+    };
+
+} }
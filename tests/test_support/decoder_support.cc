@@ -16,10 +16,69 @@
 // along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
 
 #include "test_support/decoder_support.h"
+#include <cstring>
+#include "algo/range.h"
 #include "test_support/catch.h"
 
 using namespace au;
 
+namespace
+{
+    class CollectingBandSink final : public res::IImageBandSink
+    {
+    public:
+        void begin(
+            const size_t width,
+            const size_t height,
+            const bool is_opaque) override;
+        void write_band(const res::ImageView &band) override;
+        void end() override;
+
+        std::unique_ptr<res::Image> image;
+        bool is_opaque = false;
+        size_t next_row = 0;
+        bool ended = false;
+    };
+}
+
+void CollectingBandSink::begin(
+    const size_t width, const size_t height, const bool is_opaque)
+{
+    REQUIRE(!image);
+    image = std::make_unique<res::Image>(width, height);
+    this->is_opaque = is_opaque;
+}
+
+void CollectingBandSink::write_band(const res::ImageView &band)
+{
+    REQUIRE(image);
+    REQUIRE(!ended);
+    REQUIRE(band.width() == image->width());
+    REQUIRE(next_row + band.height() <= image->height());
+    std::vector<res::Pixel> scratch(band.width());
+    bool opaque_pixels = true;
+    for (const auto y : algo::range(band.height()))
+    {
+        const auto row_ptr = band.get_row(y, scratch.data());
+        for (const auto x : algo::range(band.width()))
+            opaque_pixels &= row_ptr[x].a == 0xFF;
+        std::memcpy(
+            &image->at(0, next_row + y),
+            row_ptr,
+            band.width() * sizeof(res::Pixel));
+    }
+    // decoders must not declare images with alpha opaque
+    REQUIRE((opaque_pixels || !is_opaque));
+    next_row += band.height();
+}
+
+void CollectingBandSink::end()
+{
+    REQUIRE(image);
+    REQUIRE(next_row == image->height());
+    ended = true;
+}
+
 // This is to test whether ImageDecoder::decode, IDecoder::is_recognized etc.
 // take care of stream position themselves rather than relying on the callers.
 static void navigate_to_random_place(io::BaseByteStream &input_stream)
@@ -78,3 +137,15 @@ res::Audio tests::decode(
     dummy_logger.mute();
     return decoder.decode(dummy_logger, input_file);
 }
+
+res::Image tests::decode_bands(
+    const dec::BaseImageDecoder &decoder, io::File &input_file)
+{
+    navigate_to_random_place(input_file.stream);
+    Logger dummy_logger;
+    dummy_logger.mute();
+    CollectingBandSink sink;
+    decoder.decode_bands(dummy_logger, input_file, sink);
+    REQUIRE(sink.ended);
+    return std::move(*sink.image);
+}
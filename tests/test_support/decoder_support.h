@@ -37,4 +37,8 @@ namespace tests {
     res::Audio decode(
         const au::dec::BaseAudioDecoder &decoder, io::File &input_file);
 
+    // Decodes the image through decode_bands() and joins the bands.
+    res::Image decode_bands(
+        const au::dec::BaseImageDecoder &decoder, io::File &input_file);
+
 } }
@@ -17,7 +17,9 @@
 
 #pragma once
 
+#include <functional>
 #include "dec/registry.h"
+#include "flow/parallel_unpacker.h"
 #include "io/file.h"
 
 namespace au {
@@ -26,6 +28,8 @@ namespace tests {
     std::vector<std::shared_ptr<io::File>> flow_unpack(
         const dec::Registry &registry,
         const bool enable_ensted_decoding,
-        io::File &input_file);
+        io::File &input_file,
+        const std::function<void(flow::ParallelUnpackerContext &)>
+            configure_context = nullptr);
 
 } }
@@ -0,0 +1,264 @@
+// Copyright (C) 2016 by rr-
+//
+// This file is part of arc_unpacker.
+//
+// arc_unpacker is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// arc_unpacker is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with arc_unpacker. If not, see <http://www.gnu.org/licenses/>.
+
+#include "virtual_file_system.h"
+#include "io/file_byte_stream.h"
+#include "io/file_system.h"
+#include "test_support/catch.h"
+#include "test_support/common.h"
+
+using namespace au;
+
+namespace
+{
+    class TestResolver final : public IVirtualFileResolver
+    {
+    public:
+        TestResolver(const bstr &content = "resolved"_b);
+
+        io::path find(
+            const VirtualFileKey key_type,
+            const std::string &key) const override;
+
+        std::unique_ptr<io::File> open(const io::path &path) const override;
+
+        mutable size_t open_calls;
+
+    private:
+        bstr content;
+    };
+}
+
+TestResolver::TestResolver(const bstr &content)
+    : open_calls(0), content(content)
+{
+}
+
+io::path TestResolver::find(
+    const VirtualFileKey key_type, const std::string &key) const
+{
+    if ((key_type == VirtualFileKey::Stem && key == "mask")
+        || (key_type == VirtualFileKey::Name && key == "mask.tga")
+        || (key_type == VirtualFileKey::Path && key == "arc/mask.tga"))
+    {
+        return "arc/mask.tga";
+    }
+    return "";
+}
+
+std::unique_ptr<io::File> TestResolver::open(const io::path &path) const
+{
+    ++open_calls;
+    return std::make_unique<io::File>(path, content);
+}
+
+static void register_stub_file(const io::path &path, const bstr &content)
+{
+    VirtualFileSystem::register_file(
+        path,
+        [=]() { return std::make_unique<io::File>(path, content); });
+}
+
+TEST_CASE("Virtual file system", "[core]")
+{
+    register_stub_file("dir/Palette.PAL", "palette"_b);
+    register_stub_file("dir/mask.bmp", "mask"_b);
+
+    SECTION("Lookups are case insensitive")
+    {
+        auto file = VirtualFileSystem::get_by_stem("PALETTE");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "palette"_b);
+        file = VirtualFileSystem::get_by_name("palette.pal");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "palette"_b);
+        file = VirtualFileSystem::get_by_path("DIR/palette.pal");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "palette"_b);
+    }
+
+    SECTION("Missing files")
+    {
+        REQUIRE(!VirtualFileSystem::get_by_stem("dir"));
+        REQUIRE(!VirtualFileSystem::get_by_name("mask.pal"));
+        REQUIRE(!VirtualFileSystem::get_by_path("mask.bmp"));
+    }
+
+    SECTION("Unregistered files are not found")
+    {
+        VirtualFileSystem::unregister_file("dir/mask.bmp");
+        REQUIRE(!VirtualFileSystem::get_by_stem("mask"));
+        REQUIRE(!VirtualFileSystem::get_by_name("mask.bmp"));
+        REQUIRE(!VirtualFileSystem::get_by_path("dir/mask.bmp"));
+    }
+
+    SECTION("Files sharing a stem")
+    {
+        register_stub_file("dir/mask.png", "mask2"_b);
+        auto file = VirtualFileSystem::get_by_stem("mask");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "mask"_b);
+        VirtualFileSystem::unregister_file("dir/mask.bmp");
+        file = VirtualFileSystem::get_by_stem("mask");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "mask2"_b);
+    }
+
+    SECTION("Disabled file system")
+    {
+        VirtualFileSystem::disable();
+        REQUIRE(!VirtualFileSystem::get_by_stem("palette"));
+        VirtualFileSystem::enable();
+        REQUIRE(VirtualFileSystem::get_by_stem("palette"));
+    }
+
+    SECTION("Files in registered directories")
+    {
+        io::create_directories("vfs_test/sub");
+        io::FileByteStream("vfs_test/sub/Script.TXT", io::FileMode::Write)
+            .write("script"_b);
+        VirtualFileSystem::register_directory("vfs_test");
+        {
+            auto file = VirtualFileSystem::get_by_name("script.txt");
+            REQUIRE(file);
+            REQUIRE(file->stream.read_to_eof() == "script"_b);
+            file = VirtualFileSystem::get_by_stem("SCRIPT");
+            REQUIRE(file);
+            file = VirtualFileSystem::get_by_path("vfs_test/sub/script.txt");
+            REQUIRE(file);
+            REQUIRE(!VirtualFileSystem::get_by_name("sub"));
+        }
+        VirtualFileSystem::unregister_directory("vfs_test");
+        REQUIRE(!VirtualFileSystem::get_by_name("script.txt"));
+        io::remove("vfs_test/sub/Script.TXT");
+        io::remove("vfs_test/sub");
+        io::remove("vfs_test");
+    }
+
+    SECTION("Materialized files are cached")
+    {
+        auto calls = 0;
+        VirtualFileSystem::register_file(
+            "dir/cached.pal",
+            [&]()
+            {
+                ++calls;
+                return std::make_unique<io::File>("dir/cached.pal", "x"_b);
+            });
+        REQUIRE(VirtualFileSystem::get_by_name("cached.pal"));
+        auto file = VirtualFileSystem::get_by_stem("cached");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "x"_b);
+        REQUIRE(file->path.str() == "dir/cached.pal");
+        REQUIRE(calls == 1);
+
+        // files registered again under the same path are materialized anew
+        VirtualFileSystem::register_file(
+            "dir/cached.pal",
+            [&]()
+            {
+                ++calls;
+                return std::make_unique<io::File>("dir/cached.pal", "y"_b);
+            });
+        file = VirtualFileSystem::get_by_path("dir/cached.pal");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "y"_b);
+        REQUIRE(calls == 2);
+
+        VirtualFileSystem::set_cache_size(0);
+        REQUIRE(VirtualFileSystem::get_by_path("dir/cached.pal"));
+        REQUIRE(calls == 3);
+        VirtualFileSystem::set_cache_size(32 * 1024 * 1024);
+    }
+
+    SECTION("Resolvers")
+    {
+        const auto resolver = std::make_shared<TestResolver>();
+        VirtualFileSystem::register_resolver(resolver);
+
+        auto file = VirtualFileSystem::get_by_name("MASK.tga");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "resolved"_b);
+        REQUIRE(VirtualFileSystem::get_by_path("arc/mask.tga"));
+
+        // "arc/mask.tga" sorts before "dir/mask.bmp"
+        file = VirtualFileSystem::get_by_stem("mask");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "resolved"_b);
+
+        VirtualFileSystem::unregister_resolver(resolver);
+        REQUIRE(!VirtualFileSystem::get_by_name("mask.tga"));
+        file = VirtualFileSystem::get_by_stem("mask");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "mask"_b);
+    }
+
+    SECTION("Resolvers registered later win over the same path")
+    {
+        const auto resolver1 = std::make_shared<TestResolver>("first"_b);
+        const auto resolver2 = std::make_shared<TestResolver>("second"_b);
+        VirtualFileSystem::register_resolver(resolver1);
+        auto file = VirtualFileSystem::get_by_path("arc/mask.tga");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "first"_b);
+
+        VirtualFileSystem::register_resolver(resolver2);
+        file = VirtualFileSystem::get_by_path("arc/mask.tga");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "second"_b);
+
+        // files registered under the same path later win as well
+        register_stub_file("arc/mask.tga", "file"_b);
+        file = VirtualFileSystem::get_by_path("arc/mask.tga");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "file"_b);
+        VirtualFileSystem::unregister_file("arc/mask.tga");
+
+        VirtualFileSystem::unregister_resolver(resolver2);
+        file = VirtualFileSystem::get_by_path("arc/mask.tga");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "first"_b);
+        VirtualFileSystem::unregister_resolver(resolver1);
+    }
+
+    SECTION("Same paths of different resolvers are cached separately")
+    {
+        const auto resolver1 = std::make_shared<TestResolver>("first"_b);
+        const auto resolver2 = std::make_shared<TestResolver>("second"_b);
+        VirtualFileSystem::register_resolver(resolver1);
+        REQUIRE(VirtualFileSystem::get_by_path("arc/mask.tga"));
+        VirtualFileSystem::register_resolver(resolver2);
+        REQUIRE(VirtualFileSystem::get_by_path("arc/mask.tga"));
+        REQUIRE(resolver1->open_calls == 1);
+        REQUIRE(resolver2->open_calls == 1);
+
+        // the entry of the first resolver is still cached
+        VirtualFileSystem::unregister_resolver(resolver2);
+        auto file = VirtualFileSystem::get_by_path("arc/mask.tga");
+        REQUIRE(file);
+        REQUIRE(file->stream.read_to_eof() == "first"_b);
+        REQUIRE(resolver1->open_calls == 1);
+
+        // resolvers registered again have their entries materialized anew
+        VirtualFileSystem::unregister_resolver(resolver1);
+        VirtualFileSystem::register_resolver(resolver1);
+        file = VirtualFileSystem::get_by_path("arc/mask.tga");
+        REQUIRE(file);
+        REQUIRE(resolver1->open_calls == 2);
+        VirtualFileSystem::unregister_resolver(resolver1);
+    }
+}